@@ -0,0 +1,39 @@
+# (C) Copyright 1996- ECMWF.
+#
+# This software is licensed under the terms of the Apache Licence Version 2.0
+# which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+# In applying this licence, ECMWF does not waive the privileges and immunities
+# granted to it by virtue of its status as an intergovernmental organisation
+# nor does it submit to any jurisdiction.
+
+# - Try to find liburing, the userspace library for Linux io_uring
+
+# Once done this will define
+#  LIBURING_FOUND        - System has liburing
+#  LIBURING_INCLUDE_DIRS - The liburing include directories
+#  LIBURING_LIBRARIES    - The libraries needed to use liburing
+#
+# The following paths will be searched with priority if set in CMake or env
+#
+#  LIBURING_DIR          - prefix path of the liburing installation
+#  LIBURING_PATH         - prefix path of the liburing installation
+
+find_path( LIBURING_INCLUDE_DIR liburing.h
+           PATHS ${LIBURING_DIR} ${LIBURING_PATH} ENV LIBURING_DIR ENV LIBURING_PATH
+           PATH_SUFFIXES include NO_DEFAULT_PATH )
+
+find_path( LIBURING_INCLUDE_DIR liburing.h PATH_SUFFIXES include )
+
+find_library( LIBURING_LIBRARY NAMES uring
+              PATHS ${LIBURING_DIR} ${LIBURING_PATH} ENV LIBURING_DIR ENV LIBURING_PATH
+              PATH_SUFFIXES lib lib64 NO_DEFAULT_PATH )
+find_library( LIBURING_LIBRARY NAMES uring PATH_SUFFIXES lib lib64 )
+
+set( LIBURING_LIBRARIES    ${LIBURING_LIBRARY} )
+set( LIBURING_INCLUDE_DIRS ${LIBURING_INCLUDE_DIR} )
+
+include(FindPackageHandleStandardArgs)
+
+find_package_handle_standard_args(LIBURING  DEFAULT_MSG LIBURING_LIBRARY LIBURING_INCLUDE_DIR)
+
+mark_as_advanced(LIBURING_INCLUDE_DIR LIBURING_LIBRARY )
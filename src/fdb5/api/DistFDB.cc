@@ -13,11 +13,14 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <algorithm>
 #include <vector>
 #include <thread>
 #include <future>
 
 #include "eckit/config/LocalConfiguration.h"
+#include "eckit/config/Resource.h"
+#include "eckit/container/Queue.h"
 #include "eckit/exception/Exceptions.h"
 #include "eckit/log/Log.h"
 #include "eckit/message/Message.h"
@@ -30,6 +33,7 @@
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/api/helpers/ListIterator.h"
 #include "fdb5/io/HandleGatherer.h"
+#include "fdb5/rules/Schema.h"
 #include "fdb5/LibFdb5.h"
 
 using eckit::Log;
@@ -49,8 +53,157 @@ struct DistributionError : public eckit::Exception {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Archives the fields queued for one lane, in order, in its own thread. If the lane fails before any
+/// data has been written to it, the lane is disabled and the fields are passed on to the next lane in
+/// their order of preference.
+
+class DistFDB::LaneArchiver {
+
+    struct Task {
+        Task() : data_(0) {}
+        Task(const LaneOrder& order, const Key& key, eckit::Buffer&& data) :
+            order_(order), key_(key), data_(std::move(data)) {}
+        explicit Task(const std::shared_ptr<std::promise<void>>& flushed) : data_(0), flushed_(flushed) {}
+
+        LaneOrder order_;
+        Key key_;
+        eckit::Buffer data_;
+        std::shared_ptr<std::promise<void>> flushed_;  ///< Set for a flush of the lane
+    };
+
+public: // methods
+
+    LaneArchiver(DistFDB& dist, size_t index, size_t queueLength) :
+        dist_(dist),
+        index_(index),
+        lane_(dist.lanes_[index]),
+        archivable_(lane_.enabled(ControlIdentifier::Archive)),
+        queue_(queueLength),
+        disabled_(false) {
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~LaneArchiver() {
+        queue_.close();
+        thread_.join();
+    }
+
+    void archive(const LaneOrder& order, const Key& key, eckit::Buffer&& data) {
+        queue_.emplace(Task(order, key, std::move(data)));
+    }
+
+    /// Flush the lane once everything queued so far has been archived
+    std::future<void> flush() {
+        auto flushed = std::make_shared<std::promise<void>>();
+        std::future<void> result = flushed->get_future();
+        queue_.emplace(Task(flushed));
+        return result;
+    }
+
+    // n.b. called from any thread, so these do not touch the lane itself
+
+    bool archivable() const { return archivable_; }
+    bool disabled() const { return disabled_; }
+
+    FDBStats stats() const {
+        std::lock_guard<std::mutex> lock(laneMutex_);
+        return lane_.internalStats();
+    }
+
+private: // methods
+
+    void run() {
+        Task task;
+        while (queue_.pop(task) != -1) {
+            if (task.flushed_) {
+                flushLane(*task.flushed_);
+            } else {
+                archive(task);
+            }
+            task = Task();
+        }
+    }
+
+    void flushLane(std::promise<void>& flushed) {
+        try {
+            std::lock_guard<std::mutex> lock(laneMutex_);
+            lane_.flush();
+            flushed.set_value();
+        } catch (...) {
+            flushed.set_exception(std::current_exception());
+        }
+    }
+
+    void archive(Task& task) {
+
+        try {
+
+            if (!disabled_) {
+                try {
+
+                    std::lock_guard<std::mutex> lock(laneMutex_);
+                    lane_.archive(task.key_, task.data_.data(), task.data_.size());
+                    return;
+
+                } catch (eckit::Exception& e) {
+
+                    // TODO: This will be messy and verbose. Reduce output if it has already failed.
+
+                    std::stringstream ss;
+                    ss << "Archive failure on lane: " << lane_ << " (" << index_ << ")";
+                    eckit::Log::error() << ss.str() << std::endl;
+                    eckit::Log::error() << "with exception: " << e << std::endl;
+
+                    // If we have written, but not flushed, data to a give lane, and an archive operation
+                    // fails, then this is a bit of an issue. Otherwise, just skip the lane.
+
+                    std::lock_guard<std::mutex> lock(laneMutex_);
+
+                    if (lane_.dirty()) {
+                        ss << " -- Exception: " << e;
+                        throw DistributionError(ss.str(), Here());
+                    }
+
+                    // Mark the lane as no longer writable
+                    lane_.disable();
+                    disabled_ = true;
+                }
+            }
+
+            // Pass the field on to the next lane in order
+
+            const std::vector<size_t>& order(*task.order_);
+            size_t next = std::find(order.begin(), order.end(), index_) - order.begin() + 1;
+            dist_.dispatch(task.order_, next, task.key_, std::move(task.data_));
+            ++dist_.rerouted_;
+
+        } catch (...) {
+            dist_.archiveError(std::current_exception());
+        }
+    }
+
+private: // members
+
+    DistFDB& dist_;
+    size_t index_;
+    FDB& lane_;
+    const bool archivable_;          ///< The lane is configured to accept archives
+
+    mutable std::mutex laneMutex_;   ///< Protects the lane, which is otherwise only used by the archiver thread
+    eckit::Queue<Task> queue_;
+    std::atomic<bool> disabled_;
+
+    std::thread thread_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
 DistFDB::DistFDB(const Config& config, const std::string& name) :
-    FDBBase(config, name) {
+    FDBBase(config, name),
+    schema_(nullptr),
+    archiveQueueLength_(config.getInt("archiveQueueLength",
+        eckit::Resource<int>("fdbDistArchiveQueueLength;$FDB_DIST_ARCHIVE_QUEUE_LENGTH", 200))),
+    rerouted_(0) {
 
     ASSERT(config.getString("type", "") == "dist");
 
@@ -68,68 +221,83 @@ DistFDB::DistFDB(const Config& config, const std::string& name) :
     }
 }
 
-DistFDB::~DistFDB() {}
+DistFDB::~DistFDB() {
+
+    // n.b. fields that are still queued are archived (but not flushed) before the lanes are destroyed
+
+    archivers_.clear();
+}
 
 void DistFDB::archive(const Key& key, const void* data, size_t length) {
 
-    std::vector<size_t> laneIndices;
+    checkArchiveErrors();
 
-    //Log::debug<LibFdb5>() << "Number of lanes: " << lanes_.size() << std::endl;
-    //Log::debug<LibFdb5>() << "Lane indices: ";
-    //for (const auto& i : laneIndices) Log::debug<LibFdb5>() << i << ", ";
-    //Log::debug<LibFdb5>() << std::endl;
+    if (archivers_.empty()) {
 
-    hash_.hashOrder(key.keyDict(), laneIndices);
+        // Lanes are chosen per database if we have a schema to identify the database of each field
 
-    //Log::debug<LibFdb5>() << "Number of lanes: " << lanes_.size() << std::endl;
-    //Log::debug<LibFdb5>() << "Lane indices: ";
-    //for (const auto& i : laneIndices) Log::debug<LibFdb5>() << i << ", ";
-    //Log::debug<LibFdb5>() << std::endl;
+        try {
+            schema_ = &config_.schema();
+        } catch (std::exception& e) {
+            Log::debug<LibFdb5>() << "DistFDB: no schema available (" << e.what()
+                                  << "), lanes are chosen for each field" << std::endl;
+        }
+
+        for (size_t i = 0; i < lanes_.size(); ++i) {
+            archivers_.emplace_back(new LaneArchiver(*this, i, archiveQueueLength_));
+        }
+    }
 
-    // Given an order supplied by the Rendezvous hash, try the FDB in order until
-    // one works. n.b. Errors are unacceptable once the FDB is dirty.
     Log::debug<LibFdb5>() << "Attempting dist FDB archive" << std::endl;
 
-    decltype(laneIndices)::const_iterator it = laneIndices.begin();
-    decltype(laneIndices)::const_iterator end = laneIndices.end();
-    for (; it != end; ++it) {
-        size_t idx = *it;
+    dispatch(laneOrder(key), 0, key, eckit::Buffer(static_cast<const char*>(data), length));
+}
 
-        FDB& lane = lanes_[idx];
+DistFDB::LaneOrder DistFDB::laneOrder(const Key& key) {
 
-        if(!lane.enabled(ControlIdentifier::Archive)) {
-            continue;
-        }
-        if (lane.disabled()) {
-            eckit::Log::warning() << "FDB lane " << lane << " is disabled" << std::endl;
-            continue;
-        }
+    // The Rendezvous hash supplies the order in which the lanes are tried. This is the same for all
+    // of the fields of a database, so only needs computing once for each.
 
-        try {
+    Key dbKey;
+    if (schema_ && schema_->expandFirstLevel(key, dbKey)) {
 
-            lane.archive(key, data, length);
-            return;
+        auto it = laneOrders_.find(dbKey);
+        if (it != laneOrders_.end()) {
+            return it->second;
+        }
 
-        } catch (eckit::Exception& e) {
+        auto order = std::make_shared<std::vector<size_t>>();
+        hash_.hashOrder(dbKey.keyDict(), *order);
+        laneOrders_.emplace(dbKey, order);
+        return order;
+    }
 
-            // TODO: This will be messy and verbose. Reduce output if it has already failed.
+    auto order = std::make_shared<std::vector<size_t>>();
+    hash_.hashOrder(key.keyDict(), *order);
+    return order;
+}
 
-            std::stringstream ss;
-            ss << "Archive failure on lane: " << lane << " (" << idx << ")";
-            eckit::Log::error() << ss.str() << std::endl;
-            eckit::Log::error() << "with exception: " << e << std::endl;
+void DistFDB::dispatch(const LaneOrder& order, size_t first, const Key& key, eckit::Buffer&& data) {
 
-            // If we have written, but not flushed, data to a give lane, and an archive operation
-            // fails, then this is a bit of an issue. Otherwise, just skip the lane.
+    // Try the lanes in order until we find one that is writable. n.b. Errors are unacceptable once
+    // the FDB is dirty, which is handled by the LaneArchiver.
 
-            if (lane.dirty()) {
-                ss << " -- Exception: " << e;
-                throw DistributionError(ss.str(), Here());
-            }
+    for (size_t i = first; i < order->size(); ++i) {
+        size_t idx = (*order)[i];
 
-            // Mark the lane as no longer writable
-            lane.disable();
+        // n.b. this may be called by the archiver of another lane, so use the state of the lane recorded
+        //      by its archiver rather than the lane itself
+
+        if (!archivers_[idx]->archivable()) {
+            continue;
+        }
+        if (archivers_[idx]->disabled()) {
+            eckit::Log::warning() << "FDB lane " << idx << " is disabled" << std::endl;
+            continue;
         }
+
+        archivers_[idx]->archive(order, key, std::move(data));
+        return;
     }
 
     Log::error() << "No writable lanes!!!!" << std::endl;
@@ -137,6 +305,24 @@ void DistFDB::archive(const Key& key, const void* data, size_t length) {
     throw DistributionError("No writable lanes available for archive", Here());
 }
 
+void DistFDB::archiveError(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    if (!archiveError_) {
+        archiveError_ = e;
+    }
+}
+
+void DistFDB::checkArchiveErrors() {
+    std::exception_ptr e;
+    {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        std::swap(e, archiveError_);
+    }
+    if (e) {
+        std::rethrow_exception(e);
+    }
+}
+
 /*
  * Exemplar for templated query functionality:
  *
@@ -227,6 +413,14 @@ PurgeIterator DistFDB::purge(const FDBToolRequest& request, bool doit, bool porc
     });
 }
 
+CompactIterator DistFDB::compact(const FDBToolRequest& request, bool doit, bool porcelain) {
+    Log::debug<LibFdb5>() << "DistFDB::compact() : " << request << std::endl;
+    return queryInternal(request,
+                         [doit, porcelain](FDB& fdb, const FDBToolRequest& request) {
+                            return fdb.compact(request, doit, porcelain);
+    });
+}
+
 StatsIterator DistFDB::stats(const FDBToolRequest &request) {
     Log::debug<LibFdb5>() << "DistFDB::stats() : " << request << std::endl;
     return queryInternal(request,
@@ -256,19 +450,56 @@ MoveIterator DistFDB::move(const FDBToolRequest& request, const eckit::URI& dest
 
 void DistFDB::flush() {
 
-    std::vector<std::future<void>> futures;
+    if (archivers_.empty()) {
 
-    for (FDB& lane : lanes_) {
-        futures.emplace_back(std::async(std::launch::async, [&lane] {
-            lane.flush();
-        }));
+        std::vector<std::future<void>> futures;
+
+        for (FDB& lane : lanes_) {
+            futures.emplace_back(std::async(std::launch::async, [&lane] {
+                lane.flush();
+            }));
+        }
+
+        for (std::future<void>& f : futures) {
+            f.get();
+        }
+        return;
     }
+
+    // Flush all of the lanes once the fields queued on them have been archived. If a lane failed during
+    // the flush, its fields may have been passed on to a lane that had already flushed, so go round again.
+
+    size_t rerouted;
+    do {
+        rerouted = rerouted_;
+
+        std::vector<std::future<void>> futures;
+        for (auto& archiver : archivers_) {
+            futures.emplace_back(archiver->flush());
+        }
+
+        for (std::future<void>& f : futures) {
+            try {
+                f.get();
+            } catch (...) {
+                archiveError(std::current_exception());
+            }
+        }
+    } while (rerouted != rerouted_);
+
+    checkArchiveErrors();
 }
 
 FDBStats DistFDB::stats() const {
     FDBStats s;
-    for (const auto& lane : lanes_) {
-        s += lane.internalStats();
+    if (archivers_.empty()) {
+        for (const auto& lane : lanes_) {
+            s += lane.internalStats();
+        }
+    } else {
+        for (const auto& archiver : archivers_) {
+            s += archiver->stats();
+        }
     }
     return s;
 }
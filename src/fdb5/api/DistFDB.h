@@ -19,18 +19,30 @@
 #ifndef fdb5_api_DistFDB_H
 #define fdb5_api_DistFDB_H
 
+#include <atomic>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include "fdb5/api/FDB.h"
 #include "fdb5/api/FDBFactory.h"
 
+#include "eckit/io/Buffer.h"
 #include "eckit/utils/RendezvousHash.h"
 
 
 namespace fdb5 {
 
 class FDB;
+class Schema;
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Distributes the archived fields over a number of lanes (FDBs), chosen by a rendezvous hash of the database
+/// key. Each lane is fed through its own bounded queue by a worker thread, so that a slow lane does not hold
+/// up archiving to the others. Errors in the lanes are reported by a subsequent archive() or flush().
 
 class DistFDB : public FDBBase {
 
@@ -55,6 +67,8 @@ public: // method
 
     PurgeIterator purge(const FDBToolRequest& request, bool doit, bool porcelain) override;
 
+    CompactIterator compact(const FDBToolRequest& request, bool doit, bool porcelain) override;
+
     StatsIterator stats(const FDBToolRequest& request) override;
 
     ControlIterator control(const FDBToolRequest& request,
@@ -67,10 +81,24 @@ public: // method
 
     FDBStats stats() const override;
 
+private: // types
+
+    class LaneArchiver;
+    using LaneOrder = std::shared_ptr<const std::vector<size_t>>;
+
 private: // methods
 
     virtual void print(std::ostream& s) const override;
 
+    /// The lanes to try for a field, in order of preference
+    LaneOrder laneOrder(const Key& key);
+
+    /// Queue a field on the first usable lane, starting from the given position in the order
+    void dispatch(const LaneOrder& order, size_t first, const Key& key, eckit::Buffer&& data);
+
+    void archiveError(std::exception_ptr e);
+    void checkArchiveErrors();
+
     template <typename QueryFN>
     auto queryInternal(const FDBToolRequest& request, const QueryFN& fn) -> decltype(fn(*(FDB*)(nullptr), request));
 
@@ -79,6 +107,19 @@ private:
     eckit::RendezvousHash hash_;
 
     std::vector<FDB> lanes_;
+
+    // The schema is used to choose lanes per database. Without one, lanes are chosen for each field.
+    const Schema* schema_;
+    std::map<Key, LaneOrder> laneOrders_;
+
+    // Created on the first archive()
+    size_t archiveQueueLength_;
+    std::vector<std::unique_ptr<LaneArchiver>> archivers_;
+
+    std::atomic<size_t> rerouted_;   ///< Fields moved to another lane after a lane failed
+
+    std::mutex errorMutex_;
+    std::exception_ptr archiveError_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -13,10 +13,13 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <chrono>
+
 #include "eckit/config/Resource.h"
 #include "eckit/io/DataHandle.h"
 #include "eckit/io/MemoryHandle.h"
 #include "eckit/log/Log.h"
+#include "eckit/log/Timer.h"
 #include "eckit/message/Message.h"
 #include "eckit/message/Reader.h"
 
@@ -27,7 +30,9 @@
 #include "fdb5/api/FDBFactory.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/database/Key.h"
+#include "fdb5/io/FieldHandle.h"
 #include "fdb5/io/HandleGatherer.h"
+#include "fdb5/io/LocationBatcher.h"
 #include "fdb5/message/MessageDecoder.h"
 
 namespace fdb5 {
@@ -37,6 +42,7 @@ namespace fdb5 {
 FDB::FDB(const Config &config) :
     internal_(FDBFactory::instance().build(config)),
     dirty_(false),
+    flushing_(false),
     reportStats_(config.getBool("statistics", false)) {}
 
 
@@ -96,32 +102,73 @@ void FDB::archive(const metkit::mars::MarsRequest& request, eckit::DataHandle& h
     }
 }
 
+static Key stripStepUnits(const Key& key) {
+
+    auto stepunit = key.find("stepunits");
+    ASSERT(stepunit != key.end());
+
+    Key k;
+    for (auto it : key) {
+        if (it.first == "step" && stepunit->second.size()>0 && stepunit->second[0]!='h') {
+            // TODO - enable canonical representation of step (as soon as Metkit supports it)
+            std::string canonicalStep = it.second+stepunit->second; // k.registry().lookupType("step").toKey("step", it.second+stepunit->second);
+            k.set(it.first, canonicalStep);
+        } else {
+            if (it.first != "stepunits") {
+                k.set(it.first, it.second);
+            }
+        }
+    }
+    return k;
+}
+
 void FDB::archive(const Key& key, const void* data, size_t length) {
     eckit::Timer timer;
     timer.start();
 
-    auto stepunit = key.find("stepunits");
-    if (stepunit != key.end()) {
-        Key k;
-        for (auto it : key) {
-            if (it.first == "step" && stepunit->second.size()>0 && stepunit->second[0]!='h') {
-                // TODO - enable canonical representation of step (as soon as Metkit supports it)
-                std::string canonicalStep = it.second+stepunit->second; // k.registry().lookupType("step").toKey("step", it.second+stepunit->second);
-                k.set(it.first, canonicalStep);
+    if (key.find("stepunits") != key.end()) {
+        internal_->archive(stripStepUnits(key), data, length);
+    } else {
+        internal_->archive(key, data, length);
+    }
+    dirty_ = true;
+
+    timer.stop();
+    stats_.addArchive(length, timer);
+}
+
+void FDB::archive(const std::vector<ArchiveElement>& elements) {
+
+    if (elements.empty()) return;
+
+    eckit::Timer timer;
+    timer.start();
+
+    size_t length = 0;
+    bool stepunits = false;
+    for (const ArchiveElement& element : elements) {
+        length += element.length_;
+        stepunits = stepunits || (element.key_.find("stepunits") != element.key_.end());
+    }
+
+    if (stepunits) {
+        std::vector<ArchiveElement> canonical;
+        canonical.reserve(elements.size());
+        for (const ArchiveElement& element : elements) {
+            if (element.key_.find("stepunits") != element.key_.end()) {
+                canonical.emplace_back(stripStepUnits(element.key_), element.data_, element.length_);
             } else {
-                if (it.first != "stepunits") {
-                    k.set(it.first, it.second);
-                }
+                canonical.push_back(element);
             }
         }
-        internal_->archive(k, data, length);
+        internal_->archive(canonical);
     } else {
-        internal_->archive(key, data, length);
+        internal_->archive(elements);
     }
     dirty_ = true;
 
     timer.stop();
-    stats_.addArchive(length, timer);
+    stats_.addArchive(length, timer, elements.size());
 }
 
 bool FDB::sorted(const metkit::mars::MarsRequest &request) {
@@ -168,10 +215,22 @@ eckit::DataHandle* FDB::read(ListIterator& it, bool sorted) {
     eckit::Timer timer;
     timer.start();
 
+    static bool dedup = eckit::Resource<bool>("fdbDeduplicate;$FDB_DEDUPLICATE_FIELDS", false);
+
+    // Sorting and deduplication need to see all of the fields before any data can be read. Otherwise
+    // the data handle may pull fields from the iterator as it is read.
+
+    static bool streamingRead = eckit::Resource<bool>("fdbStreamingRead;$FDB_STREAMING_READ", false);
+    static size_t streamingReadBatch = eckit::Resource<size_t>("fdbStreamingReadBatch;$FDB_STREAMING_READ_BATCH", 1024);
+
+    if (streamingRead && !sorted && !dedup) {
+        return new FieldHandle(std::move(it), streamingReadBatch);
+    }
+
     HandleGatherer result(sorted);
+    LocationBatcher batcher(result);
     ListElement el;
 
-    static bool dedup = eckit::Resource<bool>("fdbDeduplicate;$FDB_DEDUPLICATE_FIELDS", false);
     if (dedup) {
         if (it.next(el)) {
             // build the request representing the tensor-product of all retrieved fields
@@ -202,16 +261,18 @@ eckit::DataHandle* FDB::read(ListIterator& it, bool sorted) {
             for (size_t i=0; i< cube.size(); i++) {
                 ListElement element;
                 if (cube.find(i, element)) {
-                    result.add(element.location().dataHandle());
+                    batcher.add(element.sharedLocation());
                 }
             }
         }
     }
     else {
         while (it.next(el)) {
-            result.add(el.location().dataHandle());
+            batcher.add(el.sharedLocation());
         }
     }
+
+    batcher.flush();
     return result.dataHandle();
 }
 
@@ -244,6 +305,10 @@ PurgeIterator FDB::purge(const FDBToolRequest &request, bool doit, bool porcelai
     return internal_->purge(request, doit, porcelain);
 }
 
+CompactIterator FDB::compact(const FDBToolRequest &request, bool doit, bool porcelain) {
+    return internal_->compact(request, doit, porcelain);
+}
+
 StatsIterator FDB::stats(const FDBToolRequest &request) {
     return internal_->stats(request);
 }
@@ -261,7 +326,14 @@ MoveIterator FDB::move(const FDBToolRequest& request, const eckit::URI& dest) {
 }
 
 FDBStats FDB::stats() const {
-    return stats_;
+
+    // A background flush is counted once it has completed, whether or not it has been waited for
+
+    FDBStats stats(stats_);
+    if (asyncFlush_.valid() && asyncFlush_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        stats.addFlush(*asyncFlushTimer_);
+    }
+    return stats;
 }
 
 FDBStats FDB::internalStats() const {
@@ -280,20 +352,58 @@ void FDB::print(std::ostream& s) const {
     s << *internal_;
 }
 
+void FDB::waitAsyncFlush() {
+    if (asyncFlush_.valid()) {
+        asyncFlush_.wait();
+        stats_.addFlush(*asyncFlushTimer_);
+        asyncFlush_ = std::shared_future<void>();
+        asyncFlushTimer_.reset();
+    }
+}
+
 void FDB::flush() {
-    if (dirty_) {
+    if (dirty_ || flushing_) {
+
+        // n.b. any error in the background flush is rethrown by the internal flush
+
+        waitAsyncFlush();
 
         eckit::Timer timer;
         timer.start();
 
         internal_->flush();
         dirty_ = false;
+        flushing_ = false;
 
         timer.stop();
         stats_.addFlush(timer);
     }
 }
 
+std::shared_future<void> FDB::flushAsync() {
+    if (dirty_) {
+
+        waitAsyncFlush();
+
+        std::shared_ptr<eckit::Timer> timer(new eckit::Timer);
+        timer->start();
+
+        // The flush is timed up to its completion in the background. n.b. the timer is stopped before the
+        // future completes, so is not read until then.
+
+        asyncFlush_ = internal_->flushAsync([timer] { timer->stop(); });
+        asyncFlushTimer_ = timer;
+        dirty_ = false;
+        flushing_ = true;
+
+        return asyncFlush_;
+    }
+
+    std::promise<void> done;
+    done.set_value();
+    return done.get_future().share();
+}
+
 bool FDB::dirty() const {
     return dirty_;
 }
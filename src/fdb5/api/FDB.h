@@ -19,12 +19,15 @@
 #ifndef fdb5_api_FDB_H
 #define fdb5_api_FDB_H
 
+#include <future>
 #include <memory>
 #include <iosfwd>
 
 #include "eckit/distributed/Transport.h"
 
 #include "fdb5/api/FDBStats.h"
+#include "fdb5/api/helpers/ArchiveElement.h"
+#include "fdb5/api/helpers/CompactIterator.h"
 #include "fdb5/api/helpers/ControlIterator.h"
 #include "fdb5/api/helpers/DumpIterator.h"
 #include "fdb5/api/helpers/ListIterator.h"
@@ -40,6 +43,7 @@ namespace message {
 class Message;
 }
 class DataHandle;
+class Timer;
 }  // namespace eckit
 
 namespace metkit { class MarsRequest; }
@@ -76,15 +80,28 @@ public: // methods
     void archive(const metkit::mars::MarsRequest& request, eckit::DataHandle& handle);
     // disclaimer: this is a low-level API. The provided key and the corresponding data are not checked for consistency
     void archive(const Key& key, const void* data, size_t length);
+    /// Archive a batch of fields, amortising the schema lookups and writing the fields of each index together
+    /// @note as above, the keys and the corresponding data are not checked for consistency
+    void archive(const std::vector<ArchiveElement>& elements);
 
     /// Flushes all buffers and closes all data handles into a consistent DB state
     /// @note always safe to call
     void flush();
 
+    /// Starts a flush in the background, and returns as soon as the following archives can proceed. These
+    /// are written into new data files and indexes. The returned future completes once the data flushed is
+    /// durable and its indexes are published, and rethrows any error in doing so.
+    /// @note only one flush is in progress at a time, so this first waits for any previous one
+    /// @note flush() waits for any flushes still in progress
+    /// @note flushes are timed (see stats()) until their future completes
+    std::shared_future<void> flushAsync();
+
     eckit::DataHandle* read(const eckit::URI& uri);
 
     eckit::DataHandle* read(const std::vector<eckit::URI>& uris, bool sorted = false);
 
+    /// @note with fdbStreamingRead enabled (and neither sorting nor deduplication) the iterator is moved
+    ///       into the returned handle, and fields are pulled from it as the data is read
     eckit::DataHandle* read(ListIterator& it, bool sorted = false);
 
     eckit::DataHandle* retrieve(const metkit::mars::MarsRequest& request);
@@ -104,6 +121,10 @@ public: // methods
 
     PurgeIterator purge(const FDBToolRequest& request, bool doit=false, bool porcelain=false);
 
+    /// Rewrite the fields that are still reachable from sparsely used data files into new data files, and
+    /// replace the indexes that refer to them. The old data files are left to be removed by purge.
+    CompactIterator compact(const FDBToolRequest& request, bool doit=false, bool porcelain=false);
+
     StatsIterator stats(const FDBToolRequest& request);
 
     ControlIterator control(const FDBToolRequest& request,
@@ -138,14 +159,21 @@ private: // methods
 
     bool sorted(const metkit::mars::MarsRequest &request);
 
+    /// Wait for the flushAsync() in progress, if any, and record its time
+    void waitAsyncFlush();
+
 private: // members
 
     std::unique_ptr<FDBBase> internal_;
 
     bool dirty_;
+    bool flushing_;  ///< A flushAsync() may still be in progress
     bool reportStats_;
 
     FDBStats stats_;
+
+    std::shared_future<void> asyncFlush_;            ///< Completes once the last flushAsync() has been timed
+    std::shared_ptr<eckit::Timer> asyncFlushTimer_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -56,6 +56,26 @@ FDBBase::FDBBase(const Config& config, const std::string& name) :
 
 FDBBase::~FDBBase() {}
 
+void FDBBase::archive(const std::vector<ArchiveElement>& elements) {
+    for (const ArchiveElement& element : elements) {
+        archive(element.key_, element.data_, element.length_);
+    }
+}
+
+std::shared_future<void> FDBBase::flushAsync(const std::function<void()>& done) {
+    std::promise<void> flushed;
+    try {
+        flush();
+        flushed.set_value();
+    } catch (...) {
+        flushed.set_exception(std::current_exception());
+    }
+    if (done) {
+        done();
+    }
+    return flushed.get_future().share();
+}
+
 std::string FDBBase::id() const {
     std::stringstream ss;
     ss << config_;
@@ -19,6 +19,8 @@
 #ifndef fdb5_api_FDBFactory_H
 #define fdb5_api_FDBFactory_H
 
+#include <functional>
+#include <future>
 #include <memory>
 
 #include "eckit/distributed/Transport.h"
@@ -28,6 +30,7 @@
 #include "fdb5/database/DB.h"
 #include "fdb5/config/Config.h"
 #include "fdb5/api/FDBStats.h"
+#include "fdb5/api/helpers/ArchiveElement.h"
 #include "fdb5/api/helpers/ListIterator.h"
 #include "fdb5/api/helpers/ListIterator.h"
 #include "fdb5/api/helpers/ControlIterator.h"
@@ -35,6 +38,7 @@
 #include "fdb5/api/helpers/WipeIterator.h"
 #include "fdb5/api/helpers/MoveIterator.h"
 #include "fdb5/api/helpers/PurgeIterator.h"
+#include "fdb5/api/helpers/CompactIterator.h"
 #include "fdb5/api/helpers/StatsIterator.h"
 #include "fdb5/api/helpers/StatusIterator.h"
 
@@ -66,8 +70,15 @@ public: // methods
 
     virtual void archive(const Key& key, const void* data, size_t length) = 0;
 
+    /// By default, the fields of a batch are archived one at a time
+    virtual void archive(const std::vector<ArchiveElement>& elements);
+
     virtual void flush() = 0;
 
+    /// By default, the flush is synchronous
+    /// @param done Called once the flush has completed, before the returned future completes
+    virtual std::shared_future<void> flushAsync(const std::function<void()>& done);
+
     virtual ListIterator inspect(const metkit::mars::MarsRequest& request) = 0;
 
     virtual ListIterator list(const FDBToolRequest& request) = 0;
@@ -80,6 +91,8 @@ public: // methods
 
     virtual PurgeIterator purge(const FDBToolRequest& request, bool doit, bool porcelain) = 0;
 
+    virtual CompactIterator compact(const FDBToolRequest& request, bool doit, bool porcelain) = 0;
+
     virtual StatsIterator stats(const FDBToolRequest& request) = 0;
 
     virtual ControlIterator control(const FDBToolRequest& request,
@@ -19,6 +19,8 @@
 #include "eckit/log/Seconds.h"
 #include "eckit/log/Bytes.h"
 
+#include <algorithm>
+
 #include "fdb5/api/FDBStats.h"
 #include "fdb5/LibFdb5.h"
 
@@ -40,7 +42,17 @@ FDBStats::FDBStats() :
     elapsedRetrieve_(0),
     sumArchiveTimingSquared_(0),
     sumRetrieveTimingSquared_(0),
-    sumFlushTimingSquared_(0) {}
+    sumFlushTimingSquared_(0),
+    numCompressed_(0),
+    numDecompressed_(0),
+    bytesUncompressed_(0),
+    bytesCompressed_(0),
+    cpuCompress_(0),
+    cpuDecompress_(0),
+    cacheHits_(0),
+    cacheMisses_(0),
+    cacheRefreshes_(0),
+    cacheEvictions_(0) {}
 
 
 FDBStats::~FDBStats() {}
@@ -60,6 +72,23 @@ FDBStats& FDBStats::operator+=(const FDBStats& rhs) {
     sumArchiveTimingSquared_ += rhs.sumArchiveTimingSquared_;
     sumRetrieveTimingSquared_ += rhs.sumRetrieveTimingSquared_;
     sumFlushTimingSquared_ += rhs.sumFlushTimingSquared_;
+    numCompressed_ += rhs.numCompressed_;
+    numDecompressed_ += rhs.numDecompressed_;
+    bytesUncompressed_ += rhs.bytesUncompressed_;
+    bytesCompressed_ += rhs.bytesCompressed_;
+    cpuCompress_ += rhs.cpuCompress_;
+    cpuDecompress_ += rhs.cpuDecompress_;
+    cacheHits_ = std::max(cacheHits_, rhs.cacheHits_);
+    cacheMisses_ = std::max(cacheMisses_, rhs.cacheMisses_);
+    cacheRefreshes_ = std::max(cacheRefreshes_, rhs.cacheRefreshes_);
+    cacheEvictions_ = std::max(cacheEvictions_, rhs.cacheEvictions_);
+    writeBuffers_.budget_ = std::max(writeBuffers_.budget_, rhs.writeBuffers_.budget_);
+    writeBuffers_.used_ = std::max(writeBuffers_.used_, rhs.writeBuffers_.used_);
+    writeBuffers_.peak_ = std::max(writeBuffers_.peak_, rhs.writeBuffers_.peak_);
+    writeBuffers_.buffers_ = std::max(writeBuffers_.buffers_, rhs.writeBuffers_.buffers_);
+    writeBuffers_.reserved_ = std::max(writeBuffers_.reserved_, rhs.writeBuffers_.reserved_);
+    writeBuffers_.reclaimed_ = std::max(writeBuffers_.reclaimed_, rhs.writeBuffers_.reclaimed_);
+    writeBuffers_.refused_ = std::max(writeBuffers_.refused_, rhs.writeBuffers_.refused_);
     return *this;
 }
 
@@ -115,6 +144,33 @@ void FDBStats::addFlush(eckit::Timer& timer) {
 }
 
 
+void FDBStats::addCompression(size_t count, size_t bytesIn, size_t bytesOut, double cpuTime) {
+    numCompressed_ += count;
+    bytesUncompressed_ += bytesIn;
+    bytesCompressed_ += bytesOut;
+    cpuCompress_ += cpuTime;
+}
+
+
+void FDBStats::addDecompression(size_t count, double cpuTime) {
+    numDecompressed_ += count;
+    cpuDecompress_ += cpuTime;
+}
+
+
+void FDBStats::catalogueCache(size_t hits, size_t misses, size_t refreshes, size_t evictions) {
+    cacheHits_ = hits;
+    cacheMisses_ = misses;
+    cacheRefreshes_ = refreshes;
+    cacheEvictions_ = evictions;
+}
+
+
+void FDBStats::writeBuffers(const WriteBufferPoolStats& stats) {
+    writeBuffers_ = stats;
+}
+
+
 void FDBStats::report(std::ostream& out, const char* prefix) const {
 
     // Archive statistics
@@ -135,6 +191,41 @@ void FDBStats::report(std::ostream& out, const char* prefix) const {
 
     reportCount(out, "num flush", numFlush_, prefix);
     reportTimeStats(out, "flush time", numFlush_, elapsedFlush_, sumFlushTimingSquared_, prefix);
+
+    // Compression of network traffic
+
+    if (numCompressed_ != 0 || numDecompressed_ != 0) {
+        reportCount(out, "num compressed", numCompressed_, prefix);
+        reportBytes(out, "bytes before compression", bytesUncompressed_, prefix);
+        reportBytes(out, "bytes after compression", bytesCompressed_, prefix);
+        if (bytesCompressed_ != 0) {
+            out << prefix << "compression ratio: " << double(bytesUncompressed_) / bytesCompressed_ << std::endl;
+        }
+        out << prefix << "compression cpu time: " << Seconds(cpuCompress_) << std::endl;
+        reportCount(out, "num decompressed", numDecompressed_, prefix);
+        out << prefix << "decompression cpu time: " << Seconds(cpuDecompress_) << std::endl;
+    }
+
+    // Catalogue cache (shared by the whole process)
+
+    if (cacheHits_ != 0 || cacheMisses_ != 0) {
+        reportCount(out, "catalogue cache hits", cacheHits_, prefix);
+        reportCount(out, "catalogue cache misses", cacheMisses_, prefix);
+        reportCount(out, "catalogue cache refreshes", cacheRefreshes_, prefix);
+        reportCount(out, "catalogue cache evictions", cacheEvictions_, prefix);
+    }
+
+    // Write buffer pool (shared by the whole process)
+
+    if (writeBuffers_.reserved_ != 0 || writeBuffers_.refused_ != 0) {
+        reportBytes(out, "write buffer budget", writeBuffers_.budget_, prefix);
+        reportBytes(out, "write buffers in use", writeBuffers_.used_, prefix);
+        reportBytes(out, "write buffers peak", writeBuffers_.peak_, prefix);
+        reportCount(out, "write buffers held", writeBuffers_.buffers_, prefix);
+        reportCount(out, "write buffers reserved", writeBuffers_.reserved_, prefix);
+        reportCount(out, "write buffers reclaimed", writeBuffers_.reclaimed_, prefix);
+        reportCount(out, "write buffers refused", writeBuffers_.refused_, prefix);
+    }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -24,6 +24,8 @@
 
 #include "eckit/log/Statistics.h"
 
+#include "fdb5/io/WriteBufferPool.h"
+
 
 namespace fdb5 {
 
@@ -42,6 +44,17 @@ public:
     void addRetrieve(size_t length, eckit::Timer& timer);
     void addFlush(eckit::Timer& timer);
 
+    /// Compression of data sent over the network, and the CPU time it used
+    void addCompression(size_t count, size_t bytesIn, size_t bytesOut, double cpuTime);
+    void addDecompression(size_t count, double cpuTime);
+
+    /// Process-wide catalogue cache counters. These are snapshots rather than increments, so are combined
+    /// by taking the largest.
+    void catalogueCache(size_t hits, size_t misses, size_t refreshes, size_t evictions);
+
+    /// Process-wide write buffer pool occupancy and counters. Also snapshots, combined by taking the largest.
+    void writeBuffers(const WriteBufferPoolStats& stats);
+
     void report(std::ostream& out, const char* indent) const;
 
     FDBStats& operator+=(const FDBStats& rhs);
@@ -65,6 +78,21 @@ private: // members
     double sumArchiveTimingSquared_;
     double sumRetrieveTimingSquared_;
     double sumFlushTimingSquared_;
+
+    size_t numCompressed_;
+    size_t numDecompressed_;
+    size_t bytesUncompressed_;
+    size_t bytesCompressed_;
+
+    double cpuCompress_;
+    double cpuDecompress_;
+
+    size_t cacheHits_;
+    size_t cacheMisses_;
+    size_t cacheRefreshes_;
+    size_t cacheEvictions_;
+
+    WriteBufferPoolStats writeBuffers_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -26,9 +26,16 @@
 #include "fdb5/database/Index.h"
 #include "fdb5/database/Inspector.h"
 #include "fdb5/database/Key.h"
+#include "fdb5/io/WriteBufferPool.h"
 #include "fdb5/rules/Schema.h"
 #include "fdb5/LibFdb5.h"
+#include "fdb5/fdb5_config.h"
 
+#if defined(fdb5_HAVE_TOCFDB)
+#include "fdb5/toc/TocCatalogueCache.h"
+#endif
+
+#include "fdb5/api/local/CompactVisitor.h"
 #include "fdb5/api/local/ControlVisitor.h"
 #include "fdb5/api/local/DumpVisitor.h"
 #include "fdb5/api/local/ListVisitor.h"
@@ -55,6 +62,16 @@ void LocalFDB::archive(const Key& key, const void* data, size_t length) {
     archiver_->archive(key, data, length);
 }
 
+void LocalFDB::archive(const std::vector<ArchiveElement>& elements) {
+
+    if (!archiver_) {
+        Log::debug<LibFdb5>() << *this << ": Constructing new archiver" << std::endl;
+        archiver_.reset(new Archiver(config_));
+    }
+
+    archiver_->archive(elements);
+}
+
 ListIterator LocalFDB::inspect(const metkit::mars::MarsRequest &request) {
 
     if (!inspector_) {
@@ -74,8 +91,16 @@ APIIterator<typename VisitorType::ValueType> LocalFDB::queryInternal(const FDBTo
 
     auto async_worker = [this, request, args...] (Queue<ValueType>& queue) {
         EntryVisitMechanism mechanism(config_);
-        VisitorType visitor(queue, request.request(), args...);
-        mechanism.visit(request, visitor);
+        if (VisitorType::concurrent && mechanism.threads() > 1) {
+            auto ctor = [&request, args...] (Queue<ValueType>& q) -> EntryVisitor* {
+                return new VisitorType(q, request.request(), args...);
+            };
+            QueryVisitorBuilder<ValueType> builder(queue, ctor, mechanism.ordered());
+            mechanism.visit(request, builder);
+        } else {
+            VisitorType visitor(queue, request.request(), args...);
+            mechanism.visit(request, visitor);
+        }
     };
 
     return QueryIterator(new AsyncIterator(async_worker));
@@ -111,6 +136,29 @@ PurgeIterator LocalFDB::purge(const FDBToolRequest& request, bool doit, bool por
     return queryInternal<fdb5::api::local::PurgeVisitor>(request, doit, porcelain);
 }
 
+CompactIterator LocalFDB::compact(const FDBToolRequest& request, bool doit, bool porcelain) {
+    Log::debug<LibFdb5>() << "LocalFDB::compact() : " << request << std::endl;
+    return queryInternal<CompactVisitor>(request, doit, porcelain);
+}
+
+FDBStats LocalFDB::stats() const {
+
+    FDBStats stats;
+
+#if defined(fdb5_HAVE_TOCFDB)
+    const TocCatalogueCache& cache(TocCatalogueCache::instance());
+    if (cache.enabled()) {
+        TocCatalogueCacheStats s = cache.statistics();
+        Log::debug<LibFdb5>() << "LocalFDB::stats() : " << s << std::endl;
+        stats.catalogueCache(s.hits_, s.misses_, s.refreshes_, s.evictions_);
+    }
+#endif
+
+    stats.writeBuffers(WriteBufferPool::instance().statistics());
+
+    return stats;
+}
+
 StatsIterator LocalFDB::stats(const FDBToolRequest& request) {
     Log::debug<LibFdb5>() << "LocalFDB::stats() : " << request << std::endl;
     return queryInternal<StatsVisitor>(request);
@@ -129,6 +177,13 @@ void LocalFDB::flush() {
     }
 }
 
+std::shared_future<void> LocalFDB::flushAsync(const std::function<void()>& done) {
+    if (archiver_) {
+        return archiver_->flushAsync(done);
+    }
+    return FDBBase::flushAsync(done);
+}
+
 
 void LocalFDB::print(std::ostream &s) const {
     s << "LocalFDB(home=" << config_.expandPath("~fdb") << ")";
@@ -37,8 +37,12 @@ public: // methods
     using FDBBase::FDBBase;
     using FDBBase::stats;
 
+    FDBStats stats() const override;
+
     void archive(const Key& key, const void* data, size_t length) override;
 
+    void archive(const std::vector<ArchiveElement>& elements) override;
+
     ListIterator inspect(const metkit::mars::MarsRequest& request) override;
 
     ListIterator list(const FDBToolRequest& request) override;
@@ -51,6 +55,8 @@ public: // methods
 
     PurgeIterator purge(const FDBToolRequest& request, bool doit, bool porcelain) override;
 
+    CompactIterator compact(const FDBToolRequest& request, bool doit, bool porcelain) override;
+
     StatsIterator stats(const FDBToolRequest& request) override;
 
     ControlIterator control(const FDBToolRequest& request,
@@ -61,6 +67,8 @@ public: // methods
 
     void flush() override;
 
+    std::shared_future<void> flushAsync(const std::function<void()>& done) override;
+
 private: // methods
 
     void print(std::ostream& s) const override;
@@ -13,28 +13,32 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <algorithm>
 #include <functional>
+#include <limits>
 #include <unistd.h>
 
 #include "fdb5/api/RemoteFDB.h"
 #include "fdb5/LibFdb5.h"
 #include "fdb5/io/HandleGatherer.h"
+#include "fdb5/remote/ClientConnection.h"
 #include "fdb5/remote/Messages.h"
 #include "fdb5/remote/RemoteFieldLocation.h"
+#include "fdb5/remote/SocketWrite.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/database/Key.h"
 
 #include "eckit/config/LocalConfiguration.h"
 #include "eckit/io/Buffer.h"
+#include "eckit/io/ResizableBuffer.h"
 #include "eckit/log/Bytes.h"
 #include "eckit/log/Log.h"
 #include "eckit/message/Message.h"
 #include "eckit/distributed/Transport.h"
 #include "eckit/config/Resource.h"
 #include "eckit/serialisation/MemoryStream.h"
-#include "eckit/utils/Translator.h"
+#include "eckit/serialisation/ResizableMemoryStream.h"
 #include "eckit/runtime/Main.h"
-#include "eckit/os/BackTrace.h"
 
 #include "metkit/mars/MarsRequest.h"
 
@@ -43,86 +47,33 @@ using namespace eckit::net;
 using namespace fdb5::remote;
 
 
-namespace eckit {
-template<> struct Translator<Endpoint, std::string> {
-    std::string operator()(const net::Endpoint& e) {
-        std::stringstream ss;
-        ss << e;
-        return ss.str();
-    }
-};
-}
-
 namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
-class ConnectionError : public eckit::Exception {
-public:
-    ConnectionError(const int);
-    ConnectionError(const int, const eckit::net::Endpoint&);
-
-    bool retryOnClient() const override { return true; } 
-};
-
-ConnectionError::ConnectionError(const int retries) {
-    std::ostringstream s;
-    s << "Unable to create a connection with the FDB server after " << retries << " retries";
-    reason(s.str());
-    Log::status() << what() << std::endl;
-}
-
-ConnectionError::ConnectionError(const int retries, const eckit::net::Endpoint& endpoint) {
-    std::ostringstream s;
-    s << "Unable to create a connection with the FDB endpoint " << endpoint << " after " << retries << " retries";
-    reason(s.str());
-    Log::status() << what() << std::endl;
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-
-namespace {
-class TCPException : public Exception {
-public:
-    TCPException(const std::string& msg, const CodeLocation& here) :
-        Exception(std::string("TCPException: ") + msg, here) {
-
-        eckit::Log::error() << "TCP Exception; backtrace(): " << std::endl;
-        eckit::Log::error() << eckit::BackTrace::dump() << std::endl;
-    }
-};
-}
-
-class RemoteFDBException : public RemoteException {
-public:
-    RemoteFDBException(const std::string& msg, const net::Endpoint& endpoint):
-        RemoteException(msg, eckit::Translator<Endpoint, std::string>()(endpoint)) {}
-};
-
-//----------------------------------------------------------------------------------------------------------------------
-
-// n.b. if we get integer overflow, we reuse the IDs. This is not a
-//      big deal. The idea that we could be on the 2.1 billionth (successful)
-//      request, and still have an ongoing request 0 is ... laughable.
-
-static uint32_t generateRequestID() {
-
-    static std::mutex m;
-    static uint32_t id = 0;
-
-    std::lock_guard<std::mutex> lock(m);
-    return ++id;
-}
-
-
 RemoteFDB::RemoteFDB(const eckit::Configuration& config, const std::string& name) :
     FDBBase(config, name),
     controlEndpoint_(config.getString("host"), config.getInt("port")),
+    shareConnection_(config.getBool("shareConnections",
+        eckit::Resource<bool>("fdbRemoteShareConnections;$FDB_REMOTE_SHARE_CONNECTIONS", true))),
     archiveID_(0),
     maxArchiveQueueLength_(eckit::Resource<size_t>("fdbRemoteArchiveQueueLength;$FDB_REMOTE_ARCHIVE_QUEUE_LENGTH", 200)),
     maxArchiveBatchSize_(config.getInt("maxBatchSize", 1)),
-    retrieveMessageQueue_(eckit::Resource<size_t>("fdbRemoteRetrieveQueueLength;$FDB_REMOTE_RETRIEVE_QUEUE_LENGTH", 200)),
-    connected_(false) {}
+    retrieveMessageQueue_(messageQueueLength(
+        eckit::Resource<size_t>("fdbRemoteRetrieveQueueLength;$FDB_REMOTE_RETRIEVE_QUEUE_LENGTH", 200))) {
+
+    compression_ = config.getString("compression",
+        eckit::Resource<std::string>("fdbRemoteCompression;$FDB_REMOTE_COMPRESSION", "none"));
+
+    if (compression_ != "none") {
+        std::vector<std::string> codecs = remote::WireCompression::available();
+        if (std::find(codecs.begin(), codecs.end(), compression_) == codecs.end()) {
+            Log::warning() << "Compression " << compression_
+                           << " not available for remote connections. Data will be sent uncompressed" << std::endl;
+            compression_ = "none";
+        }
+    }
+}
 
 
 RemoteFDB::~RemoteFDB() {
@@ -141,390 +92,169 @@ RemoteFDB::~RemoteFDB() {
 
 
 // Functions for management of the connection
-
-// Protocol negotiation:
-//
-// i) Connect to server. Send:
-//     - session identification
-//     - supported functionality for protocol negotiation
-//
-// ii) Server responds. Sends:
-//     - returns the client session id (for verification)
-//     - the server session id
-//     - endpoint for data connection
-//     - selected functionality for protocol negotiation
-//
-// iii) Open data connection, and write to server:
-//     - client session id
-//     - server session id
 //
-// This appears quite verbose in terms of protocol negotiation, but the repeated
-// sending of both session ids allows clients and servers to be sure that they are
-// connected to the correct endpoint in a multi-process, multi-host environment.
-//
-// This was an issue on the NextGenIO prototype machine, where TCP connections were
-// getting lost, and/or incorrectly reset, and as a result sessions were being
-// mispaired by the network stack!
+// Unless disabled, the connection to the server is shared with the other RemoteFDB instances of the
+// process that use the same endpoint (see ClientConnectionPool). The connection is set up, and the
+// session negotiated with the server, the first time that it is used.
 
 void RemoteFDB::connect() {
 
-    if (!connected_) {
-
-        static int fdbMaxConnectRetries = eckit::Resource<int>("fdbMaxConnectRetries", 5);
-
-        try {
-            // Connect to server, and check that the server is happy on the response
-
-            Log::debug<LibFdb5>() << "Connecting to host: " << controlEndpoint_ << std::endl;
-            controlClient_.connect(controlEndpoint_, fdbMaxConnectRetries);
-            writeControlStartupMessage();
-            SessionID serverSession = verifyServerStartupResponse();
-
-            // Connect to the specified data port
-            Log::debug<LibFdb5>() << "Received data endpoint from host: " << dataEndpoint_ << std::endl;
-            dataClient_.connect(dataEndpoint_, fdbMaxConnectRetries);
-            writeDataStartupMessage(serverSession);
-
-            // And the connections are set up. Let everything start up!
-            listeningThread_ = std::thread([this] { listeningThreadLoop(); });
-            connected_ = true;
-        } catch(TooManyRetries& e) {
-            if (controlClient_.isConnected()) {
-                controlClient_.close();
-                throw ConnectionError(fdbMaxConnectRetries, dataEndpoint_);
-            } else {
-                throw ConnectionError(fdbMaxConnectRetries, controlEndpoint_);
-            }
+    if (!connection_ || connection_->failed()) {
+        if (connection_) {
+            connection_->detach(this);
+        }
+        if (shareConnection_) {
+            connection_ = ClientConnectionPool::instance().connection(controlEndpoint_, compression_);
+        } else {
+            connection_ = std::make_shared<ClientConnection>(controlEndpoint_, compression_);
         }
+        connection_->attach(this);
     }
+
+    connection_->connect();
 }
 
 void RemoteFDB::disconnect() {
-    if (connected_) {
-
-        // Send termination message
-        controlWrite(fdb5::remote::Message::Exit, generateRequestID());
 
-        listeningThread_.join();
+    // n.b. an unshared connection is closed when released. Shared connections are kept open by the
+    //      ClientConnectionPool for the lifetime of the process, for reuse by later instances.
 
-        // Close both the control and data connections
-        controlClient_.close();
-        dataClient_.close();
-        connected_ = false;
+    if (archiveConnection_) {
+        archiveConnection_->detach(this);
+        archiveConnection_.reset();
     }
-}
-
-void RemoteFDB::writeControlStartupMessage() {
 
-    Buffer payload(4096);
-    MemoryStream s(payload);
-    s << sessionID_;
-    s << controlEndpoint_;
-    s << LibFdb5::instance().remoteProtocolVersion().used();
-
-    // TODO: Abstract this dictionary into a RemoteConfiguration object, which
-    //       understands how to do the negotiation, etc, but uses Value (i.e.
-    //       essentially JSON) over the wire for flexibility.
-    s << availableFunctionality().get();
-
-    controlWrite(fdb5::remote::Message::Startup, 0, payload.data(), s.position());
+    if (connection_) {
+        connection_->detach(this);
+        connection_.reset();
+    }
 }
 
-SessionID RemoteFDB::verifyServerStartupResponse() {
+void RemoteFDB::sendRequest(remote::Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
 
-    MessageHeader hdr;
-    controlRead(&hdr, sizeof(hdr));
-
-    ASSERT(hdr.marker == StartMarker);
-    ASSERT(hdr.version == CurrentVersion);
-    ASSERT(hdr.message == fdb5::remote::Message::Startup);
-    ASSERT(hdr.requestID == 0);
-
-    Buffer payload(hdr.payloadSize);
-    eckit::FixedString<4> tail;
-    controlRead(payload, hdr.payloadSize);
-    controlRead(&tail, sizeof(tail));
-    ASSERT(tail == EndMarker);
-
-    MemoryStream s(payload);
-    SessionID clientSession(s);
-    SessionID serverSession(s);
-    Endpoint dataEndpoint(s);
-    LocalConfiguration serverFunctionality(s);
-
-    dataEndpoint_ = dataEndpoint;
+    // Ensure that the responses can be routed back to us before we trigger anything that
+    // will result in return messages
 
-    if (dataEndpoint_.hostname() != controlEndpoint_.hostname()) {
-        Log::warning() << "Data and control interface hostnames do not match. "
-                       << dataEndpoint_.hostname() << " /= "
-                       << controlEndpoint_.hostname() << std::endl;
-    }
+    connection_->route(requestID, this);
 
-    if (clientSession != sessionID_) {
-        std::stringstream ss;
-        ss << "Session ID does not match session received from server: "
-           << sessionID_ << " != " << clientSession;
-        throw BadValue(ss.str(), Here());
+    try {
+        connection_->controlWriteCheckResponse(msg, requestID, payload, payloadLength);
+    } catch (...) {
+        connection_->unroute(requestID);
+        throw;
     }
-
-    return serverSession;
 }
 
-void RemoteFDB::writeDataStartupMessage(const eckit::SessionID& serverSession) {
-
-    Buffer payload(1024);
-    MemoryStream s(payload);
+size_t RemoteFDB::messageQueueLength(size_t length) const {
 
-    s << sessionID_;
-    s << serverSession;
+    // Received messages are queued by the listening thread of the connection. The listening thread of a
+    // shared connection serves all of its clients, and must not wait for any one of them to consume its
+    // messages, so their queues are not bounded. Otherwise, a full queue holds back the server.
 
-    dataWrite(fdb5::remote::Message::Startup, 0, payload.data(), s.position());
+    return shareConnection_ ? std::numeric_limits<size_t>::max() : length;
 }
 
-eckit::LocalConfiguration RemoteFDB::availableFunctionality() const {
-    eckit::LocalConfiguration conf;
-    std::vector<int> remoteFieldLocationVersions = {1};
-    conf.set("RemoteFieldLocation", remoteFieldLocationVersions);
-    return conf;
-}
-
-void RemoteFDB::listeningThreadLoop() {
-
-    /// @note This routine retrieves BOTH normal API asynchronously returned data, AND
-    /// fields that are being returned by a retrieve() call. These need to go into different
-    /// queues
-    /// --> Test if the requestID is a known API request, otherwise push onto the retrieve queue
-
+std::shared_ptr<RemoteFDB::MessageQueue> RemoteFDB::findMessageQueue(uint32_t requestID, bool remove) {
 
     /// @note messageQueues_ is a map of requestID:MessageQueue. At the point that
     /// a request is complete, errored or otherwise killed, it needs to be removed
     /// from the map. The shared_ptr allows this removal to be asynchronous with
     /// the actual task cleaning up and returning to the client.
 
-    try {
-
-    MessageHeader hdr;
-    eckit::FixedString<4> tail;
-
-    while (true) {
-
-        dataRead(&hdr, sizeof(hdr));
+    std::lock_guard<std::mutex> lock(messageQueuesMutex_);
 
-        ASSERT(hdr.marker == StartMarker);
-        ASSERT(hdr.version == CurrentVersion);
+    std::shared_ptr<MessageQueue> queue;
+    auto it = messageQueues_.find(requestID);
+    if (it != messageQueues_.end()) {
+        queue = it->second;
+        if (remove) messageQueues_.erase(it);
+    }
+    return queue;
+}
 
-        switch (hdr.message) {
+void RemoteFDB::receive(const MessageHeader& hdr, eckit::Buffer&& payload) {
 
-        case fdb5::remote::Message::Exit:
-            return;
+    /// @note This routine receives BOTH normal API asynchronously returned data, AND
+    /// fields that are being returned by a read. These need to go into different
+    /// queues
+    /// --> Test if the requestID is a known API request, otherwise push onto the retrieve queue
 
-        case fdb5::remote::Message::Blob: {
-            Buffer payload(hdr.payloadSize);
-            if (hdr.payloadSize > 0) dataRead(payload, hdr.payloadSize);
+    switch (hdr.message) {
 
-            auto it = messageQueues_.find(hdr.requestID);
-            if (it != messageQueues_.end()) {
-                it->second->emplace(std::make_pair(hdr, std::move(payload)));
-            } else {
-                retrieveMessageQueue_.emplace(std::make_pair(hdr, std::move(payload)));
-            }
-            break;
+    case fdb5::remote::Message::Blob: {
+        std::shared_ptr<MessageQueue> queue = findMessageQueue(hdr.requestID, false);
+        if (queue) {
+            queue->emplace(std::make_pair(hdr, std::move(payload)));
+        } else {
+            retrieveMessageQueue_.emplace(std::make_pair(hdr, std::move(payload)));
         }
+        break;
+    }
 
-        case fdb5::remote::Message::Complete: {
-            auto it = messageQueues_.find(hdr.requestID);
-            if (it != messageQueues_.end()) {
-                it->second->close();
+    case fdb5::remote::Message::Complete: {
 
-                // Remove entry (shared_ptr --> message queue will be destroyed when it
-                // goes out of scope in the worker thread).
-                messageQueues_.erase(it);
+        // Remove entry (shared_ptr --> message queue will be destroyed when it
+        // goes out of scope in the worker thread).
 
-            } else {
-                retrieveMessageQueue_.emplace(std::make_pair(hdr, Buffer(0)));
-            }
-            break;
+        std::shared_ptr<MessageQueue> queue = findMessageQueue(hdr.requestID, true);
+        if (queue) {
+            queue->close();
+        } else {
+            retrieveMessageQueue_.emplace(std::make_pair(hdr, Buffer(0)));
         }
+        break;
+    }
 
-        case fdb5::remote::Message::Error: {
-
-            auto it = messageQueues_.find(hdr.requestID);
-            if (it != messageQueues_.end()) {
-                std::string msg;
-                if (hdr.payloadSize > 0) {
-                    msg.resize(hdr.payloadSize, ' ');
-                    dataRead(&msg[0], hdr.payloadSize);
-                }
-                it->second->interrupt(std::make_exception_ptr(RemoteFDBException(msg, dataEndpoint_)));
-
-                // Remove entry (shared_ptr --> message queue will be destroyed when it
-                // goes out of scope in the worker thread).
-                messageQueues_.erase(it);
-
-            } else if (hdr.requestID == archiveID_) {
-
-                std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
+    case fdb5::remote::Message::Error: {
 
-                if (archiveQueue_) {
-                    std::string msg;
-                    if (hdr.payloadSize > 0) {
-                        msg.resize(hdr.payloadSize, ' ');
-                        dataRead(&msg[0], hdr.payloadSize);
-                    }
+        std::string msg(static_cast<const char*>(payload.data()), hdr.payloadSize);
 
-                    archiveQueue_->interrupt(std::make_exception_ptr(RemoteFDBException(msg, dataEndpoint_)));
-                }
-            } else {
-                Buffer payload(hdr.payloadSize);
-                if (hdr.payloadSize > 0) dataRead(payload, hdr.payloadSize);
-                retrieveMessageQueue_.emplace(std::make_pair(hdr, std::move(payload)));
+        std::shared_ptr<MessageQueue> queue = findMessageQueue(hdr.requestID, true);
+        if (queue) {
+            queue->interrupt(std::make_exception_ptr(RemoteFDBException(msg, controlEndpoint_)));
+        } else if (hdr.requestID == archiveID_) {
+            std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
+            if (archiveQueue_) {
+                archiveQueue_->interrupt(std::make_exception_ptr(RemoteFDBException(msg, controlEndpoint_)));
             }
-            break;
-        }
-
-        default: {
-            std::stringstream ss;
-            ss << "ERROR: Unexpected message recieved (" << static_cast<int>(hdr.message) << "). ABORTING";
-            Log::status() << ss.str() << std::endl;
-            Log::error() << "Retrieving... " << ss.str() << std::endl;
-            throw SeriousBug(ss.str(), Here());
+        } else {
+            retrieveMessageQueue_.emplace(std::make_pair(hdr, std::move(payload)));
         }
-        };
-
-        // Ensure we have consumed exactly the correct amount from the socket.
-
-        dataRead(&tail, sizeof(tail));
-        ASSERT(tail == EndMarker);
+        break;
     }
 
-    // We don't want to let exceptions escape inside a worker thread.
+    default:
+        NOTIMP;
+    }
+}
 
-    } catch (const std::exception& e) {
-        for (auto& it : messageQueues_) {
-            it.second->interrupt(std::make_exception_ptr(e));
-        }
-        messageQueues_.clear();
-        retrieveMessageQueue_.interrupt(std::make_exception_ptr(e));
-        {
-            std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
-            if (archiveQueue_) archiveQueue_->interrupt(std::make_exception_ptr(e));
-        }
-    } catch (...) {
+void RemoteFDB::failed(std::exception_ptr e) {
+    {
+        std::lock_guard<std::mutex> lock(messageQueuesMutex_);
         for (auto& it : messageQueues_) {
-            it.second->interrupt(std::current_exception());
+            it.second->interrupt(e);
         }
         messageQueues_.clear();
-        retrieveMessageQueue_.interrupt(std::current_exception());
-        {
-            std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
-            if (archiveQueue_) archiveQueue_->interrupt(std::current_exception());
-        }
-    }
-}
-
-void RemoteFDB::controlWriteCheckResponse(fdb5::remote::Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
-
-    controlWrite(msg, requestID, payload, payloadLength);
-
-    // Wait for the receipt acknowledgement
-
-    MessageHeader response;
-    controlRead(&response, sizeof(MessageHeader));
-
-    handleError(response);
-
-    ASSERT(response.marker == StartMarker);
-    ASSERT(response.version == CurrentVersion);
-    ASSERT(response.message == fdb5::remote::Message::Received);
-
-    eckit::FixedString<4> tail;
-    controlRead(&tail, sizeof(tail));
-    ASSERT(tail == EndMarker);
-}
-
-void RemoteFDB::controlWrite(fdb5::remote::Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
-
-    ASSERT((payload == nullptr) == (payloadLength == 0));
-
-    MessageHeader message(msg, requestID, payloadLength);
-    controlWrite(&message, sizeof(message));
-    if (payload) {
-        controlWrite(payload, payloadLength);
     }
-    controlWrite(&EndMarker, sizeof(EndMarker));
-}
-
-void RemoteFDB::controlWrite(const void* data, size_t length) {
-    size_t written = controlClient_.write(data, length);
-    if (length != written) {
-        std::stringstream ss;
-        ss << "Write error. Expected " << length << " bytes, wrote " << written;
-        throw TCPException(ss.str(), Here());
-    }
-}
-
-void RemoteFDB::controlRead(void* data, size_t length) {
-    size_t read = controlClient_.read(data, length);
-    if (length != read) {
-        std::stringstream ss;
-        ss << "Read error. Expected " << length << " bytes, read " << read;
-        throw TCPException(ss.str(), Here());
+    retrieveMessageQueue_.interrupt(e);
+    {
+        std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
+        if (archiveQueue_) archiveQueue_->interrupt(e);
     }
 }
 
-void RemoteFDB::dataWrite(fdb5::remote::Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
-
-    ASSERT((payload == nullptr) == (payloadLength == 0));
+FDBStats RemoteFDB::stats() const {
 
-    MessageHeader message(msg, requestID, payloadLength);
-    dataWrite(&message, sizeof(message));
-    if (payload) {
-        dataWrite(payload, payloadLength);
-    }
-    dataWrite(&EndMarker, sizeof(EndMarker));
-}
+    // n.b. the compression statistics are those of the (possibly shared) connections
 
-void RemoteFDB::dataWrite(const void* data, size_t length) {
-    size_t written = dataClient_.write(data, length);
-    if (length != written) {
-        std::stringstream ss;
-        ss << "Write error. Expected " << length << " bytes, wrote " << written;
-        throw TCPException(ss.str(), Here());
+    FDBStats stats(internalStats_);
+    if (connection_) {
+        connection_->compression().stats(stats);
     }
-}
-
-void RemoteFDB::dataRead(void* data, size_t length) {
-    size_t read = dataClient_.read(data, length);
-    if (length != read) {
-        std::stringstream ss;
-        ss << "Read error. Expected " << length << " bytes, read " << read;
-        throw TCPException(ss.str(), Here());
+    if (archiveConnection_ && archiveConnection_ != connection_) {
+        archiveConnection_->compression().stats(stats);
     }
-}
-
-void RemoteFDB::handleError(const MessageHeader& hdr) {
-
-    ASSERT(hdr.marker == StartMarker);
-    ASSERT(hdr.version == CurrentVersion);
-
-    if (hdr.message == fdb5::remote::Message::Error) {
-        ASSERT(hdr.payloadSize > 9);
-
-        std::string what(hdr.payloadSize, ' ');
-        controlRead(&what[0], hdr.payloadSize);
-        what[hdr.payloadSize] = 0; // Just in case
-
-        try {
-            eckit::FixedString<4> tail;
-            controlRead(&tail, sizeof(tail));
-        } catch (...) {}
-
-        throw RemoteFDBException(what, controlEndpoint_);
-    }
-}
-
-FDBStats RemoteFDB::stats() const {
-    return internalStats_;
+    return stats;
 }
 
 
@@ -602,6 +332,24 @@ private:
     bool porcelain_;
 };
 
+struct CompactHelper : BaseAPIHelper<CompactElement, fdb5::remote::Message::Compact> {
+
+    CompactHelper(bool doit, bool porcelain) : doit_(doit), porcelain_(porcelain) {}
+    void encodeExtra(eckit::Stream& s) const {
+        s << doit_;
+        s << porcelain_;
+    }
+    static CompactElement valueFromStream(eckit::Stream& s, RemoteFDB*) {
+        CompactElement elem;
+        s >> elem;
+        return elem;
+    }
+
+private:
+    bool doit_;
+    bool porcelain_;
+};
+
 struct WipeHelper : BaseAPIHelper<WipeElement, fdb5::remote::Message::Wipe> {
 
     WipeHelper(bool doit, bool porcelain, bool unsafeWipeAll) :
@@ -679,10 +427,12 @@ auto RemoteFDB::forwardApiCall(const HelperClass& helper, const FDBToolRequest&
     // Ensure we have an entry in the message queue before we trigger anything that
     // will result in return messages
 
-    uint32_t id = generateRequestID();
-    auto entry = messageQueues_.emplace(id, std::make_shared<MessageQueue>(HelperClass::queueSize()));
-    ASSERT(entry.second);
-    std::shared_ptr<MessageQueue> messageQueue(entry.first->second);
+    uint32_t id = ClientConnection::generateRequestID();
+    std::shared_ptr<MessageQueue> messageQueue(std::make_shared<MessageQueue>(messageQueueLength(HelperClass::queueSize())));
+    {
+        std::lock_guard<std::mutex> lock(messageQueuesMutex_);
+        ASSERT(messageQueues_.emplace(id, messageQueue).second);
+    }
 
     // Encode the request and send it to the server
 
@@ -691,7 +441,12 @@ auto RemoteFDB::forwardApiCall(const HelperClass& helper, const FDBToolRequest&
     s << request;
     helper.encodeExtra(s);
 
-    controlWriteCheckResponse(HelperClass::message(), id, encodeBuffer, s.position());
+    try {
+        sendRequest(HelperClass::message(), id, encodeBuffer, s.position());
+    } catch (...) {
+        findMessageQueue(id, true);
+        throw;
+    }
 
     // Return an AsyncIterator to allow the messages to be retrieved in the API
 
@@ -740,6 +495,10 @@ PurgeIterator RemoteFDB::purge(const FDBToolRequest& request, bool doit, bool po
     return forwardApiCall(PurgeHelper(doit, porcelain), request);
 }
 
+CompactIterator RemoteFDB::compact(const FDBToolRequest& request, bool doit, bool porcelain) {
+    return forwardApiCall(CompactHelper(doit, porcelain), request);
+}
+
 StatsIterator RemoteFDB::stats(const FDBToolRequest& request) {
     return forwardApiCall(StatsHelper(), request);
 }
@@ -766,10 +525,38 @@ void RemoteFDB::archive(const Key& key, const void* data, size_t length) {
 
     if (!archiveFuture_.valid()) {
 
-        // Start the archival request on the remote side
         ASSERT(archiveID_ == 0);
-        uint32_t id = generateRequestID();
-        controlWriteCheckResponse(fdb5::remote::Message::Archive, id);
+
+        // The server handles one archive at a time in each session. If another client is already
+        // archiving through a shared connection, archive through a connection of our own.
+
+        if (archiveConnection_ && archiveConnection_->failed()) {
+            archiveConnection_->detach(this);
+            archiveConnection_.reset();
+        }
+
+        if (!archiveConnection_) {
+            if (connection_->acquireArchive(this)) {
+                archiveConnection_ = connection_;
+            } else {
+                Log::debug<LibFdb5>() << "Shared connection to " << controlEndpoint_
+                                      << " busy archiving. Opening a new connection" << std::endl;
+                archiveConnection_ = std::make_shared<ClientConnection>(controlEndpoint_, compression_);
+                archiveConnection_->attach(this);
+            }
+        }
+
+        archiveConnection_->connect();
+
+        // Start the archival request on the remote side
+        uint32_t id = ClientConnection::generateRequestID();
+        archiveConnection_->route(id, this);
+        try {
+            archiveConnection_->controlWriteCheckResponse(fdb5::remote::Message::Archive, id);
+        } catch (...) {
+            endArchive(id);
+            throw;
+        }
         archiveID_ = id;
 
         // Reset the queue after previous done/errors
@@ -801,27 +588,37 @@ void RemoteFDB::flush() {
     // Flush only does anything if there is an ongoing archive();
     if (archiveFuture_.valid()) {
 
-        ASSERT(archiveID_ != 0);
+        uint32_t id = archiveID_;
+        ASSERT(id != 0);
         {
             ASSERT(archiveQueue_);
             std::lock_guard<std::mutex> lock(archiveQueuePtrMutex_);
             archiveQueue_->close();
         }
-        FDBStats stats = archiveFuture_.get();
-        ASSERT(!archiveQueue_);
-        archiveID_ = 0;
 
-        ASSERT(stats.numFlush() == 0);
-        size_t numArchive = stats.numArchive();
+        try {
+            FDBStats stats = archiveFuture_.get();
+            ASSERT(!archiveQueue_);
+            archiveID_ = 0;
+
+            ASSERT(stats.numFlush() == 0);
+            size_t numArchive = stats.numArchive();
+
+            Buffer sendBuf(4096);
+            MemoryStream s(sendBuf);
+            s << numArchive;
 
-        Buffer sendBuf(4096);
-        MemoryStream s(sendBuf);
-        s << numArchive;
+            // The flush call is blocking
+            archiveConnection_->controlWriteCheckResponse(fdb5::remote::Message::Flush,
+                                                          ClientConnection::generateRequestID(), sendBuf, s.position());
 
-        // The flush call is blocking
-        controlWriteCheckResponse(fdb5::remote::Message::Flush, generateRequestID(), sendBuf, s.position());
+            internalStats_ += stats;
+        } catch (...) {
+            endArchive(id);
+            throw;
+        }
 
-        internalStats_ += stats;
+        endArchive(id);
     }
 
     timer.stop();
@@ -829,6 +626,19 @@ void RemoteFDB::flush() {
 }
 
 
+void RemoteFDB::endArchive(uint32_t requestID) {
+
+    archiveConnection_->unroute(requestID);
+
+    // Let other clients archive through a shared connection
+
+    if (archiveConnection_ == connection_) {
+        connection_->releaseArchive(this);
+        archiveConnection_.reset();
+    }
+}
+
+
 FDBStats RemoteFDB::archiveThreadLoop(uint32_t requestID) {
 
     FDBStats localStats;
@@ -859,8 +669,8 @@ FDBStats RemoteFDB::archiveThreadLoop(uint32_t requestID) {
         // on by the ::flush() routine)
 
         MessageHeader hdr(fdb5::remote::Message::Flush, requestID);
-        dataWrite(&hdr, sizeof(hdr));
-        dataWrite(&EndMarker, sizeof(EndMarker));
+        archiveConnection_->dataWrite(&hdr, sizeof(hdr));
+        archiveConnection_->dataWrite(&EndMarker, sizeof(EndMarker));
 
         archiveID_ = 0;
         archiveQueue_.reset();
@@ -883,41 +693,71 @@ long RemoteFDB::sendArchiveData(uint32_t id, const std::vector<std::pair<Key, Bu
         return elements[0].second.size();
     }
 
-    // Serialise the keys
+    // Serialise all of the keys into one buffer
 
-    std::vector<Buffer> keyBuffers;
-    std::vector<size_t> keySizes;
-    keyBuffers.reserve(count);
-    keySizes.reserve(count);
+    ResizableBuffer keyBuffer(count * 256);
+    ResizableMemoryStream keyStream(keyBuffer);
 
-    size_t containedSize = 0;
+    std::vector<size_t> keyOffsets;
+    keyOffsets.reserve(count + 1);
 
     for (size_t i = 0; i < count; ++i) {
-        keyBuffers.emplace_back(Buffer {4096});
-        MemoryStream keyStream(keyBuffers.back());
+        keyOffsets.push_back(keyStream.position());
         keyStream << elements[i].first;
-        keySizes.push_back(keyStream.position());
-        containedSize += (keyStream.position() + elements[i].second.size() +
-                          sizeof(MessageHeader) + sizeof(EndMarker));
     }
+    keyOffsets.push_back(keyStream.position());
 
-    // Construct the containing message
-
-    MessageHeader message(fdb5::remote::Message::MultiBlob, id, containedSize);
-    dataWrite(&message, sizeof(message));
+    // The payload of each contained Blob (compressed, if agreed with the server)
 
+    const char* keys = static_cast<const char*>(keyBuffer.data());
     long dataSent = 0;
 
+    WireCompression& compression(archiveConnection_->compression());
+
+    std::vector<std::vector<struct iovec>> payloads(count);
+    std::vector<CompressedPayloadHeader> payloadHeaders(compression.enabled() ? count : 0);
+    std::vector<std::unique_ptr<ResizableBuffer>> compressed;
+
+    size_t containedSize = 0;
     for (size_t i = 0; i < count; ++i) {
-        MessageHeader containedMessage(fdb5::remote::Message::Blob, id, elements[i].second.size() + keySizes[i]);
-        dataWrite(&containedMessage, sizeof(containedMessage));
-        dataWrite(keyBuffers[i], keySizes[i]);
-        dataWrite(elements[i].second.data(), elements[i].second.size());
-        dataWrite(&EndMarker, sizeof(EndMarker));
+        payloads[i].push_back(ioBuffer(keys + keyOffsets[i], keyOffsets[i+1] - keyOffsets[i]));
+        payloads[i].push_back(ioBuffer(elements[i].second.data(), elements[i].second.size()));
+        if (compression.enabled()) {
+            compressed.emplace_back(new ResizableBuffer(0));
+            compression.encode(payloads[i], payloadHeaders[i], *compressed.back());
+        }
+        for (const struct iovec& v : payloads[i]) {
+            containedSize += v.iov_len;
+        }
+        containedSize += sizeof(MessageHeader) + sizeof(EndMarker);
         dataSent += elements[i].second.size();
     }
 
-    dataWrite(&EndMarker, sizeof(EndMarker));
+    // Construct the containing message, and send everything with one vectored write. Uncompressed
+    // field data is sent directly from the queued buffers.
+
+    std::vector<MessageHeader> headers;
+    headers.reserve(count + 1);
+    headers.emplace_back(fdb5::remote::Message::MultiBlob, id, containedSize);
+
+    std::vector<struct iovec> iov;
+    iov.reserve(5 * count + 2);
+    iov.push_back(ioBuffer(&headers.back(), sizeof(MessageHeader)));
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t payloadSize = 0;
+        for (const struct iovec& v : payloads[i]) {
+            payloadSize += v.iov_len;
+        }
+        headers.emplace_back(fdb5::remote::Message::Blob, id, payloadSize);
+        iov.push_back(ioBuffer(&headers.back(), sizeof(MessageHeader)));
+        iov.insert(iov.end(), payloads[i].begin(), payloads[i].end());
+        iov.push_back(ioBuffer(&EndMarker, sizeof(EndMarker)));
+    }
+
+    iov.push_back(ioBuffer(&EndMarker, sizeof(EndMarker)));
+
+    archiveConnection_->dataWrite(iov);
     return dataSent;
 }
 
@@ -927,15 +767,33 @@ void RemoteFDB::sendArchiveData(uint32_t id, const Key& key, const void* data, s
     ASSERT(data);
     ASSERT(length != 0);
 
-    Buffer keyBuffer(4096);
-    MemoryStream keyStream(keyBuffer);
+    char keyBuffer[4096];
+    MemoryStream keyStream(keyBuffer, sizeof(keyBuffer));
     keyStream << key;
 
-    MessageHeader message(fdb5::remote::Message::Blob, id, length + keyStream.position());
-    dataWrite(&message, sizeof(message));
-    dataWrite(keyBuffer, keyStream.position());
-    dataWrite(data, length);
-    dataWrite(&EndMarker, sizeof(EndMarker));
+    std::vector<struct iovec> payload {ioBuffer(keyBuffer, keyStream.position()),
+                                       ioBuffer(data, length)};
+
+    CompressedPayloadHeader payloadHeader;
+    ResizableBuffer compressed(0);
+    WireCompression& compression(archiveConnection_->compression());
+    if (compression.enabled()) {
+        compression.encode(payload, payloadHeader, compressed);
+    }
+
+    size_t payloadSize = 0;
+    for (const struct iovec& v : payload) {
+        payloadSize += v.iov_len;
+    }
+
+    MessageHeader message(fdb5::remote::Message::Blob, id, payloadSize);
+
+    std::vector<struct iovec> iov;
+    iov.reserve(payload.size() + 2);
+    iov.push_back(ioBuffer(&message, sizeof(message)));
+    iov.insert(iov.end(), payload.begin(), payload.end());
+    iov.push_back(ioBuffer(&EndMarker, sizeof(EndMarker)));
+    archiveConnection_->dataWrite(iov);
 }
 
 // -----------------------------------------------------------------------------------------------------
@@ -1106,15 +964,37 @@ eckit::DataHandle* RemoteFDB::dataHandle(const FieldLocation& fieldLocation, con
     s << fieldLocation;
     s << remapKey;
 
-    uint32_t id = generateRequestID();
+    uint32_t id = ClientConnection::generateRequestID();
+
+    sendRequest(fdb5::remote::Message::Read, id, encodeBuffer, s.position());
+
+    return new FDBRemoteDataHandle(id, retrieveMessageQueue_, controlEndpoint_);
+}
+
+eckit::DataHandle* RemoteFDB::dataHandle(const std::vector<std::shared_ptr<const FieldLocation>>& fieldLocations) {
+
+    connect();
 
-    controlWriteCheckResponse(fdb5::remote::Message::Read, id, encodeBuffer, s.position());
+    ResizableBuffer encodeBuffer(4096);
+    ResizableMemoryStream s(encodeBuffer);
+    s << fieldLocations.size();
+    for (const auto& location : fieldLocations) {
+        s << *location;
+    }
+
+    uint32_t id = ClientConnection::generateRequestID();
+
+    sendRequest(fdb5::remote::Message::ReadMany, id, encodeBuffer, s.position());
 
     return new FDBRemoteDataHandle(id, retrieveMessageQueue_, controlEndpoint_);
 }
 
 void RemoteFDB::print(std::ostream &s) const {
-    s << "RemoteFDB(host=" << controlEndpoint_ << ", data=" << dataEndpoint_ << ")";
+    s << "RemoteFDB(host=" << controlEndpoint_;
+    if (connection_) {
+        s << ", data=" << connection_->dataEndpoint();
+    }
+    s << ")";
 }
 
 static FDBBuilder<RemoteFDB> remoteFdbBuilder("remote");
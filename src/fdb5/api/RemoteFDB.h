@@ -20,17 +20,16 @@
 #define fdb5_remote_RemoteFDB_H
 
 #include <future>
-#include <thread>
+#include <memory>
+#include <mutex>
 
 #include "eckit/container/Queue.h"
 #include "eckit/io/Buffer.h"
 #include "eckit/net/Endpoint.h"
-#include "eckit/net/TCPClient.h"
-#include "eckit/net/TCPStream.h"
-#include "eckit/runtime/SessionID.h"
 
 #include "fdb5/api/FDB.h"
 #include "fdb5/api/FDBFactory.h"
+#include "fdb5/remote/ClientConnection.h"
 #include "fdb5/remote/Messages.h"
 
 namespace fdb5 {
@@ -39,7 +38,11 @@ class FDB;
 
 //----------------------------------------------------------------------------------------------------------------------
 
-class RemoteFDB : public FDBBase {
+/// An FDB served by a remote FDB server. Unless the shareConnections option (or the
+/// fdbRemoteShareConnections resource) is false, all of the RemoteFDB instances of a process that use
+/// the same server share one connection to it, and their requests are routed by requestID.
+
+class RemoteFDB : public FDBBase, private remote::ClientConnection::Receiver {
 
 public: // types
 
@@ -60,6 +63,9 @@ public: // method
     eckit::DataHandle* dataHandle(const FieldLocation& fieldLocation);
     eckit::DataHandle* dataHandle(const FieldLocation& fieldLocation, const Key& remapKey);
 
+    /// Read many fields with one request. The data is streamed back in the order of the locations.
+    eckit::DataHandle* dataHandle(const std::vector<std::shared_ptr<const FieldLocation>>& fieldLocations);
+
     ListIterator inspect(const metkit::mars::MarsRequest& request) override;
 
     ListIterator list(const FDBToolRequest& request) override;
@@ -72,6 +78,8 @@ public: // method
 
     PurgeIterator purge(const FDBToolRequest& request, bool doit, bool porcelain) override;
 
+    CompactIterator compact(const FDBToolRequest& request, bool doit, bool porcelain) override;
+
     StatsIterator stats(const FDBToolRequest& request) override;
 
     ControlIterator control(const FDBToolRequest& request,
@@ -91,28 +99,17 @@ private: // methods
     void connect();
     void disconnect();
 
-    // Session negotiation with the server
-    void writeControlStartupMessage();
-    eckit::SessionID verifyServerStartupResponse();
-    void writeDataStartupMessage(const eckit::SessionID& serverSession);
+    // Send a request, having arranged for the responses to be routed back to us
+    void sendRequest(remote::Message msg, uint32_t requestID, const void* payload=nullptr, uint32_t payloadLength=0);
 
-    // Construct dictionary for protocol negotiation
+    // Messages received from the server, pushed onto the appropriate queues
+    void receive(const remote::MessageHeader& hdr, eckit::Buffer&& payload) override;
+    void failed(std::exception_ptr e) override;
 
-    eckit::LocalConfiguration availableFunctionality() const;
+    std::shared_ptr<MessageQueue> findMessageQueue(uint32_t requestID, bool remove);
 
-    // Listen to the dataClient for incoming messages, and push them onto
-    // appropriate queues.
-    void listeningThreadLoop();
-
-    // Handle data going in either direction on the wire
-    void controlWriteCheckResponse(remote::Message msg, uint32_t requestID, const void* payload=nullptr, uint32_t payloadLength=0);
-    void controlWrite(remote::Message msg, uint32_t requestID, const void* payload=nullptr, uint32_t payloadLength=0);
-    void controlWrite(const void* data, size_t length);
-    void controlRead(void* data, size_t length);
-    void dataWrite(remote::Message msg, uint32_t requestID, const void* payload=nullptr, uint32_t payloadLength=0);
-    void dataWrite(const void* data, size_t length);
-    void dataRead(void* data, size_t length);
-    void handleError(const remote::MessageHeader& hdr);
+    // The length of a queue of received messages, given the length wanted if it can be bounded
+    size_t messageQueueLength(size_t length) const;
 
     // Worker for the API functions
 
@@ -122,6 +119,7 @@ private: // methods
     // Workers for archiving
 
     FDBStats archiveThreadLoop(uint32_t requestID);
+    void endArchive(uint32_t requestID);
 
     void sendArchiveData(uint32_t id, const Key& key, const void* data, size_t length);
     long sendArchiveData(uint32_t id, const std::vector<std::pair<Key, eckit::Buffer>>& elements, size_t count);
@@ -132,18 +130,19 @@ private: // methods
 
 private: // members
 
-    eckit::SessionID sessionID_;
-
     eckit::net::Endpoint controlEndpoint_;
-    eckit::net::Endpoint dataEndpoint_;
-
-    eckit::net::TCPClient controlClient_;
-    eckit::net::TCPClient dataClient_;
 
     FDBStats internalStats_;
 
-    // Listen on the dataClient for incoming messages.
-    std::thread listeningThread_;
+    // Compression of the data connection requested from the server
+    std::string compression_;
+
+    bool shareConnection_;
+    std::shared_ptr<remote::ClientConnection> connection_;
+
+    // The connection used while archiving. Normally connection_, unless another client is already
+    // archiving through it.
+    std::shared_ptr<remote::ClientConnection> archiveConnection_;
 
     // Where do we put received messages
     // @note This is a map of requestID:MessageQueue. At the point that a request is
@@ -151,6 +150,7 @@ private: // members
     // The shared_ptr allows this removal to be asynchronous with the actual task
     // cleaning up and returning to the client.
 
+    std::mutex messageQueuesMutex_;
     std::map<uint32_t, std::shared_ptr<MessageQueue>> messageQueues_;
 
     // Asynchronised helpers for archiving
@@ -167,8 +167,6 @@ private: // members
     std::mutex archiveQueuePtrMutex_;
     std::unique_ptr<ArchiveQueue> archiveQueue_;
     MessageQueue retrieveMessageQueue_;
-
-    bool connected_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -98,6 +98,32 @@ void SelectFDB::archive(const Key& key, const void* data, size_t length) {
     throw eckit::UserError(ss.str(), Here());
 }
 
+void SelectFDB::archive(const std::vector<ArchiveElement>& elements) {
+
+    // Split the batch between the sub-FDBs, so that each receives a single (smaller) batch
+
+    std::vector<std::vector<ArchiveElement>> batches(subFdbs_.size());
+
+    for (const ArchiveElement& element : elements) {
+        size_t i = 0;
+        while (i < subFdbs_.size() && !matches(element.key_, subFdbs_[i].first, true)) {
+            ++i;
+        }
+        if (i == subFdbs_.size()) {
+            std::stringstream ss;
+            ss << "No matching fdb for key: " << element.key_;
+            throw eckit::UserError(ss.str(), Here());
+        }
+        batches[i].push_back(element);
+    }
+
+    for (size_t i = 0; i < subFdbs_.size(); ++i) {
+        if (!batches[i].empty()) {
+            subFdbs_[i].second.archive(batches[i]);
+        }
+    }
+}
+
 ListIterator SelectFDB::inspect(const metkit::mars::MarsRequest& request) {
 
     std::queue<APIIterator<ListElement>> lists;
@@ -177,6 +203,14 @@ PurgeIterator SelectFDB::purge(const FDBToolRequest& request, bool doit, bool po
     });
 }
 
+CompactIterator SelectFDB::compact(const FDBToolRequest& request, bool doit, bool porcelain) {
+    Log::debug<LibFdb5>() << "SelectFDB::compact() >> " << request << std::endl;
+    return queryInternal(request,
+                         [doit, porcelain](FDB& fdb, const FDBToolRequest& request) {
+                            return fdb.compact(request, doit, porcelain);
+    });
+}
+
 StatsIterator SelectFDB::stats(const FDBToolRequest &request) {
     Log::debug<LibFdb5>() << "SelectFDB::stats() >> " << request << std::endl;
     return queryInternal(request,
@@ -203,6 +237,30 @@ void SelectFDB::flush() {
     }
 }
 
+std::shared_future<void> SelectFDB::flushAsync(const std::function<void()>& done) {
+
+    std::vector<std::shared_future<void>> flushes;
+    for (auto& iter : subFdbs_) {
+        FDB& fdb(iter.second);
+        flushes.push_back(fdb.flushAsync());
+    }
+
+    // Completes when all of the sub-FDBs have flushed, reporting the first error. n.b. there is no thread
+    // of our own to see them complete, so that is only seen once waited for.
+
+    return std::async(std::launch::deferred, [flushes, done] {
+        for (const std::shared_future<void>& f : flushes) {
+            f.wait();
+        }
+        if (done) {
+            done();
+        }
+        for (const std::shared_future<void>& f : flushes) {
+            f.get();
+        }
+    }).share();
+}
+
 
 void SelectFDB::print(std::ostream &s) const {
     s << "SelectFDB()";
@@ -48,6 +48,8 @@ public: // methods
 
     void archive(const Key& key, const void* data, size_t length) override;
 
+    void archive(const std::vector<ArchiveElement>& elements) override;
+
     ListIterator inspect(const metkit::mars::MarsRequest& request) override;
 
     ListIterator list(const FDBToolRequest& request) override;
@@ -60,6 +62,8 @@ public: // methods
 
     PurgeIterator purge(const FDBToolRequest& request, bool doit, bool porcelain) override;
 
+    CompactIterator compact(const FDBToolRequest& request, bool doit, bool porcelain) override;
+
     StatsIterator stats(const FDBToolRequest& request) override;
 
     ControlIterator control(const FDBToolRequest& request,
@@ -70,6 +74,8 @@ public: // methods
 
     void flush() override;
 
+    std::shared_future<void> flushAsync(const std::function<void()>& done) override;
+
 private: // methods
 
     void print(std::ostream& s) const override;
@@ -316,6 +316,24 @@ int fdb_archive(fdb_handle_t* fdb, fdb_key_t* key, const char* data, size_t leng
         fdb->archive(*key, data, length);
     });
 }
+int fdb_archive_batch(fdb_handle_t* fdb, fdb_key_t** keys, const char** data, const size_t* lengths, size_t count) {
+    return wrapApiFunction([fdb, keys, data, lengths, count] {
+        ASSERT(fdb);
+        ASSERT(keys || count == 0);
+        ASSERT(data || count == 0);
+        ASSERT(lengths || count == 0);
+
+        std::vector<ArchiveElement> elements;
+        elements.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            ASSERT(keys[i]);
+            ASSERT(data[i]);
+            elements.emplace_back(*keys[i], data[i], lengths[i]);
+        }
+
+        fdb->archive(elements);
+    });
+}
 int fdb_archive_multiple(fdb_handle_t* fdb, fdb_request_t* req, const char* data, size_t length) {
     return wrapApiFunction([fdb, req, data, length] {
         ASSERT(fdb);
@@ -0,0 +1,39 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   ArchiveElement.h
+/// @date   Oct 2026
+
+#pragma once
+
+#include <cstddef>
+
+#include "fdb5/database/Key.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// One field of a batch passed to FDB::archive(). The data is not copied, and must remain valid
+/// until the archive call returns.
+
+struct ArchiveElement {
+
+    ArchiveElement(const Key& key, const void* data, size_t length) :
+        key_(key), data_(data), length_(length) {}
+
+    Key key_;
+    const void* data_;
+    size_t length_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,37 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   CompactIterator.h
+/// @date   Oct 2026
+
+#ifndef fdb5_api_CompactIterator_H
+#define fdb5_api_CompactIterator_H
+
+#include <string>
+
+#include "fdb5/api/helpers/APIIterator.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+using CompactElement = std::string;
+
+using CompactIterator = APIIterator<CompactElement>;
+
+using CompactAggregateIterator = APIAggregateIterator<CompactElement>;
+
+using CompactAsyncIterator = APIAsyncIterator<CompactElement>;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
@@ -50,6 +50,7 @@ public: // methods
 
     const std::vector<Key>& key() const { return keyParts_; }
     const FieldLocation& location() const { return *location_; }
+    const std::shared_ptr<const FieldLocation>& sharedLocation() const { return location_; }
     const time_t& timestamp() const { return timestamp_; }
 
     Key combinedKey() const;
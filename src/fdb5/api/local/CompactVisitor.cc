@@ -0,0 +1,70 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "fdb5/api/local/CompactVisitor.h"
+
+#include "eckit/exception/Exceptions.h"
+
+#include "fdb5/api/local/QueueStringLogTarget.h"
+#include "fdb5/database/DB.h"
+#include "fdb5/LibFdb5.h"
+
+namespace fdb5 {
+namespace api {
+namespace local {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CompactVisitor::CompactVisitor(eckit::Queue<CompactElement>& queue,
+                               const metkit::mars::MarsRequest& request,
+                               bool doit,
+                               bool porcelain) :
+    QueryVisitor<CompactElement>(queue, request),
+    out_(new QueueStringLogTarget(queue)),
+    doit_(doit),
+    porcelain_(porcelain) {}
+
+bool CompactVisitor::visitDatabase(const Catalogue& catalogue, const Store& store) {
+
+    // If the DB is locked for wiping, then it "doesn't exist"
+    if (!catalogue.enabled(ControlIdentifier::Wipe)) {
+        return false;
+    }
+
+    EntryVisitor::visitDatabase(catalogue, store);
+
+    // Compaction applies to whole databases
+
+    if (!catalogue.key().match(request_)) {
+        std::stringstream ss;
+        ss << "Compaction not supported for over-specified requests. "
+           << "db=" << catalogue.key()
+           << ", request=" << request_;
+        throw eckit::UserError(ss.str(), Here());
+    }
+
+    // Compaction writes new data and indexes, so it must respect an archive lock
+
+    if (!catalogue.enabled(ControlIdentifier::Archive)) {
+        out_ << "Database " << catalogue.key() << " is locked against archiving. Not compacting." << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<DB> db = DB::buildWriter(catalogue.uri(), catalogue.config());
+    db->compact(out_, porcelain_, doit_);
+
+    return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace local
+} // namespace api
+} // namespace fdb5
@@ -0,0 +1,66 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   CompactVisitor.h
+/// @date   Oct 2026
+
+#ifndef fdb5_api_local_CompactVisitor_H
+#define fdb5_api_local_CompactVisitor_H
+
+#include "eckit/log/Channel.h"
+
+#include "fdb5/api/local/QueryVisitor.h"
+#include "fdb5/api/helpers/CompactIterator.h"
+
+namespace fdb5 {
+namespace api {
+namespace local {
+
+/// @note Helper classes for LocalFDB
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Compacts each matching database in turn, through a writer of its own. The entries are visited by the
+/// writer, so the databases are not explored any further here.
+
+class CompactVisitor : public QueryVisitor<CompactElement> {
+
+public: // methods
+
+    /// Destructive operations are applied to one database at a time
+    static constexpr bool concurrent = false;
+
+    CompactVisitor(eckit::Queue<CompactElement>& queue,
+                   const metkit::mars::MarsRequest& request,
+                   bool doit,
+                   bool porcelain);
+
+    bool visitIndexes() override { return false; }
+    bool visitEntries() override { return false; }
+
+    bool visitDatabase(const Catalogue& catalogue, const Store& store) override;
+    bool visitIndex(const Index&) override { NOTIMP; }
+    void visitDatum(const Field&, const Key&) override { NOTIMP; }
+    void visitDatum(const Field&, const std::string&) override { NOTIMP; }
+
+private: // members
+
+    eckit::Channel out_;
+    bool doit_;
+    bool porcelain_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace local
+} // namespace api
+} // namespace fdb5
+
+#endif
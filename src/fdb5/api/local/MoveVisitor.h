@@ -35,6 +35,9 @@ class MoveVisitor : public QueryVisitor<MoveElement> {
 
 public: // methods
 
+    /// Destructive operations are applied to one database at a time
+    static constexpr bool concurrent = false;
+
     MoveVisitor(eckit::Queue<MoveElement>& queue,
                 const metkit::mars::MarsRequest& request,
                 const eckit::URI& dest);
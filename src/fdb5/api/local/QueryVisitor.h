@@ -19,6 +19,12 @@
 #ifndef fdb5_api_local_QueryVisitor_H
 #define fdb5_api_local_QueryVisitor_H
 
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
 #include "fdb5/database/EntryVisitMechanism.h"
 
 #include "eckit/container/Queue.h"
@@ -40,6 +46,10 @@ public: // methods
 
     using ValueType = T;
 
+    /// Visitors that carry no state from one database to the next may be run concurrently, with
+    /// one instance per database.
+    static constexpr bool concurrent = true;
+
     QueryVisitor(eckit::Queue<ValueType>& queue, const metkit::mars::MarsRequest& request) :
         queue_(queue), request_(request) {}
 
@@ -50,6 +60,92 @@ protected: // members
 };
 
 
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Builds a separate QueryVisitor for each database when databases are visited concurrently.
+///
+/// If unordered, each visitor pushes directly into the shared output queue. If ordered, each
+/// visitor pushes into a bounded staging queue for its database, and collate() forwards these into
+/// the output queue one database at a time, in order.
+
+template <typename T>
+class QueryVisitorBuilder : public EntryVisitorBuilder {
+
+public: // types
+
+    using ValueType = T;
+    using VisitorConstructor = std::function<EntryVisitor*(eckit::Queue<ValueType>&)>;
+
+public: // methods
+
+    QueryVisitorBuilder(eckit::Queue<ValueType>& queue, VisitorConstructor ctor, bool ordered, size_t stagingSize=100) :
+        queue_(queue), ctor_(ctor), ordered_(ordered), stagingSize_(stagingSize) {}
+
+    std::unique_ptr<EntryVisitor> build(size_t index) override {
+        return std::unique_ptr<EntryVisitor>(ctor_(ordered_ ? staging(index) : queue_));
+    }
+
+    void complete(size_t index, std::exception_ptr error) override {
+        if (!ordered_) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = staging_.find(index);
+        if (it != staging_.end()) {
+            if (error) {
+                it->second->interrupt(error);
+            } else {
+                it->second->close();
+            }
+        }
+    }
+
+    void collate(size_t count) override {
+        if (!ordered_) return;
+
+        ValueType elem;
+        for (size_t index = 0; index < count; ++index) {
+            eckit::Queue<ValueType>& q(staging(index));
+            while (q.pop(elem) != -1) {
+                queue_.emplace(std::move(elem));
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            staging_.erase(index);
+        }
+    }
+
+    void abort(std::exception_ptr error) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!aborted_) aborted_ = error;
+        for (auto& kv : staging_) {
+            kv.second->interrupt(error);
+        }
+    }
+
+private: // methods
+
+    eckit::Queue<ValueType>& staging(size_t index) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (aborted_) std::rethrow_exception(aborted_);
+
+        auto it = staging_.find(index);
+        if (it == staging_.end()) {
+            it = staging_.emplace(index, std::unique_ptr<eckit::Queue<ValueType>>(new eckit::Queue<ValueType>(stagingSize_))).first;
+        }
+        return *it->second;
+    }
+
+private: // members
+
+    eckit::Queue<ValueType>& queue_;
+    VisitorConstructor ctor_;
+    bool ordered_;
+    size_t stagingSize_;
+
+    std::mutex mutex_;
+    std::map<size_t, std::unique_ptr<eckit::Queue<ValueType>>> staging_;
+    std::exception_ptr aborted_;
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 
 } // namespace local
@@ -38,6 +38,9 @@ class WipeVisitor : public QueryVisitor<WipeElement> {
 
 public: // methods
 
+    /// Destructive operations are applied to one database at a time
+    static constexpr bool concurrent = false;
+
     WipeVisitor(eckit::Queue<WipeElement>& queue,
                 const metkit::mars::MarsRequest& request,
                 bool doit,
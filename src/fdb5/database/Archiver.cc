@@ -11,11 +11,18 @@
 
 #include "fdb5/database/Archiver.h"
 
+#include <exception>
+#include <future>
+
 #include "eckit/config/Resource.h"
+#include "eckit/container/Queue.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/log/Log.h"
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/database/ArchiveVisitor.h"
 #include "fdb5/database/BaseArchiveVisitor.h"
+#include "fdb5/database/WriteVisitor.h"
 #include "fdb5/rules/Schema.h"
 #include "fdb5/rules/Rule.h"
 
@@ -23,20 +30,233 @@ namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Expands a field through the schema, recording the keys and rules it matches without selecting
+/// any index or archiving any data.
+
+class Archiver::ResolveVisitor : public WriteVisitor {
+
+public: // methods
+
+    ResolveVisitor(Archiver& owner, std::vector<Key>& prev) :
+        WriteVisitor(prev),
+        owner_(owner),
+        keys_(3),
+        schema_(nullptr) {}
+
+    bool selectDatabase(const Key& key, const Key&) override {
+        keys_[0] = key;
+        schema_ = &owner_.database(key).schema();
+        return true;
+    }
+
+    bool selectIndex(const Key& key, const Key&) override {
+        keys_[1] = key;
+        return true;
+    }
+
+    bool selectDatum(const Key& key, const Key& full) override {
+        keys_[2] = key;
+        full_ = full;
+        return true;
+    }
+
+    const Schema& databaseSchema() const override {
+        ASSERT(schema_);
+        return *schema_;
+    }
+
+    void print(std::ostream& out) const override {
+        out << "ResolveVisitor[]";
+    }
+
+public: // members
+
+    Archiver& owner_;
+
+    std::vector<Key> keys_;
+    Key full_;
+
+    const Schema* schema_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Archives the fields for one database on a dedicated thread. The thread is started on demand, and
+/// runs until the queue is closed by flush(), when the database is flushed.
+
+class Archiver::DatabaseWorker : public eckit::NonCopyable {
+
+public: // methods
+
+    DatabaseWorker(DB& db, size_t queueLength) :
+        db_(db),
+        queueLength_(queueLength) {}
+
+    ~DatabaseWorker() {
+        if (future_.valid()) {
+            try {
+                flush();
+            } catch (std::exception& e) {
+                eckit::Log::error() << "Error archiving to " << db_ << ": " << e.what() << std::endl;
+            }
+        }
+    }
+
+    void archive(const Key& index, const Key& datum, const void* data, size_t length) {
+
+        if (!future_.valid()) {
+            queue_.reset(new eckit::Queue<Task>(queueLength_));
+            future_ = std::async(std::launch::async, [this] { run(); });
+        }
+
+        // n.b. rethrows any error from the worker thread
+        queue_->emplace(index, datum, data, length);
+    }
+
+    /// Signal that no more fields will be queued before the flush
+    void close() {
+        if (future_.valid()) {
+            queue_->close();
+        }
+    }
+
+    /// Wait for the queued fields to be archived, and the database flushed
+    void wait() {
+        if (future_.valid()) {
+            future_.get();
+            queue_.reset();
+        }
+    }
+
+    void flush() {
+        close();
+        wait();
+    }
+
+private: // types
+
+    struct Task {
+        Task() : data_(0) {}
+        Task(const Key& index, const Key& datum, const void* data, size_t length) :
+            index_(index), datum_(datum), data_(static_cast<const char*>(data), length) {}
+
+        Key index_;
+        Key datum_;
+        eckit::Buffer data_;
+    };
+
+private: // methods
+
+    void run() {
+        try {
+            Key current;
+            db_.deselectIndex();
+
+            Task task;
+            while (queue_->pop(task) != -1) {
+                if (task.index_ != current) {
+                    db_.selectIndex(task.index_);
+                    current = task.index_;
+                }
+                db_.archive(task.datum_, task.data_, task.data_.size());
+            }
+
+            db_.flush();
+
+        } catch (...) {
+            queue_->interrupt(std::current_exception());
+            throw;
+        }
+    }
+
+private: // members
+
+    DB& db_;
+
+    size_t queueLength_;
+    std::unique_ptr<eckit::Queue<Task>> queue_;
+
+    std::future<void> future_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+Archiver::RuleCache::RuleCache(const Schema& schema) {
+    schema.valueKeywords(valueKeywords_);
+}
+
+std::string Archiver::RuleCache::signature(const Key& field) const {
+    std::string result;
+    for (const auto& kv : field) {
+        result += kv.first;
+        if (valueKeywords_.find(kv.first) != valueKeywords_.end()) {
+            result += '=';
+            result += kv.second;
+        }
+        result += ',';
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 
 Archiver::Archiver(const Config& dbConfig) :
     dbConfig_(dbConfig),
     current_(nullptr) {
+
+    static bool fdbArchiveWorkers = eckit::Resource<bool>("fdbArchiveWorkers;$FDB_ARCHIVE_WORKERS", false);
+    static long fdbArchiveQueueLength = eckit::Resource<long>("fdbArchiveQueueLength;$FDB_ARCHIVE_QUEUE_LENGTH", 200);
+
+    useWorkers_ = dbConfig_.getBool("archiveWorkers", fdbArchiveWorkers);
+    workerQueueLength_ = dbConfig_.getLong("archiveQueueLength", fdbArchiveQueueLength);
+    ASSERT(workerQueueLength_ > 0);
+
+    static long fdbMaxNbDBsOpen = eckit::Resource<long>("fdbMaxNbDBsOpen", 64);
+
+    long maxOpenDatabases = dbConfig_.getLong("maxOpenDatabases", fdbMaxNbDBsOpen);
+    ASSERT(maxOpenDatabases > 0);
+    maxOpenDatabases_ = maxOpenDatabases;
 }
 
 Archiver::~Archiver() {
 
-    flush(); // certify that all sessions are flushed before closing them
+    // Certify that all sessions are flushed before closing them. Errors must be reported by an explicit
+    // flush(), as they cannot be thrown from here.
+
+    try {
+        flush();
+    } catch (std::exception& e) {
+        eckit::Log::error() << "Error flushing Archiver on destruction: " << e.what() << std::endl;
+    }
 
+    workers_.clear();
     databases_.clear(); //< explicitly delete the DBs before schemas are destroyed
+    indexRules_.clear();
 }
 
 void Archiver::archive(const Key &key, const void* data, size_t len) {
+
+    if (useWorkers_) {
+
+        // The databases are only accessed from their worker threads. Find the keys here, and pass the
+        // field on to the worker.
+
+        static bool checkMissingKeysOnWrite = eckit::Resource<bool>("checkMissingKeysOnWrite", true);
+
+        std::vector<Key> keys(3);
+        Key full;
+        const Rule* rule = resolve(key, keys, full);
+
+        if (checkMissingKeysOnWrite) {
+            key.validateKeysOf(full);
+        }
+        rule->check(key);
+
+        worker(keys[0]).archive(keys[1], keys[2], data, len);
+        return;
+    }
+
     ArchiveVisitor visitor(*this, key, data, len);
     archive(key, visitor);
 }
@@ -58,10 +278,299 @@ void Archiver::archive(const Key &key, BaseArchiveVisitor& visitor) {
     rule->check(key);
 }
 
+void Archiver::archive(const std::vector<ArchiveElement>& elements) {
+
+    struct Datum {
+        Key key_;
+        const ArchiveElement* element_;
+    };
+
+    struct IndexGroup {
+        IndexGroup(const Key& key) : key_(key) {}
+        Key key_;
+        std::vector<Datum> data_;
+    };
+
+    struct DatabaseGroup {
+        DatabaseGroup(const Key& key) : key_(key) {}
+        Key key_;
+        std::vector<IndexGroup> indexes_;
+        std::map<Key, size_t> lookup_;
+    };
+
+    static bool checkMissingKeysOnWrite = eckit::Resource<bool>("checkMissingKeysOnWrite", true);
+
+    std::vector<DatabaseGroup> databases;
+    std::map<Key, size_t> lookup;
+
+    std::vector<Key> keys(3);
+    Key full;
+
+    for (const ArchiveElement& element : elements) {
+
+        const Rule* rule = resolve(element.key_, keys, full);
+
+        if (checkMissingKeysOnWrite) {
+            element.key_.validateKeysOf(full);
+        }
+        rule->check(element.key_);
+
+        auto db = lookup.find(keys[0]);
+        if (db == lookup.end()) {
+            db = lookup.emplace(keys[0], databases.size()).first;
+            databases.emplace_back(keys[0]);
+        }
+        DatabaseGroup& dbGroup = databases[db->second];
+
+        auto idx = dbGroup.lookup_.find(keys[1]);
+        if (idx == dbGroup.lookup_.end()) {
+            idx = dbGroup.lookup_.emplace(keys[1], dbGroup.indexes_.size()).first;
+            dbGroup.indexes_.emplace_back(keys[1]);
+        }
+        dbGroup.indexes_[idx->second].data_.push_back(Datum{keys[2], &element});
+    }
+
+    // Databases and indexes are selected directly here. Ensure that the next archive() through the
+    // visitors reselects them.
+
+    prev_.assign(3, Key());
+    current_ = nullptr;
+
+    for (const DatabaseGroup& group : databases) {
+        if (useWorkers_) {
+            DatabaseWorker& w(worker(group.key_));
+            for (const IndexGroup& index : group.indexes_) {
+                for (const Datum& datum : index.data_) {
+                    w.archive(index.key_, datum.key_, datum.element_->data_, datum.element_->length_);
+                }
+            }
+            continue;
+        }
+
+        DB& db = database(group.key_);
+        db.deselectIndex();
+        for (const IndexGroup& index : group.indexes_) {
+            db.selectIndex(index.key_);
+            for (const Datum& datum : index.data_) {
+                db.archive(datum.key_, datum.element_->data_, datum.element_->length_);
+            }
+        }
+        db.deselectIndex();
+    }
+}
+
+const Rule* Archiver::resolve(const Key& field, std::vector<Key>& keys, Key& full) {
+
+    if (!dbRules_) {
+        dbRules_.reset(new RuleCache(dbConfig_.schema()));
+    }
+
+    auto dbRule = dbRules_->rules_.find(dbRules_->signature(field));
+    if (dbRule == dbRules_->rules_.end()) {
+        return resolveFully(field, keys, full);
+    }
+
+    keys.assign(3, Key());
+    full = Key();
+    dbRule->second->expandKeys(field, keys[0], full);
+
+    // The index and datum rules come from the database's own schema
+
+    RuleCache& cache(indexRules(keys[0]));
+    auto rule = cache.rules_.find(cache.signature(field));
+    if (rule == cache.rules_.end()) {
+        return resolveFully(field, keys, full);
+    }
+
+    const Rule* datumRule = rule->second;
+    ASSERT(datumRule->parent());
+
+    full = keys[0];
+    datumRule->parent()->expandKeys(field, keys[1], full);
+    datumRule->expandKeys(field, keys[2], full);
+
+    return datumRule;
+}
+
+const Rule* Archiver::resolveFully(const Key& field, std::vector<Key>& keys, Key& full) {
+
+    std::vector<Key> prev;
+    ResolveVisitor visitor(*this, prev);
+
+    dbConfig_.schema().expand(field, visitor);
+
+    const Rule* rule = visitor.rule();
+    if (rule == nullptr) {
+        std::ostringstream oss;
+        oss << "FDB: Could not find a rule to archive " << field;
+        throw eckit::SeriousBug(oss.str());
+    }
+
+    keys = visitor.keys_;
+    full = visitor.full_;
+
+    ASSERT(keys[0].rule());
+    dbRules_->rules_[dbRules_->signature(field)] = keys[0].rule();
+
+    RuleCache& cache(indexRules(keys[0]));
+    cache.rules_[cache.signature(field)] = rule;
+
+    return rule;
+}
+
+Archiver::RuleCache& Archiver::indexRules(const Key& dbKey) {
+
+    auto it = indexRules_.find(dbKey);
+    if (it == indexRules_.end()) {
+        it = indexRules_.emplace(dbKey, RuleCache(database(dbKey).schema())).first;
+    }
+    return it->second;
+}
+
+Archiver::DatabaseWorker& Archiver::worker(const Key& dbKey) {
+
+    // n.b. always look up the database, so that it is marked as recently used
+
+    DB& db = database(dbKey);
+
+    auto it = workers_.find(dbKey);
+    if (it == workers_.end()) {
+        it = workers_.emplace(dbKey, std::unique_ptr<DatabaseWorker>(new DatabaseWorker(db, workerQueueLength_))).first;
+    }
+    return *it->second;
+}
+
+void Archiver::flushWorkers() {
+
+    // Close all of the queues before waiting for any, so the databases are flushed concurrently
+
+    for (auto& w : workers_) {
+        w.second->close();
+    }
+
+    std::exception_ptr error;
+    for (auto& w : workers_) {
+        try {
+            w.second->wait();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void Archiver::waitPending() {
+    if (pending_.valid()) {
+        std::shared_future<void> pending(std::move(pending_));
+        pending_ = std::shared_future<void>();
+        pending.get();
+    }
+}
+
 void Archiver::flush() {
+
+    // The background flushes precede this one, but the open databases are flushed regardless of
+    // any error in them
+
+    std::exception_ptr error;
+    try {
+        waitPending();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    flushWorkers();
+
     for (store_t::iterator i = databases_.begin(); i != databases_.end(); ++i) {
         i->second.second->flush();
     }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::shared_future<void> Archiver::flushAsync(const std::function<void()>& done) {
+
+    // Signal the workers that no more fields are coming, without waiting for them
+
+    for (auto& w : workers_) {
+        w.second->close();
+    }
+
+    // The following archives open the databases afresh, and so reselect them
+
+    std::shared_ptr<store_t> databases(new store_t(std::move(databases_)));
+    std::shared_ptr<std::map<Key, std::unique_ptr<DatabaseWorker>>> workers(
+        new std::map<Key, std::unique_ptr<DatabaseWorker>>(std::move(workers_)));
+
+    databases_.clear();
+    workers_.clear();
+    indexRules_.clear();
+    prev_.assign(3, Key());
+    current_ = nullptr;
+
+    // Only one background flush is in progress at a time. n.b. its error is rethrown by the next.
+
+    std::shared_future<void> previous(pending_);
+    if (previous.valid()) {
+        previous.wait();
+    }
+
+    pending_ = std::async(std::launch::async, [previous, databases, workers, done] {
+
+        // Publish the indexes of the earlier flushes first, so that those of this flush mask them
+
+        std::exception_ptr error;
+        if (previous.valid()) {
+            try {
+                previous.get();
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+
+        // n.b. DB::flush() syncs the data before writing the indexes into the TOC. Where that fails, the
+        //      fields not yet indexed are discarded, so that closing the database does not publish them.
+
+        for (auto& db : *databases) {
+            try {
+                auto w = workers->find(db.first);
+                if (w != workers->end()) {
+                    w->second->wait();
+                }
+                db.second.second->flush();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+                try {
+                    db.second.second->discard();
+                } catch (std::exception& e) {
+                    eckit::Log::error() << "Error discarding the unflushed fields of " << db.first << ": "
+                                        << e.what() << std::endl;
+                }
+            }
+        }
+
+        workers->clear();
+        databases->clear();
+
+        if (done) {
+            done();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }).share();
+
+    return pending_;
 }
 
 
@@ -75,9 +584,7 @@ DB& Archiver::database(const Key &key) {
         return db;
     }
 
-    static size_t fdbMaxNbDBsOpen = eckit::Resource<size_t>("fdbMaxNbDBsOpen", 64);
-
-    if (databases_.size() >= fdbMaxNbDBsOpen) {
+    if (databases_.size() >= maxOpenDatabases_) {
         bool found = false;
         time_t oldest = ::time(0) + 24 * 60 * 60;
         Key oldK;
@@ -89,8 +596,22 @@ DB& Archiver::database(const Key &key) {
             }
         }
         if (found) {
+
+            // Closing the database publishes its indexes. If it was reopened since a flushAsync(), those of
+            // the background flush must be published first. n.b. any error is rethrown by the next flush.
+
+            if (pending_.valid()) {
+                pending_.wait();
+            }
+
             eckit::Log::info() << "Closing database " << *databases_[oldK].second << std::endl;
+            auto w = workers_.find(oldK);
+            if (w != workers_.end()) {
+                w->second->flush();
+                workers_.erase(w);
+            }
             databases_.erase(oldK);
+            indexRules_.erase(oldK);
         }
     }
 
@@ -17,10 +17,19 @@
 #define fdb5_Archiver_H
 
 #include <time.h>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "eckit/memory/NonCopyable.h"
+#include "eckit/types/Types.h"
 
+#include "fdb5/api/helpers/ArchiveElement.h"
 #include "fdb5/database/DB.h"
 #include "fdb5/config/Config.h"
 
@@ -34,10 +43,28 @@ namespace fdb5 {
 
 class Key;
 class BaseArchiveVisitor;
+class Rule;
 class Schema;
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Archives fields into the databases matched by the schema.
+///
+/// Optionally (fdbArchiveWorkers, or archiveWorkers in the config), each open database is given its own
+/// worker thread and queue, so that the data writes and index insertions for different databases proceed
+/// concurrently. Fields are then matched against the schema on the calling thread, and their data copied
+/// into the queue. flush() waits for all of the queued fields to be archived, and the databases flushed.
+///
+/// flushAsync() hands the open databases over to a background thread, which flushes and closes them, so
+/// that the following archives proceed into newly opened databases (and so new data files and indexes).
+/// Each database flushes its data before publishing its indexes, and the background flushes complete in
+/// order, so no index is published before its data is durable, nor published after a later one. Only one
+/// background flush is in progress at a time. Where a database cannot be flushed, the fields archived
+/// into it since its last flush are discarded rather than indexed.
+///
+/// At most fdbMaxNbDBsOpen (maxOpenDatabases in the config) databases are open at once. Beyond that, the
+/// least recently used database is closed, once any background flush has completed.
+
 class Archiver : public eckit::NonCopyable {
 
 public: // methods
@@ -49,21 +76,59 @@ public: // methods
     void archive(const Key &key, BaseArchiveVisitor& visitor);
     void archive(const Key &key, const void* data, size_t len);
 
+    /// Archive a batch of fields. The fields are grouped by database and index, and the data of each
+    /// group is written contiguously. All of the fields are matched against the schema before any data
+    /// is written, so a field that cannot be archived fails the whole batch.
+    void archive(const std::vector<ArchiveElement>& elements);
+
     /// Flushes all buffers and closes all data handles into a consistent DB state
     /// @note always safe to call
+    /// @note waits for any background flushes, and rethrows their errors
     void flush();
 
+    /// Flushes and closes the open databases in the background, once any previous background flush has
+    /// completed. The returned future completes once all of the flushes started so far have completed, and
+    /// rethrows the first error in any of them.
+    /// @param done Called on the background thread once the flush has completed, before the future completes
+    std::shared_future<void> flushAsync(const std::function<void()>& done = std::function<void()>());
+
     friend std::ostream &operator<<(std::ostream &s, const Archiver &x) {
         x.print(s);
         return s;
     }
 
+private: // types
+
+    class ResolveVisitor;
+    class DatabaseWorker;
+
+    /// The rules matched by previously archived fields. Fields with the same signature expand through
+    /// the same rules (see Schema::valueKeywords), so the expansion need not be repeated.
+    struct RuleCache {
+        RuleCache(const Schema& schema);
+        std::string signature(const Key& field) const;
+
+        eckit::StringSet valueKeywords_;
+        std::unordered_map<std::string, const Rule*> rules_;
+    };
+
 private: // methods
 
     void print(std::ostream &out) const;
 
     DB& database(const Key &key);
 
+    /// Find the database, index and datum keys of a field, and the (datum level) rule it matches
+    const Rule* resolve(const Key& field, std::vector<Key>& keys, Key& full);
+    const Rule* resolveFully(const Key& field, std::vector<Key>& keys, Key& full);
+
+    RuleCache& indexRules(const Key& dbKey);
+
+    DatabaseWorker& worker(const Key& dbKey);
+    void flushWorkers();
+
+    void waitPending();
+
 private: // members
 
     friend class BaseArchiveVisitor;
@@ -77,6 +142,16 @@ private: // members
     std::vector<Key> prev_;
 
     DB* current_;
+
+    std::unique_ptr<RuleCache> dbRules_;     ///< First level rules, in the master schema
+    std::map<Key, RuleCache> indexRules_;    ///< Datum rules, in the schema of each open database
+
+    bool useWorkers_;
+    size_t workerQueueLength_;
+    size_t maxOpenDatabases_;  ///< Beyond which the least recently used database is closed
+    std::map<Key, std::unique_ptr<DatabaseWorker>> workers_;
+
+    std::shared_future<void> pending_; ///< The most recent background flush
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -119,6 +119,10 @@ public:
     virtual DbStats stats() const = 0;
     virtual bool axis(const std::string& keyword, eckit::StringSet& s) const = 0;
     virtual bool retrieve(const Key& key, Field& field) const = 0;
+
+    /// Update the catalogue with any changes made since it was opened, or last refreshed
+    /// @returns true if anything has changed
+    virtual bool refresh() = 0;
 };
 
 
@@ -129,6 +133,14 @@ public:
     virtual void overlayDB(const Catalogue& otherCatalogue, const std::set<std::string>& variableKeys, bool unmount) = 0;
     virtual void index(const Key& key, const eckit::URI& uri, eckit::Offset offset, eckit::Length length) = 0;
     virtual void reconsolidate() = 0;
+
+    /// Forget the fields indexed since the last flush, without publishing them. The catalogue can then be
+    /// cleaned and closed without publishing anything more.
+    virtual void discard() = 0;
+
+    /// Rewrite the reachable fields of sparsely used data files through the store, and replace the indexes
+    /// that refer to them. n.b. report only when doit=false.
+    virtual void compact(Store& store, std::ostream& out, bool porcelain, bool doit) = 0;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -83,6 +83,12 @@ bool DB::axis(const std::string &keyword, eckit::StringSet &s) const {
     return cat->axis(keyword, s);
 }
 
+bool DB::refresh() {
+    CatalogueReader* cat = dynamic_cast<CatalogueReader*>(catalogue_.get());
+    ASSERT(cat);
+    return cat->refresh();
+}
+
 bool DB::inspect(const Key& key, Field& field) {
 
     eckit::Log::debug<LibFdb5>() << "Trying to retrieve key " << key << std::endl;
@@ -126,6 +132,14 @@ void DB::flush() {
     catalogue_->flush();
 }
 
+void DB::discard() {
+
+    CatalogueWriter* cat = dynamic_cast<CatalogueWriter*>(catalogue_.get());
+    ASSERT(cat);
+
+    cat->discard();
+}
+
 void DB::close() {
     flush();
     catalogue_->clean();
@@ -164,6 +178,13 @@ void DB::reconsolidate() {
     cat->reconsolidate();
 }
 
+void DB::compact(std::ostream& out, bool porcelain, bool doit) {
+    CatalogueWriter* cat = dynamic_cast<CatalogueWriter*>(catalogue_.get());
+    ASSERT(cat);
+
+    cat->compact(store(), out, porcelain, doit);
+}
+
 void DB::index(const Key &key, const eckit::PathName &path, eckit::Offset offset, eckit::Length length) {
     if (catalogue_->type() == TocEngine::typeName()) {
         CatalogueWriter* cat = dynamic_cast<CatalogueWriter*>(catalogue_.get());
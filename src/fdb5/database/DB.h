@@ -62,6 +62,13 @@ public: // methods
     void flush();
     void close();
 
+    /// For writers, forget the fields archived since the last flush without indexing them, e.g. as their
+    /// data could not be flushed. Nothing more is published when the DB is closed.
+    void discard();
+
+    /// For readers, pick up any indexes added since the DB was opened (or last refreshed)
+    bool refresh();
+
     bool exists() const;
 
     void dump(std::ostream& out, bool simple=false, const eckit::Configuration& conf = eckit::LocalConfiguration()) const;
@@ -71,6 +78,7 @@ public: // methods
 
     DbStats stats() const;
     void reconsolidate();
+    void compact(std::ostream& out, bool porcelain, bool doit);
 
     // for ToC tools
     void hideContents();
@@ -10,6 +10,12 @@
 
 #include "fdb5/database/EntryVisitMechanism.h"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "eckit/config/Resource.h"
 #include "eckit/io/AutoCloser.h"
 
 #include "fdb5/api/helpers/FDBToolRequest.h"
@@ -70,15 +76,29 @@ time_t EntryVisitor::indexTimestamp() const {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+EntryVisitorBuilder::~EntryVisitorBuilder() {}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 EntryVisitMechanism::EntryVisitMechanism(const Config& config) :
     dbConfig_(config),
-    fail_(true) {}
+    fail_(true) {
 
-void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& visitor) {
+    static long fdbVisitThreads = eckit::Resource<long>("fdbVisitThreads;$FDB_VISIT_THREADS", 1);
+    static bool fdbVisitOrdered = eckit::Resource<bool>("fdbVisitOrdered;$FDB_VISIT_ORDERED", true);
 
+    long threads = config.getLong("visitThreads", fdbVisitThreads);
+    threads_ = (threads < 1) ? 1 : threads;
+    ordered_ = config.getBool("visitOrdered", fdbVisitOrdered);
+}
+
+static void checkVisitor(EntryVisitor& visitor) {
     if (visitor.visitEntries() && !visitor.visitIndexes()) {
         throw FDBVisitException("Cannot visit entries without visiting indexes", Here());
     }
+}
+
+std::vector<URI> EntryVisitMechanism::locations(const FDBToolRequest& request) const {
 
     // A request against all is the same as using an empty key in visitableLocations.
 
@@ -88,30 +108,41 @@ void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& vis
 
     Log::debug<LibFdb5>() << "REQUEST ====> " << request.request() << std::endl;
 
-    try {
+    // n.b. it is not an error if nothing is found (especially in a sub-fdb).
+
+    return Manager(dbConfig_).visitableLocations(request.request(), request.all());
+}
 
-        std::vector<URI> uris(Manager(dbConfig_).visitableLocations(request.request(), request.all()));
+void EntryVisitMechanism::visitLocation(const URI& uri, EntryVisitor& visitor) {
 
-        // n.b. it is not an error if nothing is found (especially in a sub-fdb).
+    PathName path(uri.path());
+    if (path.exists()) {
+        if (!path.isDir())
+            path = path.dirName();
+        path = path.realName();
 
-        // And do the visitation
+        Log::debug<LibFdb5>() << "FDB processing Path " << path << std::endl;
 
-        for (URI uri : uris) {
+        std::unique_ptr<DB> db = DB::buildReader(eckit::URI(uri.scheme(), path), dbConfig_);
+        ASSERT(db->open());
+        eckit::AutoCloser<DB> closer(*db);
 
-            PathName path(uri.path());
-            if (path.exists()) {
-                if (!path.isDir())
-                    path = path.dirName();
-                path = path.realName();
+        db->visitEntries(visitor, false);
+    }
+}
 
-                Log::debug<LibFdb5>() << "FDB processing Path " << path << std::endl;
+void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& visitor) {
 
-                std::unique_ptr<DB> db = DB::buildReader(eckit::URI(uri.scheme(), path), dbConfig_);
-                ASSERT(db->open());
-                eckit::AutoCloser<DB> closer(*db);
+    checkVisitor(visitor);
 
-                db->visitEntries(visitor, false);
-            }
+    try {
+
+        std::vector<URI> uris(locations(request));
+
+        // And do the visitation
+
+        for (const URI& uri : uris) {
+            visitLocation(uri, visitor);
         }
 
     } catch (eckit::UserError&) {
@@ -120,11 +151,82 @@ void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitor& vis
         Log::warning() << e.what() << std::endl;
         if (fail_) throw;
     }
+}
+
+void EntryVisitMechanism::visit(const FDBToolRequest& request, EntryVisitorBuilder& builder) {
+
+    try {
+
+        std::vector<URI> uris(locations(request));
+
+        // Databases are handed out to the workers strictly in order, so the lowest-numbered incomplete
+        // database is always being worked on. This allows the builder to collate output in order.
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> stop(false);
+
+        std::mutex errorMutex;
+        std::exception_ptr error;
+
+        auto fail = [&](std::exception_ptr e) {
+            {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = e;
+            }
+            stop = true;
+            builder.abort(e);
+        };
+
+        auto worker = [&] {
+            size_t index;
+            while (!stop && (index = next++) < uris.size()) {
+
+                std::exception_ptr failed;
+                try {
+                    std::unique_ptr<EntryVisitor> visitor(builder.build(index));
+                    checkVisitor(*visitor);
+                    visitLocation(uris[index], *visitor);
+                } catch (...) {
+                    failed = std::current_exception();
+                }
+
+                builder.complete(index, failed);
+                if (failed) {
+                    fail(failed);
+                    return;
+                }
+            }
+        };
 
+        size_t nthreads = std::min(threads_, uris.size());
+        Log::debug<LibFdb5>() << "Visiting " << uris.size() << " databases on " << nthreads << " threads" << std::endl;
 
+        std::vector<std::thread> workers;
+        workers.reserve(nthreads);
+        for (size_t i = 0; i < nthreads; ++i) {
+            workers.emplace_back(worker);
+        }
+
+        try {
+            builder.collate(uris.size());
+        } catch (...) {
+            fail(std::current_exception());
+        }
 
+        for (std::thread& t : workers) {
+            t.join();
+        }
 
+        if (error) {
+            std::rethrow_exception(error);
+        }
 
+    } catch (eckit::UserError&) {
+        throw;
+    } catch (eckit::Exception& e) {
+        Log::warning() << e.what() << std::endl;
+        if (fail_) throw;
+    }
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -14,6 +14,11 @@
 #ifndef fdb5_EntryVisitMechanism_H
 #define fdb5_EntryVisitMechanism_H
 
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include "eckit/filesystem/URI.h"
 #include "eckit/memory/NonCopyable.h"
 
 #include "fdb5/config/Config.h"
@@ -61,6 +66,33 @@ protected:  // members
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// Supplies a fresh visitor for each database when databases are visited concurrently. Visitors
+/// carry per-database state, so they cannot be shared between worker threads.
+
+class EntryVisitorBuilder : public eckit::NonCopyable {
+
+public:  // methods
+
+    virtual ~EntryVisitorBuilder();
+
+    /// Called on a worker thread, once per database, with the index of the database in visitation order
+    virtual std::unique_ptr<EntryVisitor> build(size_t index) = 0;
+
+    /// Called on the worker thread once the visitor for the given database has been destroyed.
+    /// If the visitation failed, the exception is supplied.
+    virtual void complete(size_t index, std::exception_ptr error) {}
+
+    /// Called on the visiting thread while the workers run. Must return once all (count) databases
+    /// have been completed, or throw.
+    virtual void collate(size_t count) {}
+
+    /// Called (from any thread) if the visitation is abandoned, to release any blocked workers and
+    /// the collating thread
+    virtual void abort(std::exception_ptr error) {}
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
 class EntryVisitMechanism : public eckit::NonCopyable {
 
 public:  // methods
@@ -69,12 +101,31 @@ public:  // methods
 
     void visit(const FDBToolRequest& request, EntryVisitor& visitor);
 
+    /// Visit the matching databases on a bounded pool of worker threads (see threads()), using a
+    /// separate visitor for each database
+    void visit(const FDBToolRequest& request, EntryVisitorBuilder& builder);
+
+    /// Number of databases that are opened and visited concurrently
+    size_t threads() const { return threads_; }
+
+    /// Whether output of concurrently visited databases should be delivered in database order
+    bool ordered() const { return ordered_; }
+
+private:  // methods
+
+    std::vector<eckit::URI> locations(const FDBToolRequest& request) const;
+
+    void visitLocation(const eckit::URI& uri, EntryVisitor& visitor);
+
 private:  // members
 
     const Config& dbConfig_;
 
     // Fail on error
     bool fail_;
+
+    size_t threads_;
+    bool ordered_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
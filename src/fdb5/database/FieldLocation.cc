@@ -9,6 +9,7 @@
  */
 
 #include "eckit/exception/Exceptions.h"
+#include "eckit/io/MultiHandle.h"
 #include "eckit/log/Log.h"
 #include "eckit/thread/AutoLock.h"
 #include "eckit/thread/Mutex.h"
@@ -147,6 +148,15 @@ eckit::URI FieldLocation::fullUri() const {
 FieldLocation::FieldLocation(const eckit::URI& uri, eckit::Offset offset, eckit::Length length, const Key& remapKey)
     : uri_(uri), offset_(offset), length_(length), remapKey_(remapKey) {}
 
+eckit::DataHandle* FieldLocation::readMany(const std::vector<std::shared_ptr<const FieldLocation>>& locations) const {
+
+    eckit::MultiHandle* result = new eckit::MultiHandle;
+    for (const auto& location : locations) {
+        (*result) += location->dataHandle();
+    }
+    return result;
+}
+
 void FieldLocation::encode(eckit::Stream& s) const {
     s << uri_;
     s << offset_;
@@ -17,6 +17,7 @@
 #define fdb5_FieldLocation_H
 
 #include <memory>
+#include <vector>
 #include <eckit/filesystem/URI.h>
 
 #include "eckit/filesystem/PathName.h"
@@ -57,6 +58,15 @@ public: // methods
 
     virtual eckit::DataHandle *dataHandle() const = 0;
 
+    /// Locations with the same (non-empty) batch key can be read together, with one call to
+    /// readMany(), e.g. as they are served by the same remote server. By default locations are read
+    /// one at a time.
+    virtual std::string batchKey() const { return std::string(); }
+
+    /// @returns a handle that reads the data of all of the locations, in order. The locations must all
+    ///          share the batch key of this location.
+    virtual eckit::DataHandle* readMany(const std::vector<std::shared_ptr<const FieldLocation>>& locations) const;
+
     /// Create a (shared) copy of the current object, for storage in a general container.
     virtual std::shared_ptr<FieldLocation> make_shared() const = 0;
 
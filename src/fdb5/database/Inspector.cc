@@ -10,6 +10,11 @@
 
 #include "fdb5/database/Inspector.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+
 #include "eckit/config/Resource.h"
 #include "eckit/log/Log.h"
 #include "eckit/log/Plural.h"
@@ -17,10 +22,14 @@
 #include "metkit/mars/MarsRequest.h"
 
 #include "fdb5/LibFdb5.h"
+#include "fdb5/database/DB.h"
 #include "fdb5/database/Notifier.h"
 #include "fdb5/database/MultiRetrieveVisitor.h"
+#include "fdb5/database/ReadVisitor.h"
 #include "fdb5/io/HandleGatherer.h"
 #include "fdb5/rules/Schema.h"
+#include "fdb5/types/Type.h"
+#include "fdb5/types/TypesRegistry.h"
 
 using namespace eckit;
 
@@ -28,65 +37,207 @@ namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
-InspectIterator::InspectIterator() : index_(0) {}
-
-InspectIterator::~InspectIterator() {
-    queue_.clear();
+static void purgeDB(Key& key, DB*& db) {
+    Log::debug() << "Purging DB with key " << key << std::endl;
+    delete db;
 }
 
-void InspectIterator::emplace(ListElement&& elem) {
-    queue_.push_back(elem);
+DBCache::DBCache(size_t capacity) :
+    databases_(capacity, &purgeDB) {}
+
+DBCache::~DBCache() {}
+
+DB* DBCache::checkout(const Key& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (databases_.exists(key)) {
+        return databases_.extract(key);
+    }
+    return nullptr;
 }
 
-bool InspectIterator::next(ListElement& elem) {
-    if (index_ >= queue_.size())
-        return false;
-    elem = queue_[index_];
-    index_++;
-    return true;
+void DBCache::release(DB* db) {
+    ASSERT(db);
+    std::unique_ptr<DB> duplicate;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!databases_.exists(db->key())) {
+            databases_.insert(db->key(), db);
+            return;
+        }
+        duplicate.reset(db);
+    }
+    Log::debug<LibFdb5>() << "Closing duplicate DB with key " << duplicate->key() << std::endl;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-static void purgeDB(Key& key, DB*& db) {
-    Log::debug() << "Purging DB with key " << key << std::endl;
-    delete db;
+namespace {
+
+class NullNotifier : public Notifier {
+    void notifyWind() const override {}
+};
+
+/// Expands a request only as far as the database keys, without opening any databases.
+
+class DatabaseKeyCollector : public ReadVisitor {
+
+public: // methods
+
+    DatabaseKeyCollector(const Notifier& wind, std::vector<Key>& keys) :
+        wind_(wind), keys_(keys) {}
+
+private: // methods
+
+    bool selectDatabase(const Key& key, const Key&) override {
+        keys_.push_back(key);
+        return false;
+    }
+
+    bool selectIndex(const Key&, const Key&) override { NOTIMP; }
+    bool selectDatum(const Key&, const Key&) override { NOTIMP; }
+    const Schema& databaseSchema() const override { NOTIMP; }
+
+    void values(const metkit::mars::MarsRequest& request,
+                const std::string& keyword,
+                const TypesRegistry& registry,
+                eckit::StringList& values) override {
+        registry.lookupType(keyword).getValues(request, keyword, values, wind_, nullptr);
+    }
+
+    void print(std::ostream& out) const override {
+        out << "DatabaseKeyCollector[]";
+    }
+
+private: // members
+
+    const Notifier& wind_;
+    std::vector<Key>& keys_;
+};
+
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+
 Inspector::Inspector(const Config& dbConfig) :
-    databases_(Resource<size_t>("fdbMaxOpenDatabases", 16), &purgeDB),
-    dbConfig_(dbConfig) {}
+    databases_(std::make_shared<DBCache>(Resource<size_t>("fdbMaxOpenDatabases", 16))),
+    dbConfig_(dbConfig) {
 
-Inspector::~Inspector() {
+    static long fdbInspectThreads = Resource<long>("fdbInspectThreads;$FDB_INSPECT_THREADS", 1);
+
+    static long fdbInspectQueueSize = Resource<long>("fdbInspectQueueSize;$FDB_INSPECT_QUEUE_SIZE", 100);
+
+    long threads = dbConfig_.getLong("inspectThreads", fdbInspectThreads);
+    threads_ = (threads < 1) ? 1 : threads;
+
+    long queueSize = dbConfig_.getLong("inspectQueueSize", fdbInspectQueueSize);
+    queueSize_ = (queueSize < 1) ? 1 : queueSize;
 }
 
-ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request,
-                                const Schema& schema,
-                                const fdb5::Notifier& notifyee) const {
+Inspector::~Inspector() {
+}
 
-    InspectIterator* iterator = new InspectIterator();
-    MultiRetrieveVisitor visitor(notifyee, *iterator, databases_, dbConfig_);
+// n.b. The workers capture copies of the configuration and request, and share the database cache and notifier,
+//      so that they do not depend on the Inspector, which the returned iterator may outlive. The schemas are
+//      owned by the SchemaRegistry. The iterator joins the worker when it is destroyed.
 
-    Log::debug<LibFdb5>() << "Using schema: " << schema << std::endl;
+ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request, std::shared_ptr<const Notifier> notifyee) const {
 
-    schema.expand(request, visitor);
+    ASSERT(notifyee);
 
-    using QueryIterator = APIIterator<ListElement>;
-    return QueryIterator(iterator);
-}
+    if (threads_ > 1) {
+        return pipelinedInspect(request, notifyee);
+    }
 
-ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request) const {
+    Log::debug<LibFdb5>() << "Using schema: " << dbConfig_.schema() << std::endl;
 
-    class NullNotifier : public Notifier {
-        void notifyWind() const override {}
+    auto async_worker = [databases = databases_, config = dbConfig_, request, notifyee] (Queue<ListElement>& queue) {
+        MultiRetrieveVisitor visitor(*notifyee, queue, *databases, config);
+        config.schema().expand(request, visitor);
     };
 
-    return inspect(request, NullNotifier());
+    return ListIterator(APIIterator<ListElement>(new InspectIterator(async_worker, queueSize_)));
 }
 
-ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request, const Notifier& notifyee) const {
+ListIterator Inspector::pipelinedInspect(const metkit::mars::MarsRequest& request,
+                                         std::shared_ptr<const Notifier> notifyee) const {
+
+    Log::debug<LibFdb5>() << "Using schema: " << dbConfig_.schema() << " (pipelined, " << threads_ << " threads)" << std::endl;
+
+    auto async_worker = [databases = databases_, config = dbConfig_, request, notifyee,
+                         threads = threads_, queueSize = queueSize_] (Queue<ListElement>& queue) {
+
+        std::vector<Key> dbKeys;
+        DatabaseKeyCollector collector(*notifyee, dbKeys);
+        config.schema().expand(request, collector);
+
+        // Each database streams its elements through its own bounded staging queue. Databases are
+        // handed to the workers strictly in order, so the database being forwarded is always either
+        // complete or being worked on, and memory use is bounded by the staging queues in flight.
+
+        std::vector<std::unique_ptr<Queue<ListElement>>> staging;
+        staging.reserve(dbKeys.size());
+        for (size_t i = 0; i < dbKeys.size(); ++i) {
+            staging.emplace_back(new Queue<ListElement>(queueSize));
+        }
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> stop(false);
+
+        auto worker = [&] {
+            size_t index;
+            while (!stop && (index = next++) < dbKeys.size()) {
+                try {
+                    MultiRetrieveVisitor visitor(*notifyee, *staging[index], *databases, config);
+                    ReadVisitor& v(visitor);
+                    if (v.selectDatabase(dbKeys[index], dbKeys[index])) {
+                        v.databaseSchema().expandSecond(request, v, dbKeys[index]);
+                    }
+                    staging[index]->close();
+                } catch (...) {
+                    staging[index]->interrupt(std::current_exception());
+                    stop = true;
+                    return;
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < std::min(threads, dbKeys.size()); ++i) {
+            workers.emplace_back(worker);
+        }
+
+        std::exception_ptr error;
+        try {
+            ListElement elem;
+            for (size_t index = 0; index < dbKeys.size(); ++index) {
+                while (staging[index]->pop(elem) != -1) {
+                    queue.emplace(std::move(elem));
+                }
+                staging[index].reset();
+            }
+        } catch (...) {
+            error = std::current_exception();
+            stop = true;
+            for (auto& q : staging) {
+                if (q) q->interrupt(error);
+            }
+        }
+
+        for (std::thread& t : workers) {
+            t.join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    };
+
+    return ListIterator(APIIterator<ListElement>(new InspectIterator(async_worker, queueSize_)));
+}
 
-    return inspect(request, dbConfig_.schema(), notifyee);
+ListIterator Inspector::inspect(const metkit::mars::MarsRequest& request) const {
+    // n.b. a notifier for each inspection, as it is used on the worker threads
+    return inspect(request, std::make_shared<NullNotifier>());
 }
 
 void Inspector::visitEntries(const FDBToolRequest &request, EntryVisitor &visitor) const {
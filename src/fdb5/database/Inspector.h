@@ -19,6 +19,8 @@
 #include <iosfwd>
 #include <cstdlib>
 #include <map>
+#include <memory>
+#include <mutex>
 
 #include "fdb5/config/Config.h"
 #include "fdb5/api/helpers/ListIterator.h"
@@ -48,16 +50,37 @@ class EntryVisitor;
 
 //----------------------------------------------------------------------------------------------------------------------
 
-class InspectIterator : public APIIteratorBase<ListElement> {
-public:
-    InspectIterator();
-    ~InspectIterator();
+/// Inspection results are streamed from the schema expansion (the producer, on a worker thread)
+/// to the consumer through a bounded queue, so memory use is independent of the request size and
+/// reading can begin before the expansion has completed.
 
-    void emplace(ListElement&& elem);
-    bool next(ListElement& elem) override;
-private:
-    std::vector<ListElement> queue_;
-    size_t index_;
+using InspectIterator = APIAsyncIterator<ListElement>;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Cache of open databases, shared between the (possibly concurrent) visitors of an Inspector.
+/// A database is checked out for exclusive use by one visitor, and released back to the cache
+/// once the visitor has finished with it. If the same database was opened by more than one visitor,
+/// only the first released is kept.
+
+class DBCache : public eckit::NonCopyable {
+
+public: // methods
+
+    DBCache(size_t capacity);
+
+    ~DBCache();
+
+    /// @returns the cached database, or nullptr if it is not cached (or is in use)
+    DB* checkout(const Key& key);
+
+    void release(DB* db);
+
+private: // members
+
+    std::mutex mutex_;
+
+    eckit::CacheLRU<Key,DB*> databases_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -76,10 +99,12 @@ public: // methods
     ListIterator inspect(const metkit::mars::MarsRequest& request) const;
 
     /// Retrieves the data selected by the MarsRequest to the provided DataHandle
-    /// @param notifyee is an object that handles notifications for the client, e.g. wind conversion
+    /// @param notifyee is an object that handles notifications for the client, e.g. wind conversion.
+    ///        As the request is expanded asynchronously, it is shared with the returned iterator
     /// @returns  data handle to read from
+    /// @note the iterator may outlive the Inspector. The expansion only uses state that it shares, or owns.
 
-    ListIterator inspect(const metkit::mars::MarsRequest& request, const Notifier& notifyee) const;
+    ListIterator inspect(const metkit::mars::MarsRequest& request, std::shared_ptr<const Notifier> notifyee) const;
 
     /// Give read access to a range of entries according to a request
 
@@ -94,13 +119,20 @@ private: // methods
 
     void print(std::ostream &out) const;
 
-    ListIterator inspect(const metkit::mars::MarsRequest& request, const Schema &schema, const Notifier& notifyee) const;
+    /// Expands the request to database level, and then opens the databases and performs the index
+    /// lookups on a pool of worker threads. Elements are streamed to the iterator, in database order,
+    /// as they are resolved.
+    ListIterator pipelinedInspect(const metkit::mars::MarsRequest& request, std::shared_ptr<const Notifier> notifyee) const;
 
 private: // data
 
-    mutable eckit::CacheLRU<Key,DB*> databases_;
+    std::shared_ptr<DBCache> databases_;  ///< Shared with the iterators
 
     Config dbConfig_;
+
+    size_t threads_;
+
+    size_t queueSize_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
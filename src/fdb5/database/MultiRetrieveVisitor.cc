@@ -28,17 +28,25 @@ namespace fdb5 {
 //----------------------------------------------------------------------------------------------------------------------
 
 MultiRetrieveVisitor::MultiRetrieveVisitor(const Notifier& wind,
-                                           InspectIterator& iterator,
-                                           eckit::CacheLRU<Key,DB*>& databases,
+                                           eckit::Queue<ListElement>& queue,
+                                           DBCache& databases,
                                            const Config& config) :
     db_(nullptr),
     wind_(wind),
     databases_(databases),
-    iterator_(iterator),
+    queue_(queue),
     config_(config) {
 }
 
 MultiRetrieveVisitor::~MultiRetrieveVisitor() {
+    releaseDatabase();
+}
+
+void MultiRetrieveVisitor::releaseDatabase() {
+    if (db_) {
+        databases_.release(db_);
+        db_ = nullptr;
+    }
 }
 
 // From Visitor
@@ -58,9 +66,11 @@ bool MultiRetrieveVisitor::selectDatabase(const Key& key, const Key&) {
 
     /* is the DB already open ? */
 
-    if(databases_.exists(key)) {
+    DB* cached = databases_.checkout(key);
+    if(cached) {
         eckit::Log::debug<LibFdb5>() << "FDB5 Reusing database " << key << std::endl;
-        db_ = databases_.access(key);
+        releaseDatabase();
+        db_ = cached;
         return true;
     }
 
@@ -83,8 +93,8 @@ bool MultiRetrieveVisitor::selectDatabase(const Key& key, const Key&) {
         eckit::Log::debug() << "Database does not exist " << key << std::endl;
         return false;
     } else {
+        releaseDatabase();
         db_ = newDB.release();
-        databases_.insert(key, db_);
         return true;
     }
 }
@@ -108,7 +118,7 @@ bool MultiRetrieveVisitor::selectDatum(const Key& key, const Key& full) {
                 simplifiedKey.set(k->first, k->second);
         }
 
-        iterator_.emplace(ListElement({db_->key(), db_->indexKey(), simplifiedKey}, field.stableLocation(), field.timestamp()));
+        queue_.emplace(ListElement({db_->key(), db_->indexKey(), simplifiedKey}, field.stableLocation(), field.timestamp()));
         return true;
     }
 
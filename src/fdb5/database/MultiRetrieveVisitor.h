@@ -18,7 +18,6 @@
 
 #include <string>
 
-#include "eckit/container/CacheLRU.h"
 #include "eckit/container/Queue.h"
 
 #include "fdb5/api/helpers/ListIterator.h"
@@ -40,14 +39,17 @@ class MultiRetrieveVisitor : public ReadVisitor {
 public: // methods
 
     MultiRetrieveVisitor(const Notifier& wind,
-                         InspectIterator& queue,
-                         eckit::CacheLRU<Key,DB*>& databases,
+                         eckit::Queue<ListElement>& queue,
+                         DBCache& databases,
                          const Config& config);
 
     ~MultiRetrieveVisitor();
 
 private:  // methods
 
+    /// Return the current database (if any) to the shared cache
+    void releaseDatabase();
+
     // From Visitor
 
     virtual bool selectDatabase(const Key &key, const Key &full) override;
@@ -71,9 +73,9 @@ private:
 
     const Notifier& wind_;
 
-    eckit::CacheLRU<Key,DB*>& databases_;
+    DBCache& databases_;
 
-    InspectIterator& iterator_;
+    eckit::Queue<ListElement>& queue_;
 
     Config config_;
 };
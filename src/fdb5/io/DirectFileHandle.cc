@@ -0,0 +1,261 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FDataSync.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/DirectFileHandle.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+size_t roundDown(size_t n, size_t alignment) {
+    return n - (n % alignment);
+}
+
+size_t roundUp(size_t n, size_t alignment) {
+    return roundDown(n + alignment - 1, alignment);
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+size_t DirectFileHandle::alignment() {
+    static size_t fdbDirectIOAlignment = eckit::Resource<unsigned long>("fdbDirectIOAlignment;$FDB_DIRECT_IO_ALIGNMENT", 4096);
+    ASSERT(fdbDirectIOAlignment > 0 && (fdbDirectIOAlignment & (fdbDirectIOAlignment - 1)) == 0);
+    return fdbDirectIOAlignment;
+}
+
+DirectFileHandle::DirectFileHandle(const std::string& path, size_t buffer) :
+    path_(path),
+    fd_(-1),
+    buffer_(nullptr),
+    size_(roundUp(std::max(buffer, alignment()), alignment())),
+    used_(0),
+    bufferOffset_(0) {}
+
+DirectFileHandle::~DirectFileHandle() {
+    try {
+        close();
+    } catch (std::exception& e) {
+        Log::error() << "Error closing " << path_ << ": " << e.what() << std::endl;
+    }
+}
+
+void DirectFileHandle::print(std::ostream& s) const {
+    s << "DirectFileHandle[file=" << path_ << ']';
+}
+
+Length DirectFileHandle::openForRead() {
+    NOTIMP;
+}
+
+void DirectFileHandle::openForWrite(const Length&) {
+    NOTIMP;
+}
+
+void DirectFileHandle::openForAppend(const Length&) {
+
+    ASSERT(fd_ < 0);
+
+#if defined(O_DIRECT)
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_DIRECT | O_CLOEXEC, 0666);
+    if (fd_ < 0) {
+        if (errno == EINVAL) {
+            throw eckit::BadParameter("Direct I/O is not supported by the filesystem of " + path_, Here());
+        }
+        throw eckit::CantOpenFile(path_);
+    }
+#else
+    throw eckit::NotImplemented("Direct I/O is not supported on this platform", Here());
+#endif
+
+    void* p = nullptr;
+    int ret = ::posix_memalign(&p, alignment(), size_);
+    if (ret != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        throw eckit::OutOfMemory();
+    }
+    buffer_ = static_cast<char*>(p);
+
+    // Continue from the end of the data. Any partial block at the end of the file is read back into the
+    // buffer, as it will be rewritten.
+
+    off_t end;
+    SYSCALL(end = ::lseek(fd_, 0, SEEK_END));
+
+    bufferOffset_ = roundDown(end, alignment());
+    used_ = end - bufferOffset_;
+
+    if (used_) {
+        ssize_t len;
+        while ((len = ::pread(fd_, buffer_, alignment(), bufferOffset_)) < 0 && errno == EINTR) {}
+        if (len < 0 || size_t(len) != used_) {
+            ::close(fd_);
+            fd_ = -1;
+            releaseBuffer();
+            throw eckit::ReadError(path_, Here());
+        }
+    }
+}
+
+long DirectFileHandle::read(void*, long) {
+    NOTIMP;
+}
+
+long DirectFileHandle::write(const void* buffer, long length) {
+
+    ASSERT(buffer);
+    ASSERT(fd_ >= 0);
+    ASSERT(length >= 0);
+
+    const char* p = static_cast<const char*>(buffer);
+    size_t left = length;
+
+    while (left) {
+        size_t n = std::min(left, size_ - used_);
+        ::memcpy(buffer_ + used_, p, n);
+        used_ += n;
+        p += n;
+        left -= n;
+
+        if (used_ == size_) {
+            writeOut(size_);
+            bufferOffset_ += size_;
+            used_ = 0;
+        }
+    }
+
+    return length;
+}
+
+void DirectFileHandle::writeOut(size_t length) {
+
+    size_t written = 0;
+    while (written < length) {
+        ssize_t len = ::pwrite(fd_, buffer_ + written, length - written, bufferOffset_ + written);
+        if (len < 0 && errno == EINTR) {
+            continue;
+        }
+        if (len <= 0) {
+            throw eckit::WriteError(path_, Here());
+        }
+        written += len;
+    }
+}
+
+void DirectFileHandle::writeTail() {
+
+    if (used_ == 0) {
+        return;
+    }
+
+    size_t padded = roundUp(used_, alignment());
+    ::memset(buffer_ + used_, 0, padded - used_);
+    writeOut(padded);
+
+    // Keep the partial block, which is rewritten as it is completed
+
+    size_t complete = roundDown(used_, alignment());
+    if (complete) {
+        ::memmove(buffer_, buffer_ + complete, used_ - complete);
+        bufferOffset_ += complete;
+        used_ -= complete;
+    }
+}
+
+void DirectFileHandle::flush() {
+
+    static bool fdbDataSyncOnFlush =
+        eckit::LibResource<bool, LibFdb5>("$FDB_DATA_SYNC_ON_FLUSH;fdbDataSyncOnFlush", true);
+
+    if (fd_ >= 0) {
+
+        writeTail();
+
+        // n.b. O_DIRECT bypasses the page cache, but does not make the file metadata durable
+
+        if (fdbDataSyncOnFlush) {
+            int ret = eckit::fdatasync(fd_);
+
+            while (ret < 0 && errno == EINTR) {
+                ret = eckit::fdatasync(fd_);
+            }
+            if (ret < 0) {
+                Log::error() << "Cannot fdatasync(" << path_ << ") " << fd_ << Log::syserr << std::endl;
+                throw eckit::WriteError(path_);
+            }
+        }
+    }
+}
+
+void DirectFileHandle::close() {
+
+    if (fd_ >= 0) {
+
+        off_t end = bufferOffset_ + used_;
+
+        try {
+            writeTail();
+            SYSCALL(::ftruncate(fd_, end));
+        } catch (...) {
+            ::close(fd_);
+            fd_ = -1;
+            releaseBuffer();
+            throw;
+        }
+
+        int ret = ::close(fd_);
+        fd_ = -1;
+        releaseBuffer();
+
+        if (ret < 0) {
+            throw WriteError(std::string("close ") + path_);
+        }
+    }
+}
+
+void DirectFileHandle::releaseBuffer() {
+    ::free(buffer_);
+    buffer_ = nullptr;
+    used_ = 0;
+    bufferOffset_ = 0;
+}
+
+Offset DirectFileHandle::position() {
+    return bufferOffset_ + used_;
+}
+
+std::string DirectFileHandle::title() const {
+    return PathName::shorten(path_);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
@@ -0,0 +1,87 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   DirectFileHandle.h
+/// @date   Oct 2026
+
+#ifndef fdb5_io_DirectFileHandle_h
+#define fdb5_io_DirectFileHandle_h
+
+#include <sys/types.h>
+
+#include "eckit/io/DataHandle.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Appends to a data file with direct I/O (O_DIRECT), bypassing the page cache.
+///
+/// Data is gathered in an aligned buffer, and written out in aligned blocks. On flush() the partial block at
+/// the tail is padded and written, and kept in the buffer to be completed and rewritten by the following
+/// writes. The padding is removed when the handle is closed. Positions are always those of the data, so
+/// the field locations do not depend on the padding.
+///
+/// TOC databases write their data files with this handle when fdbDirectIO is set. This cannot be combined
+/// with fdbAsyncWrite or fdbUringWrite, and opening a data file fails if it is.
+///
+/// As with FDBFileHandle:
+///   * it only syncs the data to disk on flush()
+///   * this class can only be used in Append mode
+///   * this is not thread-safe
+
+class DirectFileHandle : public eckit::DataHandle {
+public:  // methods
+
+    DirectFileHandle(const std::string& path, size_t buffer);
+
+    ~DirectFileHandle() override;
+
+    eckit::Length openForRead() override;
+    void openForWrite(const eckit::Length&) override;
+    void openForAppend(const eckit::Length&) override;
+
+    long read(void*, long) override;
+    long write(const void*, long) override;
+    void close() override;
+    void flush() override;
+    void print(std::ostream&) const override;
+    eckit::Offset position() override;
+    std::string title() const override;
+    bool canSeek() const override { return false; }
+
+    /// The alignment of the buffer, and of the size and offset of each write (fdbDirectIOAlignment)
+    static size_t alignment();
+
+protected: // members
+
+    std::string path_;
+
+private: // methods
+
+    void writeOut(size_t length);
+    void writeTail();
+    void releaseBuffer();
+
+private: // members
+
+    int fd_;
+
+    char* buffer_;       ///< Aligned
+    size_t size_;        ///< A multiple of the alignment
+    size_t used_;
+    off_t bufferOffset_; ///< The (aligned) offset in the file of the start of the buffer
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_io_DirectFileHandle_h
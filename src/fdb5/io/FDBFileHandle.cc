@@ -10,10 +10,12 @@
 
 #include <unistd.h>
 #include <cstdio>
+#include <cstring>
 
 #include "eckit/config/Resource.h"
 #include "eckit/eckit.h"
 #include "eckit/io/FDataSync.h"
+#include "eckit/log/Bytes.h"
 #include "eckit/log/Log.h"
 
 #include "fdb5/LibFdb5.h"
@@ -29,13 +31,23 @@ void FDBFileHandle::print(std::ostream& s) const {
     s << "FDBFileHandle[file=" << path_ << ']';
 }
 
-FDBFileHandle::FDBFileHandle(const std::string& name, size_t buffer) :
+FDBFileHandle::FDBFileHandle(const std::string& name, size_t buffer, WriteBufferPool& pool) :
     path_(name),
     file_(nullptr),
-    buffer_(buffer),
-    pos_(0) {}
-
-FDBFileHandle::~FDBFileHandle() {}
+    pos_(0),
+    pool_(pool),
+    bufferSize_(buffer),
+    buffered_(0) {}
+
+FDBFileHandle::~FDBFileHandle() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffered_) {
+        Log::warning() << "FDBFileHandle " << path_ << " destroyed without being closed, "
+                       << Bytes(buffered_) << " of buffered data discarded" << std::endl;
+        buffered_ = 0;
+    }
+    releaseBuffer();
+}
 
 Length FDBFileHandle::openForRead() {
     NOTIMP;
@@ -52,7 +64,9 @@ void FDBFileHandle::openForAppend(const Length&) {
         throw eckit::CantOpenFile(path_);
     }
     SYSCALL(pos_ = ::ftello(file_));
-    SYSCALL(::setvbuf(file_, buffer_, _IOFBF, buffer_.size()));
+
+    // Buffering is done by this handle, with a buffer from the pool
+    SYSCALL(::setvbuf(file_, nullptr, _IONBF, 0));
 }
 
 long FDBFileHandle::read(void*, long) {
@@ -62,23 +76,83 @@ long FDBFileHandle::read(void*, long) {
 long FDBFileHandle::write(const void* buffer, long length) {
     ASSERT(buffer);
     ASSERT(file_);
+    ASSERT(length >= 0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    size_t len = length;
+
+    if (!buffer_ && len < bufferSize_ && pool_.reserve(*this, bufferSize_)) {
+        buffer_.reset(new eckit::Buffer(bufferSize_));
+    }
 
-    long written = ::fwrite(buffer, 1, length, file_);
+    if (buffer_ && len < bufferSize_) {
+        if (buffered_ + len > bufferSize_) {
+            spill();
+        }
+        char* p = *buffer_;
+        ::memcpy(p + buffered_, buffer, len);
+        buffered_ += len;
+        touch();
+    } else {
+        spill();
+        writeOut(buffer, len);
+    }
+
+    pos_ += length;
+
+    return length;
+}
+
+void FDBFileHandle::spill() {
+    if (buffered_) {
+        writeOut(*buffer_, buffered_);
+        buffered_ = 0;
+    }
+}
 
-    if (written != length) {
+void FDBFileHandle::writeOut(const void* data, size_t length) {
+    if (::fwrite(data, 1, length, file_) != length) {
         throw eckit::WriteError(path_);
     }
+}
+
+void FDBFileHandle::releaseBuffer() {
+    if (buffer_) {
+        ASSERT(buffered_ == 0);
+        buffer_.reset();
+        pool_.release(*this);
+    }
+}
 
-    pos_ += written;
+bool FDBFileHandle::yieldBuffer() {
+
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || !buffer_) {
+        return false;
+    }
+
+    try {
+        spill();
+    } catch (std::exception& e) {
+        // Keep the buffer. The error is reported to the owner of the handle when it next writes out its data.
+        Log::warning() << "Failed to write out buffer of " << path_ << ": " << e.what() << std::endl;
+        return false;
+    }
 
-    return written;
+    buffer_.reset();
+    return true;
 }
 
 void FDBFileHandle::flush() {
     static bool fdbDataSyncOnFlush =
         eckit::LibResource<bool, LibFdb5>("$FDB_DATA_SYNC_ON_FLUSH;fdbDataSyncOnFlush", true);
 
+    std::lock_guard<std::mutex> lock(mutex_);
+
     if (file_) {
+        spill();
+
         if (::fflush(file_))
             throw WriteError(std::string("FDBFileHandle::~FDBFileHandle(fflush(") + path_ + "))",
                              Here());
@@ -103,7 +177,22 @@ void FDBFileHandle::flush() {
 }
 
 void FDBFileHandle::close() {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
     if (file_) {
+        try {
+            spill();
+        } catch (...) {
+            buffered_ = 0;
+            releaseBuffer();
+            ::fclose(file_);
+            file_ = nullptr;
+            pos_ = 0;
+            throw;
+        }
+        releaseBuffer();
+
         if (::fclose(file_)) {
             file_ = nullptr;
             pos_ = 0;
@@ -15,9 +15,14 @@
 #ifndef fdb5_FDBFileHandle_h
 #define fdb5_FDBFileHandle_h
 
+#include <memory>
+#include <mutex>
+
 #include "eckit/io/DataHandle.h"
 #include "eckit/io/Buffer.h"
 
+#include "fdb5/io/WriteBufferPool.h"
+
 namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -28,11 +33,13 @@ namespace fdb5 {
 ///   * it fails on ENOSPC
 ///   * this class can only be used in Append mode
 ///   * this is not thread-safe neither multi-process safe
+///   * the write buffer is reserved from a WriteBufferPool on the first write, and may be reclaimed by the
+///     pool (after writing out its contents) whenever the handle is not in use
 
-class FDBFileHandle : public eckit::DataHandle {
+class FDBFileHandle : public eckit::DataHandle, private WriteBufferPool::Client {
 public:  // methods
 
-    FDBFileHandle(const std::string&, size_t buffer);
+    FDBFileHandle(const std::string&, size_t buffer, WriteBufferPool& pool = WriteBufferPool::instance());
 
     ~FDBFileHandle();
 
@@ -53,12 +60,27 @@ protected: // members
 
     std::string      path_;
 
+private: // methods
+
+    bool yieldBuffer() override;
+
+    void spill();
+    void writeOut(const void*, size_t);
+    void releaseBuffer();
+
 private: // members
 
     FILE            *file_;
-    eckit::Buffer    buffer_;
     off_t pos_;
 
+    WriteBufferPool& pool_;
+    size_t bufferSize_;
+    std::unique_ptr<eckit::Buffer> buffer_;
+    size_t buffered_;
+
+    // Guards the buffer against the pool reclaiming it from another thread
+    std::mutex mutex_;
+
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,114 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "fdb5/io/FieldHandle.h"
+
+#include "eckit/exception/Exceptions.h"
+
+#include "fdb5/io/HandleGatherer.h"
+#include "fdb5/io/LocationBatcher.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+FieldHandle::FieldHandle(ListIterator&& it, size_t batchSize) :
+    it_(std::move(it)),
+    batchSize_(batchSize),
+    fields_(0),
+    exhausted_(false) {
+    ASSERT(batchSize_ > 0);
+}
+
+FieldHandle::~FieldHandle() {
+    close();
+}
+
+eckit::Length FieldHandle::openForRead() {
+    return estimate();
+}
+
+eckit::Length FieldHandle::estimate() {
+    return 0;
+}
+
+bool FieldHandle::openNextBatch() {
+
+    if (exhausted_) return false;
+
+    // Each batch is gathered, and its locations batched, exactly as for the whole of a non-streaming read
+
+    HandleGatherer gatherer(false);
+    LocationBatcher batcher(gatherer);
+    ListElement el;
+
+    size_t count = 0;
+    while (count < batchSize_ && it_.next(el)) {
+        batcher.add(el.sharedLocation());
+        ++count;
+    }
+
+    batcher.flush();
+
+    if (count < batchSize_) {
+        exhausted_ = true;
+    }
+
+    if (count == 0) {
+        return false;
+    }
+
+    fields_ += count;
+
+    current_.reset(gatherer.dataHandle());
+    current_->openForRead();
+    return true;
+}
+
+long FieldHandle::read(void* buffer, long length) {
+
+    char* p = static_cast<char*>(buffer);
+    long total = 0;
+
+    while (length > 0) {
+
+        if (!current_ && !openNextBatch()) {
+            break;
+        }
+
+        long n = current_->read(p, length);
+        if (n <= 0) {
+            current_->close();
+            current_.reset();
+            continue;
+        }
+
+        total += n;
+        p += n;
+        length -= n;
+    }
+
+    return total;
+}
+
+void FieldHandle::close() {
+    if (current_) {
+        current_->close();
+        current_.reset();
+    }
+}
+
+void FieldHandle::print(std::ostream& s) const {
+    s << "FieldHandle[fields=" << fields_ << ",batchSize=" << batchSize_ << "]";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
@@ -0,0 +1,70 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @date   October 2026
+
+#ifndef fdb5_FieldHandle_H
+#define fdb5_FieldHandle_H
+
+#include <memory>
+
+#include "eckit/io/DataHandle.h"
+
+#include "fdb5/api/helpers/ListIterator.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A read-only DataHandle over the fields returned by a ListIterator.
+///
+/// The fields are pulled from the iterator lazily, a batch at a time, as the data is read. Within a
+/// batch, locations that can be read together are requested at once by a LocationBatcher, and contiguous
+/// fields are merged exactly as by HandleGatherer. This allows data reads to overlap with the index
+/// lookups that are still producing later fields, and bounds memory use independently of the number
+/// of fields. As the total size is not known in advance, estimate() returns 0.
+
+class FieldHandle : public eckit::DataHandle {
+
+public: // methods
+
+    FieldHandle(ListIterator&& it, size_t batchSize);
+
+    ~FieldHandle() override;
+
+    eckit::Length openForRead() override;
+    long read(void*, long) override;
+    void close() override;
+
+    eckit::Length estimate() override;
+    bool canSeek() const override { return false; }
+
+    void print(std::ostream&) const override;
+
+private: // methods
+
+    bool openNextBatch();
+
+private: // members
+
+    ListIterator it_;
+    size_t batchSize_;
+
+    std::unique_ptr<eckit::DataHandle> current_;
+
+    size_t fields_;
+    bool exhausted_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace fdb5
+
+#endif
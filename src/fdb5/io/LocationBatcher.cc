@@ -0,0 +1,59 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include "fdb5/io/LocationBatcher.h"
+
+#include "eckit/config/Resource.h"
+
+#include "fdb5/database/FieldLocation.h"
+#include "fdb5/io/HandleGatherer.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LocationBatcher::LocationBatcher(HandleGatherer& gatherer, size_t batchSize) :
+    gatherer_(gatherer),
+    batchSize_(batchSize) {}
+
+size_t LocationBatcher::defaultBatchSize() {
+    static size_t fdbReadBatchSize = eckit::Resource<size_t>("fdbReadBatchSize;$FDB_READ_BATCH_SIZE", 100000);
+    return fdbReadBatchSize;
+}
+
+void LocationBatcher::add(const std::shared_ptr<const FieldLocation>& location) {
+
+    std::string key = (batchSize_ > 1) ? location->batchKey() : std::string();
+
+    if (key != batchKey_ || batch_.size() >= batchSize_) {
+        flush();
+    }
+
+    if (key.empty()) {
+        gatherer_.add(location->dataHandle());
+    } else {
+        batchKey_ = key;
+        batch_.push_back(location);
+    }
+}
+
+void LocationBatcher::flush() {
+    if (batch_.size() == 1) {
+        gatherer_.add(batch_[0]->dataHandle());
+    } else if (!batch_.empty()) {
+        gatherer_.add(batch_[0]->readMany(batch_));
+    }
+    batch_.clear();
+    batchKey_.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
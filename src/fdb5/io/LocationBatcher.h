@@ -0,0 +1,61 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   LocationBatcher.h
+/// @date   Oct 2026
+
+#ifndef fdb5_LocationBatcher_H
+#define fdb5_LocationBatcher_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/memory/NonCopyable.h"
+
+namespace fdb5 {
+
+class FieldLocation;
+class HandleGatherer;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Accumulates runs of consecutive locations that can be read together (e.g. from the same remote
+/// server), so that each run is requested at once rather than one field at a time. The data are
+/// added to the gatherer in the order the locations are added.
+
+class LocationBatcher : private eckit::NonCopyable {
+
+public: // methods
+
+    /// @param batchSize The maximum number of locations read together (fdbReadBatchSize by default)
+    LocationBatcher(HandleGatherer& gatherer, size_t batchSize = defaultBatchSize());
+
+    void add(const std::shared_ptr<const FieldLocation>& location);
+
+    /// Add the current run (if any) to the gatherer
+    void flush();
+
+    static size_t defaultBatchSize();
+
+private: // members
+
+    HandleGatherer& gatherer_;
+    size_t batchSize_;
+
+    std::string batchKey_;
+    std::vector<std::shared_ptr<const FieldLocation>> batch_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_LocationBatcher_H
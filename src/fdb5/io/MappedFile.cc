@@ -0,0 +1,93 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/MappedFile.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+MappedFile::MappedFile(const eckit::PathName& path, int fd, off_t offset, size_t length) :
+    path_(path),
+    address_(nullptr),
+    mapped_(0),
+    data_(nullptr),
+    length_(length) {
+    map(fd, offset);
+}
+
+MappedFile::MappedFile(const eckit::PathName& path, off_t offset, size_t length) :
+    path_(path),
+    address_(nullptr),
+    mapped_(0),
+    data_(nullptr),
+    length_(length) {
+
+    int fd;
+    SYSCALL2((fd = ::open(path_.localPath(), O_RDONLY)), path_);
+    try {
+        map(fd, offset);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    SYSCALL2(::close(fd), path_);
+}
+
+MappedFile::~MappedFile() {
+    if (address_) {
+        if (::munmap(address_, mapped_) != 0) {
+            eckit::Log::error() << "Failed to unmap " << path_ << ": " << eckit::Log::syserr << std::endl;
+        }
+    }
+}
+
+void MappedFile::map(int fd, off_t offset) {
+
+    // n.b. it is not valid to map a zero length region
+
+    if (length_ == 0) {
+        return;
+    }
+
+    // Mappings must start on a page boundary
+
+    static const off_t pageSize = ::sysconf(_SC_PAGESIZE);
+    off_t start = offset - (offset % pageSize);
+    mapped_ = length_ + (offset - start);
+
+    address_ = ::mmap(nullptr, mapped_, PROT_READ, MAP_SHARED, fd, start);
+    if (address_ == MAP_FAILED) {
+        address_ = nullptr;
+        throw eckit::FailedSystemCall("mmap", Here(), errno);
+    }
+
+    data_ = static_cast<const char*>(address_) + (offset - start);
+
+    eckit::Log::debug<LibFdb5>() << "Mapped " << path_ << " offset=" << offset << " length=" << length_ << std::endl;
+}
+
+void MappedFile::willNeed() const {
+    if (address_) {
+        SYSCALL2(::madvise(address_, mapped_, MADV_WILLNEED), path_);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
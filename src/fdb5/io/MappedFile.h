@@ -0,0 +1,67 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   MappedFile.h
+/// @date   Oct 2026
+
+#ifndef fdb5_MappedFile_H
+#define fdb5_MappedFile_H
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/memory/NonCopyable.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A read-only, shared, memory mapping of a region of a file. The mapped pages live in the OS page cache, and
+/// are shared with every other process reading the same file.
+///
+/// @note The file descriptor may be closed once the mapping has been made.
+
+class MappedFile : private eckit::NonCopyable {
+
+public: // methods
+
+    MappedFile(const eckit::PathName& path, int fd, off_t offset, size_t length);
+    MappedFile(const eckit::PathName& path, off_t offset, size_t length);
+
+    ~MappedFile();
+
+    const void* data() const { return data_; }
+    size_t size() const { return length_; }
+
+    /// Hint that the whole region will be read soon
+    void willNeed() const;
+
+private: // methods
+
+    void map(int fd, off_t offset);
+
+private: // members
+
+    eckit::PathName path_;
+
+    void* address_;  ///< start of the (page aligned) mapping
+    size_t mapped_;
+
+    const char* data_;
+    size_t length_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_MappedFile_H
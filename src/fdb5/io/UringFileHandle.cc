@@ -0,0 +1,260 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FDataSync.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/UringFileHandle.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void UringFileHandle::Slot::completed(int result) {
+    inFlight_ = false;
+    if (result < 0) {
+        error_ = -result;
+    } else if (result == 0) {
+        error_ = EIO;  // No progress
+    } else {
+        written_ += result;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+UringFileHandle::UringFileHandle(const std::string& path, size_t count, size_t size, bool uring) :
+    path_(path),
+    fd_(-1),
+    pos_(0),
+    writeOffset_(0),
+    current_(0) {
+
+    ASSERT(count > 0);
+    ASSERT(size > 0);
+
+    queue_.reset(new UringQueue(count, uring));
+    for (size_t i = 0; i < count; ++i) {
+        slots_.emplace_back(new Slot(size));
+    }
+}
+
+UringFileHandle::~UringFileHandle() {
+
+    try {
+        close();
+    } catch (std::exception& e) {
+        Log::error() << "Error closing " << path_ << ": " << e.what() << std::endl;
+    }
+
+    // n.b. the queue waits for any outstanding writes, which refer to the slots
+    queue_.reset();
+}
+
+void UringFileHandle::print(std::ostream& s) const {
+    s << "UringFileHandle[file=" << path_ << ']';
+}
+
+Length UringFileHandle::openForRead() {
+    NOTIMP;
+}
+
+void UringFileHandle::openForWrite(const Length&) {
+    NOTIMP;
+}
+
+void UringFileHandle::openForAppend(const Length&) {
+
+    ASSERT(fd_ < 0);
+
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0666);
+    if (fd_ < 0) {
+        throw eckit::CantOpenFile(path_);
+    }
+
+    // Writes are made at explicit offsets, from the end of the file
+
+    SYSCALL(pos_ = ::lseek(fd_, 0, SEEK_END));
+    writeOffset_ = pos_;
+}
+
+long UringFileHandle::read(void*, long) {
+    NOTIMP;
+}
+
+long UringFileHandle::write(const void* buffer, long length) {
+
+    ASSERT(buffer);
+    ASSERT(fd_ >= 0);
+    ASSERT(length >= 0);
+
+    const char* p = static_cast<const char*>(buffer);
+    size_t left = length;
+
+    while (left) {
+
+        Slot& slot = *slots_[current_];
+        wait(slot);
+
+        size_t n = std::min(left, slot.buffer_.size() - slot.used_);
+        char* data = slot.buffer_;
+        ::memcpy(data + slot.used_, p, n);
+        slot.used_ += n;
+        p += n;
+        left -= n;
+
+        if (slot.used_ == slot.buffer_.size()) {
+            submit(slot);
+            current_ = (current_ + 1) % slots_.size();
+        }
+    }
+
+    pos_ += length;
+
+    return length;
+}
+
+void UringFileHandle::submit(Slot& slot) {
+
+    ASSERT(!slot.submitted_);
+    ASSERT(slot.used_ > 0);
+
+    slot.offset_ = writeOffset_;
+    writeOffset_ += slot.used_;
+
+    slot.written_ = 0;
+    slot.error_ = 0;
+    slot.submitted_ = true;
+    slot.inFlight_ = true;
+
+    queue_->write(slot, fd_, slot.buffer_, slot.used_, slot.offset_);
+    queue_->submit();
+}
+
+void UringFileHandle::wait(Slot& slot) {
+
+    while (slot.submitted_) {
+
+        while (slot.inFlight_) {
+            queue_->wait();
+        }
+
+        if (slot.error_) {
+            int error = slot.error_;
+            slot.submitted_ = false;
+            slot.used_ = 0;
+            slot.error_ = 0;
+            std::ostringstream msg;
+            msg << path_ << ": " << ::strerror(error);
+            throw eckit::WriteError(msg.str(), Here());
+        }
+
+        if (slot.written_ < slot.used_) {
+
+            // Short write. Write the rest.
+
+            const char* data = slot.buffer_;
+            slot.inFlight_ = true;
+            queue_->write(slot, fd_, data + slot.written_, slot.used_ - slot.written_, slot.offset_ + slot.written_);
+            queue_->submit();
+            continue;
+        }
+
+        slot.submitted_ = false;
+        slot.used_ = 0;
+        slot.written_ = 0;
+    }
+}
+
+void UringFileHandle::drain() {
+
+    Slot& slot = *slots_[current_];
+    if (!slot.submitted_ && slot.used_ > 0) {
+        submit(slot);
+        current_ = (current_ + 1) % slots_.size();
+    }
+
+    for (auto& s : slots_) {
+        wait(*s);
+    }
+}
+
+void UringFileHandle::flush() {
+
+    static bool fdbDataSyncOnFlush =
+        eckit::LibResource<bool, LibFdb5>("$FDB_DATA_SYNC_ON_FLUSH;fdbDataSyncOnFlush", true);
+
+    if (fd_ >= 0) {
+
+        drain();
+
+        if (fdbDataSyncOnFlush) {
+            int ret = eckit::fdatasync(fd_);
+
+            while (ret < 0 && errno == EINTR) {
+                ret = eckit::fdatasync(fd_);
+            }
+            if (ret < 0) {
+                Log::error() << "Cannot fdatasync(" << path_ << ") " << fd_ << Log::syserr << std::endl;
+                throw eckit::WriteError(path_);
+            }
+        }
+
+        ASSERT(writeOffset_ == pos_);
+    }
+}
+
+void UringFileHandle::close() {
+
+    if (fd_ >= 0) {
+
+        try {
+            drain();
+        } catch (...) {
+            ::close(fd_);
+            fd_ = -1;
+            pos_ = 0;
+            throw;
+        }
+
+        int ret = ::close(fd_);
+        fd_ = -1;
+        pos_ = 0;
+        if (ret < 0) {
+            throw WriteError(std::string("close ") + path_);
+        }
+    }
+}
+
+Offset UringFileHandle::position() {
+    return pos_;
+}
+
+std::string UringFileHandle::title() const {
+    return PathName::shorten(path_);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
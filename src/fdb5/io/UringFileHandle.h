@@ -0,0 +1,101 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   UringFileHandle.h
+/// @date   Oct 2026
+
+#ifndef fdb5_io_UringFileHandle_h
+#define fdb5_io_UringFileHandle_h
+
+#include <sys/types.h>
+
+#include <memory>
+#include <vector>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/io/DataHandle.h"
+
+#include "fdb5/io/UringQueue.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Appends to a data file through io_uring, with up to a number of buffers of data being written at once.
+/// Where io_uring is unavailable, the buffers are written synchronously as they fill.
+///
+/// As with FDBFileHandle:
+///   * it only syncs the data to disk on flush()
+///   * this class can only be used in Append mode
+///   * this is not thread-safe
+
+class UringFileHandle : public eckit::DataHandle {
+public:  // methods
+
+    UringFileHandle(const std::string& path, size_t count, size_t size, bool uring = UringQueue::available());
+
+    ~UringFileHandle() override;
+
+    eckit::Length openForRead() override;
+    void openForWrite(const eckit::Length&) override;
+    void openForAppend(const eckit::Length&) override;
+
+    long read(void*, long) override;
+    long write(const void*, long) override;
+    void close() override;
+    void flush() override;
+    void print(std::ostream&) const override;
+    eckit::Offset position() override;
+    std::string title() const override;
+    bool canSeek() const override { return false; }
+
+protected: // members
+
+    std::string path_;
+
+private: // types
+
+    struct Slot : public UringQueue::Request {
+        Slot(size_t size) :
+            buffer_(size), used_(0), written_(0), offset_(0), error_(0), submitted_(false), inFlight_(false) {}
+
+        void completed(int result) override;
+
+        eckit::Buffer buffer_;
+        size_t used_;
+        size_t written_;
+        off_t offset_;
+        int error_;
+        bool submitted_;  ///< Handed to the kernel, and not yet completely written
+        bool inFlight_;
+    };
+
+private: // methods
+
+    void submit(Slot& slot);
+    void wait(Slot& slot);
+    void drain();
+
+private: // members
+
+    int fd_;
+    off_t pos_;
+    off_t writeOffset_;  ///< Where the next submitted buffer is written
+
+    std::unique_ptr<UringQueue> queue_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    size_t current_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_io_UringFileHandle_h
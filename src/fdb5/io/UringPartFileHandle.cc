@@ -0,0 +1,231 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+
+#include "fdb5/io/UringPartFileHandle.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct Chunk : public UringQueue::Request {
+
+    Chunk(size_t part, char* data, size_t length, off_t offset) :
+        part_(part), data_(data), length_(length), offset_(offset), done_(0), error_(0), inFlight_(false) {}
+
+    void completed(int result) override {
+        inFlight_ = false;
+        if (result < 0) {
+            error_ = -result;
+        } else {
+            done_ += result;
+            if (result == 0 && done_ < length_) {
+                error_ = EIO;  // Unexpected end of file
+            }
+        }
+    }
+
+    size_t part_;
+    char* data_;
+    size_t length_;
+    off_t offset_;
+    size_t done_;
+    int error_;
+    bool inFlight_;
+};
+
+size_t readChunkSize() {
+    static size_t fdbUringReadChunkSize =
+        eckit::Resource<unsigned long>("fdbUringReadChunkSize;$FDB_URING_READ_CHUNK_SIZE", 1024 * 1024);
+    return fdbUringReadChunkSize;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+UringPartFileHandle::UringPartFileHandle(const PathName& path, const Offset& offset, const Length& length,
+                                         bool uring) :
+    UringPartFileHandle(std::vector<Part>{Part{path, offset, length}}, uring) {}
+
+UringPartFileHandle::UringPartFileHandle(const std::vector<Part>& parts, bool uring) :
+    parts_(parts),
+    length_(0),
+    uring_(uring),
+    position_(0) {
+
+    ASSERT(!parts_.empty());
+
+    long long start = 0;
+    for (const Part& part : parts_) {
+        starts_.push_back(start);
+        start += (long long)part.length_;
+    }
+    starts_.push_back(start);
+    length_ = start;
+}
+
+UringPartFileHandle::~UringPartFileHandle() {
+    close();
+}
+
+void UringPartFileHandle::print(std::ostream& s) const {
+    if (parts_.size() == 1) {
+        s << "UringPartFileHandle[path=" << parts_[0].path_ << ",offset=" << parts_[0].offset_
+          << ",length=" << parts_[0].length_ << ']';
+    } else {
+        s << "UringPartFileHandle[parts=" << parts_.size() << ",length=" << length_ << ']';
+    }
+}
+
+std::string UringPartFileHandle::title() const {
+    if (parts_.size() == 1) {
+        return PathName::shorten(parts_[0].path_);
+    }
+    std::ostringstream oss;
+    oss << parts_.size() << " parts";
+    return oss.str();
+}
+
+Length UringPartFileHandle::openForRead() {
+
+    ASSERT(files_.empty());
+
+    for (const Part& part : parts_) {
+        auto it = files_.find(part.path_);
+        if (it == files_.end()) {
+            int fd = ::open(part.path_.localPath(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                close();
+                throw eckit::CantOpenFile(part.path_);
+            }
+            it = files_.emplace(part.path_, fd).first;
+        }
+        fds_.push_back(it->second);
+    }
+
+    position_ = 0;
+    return length_;
+}
+
+void UringPartFileHandle::openForWrite(const Length&) {
+    NOTIMP;
+}
+
+void UringPartFileHandle::openForAppend(const Length&) {
+    NOTIMP;
+}
+
+long UringPartFileHandle::read(void* buffer, long length) {
+
+    ASSERT(fds_.size() == parts_.size());
+    ASSERT(length >= 0);
+
+    size_t len = std::min<long long>(length, (long long)length_ - (long long)position_);
+    if (len == 0) {
+        return 0;
+    }
+
+    UringQueue& queue(UringQueue::local(uring_));
+
+    // Split the read by part, and each part into chunks
+
+    const size_t chunkSize = readChunkSize();
+    char* data = static_cast<char*>(buffer);
+    long long pos = position_;
+    long long end = pos + len;
+
+    size_t part = std::upper_bound(starts_.begin(), starts_.end(), pos) - starts_.begin() - 1;
+
+    std::vector<Chunk> chunks;
+    while (pos < end) {
+        ASSERT(part < parts_.size());
+        long long partEnd = std::min(starts_[part + 1], end);
+        off_t base = (long long)parts_[part].offset_ - starts_[part];
+        while (pos < partEnd) {
+            size_t n = std::min<long long>(chunkSize, partEnd - pos);
+            chunks.emplace_back(part, data, n, base + pos);
+            data += n;
+            pos += n;
+        }
+        ++part;
+    }
+
+    // Read all of the chunks, finishing off any short reads, before reporting any error. The chunks
+    // must not go out of scope while they are in flight.
+
+    bool pending = true;
+    while (pending) {
+
+        pending = false;
+        for (Chunk& c : chunks) {
+            if (!c.error_ && c.done_ < c.length_) {
+                c.inFlight_ = true;
+                queue.read(c, fds_[c.part_], c.data_ + c.done_, c.length_ - c.done_, c.offset_ + c.done_);
+                pending = true;
+            }
+        }
+
+        queue.submit();
+
+        for (Chunk& c : chunks) {
+            while (c.inFlight_) {
+                queue.wait();
+            }
+        }
+    }
+
+    for (const Chunk& c : chunks) {
+        if (c.error_) {
+            std::ostringstream msg;
+            msg << parts_[c.part_].path_ << " at offset " << c.offset_ << ": " << ::strerror(c.error_);
+            throw eckit::ReadError(msg.str(), Here());
+        }
+    }
+
+    position_ += len;
+    return len;
+}
+
+long UringPartFileHandle::write(const void*, long) {
+    NOTIMP;
+}
+
+Offset UringPartFileHandle::seek(const Offset& offset) {
+    ASSERT((long long)offset <= (long long)length_);
+    position_ = offset;
+    return position_;
+}
+
+void UringPartFileHandle::close() {
+    for (const auto& file : files_) {
+        ::close(file.second);
+    }
+    files_.clear();
+    fds_.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
@@ -0,0 +1,85 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   UringPartFileHandle.h
+/// @date   Oct 2026
+
+#ifndef fdb5_io_UringPartFileHandle_h
+#define fdb5_io_UringPartFileHandle_h
+
+#include <map>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+
+#include "fdb5/io/UringQueue.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Reads parts of data files, such as a batch of fields, through io_uring, as one stream of data.
+///
+/// Each read is split into chunks of at most fdbUringReadChunkSize, and never spanning two parts, which are
+/// read at once on the io_uring queue of the calling thread. Large reads therefore have many requests in
+/// flight, whether of one large field or of many small ones.
+
+class UringPartFileHandle : public eckit::DataHandle {
+public:  // types
+
+    struct Part {
+        eckit::PathName path_;
+        eckit::Offset offset_;
+        eckit::Length length_;
+    };
+
+public:  // methods
+
+    UringPartFileHandle(const eckit::PathName& path, const eckit::Offset& offset, const eckit::Length& length,
+                        bool uring = UringQueue::available());
+    UringPartFileHandle(const std::vector<Part>& parts, bool uring = UringQueue::available());
+
+    ~UringPartFileHandle() override;
+
+    eckit::Length openForRead() override;
+    void openForWrite(const eckit::Length&) override;
+    void openForAppend(const eckit::Length&) override;
+
+    long read(void*, long) override;
+    long write(const void*, long) override;
+    void close() override;
+
+    eckit::Length size() override { return length_; }
+    eckit::Length estimate() override { return length_; }
+    eckit::Offset position() override { return position_; }
+    eckit::Offset seek(const eckit::Offset&) override;
+    bool canSeek() const override { return true; }
+
+    void print(std::ostream&) const override;
+    std::string title() const override;
+
+private: // members
+
+    std::vector<Part> parts_;
+    std::vector<long long> starts_;  ///< The position in the stream of each part, and the end of the stream
+    eckit::Length length_;
+    bool uring_;
+
+    std::map<eckit::PathName, int> files_;  ///< Each file is opened once, however many parts it has
+    std::vector<int> fds_;                  ///< By part
+    eckit::Offset position_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_io_UringPartFileHandle_h
@@ -0,0 +1,200 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <liburing.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/io/UringQueue.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+unsigned localDepth() {
+    static unsigned fdbUringQueueDepth = eckit::Resource<unsigned>("fdbUringQueueDepth;$FDB_URING_QUEUE_DEPTH", 32);
+    return fdbUringQueueDepth;
+}
+
+/// @returns the number of bytes transferred, or -errno, as a completion would
+template <typename Op>
+int synchronous(Op op) {
+    ssize_t ret;
+    while ((ret = op()) < 0 && errno == EINTR) {}
+    return ret < 0 ? -errno : int(ret);
+}
+
+}  // namespace
+
+bool UringQueue::available() {
+
+    static bool available = [] {
+        io_uring ring;
+        int ret = ::io_uring_queue_init(1, &ring, 0);
+        if (ret < 0) {
+            eckit::Log::warning() << "io_uring is unavailable (" << ::strerror(-ret)
+                                  << "), data files are read and written synchronously" << std::endl;
+            return false;
+        }
+        ::io_uring_queue_exit(&ring);
+        return true;
+    }();
+
+    return available;
+}
+
+UringQueue& UringQueue::local(bool uring) {
+    if (uring) {
+        thread_local UringQueue queue(localDepth(), true);
+        return queue;
+    }
+    thread_local UringQueue queue(localDepth(), false);
+    return queue;
+}
+
+UringQueue::UringQueue(unsigned depth, bool uring) :
+    depth_(depth),
+    inFlight_(0),
+    queued_(0) {
+
+    ASSERT(depth_ > 0);
+
+    if (uring) {
+        ring_.reset(new io_uring);
+        int ret = ::io_uring_queue_init(depth_, ring_.get(), 0);
+        if (ret < 0) {
+            throw eckit::FailedSystemCall(std::string("io_uring_queue_init: ") + ::strerror(-ret), Here());
+        }
+    }
+}
+
+UringQueue::~UringQueue() {
+
+    // The kernel may still refer to the buffers of any outstanding operations
+
+    try {
+        while (inFlight_) {
+            wait();
+        }
+    } catch (std::exception& e) {
+        eckit::Log::error() << "Error waiting for outstanding io_uring operations: " << e.what() << std::endl;
+    }
+
+    if (ring_) {
+        ::io_uring_queue_exit(ring_.get());
+    }
+}
+
+void UringQueue::reserve() {
+
+    // Never have more operations in flight than there is room for their completions
+
+    while (inFlight_ >= depth_) {
+        wait();
+    }
+}
+
+void UringQueue::write(Request& request, int fd, const void* data, size_t length, off_t offset) {
+
+    reserve();
+
+    if (!ring_) {
+        ++inFlight_;
+        completed_.emplace_back(&request, synchronous([=] { return ::pwrite(fd, data, length, offset); }));
+        return;
+    }
+
+    io_uring_sqe* sqe = ::io_uring_get_sqe(ring_.get());
+    ASSERT(sqe);
+
+    ::io_uring_prep_write(sqe, fd, data, length, offset);
+    ::io_uring_sqe_set_data(sqe, &request);
+
+    ++inFlight_;
+    ++queued_;
+}
+
+void UringQueue::read(Request& request, int fd, void* data, size_t length, off_t offset) {
+
+    reserve();
+
+    if (!ring_) {
+        ++inFlight_;
+        completed_.emplace_back(&request, synchronous([=] { return ::pread(fd, data, length, offset); }));
+        return;
+    }
+
+    io_uring_sqe* sqe = ::io_uring_get_sqe(ring_.get());
+    ASSERT(sqe);
+
+    ::io_uring_prep_read(sqe, fd, data, length, offset);
+    ::io_uring_sqe_set_data(sqe, &request);
+
+    ++inFlight_;
+    ++queued_;
+}
+
+void UringQueue::submit() {
+
+    while (queued_) {
+        int ret = ::io_uring_submit(ring_.get());
+        if (ret < 0) {
+            if (ret == -EINTR || ret == -EAGAIN) continue;
+            throw eckit::FailedSystemCall(std::string("io_uring_submit: ") + ::strerror(-ret), Here());
+        }
+        ASSERT(size_t(ret) <= queued_);
+        queued_ -= ret;
+    }
+}
+
+void UringQueue::wait() {
+
+    ASSERT(inFlight_ > 0);
+
+    if (!ring_) {
+        ASSERT(!completed_.empty());
+        std::pair<Request*, int> op = completed_.front();
+        completed_.pop_front();
+        --inFlight_;
+        op.first->completed(op.second);
+        return;
+    }
+
+    submit();
+
+    io_uring_cqe* cqe = nullptr;
+    int ret;
+    while ((ret = ::io_uring_wait_cqe(ring_.get(), &cqe)) == -EINTR) {}
+
+    if (ret < 0) {
+        throw eckit::FailedSystemCall(std::string("io_uring_wait_cqe: ") + ::strerror(-ret), Here());
+    }
+
+    Request* request = static_cast<Request*>(::io_uring_cqe_get_data(cqe));
+    int result = cqe->res;
+    ::io_uring_cqe_seen(ring_.get(), cqe);
+
+    --inFlight_;
+
+    ASSERT(request);
+    request->completed(result);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
@@ -0,0 +1,97 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   UringQueue.h
+/// @date   Oct 2026
+
+#ifndef fdb5_io_UringQueue_h
+#define fdb5_io_UringQueue_h
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <utility>
+
+#include "eckit/memory/NonCopyable.h"
+
+struct io_uring;
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// An io_uring submission and completion queue. A queue must only be used by one thread at a time.
+///
+/// Reads and writes are queued against a Request, which is told of the outcome when the operation completes.
+/// Queued operations are submitted to the kernel together, by submit(), or when the queue is full.
+///
+/// Where io_uring is unavailable, e.g. as it is disabled by the kernel or a container's seccomp profile, a
+/// queue may instead be synchronous: operations are made with pread/pwrite as they are queued, and their
+/// requests are told of the outcome, as before, by wait().
+
+class UringQueue : private eckit::NonCopyable {
+
+public: // types
+
+    class Request {
+    public:
+        virtual ~Request() {}
+
+        /// The operation has completed. The result is the number of bytes transferred, or -errno.
+        /// This is called from UringQueue::wait(), and must not throw.
+        virtual void completed(int result) = 0;
+    };
+
+public: // methods
+
+    /// Whether io_uring can be used by this process. This is checked once, and a warning logged if not.
+    static bool available();
+
+    /// A queue for the synchronous use of the calling thread, i.e. where all the operations queued by a
+    /// call complete before it returns. The depth is fdbUringQueueDepth.
+    static UringQueue& local(bool uring = available());
+
+    explicit UringQueue(unsigned depth, bool uring = available());
+    ~UringQueue();
+
+    unsigned depth() const { return depth_; }
+    bool uring() const { return bool(ring_); }
+    size_t inFlight() const { return inFlight_; }
+
+    void write(Request& request, int fd, const void* data, size_t length, off_t offset);
+    void read(Request& request, int fd, void* data, size_t length, off_t offset);
+
+    void submit();
+
+    /// Wait for an operation to complete, and notify its request
+    void wait();
+
+private: // methods
+
+    void reserve();
+
+private: // members
+
+    std::unique_ptr<io_uring> ring_;  ///< Null for a synchronous queue
+
+    std::deque<std::pair<Request*, int>> completed_;  ///< Operations of a synchronous queue, to be waited for
+
+    unsigned depth_;
+    size_t inFlight_;
+    size_t queued_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_io_UringQueue_h
@@ -0,0 +1,186 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/io/WriteBufferPool.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+WriteBufferPoolStats::WriteBufferPoolStats() :
+    budget_(0),
+    used_(0),
+    peak_(0),
+    buffers_(0),
+    reserved_(0),
+    reclaimed_(0),
+    refused_(0) {}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+WriteBufferPool::Client::Client() :
+    lastUsed_(0) {}
+
+void WriteBufferPool::Client::touch() {
+    lastUsed_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+WriteBufferPool& WriteBufferPool::instance() {
+    static size_t fdbWriteBufferBudget =
+        eckit::Resource<unsigned long>("fdbWriteBufferBudget;$FDB_WRITE_BUFFER_BUDGET", 1024UL * 1024 * 1024);
+    static WriteBufferPool pool(fdbWriteBufferBudget);
+    return pool;
+}
+
+WriteBufferPool::WriteBufferPool(size_t budget) :
+    budget_(budget),
+    used_(0),
+    peak_(0),
+    numReserved_(0),
+    numReclaimed_(0),
+    numRefused_(0) {}
+
+WriteBufferPool::~WriteBufferPool() {}
+
+void WriteBufferPool::waitForYield(std::unique_lock<std::mutex>& lock, Client& client) {
+    yielded_.wait(lock, [this, &client] {
+        auto r = reservations_.find(&client);
+        return r == reservations_.end() || !r->second.yielding_;
+    });
+}
+
+bool WriteBufferPool::reserve(Client& client, size_t size) {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // n.b. a buffer that is being reclaimed by another thread has already been given back by the client
+
+    waitForYield(lock, client);
+    ASSERT(reservations_.find(&client) == reservations_.end());
+
+    if (used_ + size > budget_) {
+
+        // Choose the least recently used buffers that would make enough room. They are reclaimed without the
+        // pool locked, as writing out their data may take a while. Until then, they are marked so that no other
+        // thread chooses them, and so that their clients cannot release them from under us.
+
+        std::vector<std::pair<int64_t, Client*>> candidates;
+        for (const auto& r : reservations_) {
+            if (!r.second.yielding_) {
+                candidates.emplace_back(r.first->lastUsed_.load(std::memory_order_relaxed), r.first);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        std::vector<Client*> victims;
+        size_t claimed = 0;
+        for (const auto& c : candidates) {
+            if (used_ - claimed + size <= budget_) {
+                break;
+            }
+            Reservation& r(reservations_[c.second]);
+            r.yielding_ = true;
+            claimed += r.size_;
+            victims.push_back(c.second);
+        }
+
+        lock.unlock();
+
+        std::vector<bool> yielded;
+        for (Client* victim : victims) {
+            bool y = false;
+            try {
+                y = victim->yieldBuffer();
+            } catch (std::exception& e) {
+                eckit::Log::warning() << "Failed to reclaim write buffer: " << e.what() << std::endl;
+            }
+            yielded.push_back(y);
+        }
+
+        lock.lock();
+
+        for (size_t i = 0; i < victims.size(); ++i) {
+            auto r = reservations_.find(victims[i]);
+            ASSERT(r != reservations_.end() && r->second.yielding_);
+            if (yielded[i]) {
+                used_ -= r->second.size_;
+                reservations_.erase(r);
+                ++numReclaimed_;
+            } else {
+                r->second.yielding_ = false;
+            }
+        }
+
+        yielded_.notify_all();
+    }
+
+    if (used_ + size > budget_) {
+        ++numRefused_;
+        eckit::Log::debug<LibFdb5>() << "Write buffer of " << eckit::Bytes(size) << " refused, "
+                                     << eckit::Bytes(used_) << " of " << eckit::Bytes(budget_) << " in use" << std::endl;
+        return false;
+    }
+
+    used_ += size;
+    peak_ = std::max(peak_, used_);
+    ++numReserved_;
+
+    reservations_[&client] = Reservation{size, false};
+    return true;
+}
+
+void WriteBufferPool::release(Client& client) {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    waitForYield(lock, client);
+
+    auto r = reservations_.find(&client);
+    ASSERT(r != reservations_.end());
+    used_ -= r->second.size_;
+    reservations_.erase(r);
+}
+
+size_t WriteBufferPool::used() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return used_;
+}
+
+WriteBufferPoolStats WriteBufferPool::statistics() const {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    WriteBufferPoolStats stats;
+    stats.budget_    = budget_;
+    stats.used_      = used_;
+    stats.peak_      = peak_;
+    stats.buffers_   = reservations_.size();
+    stats.reserved_  = numReserved_;
+    stats.reclaimed_ = numReclaimed_;
+    stats.refused_   = numRefused_;
+    return stats;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
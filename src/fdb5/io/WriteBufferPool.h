@@ -0,0 +1,130 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   WriteBufferPool.h
+/// @date   Oct 2026
+
+#ifndef fdb5_io_WriteBufferPool_h
+#define fdb5_io_WriteBufferPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "eckit/memory/NonCopyable.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Occupancy and activity of a WriteBufferPool, as reported with the FDB statistics
+
+struct WriteBufferPoolStats {
+
+    WriteBufferPoolStats();
+
+    size_t budget_;
+    size_t used_;
+    size_t peak_;
+    size_t buffers_;    ///< Buffers currently reserved
+
+    size_t reserved_;
+    size_t reclaimed_;
+    size_t refused_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Accounts for the write buffers of the data handles of a process against a shared memory budget.
+///
+/// Buffers are reserved when a handle first writes, not when it is opened. When the budget is exhausted,
+/// the least recently used handles are asked to write out their buffered data and free their buffers.
+/// If not enough can be reclaimed, the reservation is refused and the handle writes unbuffered.
+
+class WriteBufferPool : private eckit::NonCopyable {
+
+public: // types
+
+    /// A user of a pooled buffer, which may be asked to give its buffer back
+    class Client {
+    public:
+        Client();
+        virtual ~Client() {}
+
+        /// Write out any buffered data, and free the buffer. This is called from whichever thread needs
+        /// the memory, without the pool locked, but must not block on the client being in use.
+        /// @returns false if the buffer is in use, and cannot be given back now
+        virtual bool yieldBuffer() = 0;
+
+        /// Record that the buffer has been used. This is called on every write, so takes no lock.
+        void touch();
+
+    private:
+        friend class WriteBufferPool;
+        std::atomic<int64_t> lastUsed_;
+    };
+
+public: // methods
+
+    /// The pool shared by the data handles of the process, with a budget of fdbWriteBufferBudget
+    static WriteBufferPool& instance();
+
+    explicit WriteBufferPool(size_t budget);
+    ~WriteBufferPool();
+
+    /// Reserve a buffer for the client, reclaiming the buffers of the least recently used clients if required
+    /// @returns false if the budget cannot accommodate the buffer
+    bool reserve(Client& client, size_t size);
+
+    /// Give back the buffer reserved by the client
+    void release(Client& client);
+
+    size_t budget() const { return budget_; }
+    size_t used() const;
+
+    WriteBufferPoolStats statistics() const;
+
+private: // types
+
+    struct Reservation {
+        size_t size_;
+        bool yielding_;     ///< Being reclaimed, by a thread that does not hold the lock
+    };
+
+private: // methods
+
+    /// Wait until the client's reservation is not being reclaimed
+    void waitForYield(std::unique_lock<std::mutex>& lock, Client& client);
+
+private: // members
+
+    const size_t budget_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable yielded_;
+
+    std::unordered_map<Client*, Reservation> reservations_;
+
+    size_t used_;
+    size_t peak_;
+
+    size_t numReserved_;
+    size_t numReclaimed_;
+    size_t numRefused_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_io_WriteBufferPool_h
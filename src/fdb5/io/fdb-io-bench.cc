@@ -0,0 +1,255 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   fdb-io-bench.cc
+/// @date   Oct 2026
+///
+/// Benchmark of the data handles available to the TOC store. Writes the same fields through each of the write
+/// handles, as TocStore does, and reads them back field by field through each of the read handles.
+///
+/// n.b. Reads are likely to be served from the page cache, unless it is dropped between the write and read phases
+///      (see --read-only).
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/AIOHandle.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+#include "eckit/log/Timer.h"
+#include "eckit/option/CmdArgs.h"
+#include "eckit/option/SimpleOption.h"
+
+#include "fdb5/fdb5_config.h"
+#include "fdb5/io/DirectFileHandle.h"
+#include "fdb5/io/FDBFileHandle.h"
+#include "fdb5/tools/FDBTool.h"
+
+#if defined(fdb5_HAVE_URING)
+#include "fdb5/io/UringFileHandle.h"
+#include "fdb5/io/UringPartFileHandle.h"
+#endif
+
+using namespace eckit;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class FDBIOBench : public fdb5::FDBTool {
+
+    virtual void usage(const std::string& tool) const override;
+
+    virtual void init(const eckit::option::CmdArgs& args) override;
+
+    virtual int numberOfPositionalArguments() const override { return 0; }
+
+    virtual void execute(const eckit::option::CmdArgs& args) override;
+
+public:
+
+    FDBIOBench(int argc, char** argv) :
+        fdb5::FDBTool(argc, argv),
+        path_("."),
+        fields_(1024),
+        size_(1024 * 1024),
+        buffers_(4),
+        bufferSize_(16 * 1024 * 1024),
+        readOnly_(false) {
+
+        options_.push_back(new eckit::option::SimpleOption<std::string>("path", "Directory in which to write the test files (default .)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("fields", "Number of fields written to each file (default 1024)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("size", "Size of each field in bytes (default 1 MiB)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("buffers", "Number of buffers of the asynchronous handles (default 4)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("buffer-size", "Size of the write buffers (default 16 MiB)"));
+        options_.push_back(new eckit::option::SimpleOption<bool>("read-only", "Read the files written by a previous run"));
+    }
+
+private: // types
+
+    struct Engine {
+        std::string name_;
+        std::function<eckit::DataHandle*(const eckit::PathName&)> make_;
+    };
+
+private: // methods
+
+    eckit::PathName dataPath(const std::string& engine) const;
+
+    void fill(eckit::Buffer& buffer, size_t field) const;
+    void check(const eckit::Buffer& buffer, size_t field, const std::string& engine) const;
+
+    void benchWrite(const Engine& engine) const;
+
+    void report(const std::string& what, const std::string& engine, eckit::Timer& timer) const;
+
+private: // members
+
+    eckit::PathName path_;
+    size_t fields_;
+    size_t size_;
+    size_t buffers_;
+    size_t bufferSize_;
+    bool readOnly_;
+};
+
+void FDBIOBench::usage(const std::string& tool) const {
+    Log::info() << std::endl
+                << "Usage: " << tool << " [--path=<dir>] [--fields=<n>] [--size=<bytes>] [--buffers=<n>] "
+                << "[--buffer-size=<bytes>] [--read-only]" << std::endl;
+    fdb5::FDBTool::usage(tool);
+}
+
+void FDBIOBench::init(const eckit::option::CmdArgs& args) {
+
+    FDBTool::init(args);
+
+    path_ = args.getString("path", path_);
+    fields_ = args.getLong("fields", fields_);
+    size_ = args.getLong("size", size_);
+    buffers_ = args.getLong("buffers", buffers_);
+    bufferSize_ = args.getLong("buffer-size", bufferSize_);
+    readOnly_ = args.getBool("read-only", false);
+
+    ASSERT(fields_ > 0);
+    ASSERT(size_ >= sizeof(size_t));
+    ASSERT(buffers_ > 0);
+    ASSERT(bufferSize_ > 0);
+}
+
+eckit::PathName FDBIOBench::dataPath(const std::string& engine) const {
+    return path_ / ("fdb-io-bench." + engine + ".data");
+}
+
+void FDBIOBench::fill(eckit::Buffer& buffer, size_t field) const {
+    ::memcpy(buffer, &field, sizeof(field));
+}
+
+void FDBIOBench::check(const eckit::Buffer& buffer, size_t field, const std::string& engine) const {
+    size_t stored;
+    ::memcpy(&stored, buffer, sizeof(stored));
+    if (stored != field) {
+        std::ostringstream ss;
+        ss << engine << ": read field " << stored << ", expected " << field;
+        throw SeriousBug(ss.str(), Here());
+    }
+}
+
+void FDBIOBench::report(const std::string& what, const std::string& engine, eckit::Timer& timer) const {
+    timer.stop();
+    size_t total = fields_ * size_;
+    Log::info() << what << " " << engine << ": " << Bytes(total) << " in " << timer.elapsed() << " s, "
+                << Bytes(total, timer) << std::endl;
+}
+
+void FDBIOBench::benchWrite(const Engine& engine) const {
+
+    eckit::PathName path = dataPath(engine.name_);
+    if (path.exists()) {
+        path.unlink();
+    }
+
+    eckit::Buffer data(size_);
+    ::memset(data, 0x5a, size_);
+
+    Timer timer;
+
+    std::unique_ptr<eckit::DataHandle> dh(engine.make_(path));
+    dh->openForAppend(0);
+
+    for (size_t field = 0; field < fields_; ++field) {
+        fill(data, field);
+        long len = dh->write(data, size_);
+        ASSERT(len == long(size_));
+    }
+
+    dh->flush();
+    dh->close();
+
+    report("Write", engine.name_, timer);
+
+    ASSERT(path.size() == eckit::Length(fields_ * size_));
+}
+
+void FDBIOBench::execute(const eckit::option::CmdArgs&) {
+
+    size_t bufferSize = bufferSize_;
+    size_t buffers = buffers_;
+
+    std::vector<Engine> writers;
+
+    writers.push_back({"file", [=](const eckit::PathName& p) {
+        return new fdb5::FDBFileHandle(p, bufferSize);
+    }});
+    writers.push_back({"aio", [=](const eckit::PathName& p) {
+        return new eckit::AIOHandle(p, buffers, bufferSize);
+    }});
+    writers.push_back({"direct", [=](const eckit::PathName& p) {
+        return new fdb5::DirectFileHandle(p, bufferSize);
+    }});
+#if defined(fdb5_HAVE_URING)
+    writers.push_back({"uring", [=](const eckit::PathName& p) {
+        return new fdb5::UringFileHandle(p, buffers, bufferSize);
+    }});
+#endif
+
+    if (!readOnly_) {
+        for (const Engine& engine : writers) {
+            benchWrite(engine);
+        }
+    }
+
+    // Each field is read through its own handle, as for a retrieval. All readers read the file written by
+    // FDBFileHandle.
+
+    std::vector<std::pair<std::string, std::function<eckit::DataHandle*(const eckit::PathName&, size_t)>>> readers;
+
+    size_t size = size_;
+    readers.emplace_back("part", [=](const eckit::PathName& p, size_t field) {
+        return p.partHandle(eckit::Offset(field * size), eckit::Length(size));
+    });
+#if defined(fdb5_HAVE_URING)
+    readers.emplace_back("uring", [=](const eckit::PathName& p, size_t field) {
+        return new fdb5::UringPartFileHandle(p, eckit::Offset(field * size), eckit::Length(size));
+    });
+#endif
+
+    eckit::PathName path = dataPath("file");
+
+    for (const auto& reader : readers) {
+
+        eckit::Buffer data(size_);
+        Timer timer;
+
+        for (size_t field = 0; field < fields_; ++field) {
+            std::unique_ptr<eckit::DataHandle> dh(reader.second(path, field));
+            dh->openForRead();
+            eckit::AutoClose closer(*dh);
+            long len = dh->read(data, size_);
+            ASSERT(len == long(size_));
+            check(data, field, reader.first);
+        }
+
+        report("Read", reader.first, timer);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    FDBIOBench app(argc, argv);
+    return app.start();
+}
@@ -0,0 +1,588 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <sys/socket.h>
+
+#include <sstream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/log/Log.h"
+#include "eckit/os/BackTrace.h"
+#include "eckit/serialisation/MemoryStream.h"
+#include "eckit/utils/Translator.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/remote/ClientConnection.h"
+#include "fdb5/remote/SocketWrite.h"
+
+using namespace eckit;
+using namespace eckit::net;
+
+namespace eckit {
+template<> struct Translator<Endpoint, std::string> {
+    std::string operator()(const net::Endpoint& e) {
+        std::stringstream ss;
+        ss << e;
+        return ss.str();
+    }
+};
+}
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+RemoteFDBException::RemoteFDBException(const std::string& msg, const net::Endpoint& endpoint) :
+    RemoteException(msg, eckit::Translator<Endpoint, std::string>()(endpoint)) {}
+
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+class ConnectionError : public eckit::Exception {
+public:
+    ConnectionError(const int retries, const eckit::net::Endpoint& endpoint) {
+        std::ostringstream s;
+        s << "Unable to create a connection with the FDB endpoint " << endpoint << " after " << retries << " retries";
+        reason(s.str());
+        Log::status() << what() << std::endl;
+    }
+
+    bool retryOnClient() const override { return true; }
+};
+
+class TCPException : public Exception {
+public:
+    TCPException(const std::string& msg, const CodeLocation& here) :
+        Exception(std::string("TCPException: ") + msg, here) {
+
+        eckit::Log::error() << "TCP Exception; backtrace(): " << std::endl;
+        eckit::Log::error() << eckit::BackTrace::dump() << std::endl;
+    }
+};
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// n.b. if we get integer overflow, we reuse the IDs. This is not a
+//      big deal. The idea that we could be on the 2.1 billionth (successful)
+//      request, and still have an ongoing request 0 is ... laughable.
+
+uint32_t ClientConnection::generateRequestID() {
+
+    static std::mutex m;
+    static uint32_t id = 0;
+
+    std::lock_guard<std::mutex> lock(m);
+    return ++id;
+}
+
+ClientConnection::ClientConnection(const Endpoint& controlEndpoint, const std::string& compression) :
+    controlEndpoint_(controlEndpoint),
+    compressionRequested_(compression),
+    dispatching_(nullptr),
+    archiving_(nullptr),
+    connected_(false),
+    failed_(false) {}
+
+ClientConnection::~ClientConnection() {
+    try {
+        disconnect();
+    }
+    catch (std::exception& e) {
+        Log::error() << "Error closing connection to " << controlEndpoint_ << ": " << e.what() << std::endl;
+    }
+}
+
+// Protocol negotiation:
+//
+// i) Connect to server. Send:
+//     - session identification
+//     - supported functionality for protocol negotiation
+//
+// ii) Server responds. Sends:
+//     - returns the client session id (for verification)
+//     - the server session id
+//     - endpoint for data connection
+//     - selected functionality for protocol negotiation
+//
+// iii) Open data connection, and write to server:
+//     - client session id
+//     - server session id
+//
+// This appears quite verbose in terms of protocol negotiation, but the repeated
+// sending of both session ids allows clients and servers to be sure that they are
+// connected to the correct endpoint in a multi-process, multi-host environment.
+//
+// This was an issue on the NextGenIO prototype machine, where TCP connections were
+// getting lost, and/or incorrectly reset, and as a result sessions were being
+// mispaired by the network stack!
+
+void ClientConnection::connect() {
+
+    std::lock_guard<std::mutex> lock(controlMutex_);
+
+    if (failed()) {
+        std::stringstream ss;
+        ss << "Connection to " << controlEndpoint_ << " has been lost";
+        throw TCPException(ss.str(), Here());
+    }
+
+    if (connected_) return;
+
+    static int fdbMaxConnectRetries = eckit::Resource<int>("fdbMaxConnectRetries", 5);
+
+    try {
+        // Connect to server, and check that the server is happy on the response
+
+        Log::debug<LibFdb5>() << "Connecting to host: " << controlEndpoint_ << std::endl;
+        controlClient_.connect(controlEndpoint_, fdbMaxConnectRetries);
+        writeControlStartupMessage();
+        SessionID serverSession = verifyServerStartupResponse();
+
+        // Connect to the specified data port
+        Log::debug<LibFdb5>() << "Received data endpoint from host: " << dataEndpoint_ << std::endl;
+        dataClient_.connect(dataEndpoint_, fdbMaxConnectRetries);
+        writeDataStartupMessage(serverSession);
+
+        // And the connections are set up. Let everything start up!
+        listeningThread_ = std::thread([this] { listeningThreadLoop(); });
+        connected_ = true;
+    } catch(TooManyRetries& e) {
+        if (controlClient_.isConnected()) {
+            controlClient_.close();
+            throw ConnectionError(fdbMaxConnectRetries, dataEndpoint_);
+        } else {
+            throw ConnectionError(fdbMaxConnectRetries, controlEndpoint_);
+        }
+    }
+}
+
+void ClientConnection::disconnect() {
+
+    std::lock_guard<std::mutex> lock(controlMutex_);
+
+    if (connected_) {
+
+        // Send termination message. The server responds by closing the data connection. If the connection
+        // has been lost, wake up the listening thread instead.
+        bool exitSent = false;
+        if (!failed()) {
+            try {
+                controlWrite(Message::Exit, generateRequestID());
+                exitSent = true;
+            } catch (std::exception& e) {
+                Log::warning() << "Unable to end session with " << controlEndpoint_ << ": " << e.what() << std::endl;
+            }
+        }
+        if (!exitSent) {
+            ::shutdown(dataClient_.socket(), SHUT_RDWR);
+        }
+
+        listeningThread_.join();
+
+        // Close both the control and data connections
+        controlClient_.close();
+        dataClient_.close();
+        connected_ = false;
+    }
+}
+
+bool ClientConnection::failed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+void ClientConnection::writeControlStartupMessage() {
+
+    Buffer payload(4096);
+    MemoryStream s(payload);
+    s << sessionID_;
+    s << controlEndpoint_;
+    s << LibFdb5::instance().remoteProtocolVersion().used();
+
+    // TODO: Abstract this dictionary into a RemoteConfiguration object, which
+    //       understands how to do the negotiation, etc, but uses Value (i.e.
+    //       essentially JSON) over the wire for flexibility.
+    s << availableFunctionality().get();
+
+    controlWrite(Message::Startup, 0, payload.data(), s.position());
+}
+
+SessionID ClientConnection::verifyServerStartupResponse() {
+
+    MessageHeader hdr;
+    controlRead(&hdr, sizeof(hdr));
+
+    ASSERT(hdr.marker == StartMarker);
+    ASSERT(hdr.version == CurrentVersion);
+    ASSERT(hdr.message == Message::Startup);
+    ASSERT(hdr.requestID == 0);
+
+    Buffer payload(hdr.payloadSize);
+    eckit::FixedString<4> tail;
+    controlRead(payload, hdr.payloadSize);
+    controlRead(&tail, sizeof(tail));
+    ASSERT(tail == EndMarker);
+
+    MemoryStream s(payload);
+    SessionID clientSession(s);
+    SessionID serverSession(s);
+    Endpoint dataEndpoint(s);
+    LocalConfiguration serverFunctionality(s);
+
+    dataEndpoint_ = dataEndpoint;
+
+    // The server selects the codec (if any) to use on the data connection
+
+    compression_.codec(serverFunctionality.getString("Compression", "none"));
+
+    if (dataEndpoint_.hostname() != controlEndpoint_.hostname()) {
+        Log::warning() << "Data and control interface hostnames do not match. "
+                       << dataEndpoint_.hostname() << " /= "
+                       << controlEndpoint_.hostname() << std::endl;
+    }
+
+    if (clientSession != sessionID_) {
+        std::stringstream ss;
+        ss << "Session ID does not match session received from server: "
+           << sessionID_ << " != " << clientSession;
+        throw BadValue(ss.str(), Here());
+    }
+
+    return serverSession;
+}
+
+void ClientConnection::writeDataStartupMessage(const eckit::SessionID& serverSession) {
+
+    Buffer payload(1024);
+    MemoryStream s(payload);
+
+    s << sessionID_;
+    s << serverSession;
+
+    MessageHeader message(Message::Startup, 0, s.position());
+
+    std::vector<struct iovec> iov {ioBuffer(&message, sizeof(message)),
+                                   ioBuffer(payload.data(), s.position()),
+                                   ioBuffer(&EndMarker, sizeof(EndMarker))};
+    dataWrite(iov);
+}
+
+eckit::LocalConfiguration ClientConnection::availableFunctionality() const {
+    eckit::LocalConfiguration conf;
+    std::vector<int> remoteFieldLocationVersions = {1};
+    conf.set("RemoteFieldLocation", remoteFieldLocationVersions);
+    if (compressionRequested_ != "none") {
+        std::vector<std::string> codecs = {compressionRequested_};
+        conf.set("Compression", codecs);
+    }
+    return conf;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void ClientConnection::attach(Receiver* receiver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    receivers_.insert(receiver);
+}
+
+void ClientConnection::detach(Receiver* receiver) {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    receivers_.erase(receiver);
+    for (auto it = routes_.begin(); it != routes_.end();) {
+        if (it->second == receiver) {
+            it = routes_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (archiving_ == receiver) {
+        archiving_ = nullptr;
+    }
+
+    dispatched_.wait(lock, [this, receiver] { return dispatching_ != receiver; });
+}
+
+void ClientConnection::route(uint32_t requestID, Receiver* receiver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ASSERT(receivers_.find(receiver) != receivers_.end());
+    ASSERT(routes_.emplace(requestID, receiver).second);
+}
+
+void ClientConnection::unroute(uint32_t requestID) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    routes_.erase(requestID);
+}
+
+bool ClientConnection::acquireArchive(Receiver* receiver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (archiving_ && archiving_ != receiver) return false;
+    archiving_ = receiver;
+    return true;
+}
+
+void ClientConnection::releaseArchive(Receiver* receiver) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (archiving_ == receiver) {
+        archiving_ = nullptr;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void ClientConnection::listeningThreadLoop() {
+
+    /// @note This routine receives BOTH normal API asynchronously returned data, AND
+    /// fields that are being returned by a read. The receiver that made the request
+    /// decides where they go.
+
+    try {
+
+        MessageHeader hdr;
+        eckit::FixedString<4> tail;
+
+        while (true) {
+
+            dataRead(&hdr, sizeof(hdr));
+
+            ASSERT(hdr.marker == StartMarker);
+            ASSERT(hdr.version == CurrentVersion);
+
+            if (hdr.message == Message::Exit) {
+                return;
+            }
+
+            if (hdr.message != Message::Blob && hdr.message != Message::Complete && hdr.message != Message::Error) {
+                std::stringstream ss;
+                ss << "ERROR: Unexpected message recieved (" << static_cast<int>(hdr.message) << "). ABORTING";
+                Log::status() << ss.str() << std::endl;
+                Log::error() << "Retrieving... " << ss.str() << std::endl;
+                throw SeriousBug(ss.str(), Here());
+            }
+
+            Buffer payload(hdr.payloadSize);
+            if (hdr.payloadSize > 0) dataRead(payload, hdr.payloadSize);
+
+            // Ensure we have consumed exactly the correct amount from the socket.
+
+            dataRead(&tail, sizeof(tail));
+            ASSERT(tail == EndMarker);
+
+            if (hdr.message == Message::Blob && compression_.enabled()) {
+                payload = compression_.decode(payload.data(), hdr.payloadSize);
+                hdr.payloadSize = payload.size();
+            }
+
+            dispatch(hdr, std::move(payload));
+        }
+
+    // We don't want to let exceptions escape inside a worker thread.
+
+    } catch (...) {
+        fail(std::current_exception());
+    }
+}
+
+void ClientConnection::dispatch(const MessageHeader& hdr, eckit::Buffer&& payload) {
+
+    Receiver* receiver = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = routes_.find(hdr.requestID);
+        if (it == routes_.end()) {
+            Log::warning() << "Message received from " << controlEndpoint_
+                           << " for unknown request " << hdr.requestID << ". Ignored" << std::endl;
+            return;
+        }
+
+        receiver = it->second;
+        if (hdr.message != Message::Blob) {
+            routes_.erase(it);
+        }
+        dispatching_ = receiver;
+    }
+
+    // n.b. the receiver of an unshared connection may block until its client consumes earlier messages,
+    //      so the lock is not held
+
+    try {
+        receiver->receive(hdr, std::move(payload));
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            dispatching_ = nullptr;
+        }
+        dispatched_.notify_all();
+        throw;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dispatching_ = nullptr;
+    }
+    dispatched_.notify_all();
+}
+
+void ClientConnection::fail(std::exception_ptr e) {
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    failed_ = true;
+    routes_.clear();
+
+    std::set<Receiver*> receivers(receivers_);
+    for (Receiver* receiver : receivers) {
+        if (receivers_.find(receiver) == receivers_.end()) continue;
+        dispatching_ = receiver;
+        lock.unlock();
+        receiver->failed(e);
+        lock.lock();
+        dispatching_ = nullptr;
+        dispatched_.notify_all();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void ClientConnection::controlWriteCheckResponse(Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
+
+    std::lock_guard<std::mutex> lock(controlMutex_);
+
+    ASSERT(connected_);
+
+    controlWrite(msg, requestID, payload, payloadLength);
+
+    // Wait for the receipt acknowledgement
+
+    MessageHeader response;
+    controlRead(&response, sizeof(MessageHeader));
+
+    handleError(response);
+
+    ASSERT(response.marker == StartMarker);
+    ASSERT(response.version == CurrentVersion);
+    ASSERT(response.message == Message::Received);
+
+    eckit::FixedString<4> tail;
+    controlRead(&tail, sizeof(tail));
+    ASSERT(tail == EndMarker);
+}
+
+void ClientConnection::controlWrite(Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
+
+    ASSERT((payload == nullptr) == (payloadLength == 0));
+
+    MessageHeader message(msg, requestID, payloadLength);
+
+    std::vector<struct iovec> iov {ioBuffer(&message, sizeof(message)),
+                                   ioBuffer(payload, payloadLength),
+                                   ioBuffer(&EndMarker, sizeof(EndMarker))};
+    try {
+        writeVectored(controlClient_.socket(), iov);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = true;
+        throw;
+    }
+}
+
+void ClientConnection::controlRead(void* data, size_t length) {
+    size_t read = controlClient_.read(data, length);
+    if (length != read) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            failed_ = true;
+        }
+        std::stringstream ss;
+        ss << "Read error. Expected " << length << " bytes, read " << read;
+        throw TCPException(ss.str(), Here());
+    }
+}
+
+void ClientConnection::dataWrite(std::vector<struct iovec>& iov) {
+    writeVectored(dataClient_.socket(), iov);
+}
+
+void ClientConnection::dataWrite(const void* data, size_t length) {
+    size_t written = dataClient_.write(data, length);
+    if (length != written) {
+        std::stringstream ss;
+        ss << "Write error. Expected " << length << " bytes, wrote " << written;
+        throw TCPException(ss.str(), Here());
+    }
+}
+
+void ClientConnection::dataRead(void* data, size_t length) {
+    size_t read = dataClient_.read(data, length);
+    if (length != read) {
+        std::stringstream ss;
+        ss << "Read error. Expected " << length << " bytes, read " << read;
+        throw TCPException(ss.str(), Here());
+    }
+}
+
+void ClientConnection::handleError(const MessageHeader& hdr) {
+
+    ASSERT(hdr.marker == StartMarker);
+    ASSERT(hdr.version == CurrentVersion);
+
+    if (hdr.message == Message::Error) {
+        ASSERT(hdr.payloadSize > 9);
+
+        std::string what(hdr.payloadSize, ' ');
+        controlRead(&what[0], hdr.payloadSize);
+        what[hdr.payloadSize] = 0; // Just in case
+
+        try {
+            eckit::FixedString<4> tail;
+            controlRead(&tail, sizeof(tail));
+        } catch (...) {}
+
+        throw RemoteFDBException(what, controlEndpoint_);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ClientConnectionPool& ClientConnectionPool::instance() {
+    static ClientConnectionPool pool;
+    return pool;
+}
+
+ClientConnectionPool::ClientConnectionPool() {}
+
+ClientConnectionPool::~ClientConnectionPool() {}
+
+std::shared_ptr<ClientConnection> ClientConnectionPool::connection(const Endpoint& endpoint, const std::string& compression) {
+
+    std::ostringstream key;
+    key << endpoint << "/" << compression;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    std::shared_ptr<ClientConnection>& conn(connections_[key.str()]);
+    if (!conn || conn->failed()) {
+        conn = std::make_shared<ClientConnection>(endpoint, compression);
+    }
+    return conn;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
@@ -0,0 +1,208 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   ClientConnection.h
+/// @date   Oct 2026
+
+#ifndef fdb5_remote_ClientConnection_H
+#define fdb5_remote_ClientConnection_H
+
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/memory/NonCopyable.h"
+#include "eckit/net/Endpoint.h"
+#include "eckit/net/TCPClient.h"
+#include "eckit/runtime/SessionID.h"
+
+#include "fdb5/remote/Messages.h"
+#include "fdb5/remote/WireCompression.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class RemoteFDBException : public eckit::RemoteException {
+public:
+    RemoteFDBException(const std::string& msg, const eckit::net::Endpoint& endpoint);
+};
+
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The control and data connections of one session with an FDB server.
+///
+/// A connection may be shared by many clients (normally RemoteFDB instances). Each request is routed to
+/// the client that made it: messages received on the data connection are handed to the client registered
+/// for their requestID. Requests on the control connection are serialised, so that each client sees the
+/// acknowledgement of its own request.
+///
+/// The server supports one ongoing archive per session, so only one client at a time may archive
+/// through the connection. See acquireArchive().
+
+class ClientConnection : private eckit::NonCopyable {
+
+public: // types
+
+    /// Receives the messages sent by the server in response to the requests of one client
+    class Receiver {
+    public:
+        virtual ~Receiver() {}
+
+        /// A Blob, Complete or Error message for a request routed to this receiver. Blob payloads have
+        /// already been decompressed. A receiver that may share the connection must not block, as the
+        /// messages of all of the receivers are delivered by the same thread.
+        virtual void receive(const MessageHeader& hdr, eckit::Buffer&& payload) = 0;
+
+        /// The connection has failed. No further messages will be received.
+        virtual void failed(std::exception_ptr e) = 0;
+    };
+
+public: // methods
+
+    /// Request IDs are unique within the process, and so within any (shared) connection
+    static uint32_t generateRequestID();
+
+    ClientConnection(const eckit::net::Endpoint& controlEndpoint, const std::string& compression);
+    ~ClientConnection();
+
+    /// Connect to the server, if not already connected. Thread safe.
+    void connect();
+
+    /// True once the connection has been lost. A failed connection cannot be reused.
+    bool failed() const;
+
+    void attach(Receiver* receiver);
+
+    /// Stop delivering messages to the receiver. On return the receiver is no longer in use by the
+    /// listening thread.
+    void detach(Receiver* receiver);
+
+    /// Route the messages for a request to a receiver. This must be done before the request is sent.
+    /// The route is removed when the request is complete, or has failed.
+    void route(uint32_t requestID, Receiver* receiver);
+    void unroute(uint32_t requestID);
+
+    /// Obtain, or release, the right to archive through this connection
+    bool acquireArchive(Receiver* receiver);
+    void releaseArchive(Receiver* receiver);
+
+    /// Send a message on the control connection, and wait for the server to acknowledge it
+    void controlWriteCheckResponse(Message msg, uint32_t requestID, const void* payload=nullptr, uint32_t payloadLength=0);
+
+    /// Write to the data connection. Only the client that holds the archive may write data.
+    void dataWrite(std::vector<struct iovec>& iov);
+    void dataWrite(const void* data, size_t length);
+
+    /// The compression of Blob payloads agreed with the server
+    WireCompression& compression() { return compression_; }
+    const WireCompression& compression() const { return compression_; }
+
+    const eckit::net::Endpoint& controlEndpoint() const { return controlEndpoint_; }
+    const eckit::net::Endpoint& dataEndpoint() const { return dataEndpoint_; }
+
+private: // methods
+
+    void disconnect();
+
+    // Session negotiation with the server
+    void writeControlStartupMessage();
+    eckit::SessionID verifyServerStartupResponse();
+    void writeDataStartupMessage(const eckit::SessionID& serverSession);
+
+    eckit::LocalConfiguration availableFunctionality() const;
+
+    // Listen to the data connection for incoming messages, and pass them to their receivers
+    void listeningThreadLoop();
+    void dispatch(const MessageHeader& hdr, eckit::Buffer&& payload);
+    void fail(std::exception_ptr e);
+
+    void controlWrite(Message msg, uint32_t requestID, const void* payload=nullptr, uint32_t payloadLength=0);
+    void controlRead(void* data, size_t length);
+    void dataRead(void* data, size_t length);
+    void handleError(const MessageHeader& hdr);
+
+private: // members
+
+    eckit::SessionID sessionID_;
+
+    eckit::net::Endpoint controlEndpoint_;
+    eckit::net::Endpoint dataEndpoint_;
+
+    eckit::net::TCPClient controlClient_;
+    eckit::net::TCPClient dataClient_;
+
+    // Compression of the data connection, if requested and agreed with the server
+    std::string compressionRequested_;
+    WireCompression compression_;
+
+    std::thread listeningThread_;
+
+    // Serialises the connection set up, and the request/acknowledgement pairs on the control connection
+    std::mutex controlMutex_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable dispatched_;
+    std::set<Receiver*> receivers_;
+    std::map<uint32_t, Receiver*> routes_;
+    Receiver* dispatching_;   ///< The receiver currently being called by the listening thread
+    Receiver* archiving_;
+
+    bool connected_;
+    bool failed_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The connections to FDB servers shared by all of the RemoteFDB instances of a process. Connections are
+/// kept open for the lifetime of the process, so that short lived FDB handles do not pay for the connection
+/// set up and the session negotiation.
+
+class ClientConnectionPool : private eckit::NonCopyable {
+
+public: // methods
+
+    static ClientConnectionPool& instance();
+
+    /// @returns the shared connection to an endpoint, with the requested compression. A connection that
+    ///          has failed is replaced.
+    std::shared_ptr<ClientConnection> connection(const eckit::net::Endpoint& endpoint, const std::string& compression);
+
+private: // methods
+
+    ClientConnectionPool();
+    ~ClientConnectionPool();
+
+private: // members
+
+    std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<ClientConnection>> connections_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
+
+#endif  // fdb5_remote_ClientConnection_H
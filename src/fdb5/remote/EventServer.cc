@@ -0,0 +1,488 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/log/Log.h"
+#include "eckit/runtime/SessionID.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/remote/EventServer.h"
+#include "fdb5/remote/Handler.h"
+
+using namespace eckit;
+
+namespace fdb5 {
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+// Tags identifying the listening sockets, and the wakeup event. Connections are tagged from FirstConnection.
+
+const uint64_t ControlListener = 0;
+const uint64_t DataListener = 1;
+const uint64_t Wakeup = 2;
+const uint64_t FirstConnection = 3;
+
+Config schedulerConfig(const Config& config) {
+
+    // Many clients share the scheduler. Don't let one slow client hold up the others.
+
+    Config result(config);
+    if (!result.has("serverSendThreads")) {
+        result.set("serverSendThreads", 4L);
+    }
+    return result;
+}
+
+/// Reads from the socket fail if no data arrives within the timeout. A timeout of zero waits forever.
+
+void receiveTimeout(int fd, long seconds) {
+    struct timeval tv;
+    tv.tv_sec = seconds;
+    tv.tv_usec = 0;
+    SYSCALL(::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)));
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+struct EventServer::Session {
+
+    enum State {
+        Accepted,   ///< Waiting for the client's startup message
+        Starting,   ///< Negotiating with the client
+        Waiting,    ///< Waiting for the data connection
+        Attaching,  ///< The data connection has arrived, and is being attached
+        Attached    ///< The control connection is being watched for messages
+    };
+
+    Session(SocketPtr socket) : tag_(0), fd_(socket->socket()), socket_(socket), state_(Accepted) {}
+
+    uint64_t tag_;
+    int fd_;                                  ///< Of the control connection
+    SocketPtr socket_;                        ///< The control connection, until taken over by the handler
+    std::unique_ptr<eckit::SessionID> id_;
+    std::unique_ptr<RemoteHandler> handler_;
+
+    State state_;                             ///< Protected by the server mutex, as are id_ and handler_ until attached
+    Clock::time_point deadline_;              ///< For the startup message, or the data connection, to arrive
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+EventServer::EventServer(net::TCPServer& server, const Config& config) :
+    config_(config),
+    controlServer_(server),
+    dataServer_(config.getInt("serverDataPort", 0), net::SocketOptions::server().reusePort(true)),
+    dataPort_(dataServer_.localPort()),
+    epoll_(-1),
+    wakeup_(-1),
+    timeout_(config.getLong("serverTimeout", eckit::Resource<long>("fdbServerTimeout;$FDB_SERVER_TIMEOUT", 60))),
+    stopping_(false),
+    readScheduler_(schedulerConfig(config)),
+    nextTag_(FirstConnection),
+    tasks_(eckit::Resource<size_t>("fdbServerEventQueueLength;$FDB_SERVER_EVENT_QUEUE_LENGTH", 1024)) {
+
+#if defined(__linux__)
+    SYSCALL(epoll_ = ::epoll_create1(EPOLL_CLOEXEC));
+    SYSCALL(wakeup_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+#else
+    throw eckit::NotImplemented("The event driven FDB server requires epoll", Here());
+#endif
+
+    ASSERT(timeout_ > 0);
+
+    dataServer_.closeExec(false);
+
+    static long fdbServerWorkers = eckit::Resource<long>("fdbServerWorkers;$FDB_SERVER_WORKERS", 16);
+    long workers = config.getLong("serverWorkers", fdbServerWorkers);
+    ASSERT(workers > 0);
+
+    Log::info() << "Event driven FDB server: " << workers << " workers, shared data port " << dataPort_ << std::endl;
+
+    for (long i = 0; i < workers; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+EventServer::~EventServer() {
+
+    tasks_.close();
+    for (std::thread& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+
+    readScheduler_.close();
+
+    if (wakeup_ >= 0) {
+        ::close(wakeup_);
+    }
+    if (epoll_ >= 0) {
+        ::close(epoll_);
+    }
+}
+
+void EventServer::run() {
+
+#if defined(__linux__)
+    watch(controlServer_.socket(), ControlListener, true);
+    watch(dataServer_.socket(), DataListener, true);
+    watch(wakeup_, Wakeup, true);
+
+    const int maxEvents = 64;
+    struct epoll_event events[maxEvents];
+
+    Clock::time_point nextExpiry = Clock::now() + std::chrono::seconds(1);
+
+    while (!stopping_) {
+
+        int n = ::epoll_wait(epoll_, events, maxEvents, 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw FailedSystemCall("epoll_wait", Here());
+        }
+
+        for (int i = 0; i < n; ++i) {
+            uint64_t tag = events[i].data.u64;
+            try {
+                if (tag == ControlListener) {
+                    acceptControl();
+                } else if (tag == DataListener) {
+                    acceptData();
+                } else if (tag != Wakeup) {
+                    dispatch(tag);
+                }
+            }
+            catch (std::exception& e) {
+                Log::error() << "** " << e.what() << " Caught in " << Here() << std::endl;
+                Log::error() << "** Exception is ignored" << std::endl;
+            }
+        }
+
+        if (Clock::now() >= nextExpiry) {
+            expire();
+            nextExpiry = Clock::now() + std::chrono::seconds(1);
+        }
+    }
+#endif
+}
+
+void EventServer::stop() {
+    stopping_ = true;
+    uint64_t one = 1;
+    if (::write(wakeup_, &one, sizeof(one)) < 0) {
+        Log::error() << "Failed to wake up the event driven FDB server" << Log::syserr << std::endl;
+    }
+}
+
+void EventServer::workerLoop() {
+    Task task;
+    while (tasks_.pop(task) != -1) {
+        try {
+            task();
+        }
+        catch (std::exception& e) {
+            Log::error() << "** " << e.what() << " Caught in " << Here() << std::endl;
+            Log::error() << "** Exception is ignored" << std::endl;
+        }
+        task = nullptr;
+    }
+}
+
+void EventServer::acceptControl() {
+
+    SocketPtr socket(new net::TCPSocket(controlServer_.accept()));
+
+    // Messages are only read once they start to arrive, but must then arrive promptly
+
+    receiveTimeout(socket->socket(), timeout_);
+
+    SessionPtr session(new Session(socket));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        session->tag_ = nextTag_++;
+        session->deadline_ = Clock::now() + std::chrono::seconds(timeout_);
+        sessions_[session->tag_] = session;
+    }
+
+    // n.b. the handshake is done by a worker once the startup message arrives, so that a slow client does
+    //      not hold up the others
+
+    watch(session->fd_, session->tag_, true);
+}
+
+void EventServer::acceptData() {
+
+    SocketPtr socket(new net::TCPSocket(dataServer_.accept()));
+    receiveTimeout(socket->socket(), timeout_);
+
+    uint64_t tag;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tag = nextTag_++;
+        dataConnections_[tag] = DataConnection{socket, Clock::now() + std::chrono::seconds(timeout_)};
+    }
+
+    watch(socket->socket(), tag, true);
+}
+
+void EventServer::dispatch(uint64_t tag) {
+
+    // n.b. don't block on a full task queue with the mutex held
+
+    Task task;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto it = sessions_.find(tag);
+        if (it != sessions_.end()) {
+            SessionPtr session = it->second;
+            if (session->state_ == Session::Accepted) {
+                session->state_ = Session::Starting;
+                task = [this, session] { startSession(session); };
+            } else if (session->state_ == Session::Attached) {
+                task = [this, session] { serve(session); };
+            }
+        } else {
+            auto dc = dataConnections_.find(tag);
+            if (dc != dataConnections_.end()) {
+                SocketPtr socket = dc->second.socket_;
+                dataConnections_.erase(dc);
+#if defined(__linux__)
+                ::epoll_ctl(epoll_, EPOLL_CTL_DEL, socket->socket(), nullptr);
+#endif
+                task = [this, socket] { attachData(socket); };
+            }
+        }
+    }
+
+    if (task) {
+        tasks_.emplace(std::move(task));
+    }
+}
+
+void EventServer::expire() {
+
+    Clock::time_point now = Clock::now();
+
+    std::vector<SessionPtr> sessions;
+    std::vector<SocketPtr> sockets;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto it = sessions_.begin(); it != sessions_.end();) {
+            const Session& session(*it->second);
+            if ((session.state_ == Session::Accepted || session.state_ == Session::Waiting) && session.deadline_ < now) {
+                sessions.push_back(it->second);
+                it = sessions_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        for (auto it = dataConnections_.begin(); it != dataConnections_.end();) {
+            if (it->second.deadline_ < now) {
+                sockets.push_back(it->second.socket_);
+                it = dataConnections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (SocketPtr& socket : sockets) {
+        Log::warning() << "Closing data connection that did not identify its session within " << timeout_ << "s" << std::endl;
+#if defined(__linux__)
+        ::epoll_ctl(epoll_, EPOLL_CTL_DEL, socket->socket(), nullptr);
+#endif
+    }
+
+    for (SessionPtr& session : sessions) {
+        if (session->state_ == Session::Accepted) {
+            Log::warning() << "Closing connection that did not start a session within " << timeout_ << "s" << std::endl;
+        } else {
+            Log::warning() << "Ending session " << *session->id_ << ": no data connection within " << timeout_ << "s" << std::endl;
+        }
+        tasks_.emplace([this, session] { endSession(session); });
+    }
+}
+
+void EventServer::startSession(const SessionPtr& session) {
+
+    try {
+        std::unique_ptr<RemoteHandler> handler(new RemoteHandler(*session->socket_, config_, readScheduler_));
+        RemoteHandler* h = handler.get();
+
+        // Make the session known before the client is told where to connect, so that its data connection
+        // can always be matched to it
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            session->id_.reset(new eckit::SessionID(h->sessionID()));
+            session->handler_ = std::move(handler);
+        }
+
+        if (!h->startSession(dataPort_)) {
+            abandonSession(session);
+            return;
+        }
+
+        // n.b. the data connection may already have arrived
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (session->state_ == Session::Starting) {
+            session->state_ = Session::Waiting;
+            session->deadline_ = Clock::now() + std::chrono::seconds(timeout_);
+        }
+    }
+    catch (std::exception& e) {
+        Log::error() << "Failed to start session: " << e.what() << std::endl;
+        abandonSession(session);
+    }
+}
+
+void EventServer::abandonSession(const SessionPtr& session) {
+
+    // If the data connection has already arrived, the session is ended once the lost control connection
+    // is noticed, rather than from under the worker attaching it
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (session->state_ != Session::Starting) return;
+    }
+
+    endSession(session);
+}
+
+void EventServer::attachData(SocketPtr socket) {
+
+    SessionPtr session;
+
+    try {
+        eckit::SessionID clientSession;
+        eckit::SessionID serverSession;
+        RemoteHandler::readDataStartup(*socket, clientSession, serverSession);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto& kv : sessions_) {
+                Session& s(*kv.second);
+                if ((s.state_ == Session::Starting || s.state_ == Session::Waiting) && s.id_ && *s.id_ == serverSession) {
+                    s.state_ = Session::Attaching;
+                    session = kv.second;
+                    break;
+                }
+            }
+        }
+
+        if (!session) {
+            std::stringstream ss;
+            ss << "Data connection received for unknown session: " << serverSession;
+            throw BadValue(ss.str(), Here());
+        }
+
+        // The data connection is read by the archive thread, which waits for as long as the client needs
+
+        receiveTimeout(socket->socket(), 0);
+
+        session->handler_->attachDataConnection(*socket, clientSession, serverSession);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            session->state_ = Session::Attached;
+        }
+
+        // From now on, messages on the control connection are handled as they arrive
+
+        watch(session->fd_, session->tag_, false);
+
+        Log::info() << "Session " << serverSession << " started" << std::endl;
+    }
+    catch (std::exception& e) {
+        Log::error() << "Failed to attach data connection: " << e.what() << std::endl;
+        if (session) {
+            endSession(session);
+        }
+    }
+}
+
+void EventServer::serve(const SessionPtr& session) {
+
+    bool more = false;
+
+    try {
+        more = session->handler_->handleMessage();
+    }
+    catch (std::exception& e) {
+        // The connection has been lost, or a message did not arrive in time
+        Log::error() << "Ending session: " << e.what() << std::endl;
+    }
+
+    if (more) {
+        watch(session->fd_, session->tag_, false);
+    } else {
+        endSession(session);
+    }
+}
+
+void EventServer::endSession(const SessionPtr& session) {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sessions_.erase(session->tag_);
+    }
+
+    // n.b. the control connection is watched from when it is accepted
+
+#if defined(__linux__)
+    ::epoll_ctl(epoll_, EPOLL_CTL_DEL, session->fd_, nullptr);
+#endif
+
+    // n.b. destroy the handler here, in the worker, as it waits for its outstanding work to complete
+
+    session->handler_.reset();
+    session->socket_.reset();
+}
+
+void EventServer::watch(int fd, uint64_t tag, bool add) {
+
+#if defined(__linux__)
+    struct epoll_event ev;
+    ::memset(&ev, 0, sizeof(ev));
+
+    // Connections are handed to one worker at a time, and re-armed once the message has been handled
+
+    ev.events = EPOLLIN | (tag >= FirstConnection ? EPOLLONESHOT : 0);
+    ev.data.u64 = tag;
+
+    SYSCALL(::epoll_ctl(epoll_, add ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev));
+#endif
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
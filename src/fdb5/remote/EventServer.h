@@ -0,0 +1,131 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   EventServer.h
+/// @date   Oct 2026
+
+#ifndef fdb5_remote_EventServer_H
+#define fdb5_remote_EventServer_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eckit/container/Queue.h"
+#include "eckit/memory/NonCopyable.h"
+#include "eckit/net/TCPServer.h"
+#include "eckit/net/TCPSocket.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/remote/ReadScheduler.h"
+
+namespace fdb5 {
+namespace remote {
+
+class RemoteHandler;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Serves many client sessions from a single process, without a process or thread per connection.
+///
+/// All of the connections are watched with epoll, and the messages that arrive are handled by a fixed pool of
+/// worker threads. The data connections of all sessions are accepted on one shared port, and matched to their
+/// session by the session IDs in their startup message. Reads for all sessions are served by one shared
+/// ReadScheduler, and as the sessions share a process they also share the process-wide catalogue caches.
+///
+/// A connection is only handed to a worker once data has arrived on it, and reads are subject to a timeout,
+/// so that clients that are slow or stall cannot tie up the workers. Sessions whose handshake or data
+/// connection does not arrive in time are ended.
+
+class EventServer : private eckit::NonCopyable {
+
+public: // methods
+
+    EventServer(eckit::net::TCPServer& server, const Config& config);
+    ~EventServer();
+
+    /// Serve connections until stopped
+    void run();
+
+    /// Stop serving. May be called from any thread.
+    void stop();
+
+private: // types
+
+    struct Session;
+    using SessionPtr = std::shared_ptr<Session>;
+    using SocketPtr = std::shared_ptr<eckit::net::TCPSocket>;
+
+    using Clock = std::chrono::steady_clock;
+
+    /// A data connection, waiting for its startup message
+    struct DataConnection {
+        SocketPtr socket_;
+        Clock::time_point deadline_;
+    };
+
+    using Task = std::function<void()>;
+
+private: // methods
+
+    void workerLoop();
+
+    void acceptControl();
+    void acceptData();
+
+    void startSession(const SessionPtr& session);
+    void attachData(SocketPtr socket);
+    void serve(const SessionPtr& session);
+    void abandonSession(const SessionPtr& session);
+    void endSession(const SessionPtr& session);
+
+    void dispatch(uint64_t tag);
+    void expire();
+
+    void watch(int fd, uint64_t tag, bool add);
+
+private: // members
+
+    Config config_;
+
+    eckit::net::TCPServer& controlServer_;
+    eckit::net::TCPServer dataServer_;
+    int dataPort_;
+
+    int epoll_;
+    int wakeup_;         ///< Signalled to stop the server
+
+    long timeout_;       ///< Seconds allowed for each message to arrive, once started, and for new connections
+
+    std::atomic<bool> stopping_;
+
+    ReadScheduler readScheduler_;
+
+    std::mutex mutex_;
+    std::map<uint64_t, SessionPtr> sessions_;
+    std::map<uint64_t, DataConnection> dataConnections_;
+    uint64_t nextTag_;
+
+    eckit::Queue<Task> tasks_;
+    std::vector<std::thread> workers_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
+
+#endif  // fdb5_remote_EventServer_H
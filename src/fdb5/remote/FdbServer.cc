@@ -19,6 +19,7 @@
 #include "fdb5/remote/FdbServer.h"
 
 #include "fdb5/remote/AvailablePortList.h"
+#include "fdb5/remote/EventServer.h"
 #include "fdb5/remote/Handler.h"
 
 using namespace eckit;
@@ -102,11 +103,27 @@ void FdbServerBase::doRun() {
     int port = config.getInt("serverPort", 7654);
     bool threaded = config.getBool("serverThreaded", false);
 
+    // serverMode is one of "forked" (a process per connection), "threaded" (a thread per connection) or
+    // "event" (many connections served by a fixed pool of threads)
+
+    std::string mode = config.getString("serverMode", threaded ? "threaded" : "forked");
+    threaded = (mode == "threaded");
+
+    if (mode != "forked" && mode != "threaded" && mode != "event") {
+        throw eckit::BadValue("Unknown serverMode: " + mode, Here());
+    }
+
     net::TCPServer server(net::Port("fdb", port), net::SocketOptions::server().reusePort(true));
     server.closeExec(false);
 
     port_ = server.localPort();
 
+    if (mode == "event") {
+        EventServer events(server, config);
+        events.run();
+        return;
+    }
+
     while (true) {
         try {
             if (threaded) {
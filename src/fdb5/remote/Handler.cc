@@ -13,9 +13,11 @@
  * (Project ID: 671951) www.nextgenio.eu
  */
 
+#include <algorithm>
 #include <chrono>
 
 #include "eckit/config/Resource.h"
+#include "eckit/io/ResizableBuffer.h"
 #include "eckit/maths/Functions.h"
 #include "eckit/net/Endpoint.h"
 #include "eckit/runtime/Main.h"
@@ -26,12 +28,14 @@
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/fdb5_version.h"
+#include "fdb5/api/FDBStats.h"
 #include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/database/Key.h"
 #include "fdb5/remote/AvailablePortList.h"
 #include "fdb5/remote/Handler.h"
 #include "fdb5/remote/Messages.h"
 #include "fdb5/remote/RemoteFieldLocation.h"
+#include "fdb5/remote/SocketWrite.h"
 
 using namespace eckit;
 using metkit::mars::MarsRequest;
@@ -128,6 +132,22 @@ private:
 };
 
 
+struct CompactHelper : public BaseHelper<CompactElement> {
+    void extraDecode(eckit::Stream& s) {
+        s >> doit_;
+        s >> porcelain_;
+    }
+
+    CompactIterator apiCall(FDB& fdb, const FDBToolRequest& request) const {
+        return fdb.compact(request, doit_, porcelain_);
+    }
+
+private:
+    bool doit_;
+    bool porcelain_;
+};
+
+
 struct StatsHelper : public BaseHelper<StatsElement> {
     StatsIterator apiCall(FDB& fdb, const FDBToolRequest& request) const {
         return fdb.stats(request);
@@ -176,27 +196,43 @@ private:
 
 //----------------------------------------------------------------------------------------------------------------------
 
-// n.b. by default the retrieve queue is big -- we are only queueing the requests, and it
-// is a common idiom to queue _many_ requests behind each other (and then aggregate the
-// results in a MultiHandle/HandleGatherer).
-
 RemoteHandler::RemoteHandler(eckit::net::TCPSocket& socket, const Config& config) :
     config_(config),
     controlSocket_(socket),
-    dataSocket_(selectDataPort()),
+    dataListener_(new eckit::net::EphemeralTCPServer(selectDataPort())),
+    dataListenHostname_(config.getString("dataListenHostname", "")),
+    fdb_(config),
+    readScheduler_(nullptr) {}
+
+RemoteHandler::RemoteHandler(eckit::net::TCPSocket& socket, const Config& config, ReadScheduler& readScheduler) :
+    config_(config),
+    controlSocket_(socket),
     dataListenHostname_(config.getString("dataListenHostname", "")),
     fdb_(config),
-    readLocationQueue_(eckit::Resource<size_t>("fdbRetrieveQueueSize", 10000)) {}
+    readScheduler_(&readScheduler) {}
 
 RemoteHandler::~RemoteHandler() {
     // We don't want to die before the worker threads are cleaned up
 
     waitForWorkers();
 
+    if (compression_.enabled()) {
+        FDBStats stats;
+        compression_.stats(stats);
+        Log::info() << "Data connection compressed with " << compression_.codec() << ":" << std::endl;
+        stats.report(Log::info(), "    ");
+    }
+
     // And notify the client that we are done.
 
-    Log::info() << "Sending exit message to client" << std::endl;
-    dataWrite(Message::Exit, 0);
+    if (dataSocket_.isConnected()) {
+        Log::info() << "Sending exit message to client" << std::endl;
+        try {
+            dataWrite(Message::Exit, 0);
+        } catch (std::exception& e) {
+            Log::error() << "Failed to send exit message to client: " << e.what() << std::endl;
+        }
+    }
     Log::info() << "Done" << std::endl;
 }
 
@@ -206,6 +242,7 @@ eckit::LocalConfiguration RemoteHandler::availableFunctionality() const {
 //    Add to the configuration all the components that require to be versioned, as in the following example, with a vector of supported version numbers
     std::vector<int> remoteFieldLocationVersions = {1};
     conf.set("RemoteFieldLocation", remoteFieldLocationVersions);
+    conf.set("Compression", WireCompression::available());
     return conf;
 }
 
@@ -225,6 +262,26 @@ std::vector<int> intersection(const LocalConfiguration& c1, const LocalConfigura
 }
 
 void RemoteHandler::initialiseConnections() {
+
+    if (!startSession(dataListener_->localPort())) {
+        return;
+    }
+
+    net::TCPSocket socket(dataListener_->accept());
+
+    // Check the response from the client.
+    // Ensure that the hostname matches the original hostname, and that
+    // it returns the details we sent it
+    // IE check that we are connected to the correct client!
+
+    SessionID clientSession;
+    SessionID serverSession;
+    readDataStartup(socket, clientSession, serverSession);
+
+    attachDataConnection(socket, clientSession, serverSession);
+}
+
+bool RemoteHandler::startSession(int dataport) {
     // Read the startup message from the client. Check that it all checks out.
 
     MessageHeader hdr;
@@ -241,7 +298,8 @@ void RemoteHandler::initialiseConnections() {
     ASSERT(tail == EndMarker);
 
     MemoryStream s1(payload1);
-    SessionID clientSession(s1);
+    clientSession_.reset(new SessionID(s1));
+    const SessionID& clientSession(*clientSession_);
     net::Endpoint endpointFromClient(s1);
     unsigned int remoteProtocolVersion = 0;
     std::string errorMsg;
@@ -270,6 +328,20 @@ void RemoteHandler::initialiseConnections() {
          if (rflCommon.size() > 0) {
              Log::debug() << "Protocol negotiation - RemoteFieldLocation version " << rflCommon.back() << std::endl;
              agreedConf_.set("RemoteFieldLocation", rflCommon.back());
+
+             // compression is optional. Use the first codec preferred by the client that we support
+
+             if (clientAvailableFunctionality.has("Compression")) {
+                 std::vector<std::string> serverCodecs = serverConf.getStringVector("Compression");
+                 for (const std::string& codec : clientAvailableFunctionality.getStringVector("Compression")) {
+                     if (std::find(serverCodecs.begin(), serverCodecs.end(), codec) != serverCodecs.end()) {
+                         Log::debug() << "Protocol negotiation - Compression " << codec << std::endl;
+                         agreedConf_.set("Compression", codec);
+                         break;
+                     }
+                 }
+             }
+             compression_.codec(agreedConf_.getString("Compression", "none"));
          }
          else {
              std::stringstream ss;
@@ -286,7 +358,6 @@ void RemoteHandler::initialiseConnections() {
     //               server has multiple, then we use that on, whilst retaining
     //               the capacity in the protocol for the server to make a choice.
 
-    int dataport = dataSocket_.localPort();
     // std::string host = dataListenHostname_.empty() ? dataSocket_.localHost() :
     // dataListenHostname_;
     net::Endpoint dataEndpoint(endpointFromClient.hostname(), dataport);
@@ -310,31 +381,37 @@ void RemoteHandler::initialiseConnections() {
 
     if (!errorMsg.empty()) {
         controlWrite(Message::Error, 0, errorMsg.c_str(), errorMsg.length());
-        return;
+        return false;
     }
 
-    dataSocket_.accept();
+    return true;
+}
 
-    // Check the response from the client.
-    // Ensure that the hostname matches the original hostname, and that
-    // it returns the details we sent it
-    // IE check that we are connected to the correct client!
+void RemoteHandler::readDataStartup(net::TCPSocket& socket, SessionID& clientSession, SessionID& serverSession) {
 
     MessageHeader dataHdr;
-    socketRead(&dataHdr, sizeof(dataHdr), dataSocket_);
+    socketRead(&dataHdr, sizeof(dataHdr), socket);
 
     ASSERT(dataHdr.marker == StartMarker);
     ASSERT(dataHdr.version == CurrentVersion);
     ASSERT(dataHdr.message == Message::Startup);
     ASSERT(dataHdr.requestID == 0);
 
-    Buffer payload2 = receivePayload(dataHdr, dataSocket_);
-    socketRead(&tail, sizeof(tail), dataSocket_);
+    Buffer payload2 = receivePayload(dataHdr, socket);
+    eckit::FixedString<4> tail;
+    socketRead(&tail, sizeof(tail), socket);
     ASSERT(tail == EndMarker);
 
     MemoryStream s2(payload2);
-    SessionID clientSession2(s2);
-    SessionID serverSession(s2);
+    clientSession = SessionID(s2);
+    serverSession = SessionID(s2);
+}
+
+void RemoteHandler::attachDataConnection(net::TCPSocket& socket, const SessionID& clientSession2,
+                                         const SessionID& serverSession) {
+
+    ASSERT(clientSession_);
+    const SessionID& clientSession(*clientSession_);
 
     if (clientSession != clientSession2) {
         std::stringstream ss;
@@ -347,6 +424,8 @@ void RemoteHandler::initialiseConnections() {
         ss << "Session IDs do not match: " << serverSession << " != " << sessionID_;
         throw BadValue(ss.str(), Here());
     }
+
+    dataSocket_ = socket;
 }
 
 void RemoteHandler::handle() {
@@ -356,98 +435,112 @@ void RemoteHandler::handle() {
 
     Log::info() << "Server started ..." << std::endl;
 
+    while (handleMessage()) {
+    }
+}
+
+bool RemoteHandler::handleMessage() {
+
     MessageHeader hdr;
     eckit::FixedString<4> tail;
 
-    while (true) {
-        tidyWorkers();
+    tidyWorkers();
 
-        socketRead(&hdr, sizeof(hdr), controlSocket_);
+    socketRead(&hdr, sizeof(hdr), controlSocket_);
 
-        ASSERT(hdr.marker == StartMarker);
-        ASSERT(hdr.version == CurrentVersion);
-        Log::debug<LibFdb5>() << "Got message with request ID: " << hdr.requestID << std::endl;
+    ASSERT(hdr.marker == StartMarker);
+    ASSERT(hdr.version == CurrentVersion);
+    Log::debug<LibFdb5>() << "Got message with request ID: " << hdr.requestID << std::endl;
 
-        try {
-            switch (hdr.message) {
-                case Message::Exit:
-                    Log::status() << "Exiting" << std::endl;
-                    Log::info() << "Exiting" << std::endl;
-                    return;
-
-                case Message::List:
-                    forwardApiCall<ListHelper>(hdr);
-                    break;
-
-                case Message::Dump:
-                    forwardApiCall<DumpHelper>(hdr);
-                    break;
-
-                case Message::Purge:
-                    forwardApiCall<PurgeHelper>(hdr);
-                    break;
-
-                case Message::Stats:
-                    forwardApiCall<StatsHelper>(hdr);
-                    break;
-
-                case Message::Status:
-                    forwardApiCall<StatusHelper>(hdr);
-                    break;
-
-                case Message::Wipe:
-                    forwardApiCall<WipeHelper>(hdr);
-                    break;
-
-                case Message::Control:
-                    forwardApiCall<ControlHelper>(hdr);
-                    break;
-
-                case Message::Inspect:
-                    forwardApiCall<InspectHelper>(hdr);
-                    break;
-
-                case Message::Read:
-                    read(hdr);
-                    break;
-
-                case Message::Flush:
-                    flush(hdr);
-                    break;
-
-                case Message::Archive:
-                    archive(hdr);
-                    break;
-
-                default: {
-                    std::stringstream ss;
-                    ss << "ERROR: Unexpected message recieved (" << static_cast<int>(hdr.message)
-                       << "). ABORTING";
-                    Log::status() << ss.str() << std::endl;
-                    Log::error() << "Retrieving... " << ss.str() << std::endl;
-                    throw SeriousBug(ss.str(), Here());
-                }
-            }
+    try {
+        switch (hdr.message) {
+            case Message::Exit:
+                Log::status() << "Exiting" << std::endl;
+                Log::info() << "Exiting" << std::endl;
+                return false;
+
+            case Message::List:
+                forwardApiCall<ListHelper>(hdr);
+                break;
 
-            // Ensure we have consumed exactly the correct amount from the socket.
+            case Message::Dump:
+                forwardApiCall<DumpHelper>(hdr);
+                break;
 
-            socketRead(&tail, sizeof(tail), controlSocket_);
-            ASSERT(tail == EndMarker);
+            case Message::Purge:
+                forwardApiCall<PurgeHelper>(hdr);
+                break;
 
-            // Acknowledge receipt of command
+            case Message::Compact:
+                forwardApiCall<CompactHelper>(hdr);
+                break;
 
-            controlWrite(Message::Received, hdr.requestID);
-        }
-        catch (std::exception& e) {
-            // n.b. more general than eckit::Exception
-            std::string what(e.what());
-            controlWrite(Message::Error, hdr.requestID, what.c_str(), what.length());
-        }
-        catch (...) {
-            std::string what("Caught unexpected and unknown error");
-            controlWrite(Message::Error, hdr.requestID, what.c_str(), what.length());
+            case Message::Stats:
+                forwardApiCall<StatsHelper>(hdr);
+                break;
+
+            case Message::Status:
+                forwardApiCall<StatusHelper>(hdr);
+                break;
+
+            case Message::Wipe:
+                forwardApiCall<WipeHelper>(hdr);
+                break;
+
+            case Message::Control:
+                forwardApiCall<ControlHelper>(hdr);
+                break;
+
+            case Message::Inspect:
+                forwardApiCall<InspectHelper>(hdr);
+                break;
+
+            case Message::Read:
+                read(hdr);
+                break;
+
+            case Message::ReadMany:
+                readMany(hdr);
+                break;
+
+            case Message::Flush:
+                flush(hdr);
+                break;
+
+            case Message::Archive:
+                archive(hdr);
+                break;
+
+            default: {
+                std::stringstream ss;
+                ss << "ERROR: Unexpected message recieved (" << static_cast<int>(hdr.message)
+                   << "). ABORTING";
+                Log::status() << ss.str() << std::endl;
+                Log::error() << "Retrieving... " << ss.str() << std::endl;
+                throw SeriousBug(ss.str(), Here());
+            }
         }
+
+        // Ensure we have consumed exactly the correct amount from the socket.
+
+        socketRead(&tail, sizeof(tail), controlSocket_);
+        ASSERT(tail == EndMarker);
+
+        // Acknowledge receipt of command
+
+        controlWrite(Message::Received, hdr.requestID);
+    }
+    catch (std::exception& e) {
+        // n.b. more general than eckit::Exception
+        std::string what(e.what());
+        controlWrite(Message::Error, hdr.requestID, what.c_str(), what.length());
     }
+    catch (...) {
+        std::string what("Caught unexpected and unknown error");
+        controlWrite(Message::Error, hdr.requestID, what.c_str(), what.length());
+    }
+
+    return true;
 }
 
 int RemoteHandler::selectDataPort() {
@@ -497,24 +590,48 @@ void RemoteHandler::dataWrite(Message msg, uint32_t requestID, const void* paylo
                               uint32_t payloadLength) {
     ASSERT((payload == nullptr) == (payloadLength == 0));
 
+    std::vector<struct iovec> segments {ioBuffer(payload, payloadLength)};
+
+    // Compress outside of the lock, so that concurrent writers do not serialise on it
+
+    CompressedPayloadHeader payloadHeader;
+    ResizableBuffer compressed(0);
+    if (msg == Message::Blob && compression_.enabled()) {
+        compression_.encode(segments, payloadHeader, compressed);
+        payloadLength = 0;
+        for (const struct iovec& v : segments) {
+            payloadLength += v.iov_len;
+        }
+    }
+
     MessageHeader message(msg, requestID, payloadLength);
 
+    std::vector<struct iovec> iov;
+    iov.reserve(segments.size() + 2);
+    iov.push_back(ioBuffer(&message, sizeof(message)));
+    iov.insert(iov.end(), segments.begin(), segments.end());
+    iov.push_back(ioBuffer(&EndMarker, sizeof(EndMarker)));
+
     std::lock_guard<std::mutex> lock(dataWriteMutex_);
 
-    dataWriteUnsafe(&message, sizeof(message));
-    if (payload) {
-        dataWriteUnsafe(payload, payloadLength);
-    }
-    dataWriteUnsafe(&EndMarker, sizeof(EndMarker));
+    writeVectored(dataSocket_.socket(), iov);
 }
 
-void RemoteHandler::dataWriteUnsafe(const void* data, size_t length) {
-    size_t written = dataSocket_.write(data, length);
-    if (length != written) {
-        std::stringstream ss;
-        ss << "Write error. Expected " << length << " bytes, wrote " << written;
-        throw TCPException(ss.str(), Here());
-    }
+void RemoteHandler::dataWriteFile(Message msg, uint32_t requestID, int fd, off_t offset, uint32_t length) {
+
+    MessageHeader message(msg, requestID, length);
+
+    std::lock_guard<std::mutex> lock(dataWriteMutex_);
+
+    int socket = dataSocket_.socket();
+
+    std::vector<struct iovec> header {ioBuffer(&message, sizeof(message))};
+    writeVectored(socket, header);
+
+    sendFileRange(socket, fd, offset, length);
+
+    std::vector<struct iovec> tail {ioBuffer(&EndMarker, sizeof(EndMarker))};
+    writeVectored(socket, tail);
 }
 
 
@@ -544,7 +661,15 @@ void RemoteHandler::tidyWorkers() {
 }
 
 void RemoteHandler::waitForWorkers() {
-    readLocationQueue_.close();
+
+    // Complete all of the outstanding reads
+
+    if (readChannel_) {
+        readScheduler_->wait(readChannel_);
+    }
+    if (ownReadScheduler_) {
+        ownReadScheduler_->close();
+    }
 
     tidyWorkers();
 
@@ -554,10 +679,6 @@ void RemoteHandler::waitForWorkers() {
         it.second.get();
         Log::error() << "Thread complete" << std::endl;
     }
-
-    if (readLocationWorker_.joinable()) {
-        readLocationWorker_.join();
-    }
 }
 
 
@@ -620,7 +741,15 @@ void RemoteHandler::archive(const MessageHeader& hdr) {
 
 // A helper function to make archiveThreadLoop a bit cleaner
 
-static void archiveBlobPayload(FDB& fdb, const void* data, size_t length) {
+static void archiveBlobPayload(FDB& fdb, WireCompression& compression, const void* data, size_t length) {
+
+    Buffer uncompressed(0);
+    if (compression.enabled()) {
+        uncompressed = compression.decode(data, length);
+        data = uncompressed.data();
+        length = uncompressed.size();
+    }
+
     MemoryStream s(data, length);
 
     fdb5::Key key(s);
@@ -674,13 +803,13 @@ size_t RemoteHandler::archiveThreadLoop(uint32_t id) {
                         ASSERT(*e == EndMarker);
                         charData += sizeof(EndMarker);
 
-                        archiveBlobPayload(fdb_, payloadData, hdr->payloadSize);
+                        archiveBlobPayload(fdb_, compression_, payloadData, hdr->payloadSize);
                         totalArchived += 1;
                     }
                 }
                 else {
                     // Handle single blob
-                    archiveBlobPayload(fdb_, elem.first.data(), elem.first.size());
+                    archiveBlobPayload(fdb_, compression_, elem.first.data(), elem.first.size());
                     totalArchived += 1;
                 }
             }
@@ -789,75 +918,65 @@ void RemoteHandler::flush(const MessageHeader& hdr) {
     }
 }
 
-void RemoteHandler::read(const MessageHeader& hdr) {
+void RemoteHandler::enqueueRead(uint32_t requestID, std::vector<std::unique_ptr<FieldLocation>>&& locations) {
 
-    if (!readLocationWorker_.joinable()) {
-        readLocationWorker_ = std::thread([this] { readLocationThreadLoop(); });
+    if (!readScheduler_) {
+        ownReadScheduler_.reset(new ReadScheduler(config_));
+        readScheduler_ = ownReadScheduler_.get();
     }
 
-    Buffer payload(receivePayload(hdr, controlSocket_));
-    MemoryStream s(payload);
-
-    std::unique_ptr<FieldLocation> location(eckit::Reanimator<FieldLocation>::reanimate(s));
+    if (!readChannel_) {
+        // n.b. file data cannot be passed directly to the socket if it must be compressed
 
-    Log::debug<LibFdb5>() << "Queuing for read: " << hdr.requestID << " " << *location << std::endl;
+        ReadScheduler::FileSender fileSender;
+        if (!compression_.enabled()) {
+            fileSender = [this](Message msg, uint32_t requestID, int fd, off_t offset, uint32_t length) {
+                dataWriteFile(msg, requestID, fd, offset, length);
+            };
+        }
 
-    std::unique_ptr<eckit::DataHandle> dh;
-    dh.reset(location->dataHandle());
+        readChannel_ = readScheduler_->channel(
+            [this](Message msg, uint32_t requestID, const void* payload, uint32_t payloadLength) {
+                dataWrite(msg, requestID, payload, payloadLength);
+            },
+            fileSender);
+    }
 
-    readLocationQueue_.emplace(std::make_pair(hdr.requestID, std::move(dh)));
+    readScheduler_->enqueue(readChannel_, requestID, std::move(locations));
 }
 
-void RemoteHandler::writeToParent(const uint32_t requestID, std::unique_ptr<eckit::DataHandle> dh) {
-    try {
-        Log::status() << "Reading: " << requestID << std::endl;
-        // Write the data to the parent, in chunks if necessary.
-
-        Buffer writeBuffer(10 * 1024 * 1024);
-        long dataRead;
+void RemoteHandler::read(const MessageHeader& hdr) {
 
-        dh->openForRead();
-        Log::debug<LibFdb5>() << "Reading: " << requestID << " dh size: " << dh->size()
-                              << std::endl;
+    Buffer payload(receivePayload(hdr, controlSocket_));
+    MemoryStream s(payload);
 
-        while ((dataRead = dh->read(writeBuffer, writeBuffer.size())) != 0) {
-            dataWrite(Message::Blob, requestID, writeBuffer, dataRead);
-        }
+    std::vector<std::unique_ptr<FieldLocation>> locations;
+    locations.emplace_back(eckit::Reanimator<FieldLocation>::reanimate(s));
 
-        // And when we are done, add a complete message.
+    Log::debug<LibFdb5>() << "Queuing for read: " << hdr.requestID << " " << *locations.back() << std::endl;
 
-        Log::debug<LibFdb5>() << "Writing retrieve complete message: " << requestID
-                              << std::endl;
+    enqueueRead(hdr.requestID, std::move(locations));
+}
 
-        dataWrite(Message::Complete, requestID);
+void RemoteHandler::readMany(const MessageHeader& hdr) {
 
-        Log::status() << "Done retrieve: " << requestID << std::endl;
-        Log::debug<LibFdb5>() << "Done retrieve: " << requestID << std::endl;
-    }
-    catch (std::exception& e) {
-        // n.b. more general than eckit::Exception
-        std::string what(e.what());
-        dataWrite(Message::Error, requestID, what.c_str(), what.length());
-    }
-    catch (...) {
-        // We really don't want to std::terminate the thread
-        std::string what("Caught unexpected, unknown exception in retrieve worker");
-        dataWrite(Message::Error, requestID, what.c_str(), what.length());
-    }
-}
+    Buffer payload(receivePayload(hdr, controlSocket_));
+    MemoryStream s(payload);
 
-void RemoteHandler::readLocationThreadLoop() {
-    std::pair<uint32_t, std::unique_ptr<eckit::DataHandle>> elem;
+    size_t count;
+    s >> count;
 
-    while (readLocationQueue_.pop(elem) != -1) {
-        // Get the next MarsRequest in sequence to work on, do the retrieve, and
-        // send the data back to the client.
+    Log::debug<LibFdb5>() << "Queuing for read: " << hdr.requestID << " (" << count << " locations)" << std::endl;
 
-        const uint32_t requestID(elem.first);
+    // The data is streamed back as one sequence of blobs, in the order requested
 
-        // Forward the API call
-        writeToParent(elem.first, std::move(elem.second));
+    std::vector<std::unique_ptr<FieldLocation>> locations;
+    locations.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        locations.emplace_back(eckit::Reanimator<FieldLocation>::reanimate(s));
     }
+
+    enqueueRead(hdr.requestID, std::move(locations));
 }
 
 
@@ -35,6 +35,8 @@
 #include "fdb5/config/Config.h"
 #include "fdb5/database/Key.h"
 #include "fdb5/remote/Messages.h"
+#include "fdb5/remote/ReadScheduler.h"
+#include "fdb5/remote/WireCompression.h"
 
 namespace fdb5 {
 
@@ -49,6 +51,11 @@ struct MessageHeader;
 class RemoteHandler : private eckit::NonCopyable {
 public:  // methods
     RemoteHandler(eckit::net::TCPSocket& socket, const Config& config);
+
+    /// For a server that handles many sessions together. The data connection is accepted by the server,
+    /// on a port shared between the sessions, and reads are served by a shared scheduler.
+    RemoteHandler(eckit::net::TCPSocket& socket, const Config& config, ReadScheduler& readScheduler);
+
     ~RemoteHandler();
 
     void handle();
@@ -57,6 +64,26 @@ public:  // methods
     int port() const { return controlSocket_.localPort(); }
     const eckit::LocalConfiguration& agreedConf() const { return agreedConf_; }
 
+    // Stepwise handling of a session, for use by a server that handles many sessions together
+
+    const eckit::SessionID& sessionID() const { return sessionID_; }
+    int controlSocket() const { return controlSocket_.socket(); }
+
+    /// Negotiate with the client, and direct it to connect to the given data port
+    /// @returns false if negotiation failed
+    bool startSession(int dataport);
+
+    /// Read the startup message of a new data connection, to identify the session it belongs to
+    static void readDataStartup(eckit::net::TCPSocket& socket, eckit::SessionID& clientSession,
+                                eckit::SessionID& serverSession);
+
+    void attachDataConnection(eckit::net::TCPSocket& socket, const eckit::SessionID& clientSession,
+                              const eckit::SessionID& serverSession);
+
+    /// Read and handle one message from the control connection
+    /// @returns false once the client has finished with the session
+    bool handleMessage();
+
 private:  // methods
     // Socket methods
 
@@ -67,14 +94,14 @@ private:  // methods
     void controlWrite(Message msg, uint32_t requestID, const void* payload = nullptr,
                       uint32_t payloadLength = 0);
     void controlWrite(const void* data, size_t length);
-    void socketRead(void* data, size_t length, eckit::net::TCPSocket& socket);
+    static void socketRead(void* data, size_t length, eckit::net::TCPSocket& socket);
 
     // dataWrite is protected using a mutex, as we may have multiple workers.
     void dataWrite(Message msg, uint32_t requestID, const void* payload = nullptr,
                    uint32_t payloadLength = 0);
-    void dataWriteUnsafe(const void* data, size_t length);
+    void dataWriteFile(Message msg, uint32_t requestID, int fd, off_t offset, uint32_t length);
 
-    eckit::Buffer receivePayload(const MessageHeader& hdr, eckit::net::TCPSocket& socket);
+    static eckit::Buffer receivePayload(const MessageHeader& hdr, eckit::net::TCPSocket& socket);
 
     // Worker functionality
 
@@ -93,22 +120,24 @@ private:  // methods
     void archive(const MessageHeader& hdr);
     void retrieve(const MessageHeader& hdr);
     void read(const MessageHeader& hdr);
-
-    void writeToParent(const uint32_t requestID, std::unique_ptr<eckit::DataHandle> dh);
+    void readMany(const MessageHeader& hdr);
 
     size_t archiveThreadLoop(uint32_t id);
-    void readLocationThreadLoop();
+    void enqueueRead(uint32_t requestID, std::vector<std::unique_ptr<FieldLocation>>&& locations);
 
 private:  // members
     Config config_;
     eckit::SessionID sessionID_;
+    std::unique_ptr<eckit::SessionID> clientSession_;
 
     eckit::LocalConfiguration agreedConf_;
 
     eckit::net::TCPSocket controlSocket_;
-    eckit::net::EphemeralTCPServer dataSocket_;
+    std::unique_ptr<eckit::net::EphemeralTCPServer> dataListener_;  ///< Only if the data port is not shared
+    eckit::net::TCPSocket dataSocket_;
     std::string dataListenHostname_;
     std::mutex dataWriteMutex_;
+    WireCompression compression_;
 
     // API helpers
 
@@ -121,8 +150,9 @@ private:  // members
 
     // Retrieve helpers
 
-    std::thread readLocationWorker_;
-    eckit::Queue<std::pair<uint32_t, std::unique_ptr<eckit::DataHandle>>> readLocationQueue_;
+    std::unique_ptr<ReadScheduler> ownReadScheduler_;
+    ReadScheduler* readScheduler_;
+    ReadScheduler::ChannelPtr readChannel_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -37,7 +37,7 @@ namespace remote {
 const static eckit::FixedString<4> StartMarker {"SFDB"};
 const static eckit::FixedString<4> EndMarker {"EFDB"};
 
-constexpr uint16_t CurrentVersion = 9;
+constexpr uint16_t CurrentVersion = 10;
 
 
 enum class Message : uint16_t {
@@ -62,6 +62,8 @@ enum class Message : uint16_t {
     Inspect,
     Read,
     Move,
+    ReadMany,
+    Compact,
 
     // Responses
     Received = 200,
@@ -0,0 +1,619 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/FieldLocation.h"
+#include "fdb5/remote/ReadScheduler.h"
+
+namespace fdb5 {
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+ReadBufferPool::ReadBufferPool(size_t maxRetained) :
+    retained_(0),
+    maxRetained_(maxRetained) {}
+
+ReadBufferPool::BufferPtr ReadBufferPool::acquire(size_t size) {
+
+    std::unique_ptr<eckit::Buffer> buffer;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // Don't tie up a much larger buffer for a small read
+
+        auto it = free_.lower_bound(size);
+        if (it != free_.end() && it->first <= 2 * size) {
+            buffer = std::move(it->second);
+            retained_ -= it->first;
+            free_.erase(it);
+        }
+    }
+
+    if (!buffer) {
+        size_t capacity = 64 * 1024;
+        while (capacity < size) {
+            capacity *= 2;
+        }
+        buffer.reset(new eckit::Buffer(capacity));
+    }
+
+    return BufferPtr(buffer.release(), [this](eckit::Buffer* b) { release(b); });
+}
+
+void ReadBufferPool::release(eckit::Buffer* buffer) {
+
+    std::unique_ptr<eckit::Buffer> b(buffer);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (retained_ + b->size() <= maxRetained_) {
+        retained_ += b->size();
+        free_.emplace(b->size(), std::move(b));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+class ReadOnlyFile : private eckit::NonCopyable {
+public:
+    ReadOnlyFile(const std::string& path) : path_(path) {
+        SYSCALL2(fd_ = ::open(path.c_str(), O_RDONLY), path);
+    }
+    ~ReadOnlyFile() { ::close(fd_); }
+
+    int fd() const { return fd_; }
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+    int fd_;
+};
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+struct ReadScheduler::Channel {
+
+    Channel(const Sender& sender, const FileSender& fileSender, bool sendfile) :
+        sender_(sender),
+        fileSender_(fileSender),
+        sendfile_(sendfile && fileSender),
+        sending_(false),
+        failed_(false),
+        outstanding_(0) {}
+
+    Sender sender_;
+    FileSender fileSender_;
+    bool sendfile_;
+
+    bool sending_;        ///< A request is being sent. Protected by the scheduler mutex
+    bool failed_;         ///< Only accessed by the thread sending
+    size_t outstanding_;  ///< Requests queued, and not yet sent. Protected by the scheduler mutex
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A single read. Either a (coalesced) range of a data file, containing one or more of the requested fields,
+/// or one field read through the DataHandle of its location.
+
+struct ReadScheduler::Task {
+
+    struct Member {
+        std::shared_ptr<Request> request_;
+        size_t index_;
+        size_t offset_;  ///< Offset of the field within the range
+        size_t length_;
+    };
+
+    Task() : offset_(0), length_(0), generic_(false) {}
+
+    eckit::PathName path_;
+    off_t offset_;
+    size_t length_;
+
+    bool generic_;
+
+    std::vector<Member> members_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// n.b. by default the retrieve queue is big -- we are only queueing the requests, and it
+// is a common idiom to queue _many_ requests behind each other (and then aggregate the
+// results in a MultiHandle/HandleGatherer).
+
+ReadScheduler::ReadScheduler(const Config& config) :
+    queueLength_(eckit::Resource<size_t>("fdbRetrieveQueueSize", 10000)),
+    readAheadBytes_(eckit::Resource<size_t>("fdbServerReadAhead;$FDB_SERVER_READ_AHEAD", 256 * 1024 * 1024)),
+    coalesceBytes_(eckit::Resource<size_t>("fdbServerReadCoalesce;$FDB_SERVER_READ_COALESCE", 64 * 1024 * 1024)),
+    chunkSize_(10 * 1024 * 1024),
+    sendfile_(eckit::Resource<bool>("fdbServerSendfile;$FDB_SERVER_SENDFILE", true)),
+    pool_(eckit::Resource<size_t>("fdbServerReadBufferPool;$FDB_SERVER_READ_BUFFER_POOL", 128 * 1024 * 1024)),
+    closing_(false),
+    dispatched_(false),
+    inflightBytes_(0),
+    tasks_(1024) {
+
+    static long fdbServerReadThreads = eckit::Resource<long>("fdbServerReadThreads;$FDB_SERVER_READ_THREADS", 4);
+    long threads = config.getLong("serverReadThreads", fdbServerReadThreads);
+    ASSERT(threads > 0);
+
+    // With many channels, more than one thread is needed so that a slow client does not hold up the others
+
+    static long fdbServerSendThreads = eckit::Resource<long>("fdbServerSendThreads;$FDB_SERVER_SEND_THREADS", 1);
+    long senders = config.getLong("serverSendThreads", fdbServerSendThreads);
+    ASSERT(senders > 0);
+
+    dispatcher_ = std::thread([this] { dispatchLoop(); });
+    for (long i = 0; i < senders; ++i) {
+        senderThreads_.emplace_back([this] { sendLoop(); });
+    }
+    for (long i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ReadScheduler::~ReadScheduler() {
+    close();
+}
+
+ReadScheduler::ChannelPtr ReadScheduler::channel(const Sender& sender, const FileSender& fileSender) {
+    return std::make_shared<Channel>(sender, fileSender, sendfile_);
+}
+
+void ReadScheduler::enqueue(const ChannelPtr& channel, uint32_t requestID,
+                            std::vector<std::unique_ptr<FieldLocation>>&& locations) {
+
+    ASSERT(channel);
+
+    std::shared_ptr<Request> request(new Request);
+    request->channel_ = channel;
+    request->id_ = requestID;
+    request->locations_ = std::move(locations);
+    request->parts_.resize(request->locations_.size());
+    request->ready_.resize(request->locations_.size(), false);
+    request->scheduled_ = 0;
+    request->sent_ = 0;
+    request->held_ = 0;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return pending_.size() < queueLength_; });
+    ASSERT(!closing_);
+    pending_.push_back(request);
+    ++channel->outstanding_;
+    cv_.notify_all();
+}
+
+void ReadScheduler::wait(const ChannelPtr& channel) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&channel] { return channel->outstanding_ == 0; });
+}
+
+void ReadScheduler::close() {
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    cv_.notify_all();
+
+    if (dispatcher_.joinable()) dispatcher_.join();
+    for (std::thread& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    for (std::thread& sender : senderThreads_) {
+        if (sender.joinable()) sender.join();
+    }
+}
+
+void ReadScheduler::dispatchLoop() {
+
+    while (true) {
+
+        // Take as many of the queued fields as the read-ahead allows, so that fields can be coalesced
+        // across requests. Fields are taken in the order they are sent, so that the fields the senders are
+        // waiting for are always scheduled, and at most one field goes beyond the read-ahead limit.
+
+        std::vector<Slice> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] {
+                return (!pending_.empty() && inflightBytes_ < readAheadBytes_) || (closing_ && pending_.empty());
+            });
+
+            if (pending_.empty()) break;
+
+            while (!pending_.empty() && inflightBytes_ < readAheadBytes_) {
+
+                std::shared_ptr<Request> request = pending_.front();
+                if (request->scheduled_ == 0) {
+                    inflight_.push_back(request);
+                }
+
+                // Once a request has failed, there is no point reading any more of it
+
+                Slice slice{request, request->scheduled_, request->scheduled_};
+                while (slice.end_ < request->locations_.size() && inflightBytes_ < readAheadBytes_ &&
+                       request->error_.empty()) {
+                    size_t length = request->locations_[slice.end_]->length();
+                    request->held_ += length;
+                    inflightBytes_ += length;
+                    ++slice.end_;
+                }
+                request->scheduled_ = slice.end_;
+
+                if (slice.end_ > slice.begin_) {
+                    batch.push_back(slice);
+                }
+                if (request->scheduled_ == request->locations_.size() || !request->error_.empty()) {
+                    pending_.pop_front();
+                }
+            }
+        }
+        cv_.notify_all();
+
+        schedule(batch);
+    }
+
+    tasks_.close();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        dispatched_ = true;
+    }
+    cv_.notify_all();
+}
+
+void ReadScheduler::schedule(const std::vector<Slice>& slices) {
+
+    struct Range {
+        std::shared_ptr<Request> request_;
+        size_t index_;
+        std::string path_;
+        off_t offset_;
+        size_t length_;
+    };
+
+    std::vector<std::shared_ptr<Task>> tasks;
+
+    try {
+        std::vector<Range> ranges;
+
+        for (const Slice& slice : slices) {
+            const std::shared_ptr<Request>& request(slice.request_);
+            for (size_t i = slice.begin_; i < slice.end_; ++i) {
+                const FieldLocation& location(*request->locations_[i]);
+
+                // Only plain byte ranges of files can be coalesced
+
+                if (location.uri().scheme() == "file" && location.remapKey().empty() && location.length() > 0) {
+                    ranges.push_back(Range{request, i, location.uri().path().asString(), location.offset(), size_t(location.length())});
+                } else {
+                    std::shared_ptr<Task> task(new Task);
+                    task->generic_ = true;
+                    task->members_.push_back(Task::Member{request, i, 0, 0});
+                    tasks.push_back(task);
+                }
+            }
+        }
+
+        std::stable_sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) {
+            return (a.path_ < b.path_) || (a.path_ == b.path_ && a.offset_ < b.offset_);
+        });
+
+        std::shared_ptr<Task> task;
+        std::string path;
+        for (Range& range : ranges) {
+
+            off_t end = range.offset_ + range.length_;
+
+            if (task && range.path_ == path && range.offset_ <= off_t(task->offset_ + task->length_) &&
+                size_t(end - task->offset_) <= coalesceBytes_) {
+                task->length_ = std::max(task->length_, size_t(end - task->offset_));
+            } else {
+                task.reset(new Task);
+                task->path_ = range.path_;
+                task->offset_ = range.offset_;
+                task->length_ = range.length_;
+                tasks.push_back(task);
+                path = range.path_;
+            }
+
+            task->members_.push_back(Task::Member{range.request_, range.index_, size_t(range.offset_ - task->offset_), range.length_});
+        }
+
+    } catch (std::exception& e) {
+
+        // Don't leave the sender waiting for these requests
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const Slice& slice : slices) {
+            if (slice.request_->error_.empty()) {
+                slice.request_->error_ = e.what();
+            }
+        }
+        cv_.notify_all();
+        return;
+    }
+
+    eckit::Log::debug<LibFdb5>() << "ReadScheduler: " << slices.size() << " request ranges scheduled as "
+                                 << tasks.size() << " reads" << std::endl;
+
+    for (std::shared_ptr<Task>& task : tasks) {
+        tasks_.emplace(std::move(task));
+    }
+}
+
+void ReadScheduler::workerLoop() {
+    std::shared_ptr<Task> task;
+    while (tasks_.pop(task) != -1) {
+        execute(*task);
+        task.reset();
+    }
+}
+
+void ReadScheduler::execute(Task& task) {
+
+    std::string error;
+
+    try {
+        if (task.generic_) {
+
+            ASSERT(task.members_.size() == 1);
+            Task::Member& member(task.members_[0]);
+
+            std::unique_ptr<eckit::DataHandle> dh(member.request_->locations_[member.index_]->dataHandle());
+            dh->openForRead();
+            eckit::AutoClose closer(*dh);
+
+            std::vector<Part> parts;
+            long len;
+            do {
+                ReadBufferPool::BufferPtr buffer = pool_.acquire(chunkSize_);
+                len = dh->read(buffer->data(), chunkSize_);
+                if (len > 0) {
+                    parts.push_back(Part{buffer, 0, size_t(len)});
+                }
+            } while (len > 0);
+
+            member.request_->parts_[member.index_] = std::move(parts);
+
+        } else if (std::all_of(task.members_.begin(), task.members_.end(),
+                               [](const Task::Member& m) { return m.request_->channel_->sendfile_; })) {
+
+            // The data is sent straight from the file by the sender. Load it into the page cache, so that the
+            // reads of the data files still proceed in parallel.
+
+            ReadOnlyFile file(task.path_.asString());
+#if defined(__linux__)
+            ::readahead(file.fd(), task.offset_, task.length_);
+#elif defined(POSIX_FADV_WILLNEED)
+            ::posix_fadvise(file.fd(), task.offset_, task.length_, POSIX_FADV_WILLNEED);
+#endif
+
+            for (Task::Member& member : task.members_) {
+                member.request_->parts_[member.index_].push_back(
+                    Part{nullptr, task.offset_ + member.offset_, member.length_, task.path_.asString()});
+            }
+
+        } else {
+
+            ReadBufferPool::BufferPtr buffer = pool_.acquire(task.length_);
+
+            std::unique_ptr<eckit::DataHandle> dh(task.path_.partHandle(task.offset_, task.length_));
+            dh->openForRead();
+            eckit::AutoClose closer(*dh);
+
+            char* data = static_cast<char*>(buffer->data());
+            size_t done = 0;
+            while (done < task.length_) {
+                long len = dh->read(data + done, task.length_ - done);
+                if (len <= 0) {
+                    std::ostringstream ss;
+                    ss << "Unexpected end of file reading " << task.path_ << " at offset " << (task.offset_ + done);
+                    throw eckit::ReadError(ss.str(), Here());
+                }
+                done += len;
+            }
+
+            for (Task::Member& member : task.members_) {
+                member.request_->parts_[member.index_].push_back(Part{buffer, member.offset_, member.length_});
+            }
+        }
+    }
+    catch (std::exception& e) {
+        // n.b. more general than eckit::Exception
+        error = e.what();
+    }
+    catch (...) {
+        // We really don't want to std::terminate the thread
+        error = "Caught unexpected, unknown exception in read worker";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (Task::Member& member : task.members_) {
+            if (error.empty()) {
+                member.request_->ready_[member.index_] = true;
+            } else if (member.request_->error_.empty()) {
+                member.request_->error_ = error;
+            }
+        }
+    }
+    cv_.notify_all();
+}
+
+std::shared_ptr<ReadScheduler::Request> ReadScheduler::nextToSend() {
+
+    // n.b. called with mutex_ held. Only the oldest request of each channel may be sent, and it may be sent
+    //      once the next of its locations has been read, once it has failed, or once it is complete.
+
+    std::set<const Channel*> seen;
+
+    for (const std::shared_ptr<Request>& request : inflight_) {
+        const Channel* channel = request->channel_.get();
+        if (!seen.insert(channel).second) continue;
+        if (channel->sending_) continue;
+        if (!request->error_.empty() || request->sent_ == request->locations_.size() ||
+            (request->sent_ < request->scheduled_ && request->ready_[request->sent_])) {
+            return request;
+        }
+    }
+
+    return nullptr;
+}
+
+void ReadScheduler::sendLoop() {
+
+    while (true) {
+
+        std::shared_ptr<Request> request;
+        std::string error;
+        size_t begin;
+        size_t end;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this, &request] {
+                request = nextToSend();
+                return request || (dispatched_ && inflight_.empty());
+            });
+
+            if (!request) break;
+
+            // Send all of the locations that are ready, in order
+
+            error = request->error_;
+            begin = end = request->sent_;
+            if (error.empty()) {
+                while (end < request->scheduled_ && request->ready_[end]) {
+                    ++end;
+                }
+            }
+
+            request->channel_->sending_ = true;
+        }
+
+        Channel& channel(*request->channel_);
+        bool complete = !error.empty() || end == request->locations_.size();
+
+        // If the connection has failed, continue to drain the requests so that nothing is left waiting
+
+        if (!channel.failed_) {
+            try {
+                if (!error.empty()) {
+                    channel.sender_(Message::Error, request->id_, error.c_str(), error.length());
+                } else if (!send(*request, begin, end, error)) {
+
+                    // The data could not be read. Only this request fails, not the connection.
+
+                    channel.sender_(Message::Error, request->id_, error.c_str(), error.length());
+                    complete = true;
+                } else if (complete) {
+                    channel.sender_(Message::Complete, request->id_, nullptr, 0);
+                    eckit::Log::debug<LibFdb5>() << "Done retrieve: " << request->id_ << std::endl;
+                }
+            } catch (std::exception& e) {
+                eckit::Log::error() << "Error sending data for request " << request->id_ << ": " << e.what() << std::endl;
+                channel.failed_ = true;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            for (size_t i = begin; i < end; ++i) {
+                size_t length = request->locations_[i]->length();
+                request->held_ -= length;
+                inflightBytes_ -= length;
+            }
+            request->sent_ = end;
+
+            if (!error.empty() && request->error_.empty()) {
+                request->error_ = error;
+            }
+
+            if (complete) {
+                inflightBytes_ -= request->held_;
+                request->held_ = 0;
+                inflight_.erase(std::find(inflight_.begin(), inflight_.end(), request));
+                --channel.outstanding_;
+            }
+
+            channel.sending_ = false;
+        }
+        cv_.notify_all();
+    }
+}
+
+bool ReadScheduler::send(Request& request, size_t begin, size_t end, std::string& error) {
+
+    // n.b. the parts of locations that have been read are no longer touched by the workers
+
+    const Sender& sender(request.channel_->sender_);
+
+    if (begin == 0) {
+        eckit::Log::status() << "Reading: " << request.id_ << std::endl;
+    }
+
+    std::unique_ptr<ReadOnlyFile> file;
+
+    for (size_t i = begin; i < end; ++i) {
+        for (Part& part : request.parts_[i]) {
+            if (!part.buffer_) {
+                if (!file || file->path() != part.path_) {
+                    try {
+                        file.reset(new ReadOnlyFile(part.path_));
+                    } catch (std::exception& e) {
+                        error = e.what();
+                        return false;
+                    }
+                }
+                for (size_t pos = 0; pos < part.length_; pos += chunkSize_) {
+                    request.channel_->fileSender_(Message::Blob, request.id_, file->fd(), part.offset_ + pos, std::min(chunkSize_, part.length_ - pos));
+                }
+                continue;
+            }
+
+            const char* data = static_cast<const char*>(part.buffer_->data()) + part.offset_;
+            for (size_t pos = 0; pos < part.length_; pos += chunkSize_) {
+                sender(Message::Blob, request.id_, data + pos, std::min(chunkSize_, part.length_ - pos));
+            }
+        }
+
+        // Release the buffers as soon as they have been sent
+
+        request.parts_[i].clear();
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
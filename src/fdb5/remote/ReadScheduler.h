@@ -0,0 +1,198 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   ReadScheduler.h
+/// @date   Oct 2026
+
+#ifndef fdb5_remote_ReadScheduler_H
+#define fdb5_remote_ReadScheduler_H
+
+#include <sys/types.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/container/Queue.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/memory/NonCopyable.h"
+
+#include "fdb5/remote/Messages.h"
+
+namespace fdb5 {
+
+class Config;
+class FieldLocation;
+
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A pool of reusable read buffers. Released buffers are retained for reuse, up to a limit on the total
+/// memory retained.
+
+class ReadBufferPool : private eckit::NonCopyable {
+
+public: // types
+
+    using BufferPtr = std::shared_ptr<eckit::Buffer>;
+
+public: // methods
+
+    ReadBufferPool(size_t maxRetained);
+
+    /// @returns a buffer of at least the requested size, that is returned to the pool once released.
+    /// @note The pool must outlive the buffers obtained from it.
+    BufferPtr acquire(size_t size);
+
+private: // methods
+
+    void release(eckit::Buffer* buffer);
+
+private: // members
+
+    std::mutex mutex_;
+    std::multimap<size_t, std::unique_ptr<eckit::Buffer>> free_;
+
+    size_t retained_;
+    size_t maxRetained_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Serves read requests using a pool of worker threads. Each client is served through a channel, and one
+/// scheduler may be shared between many clients.
+///
+/// Queued fields are gathered together, and their ranges are sorted and coalesced, so that adjacent fields
+/// in the same data file (possibly across requests) are read with a single read. The data of each request
+/// is sent back as Blob messages followed by a Complete message (or an Error message), strictly in the order
+/// the requests were queued on the channel, as the client expects. Different channels are sent independently
+/// of each other.
+///
+/// Each field is sent as soon as it, and the fields before it in the request, have been read. Fields are
+/// scheduled in the order they are sent, and only as far ahead of the sender as the read-ahead allows, so
+/// the data held in memory is bounded even for requests for very many fields.
+
+class ReadScheduler : private eckit::NonCopyable {
+
+public: // types
+
+    using Sender = std::function<void(Message, uint32_t, const void*, uint32_t)>;
+
+    /// Sends a message whose payload is a range of an open file. May be empty, in which case file data is
+    /// always read into memory and passed to the Sender.
+    using FileSender = std::function<void(Message, uint32_t, int, off_t, uint32_t)>;
+
+    struct Channel;
+    using ChannelPtr = std::shared_ptr<Channel>;
+
+public: // methods
+
+    ReadScheduler(const Config& config);
+    ~ReadScheduler();
+
+    /// @returns a new channel, through which the data of the requests queued on it is sent
+    ChannelPtr channel(const Sender& sender, const FileSender& fileSender);
+
+    /// Queue a request to read the given locations. Blocks if too many requests are already queued.
+    void enqueue(const ChannelPtr& channel, uint32_t requestID, std::vector<std::unique_ptr<FieldLocation>>&& locations);
+
+    /// Wait until all of the requests queued on the channel have been sent
+    void wait(const ChannelPtr& channel);
+
+    /// Complete all of the queued requests, and stop the threads
+    void close();
+
+private: // types
+
+    /// Data read into a buffer, or (if there is no buffer) a range of a file to be sent directly
+    struct Part {
+        ReadBufferPool::BufferPtr buffer_;
+        size_t offset_;
+        size_t length_;
+        std::string path_;
+    };
+
+    /// n.b. apart from the parts read, the state of a request is protected by the scheduler mutex
+    struct Request {
+        ChannelPtr channel_;
+        uint32_t id_;
+        std::vector<std::unique_ptr<FieldLocation>> locations_;
+        std::vector<std::vector<Part>> parts_; ///< The data read, per location
+        std::vector<bool> ready_;              ///< The parts of the location have been read
+        size_t scheduled_;                     ///< Number of locations scheduled to be read
+        size_t sent_;                          ///< Number of locations sent
+        size_t held_;                          ///< Bytes scheduled and not yet sent
+        std::string error_;
+    };
+
+    /// A range of the locations of a request, to be scheduled together
+    struct Slice {
+        std::shared_ptr<Request> request_;
+        size_t begin_;
+        size_t end_;
+    };
+
+    struct Task;
+
+private: // methods
+
+    void dispatchLoop();
+    void workerLoop();
+    void sendLoop();
+
+    std::shared_ptr<Request> nextToSend();
+
+    void schedule(const std::vector<Slice>& slices);
+    void execute(Task& task);
+    /// Send the data of a range of locations that have been read.
+    /// @returns false (and the error) if the data could not be read. Errors sending the data are thrown.
+    bool send(Request& request, size_t begin, size_t end, std::string& error);
+
+private: // members
+
+    size_t queueLength_;
+    size_t readAheadBytes_;
+    size_t coalesceBytes_;
+    size_t chunkSize_;
+    bool sendfile_;
+
+    ReadBufferPool pool_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+
+    bool closing_;
+    bool dispatched_;                                 ///< The dispatcher has finished
+
+    std::deque<std::shared_ptr<Request>> pending_;    ///< Queued, and not yet completely scheduled
+    std::deque<std::shared_ptr<Request>> inflight_;   ///< (Partially) scheduled, in the order to be sent
+    size_t inflightBytes_;                            ///< Bytes scheduled and not yet sent, over all requests
+
+    eckit::Queue<std::shared_ptr<Task>> tasks_;
+
+    std::thread dispatcher_;
+    std::vector<std::thread> senderThreads_;
+    std::vector<std::thread> workers_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
+
+#endif  // fdb5_remote_ReadScheduler_H
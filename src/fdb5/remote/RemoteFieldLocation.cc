@@ -37,14 +37,17 @@ RemoteFieldLocation::RemoteFieldLocation(RemoteFDB* remoteFDB, const FieldLocati
 
 RemoteFieldLocation::RemoteFieldLocation(const eckit::URI& uri) :
     FieldLocation(eckit::URI("fdb://" + uri.hostport())),
+    remoteFDB_(nullptr),
     internal_(std::shared_ptr<FieldLocation>(FieldLocationFactory::instance().build(uri.scheme(), uri))) {}
 
 RemoteFieldLocation::RemoteFieldLocation(const eckit::URI& uri, const eckit::Offset& offset, const eckit::Length& length, const Key& remapKey) :
     FieldLocation(eckit::URI("fdb://" + uri.hostport())),
+    remoteFDB_(nullptr),
     internal_(std::shared_ptr<FieldLocation>(FieldLocationFactory::instance().build(uri.scheme(), uri, offset, length, remapKey))) {}
 
 RemoteFieldLocation::RemoteFieldLocation(eckit::Stream& s) :
     FieldLocation(s),
+    remoteFDB_(nullptr),
     internal_(std::shared_ptr<FieldLocation>(eckit::Reanimator<FieldLocation>::reanimate(s))) {}
 
 RemoteFieldLocation::RemoteFieldLocation(const RemoteFieldLocation& rhs) :
@@ -62,6 +65,27 @@ eckit::DataHandle* RemoteFieldLocation::dataHandle() const {
     return remoteFDB_->dataHandle(*internal_);
 }
 
+std::string RemoteFieldLocation::batchKey() const {
+    // All the fields served by the same server can be requested together
+    return remoteFDB_ ? uri_.asString() : std::string();
+}
+
+eckit::DataHandle* RemoteFieldLocation::readMany(const std::vector<std::shared_ptr<const FieldLocation>>& locations) const {
+    ASSERT(remoteFDB_);
+
+    std::vector<std::shared_ptr<const FieldLocation>> internals;
+    internals.reserve(locations.size());
+
+    for (const auto& location : locations) {
+        const RemoteFieldLocation* remote = dynamic_cast<const RemoteFieldLocation*>(location.get());
+        ASSERT(remote);
+        ASSERT(remote->uri_ == uri_);
+        internals.push_back(remote->internal_);
+    }
+
+    return remoteFDB_->dataHandle(internals);
+}
+
 void RemoteFieldLocation::visit(FieldLocationVisitor& visitor) const {
     visitor(*this);
 }
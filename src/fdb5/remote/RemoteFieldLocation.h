@@ -43,6 +43,9 @@ public:
 
     virtual eckit::DataHandle *dataHandle() const override;
 
+    virtual std::string batchKey() const override;
+    virtual eckit::DataHandle* readMany(const std::vector<std::shared_ptr<const FieldLocation>>& locations) const override;
+
     virtual std::shared_ptr<FieldLocation> make_shared() const override;
     virtual void visit(FieldLocationVisitor& visitor) const override;
 
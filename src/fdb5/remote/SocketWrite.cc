@@ -0,0 +1,134 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <sstream>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+
+#include "fdb5/remote/SocketWrite.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace fdb5 {
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static void throwFailed(const char* call, int err) {
+    std::ostringstream ss;
+    ss << call << ": " << ::strerror(err);
+    throw eckit::FailedSystemCall(ss.str());
+}
+
+static void writeFully(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = ::send(fd, data, length, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throwFailed("send", errno);
+        }
+        data += n;
+        length -= n;
+    }
+}
+
+void writeVectored(int fd, std::vector<struct iovec>& iov) {
+
+    size_t i = 0;
+
+    while (i < iov.size()) {
+
+        if (iov[i].iov_len == 0) {
+            ++i;
+            continue;
+        }
+
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov[i];
+        msg.msg_iovlen = std::min(iov.size() - i, size_t(IOV_MAX));
+
+        ssize_t written = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throwFailed("sendmsg", errno);
+        }
+
+        // Skip past what has been written, which may end part way through a buffer
+
+        size_t remaining = written;
+        while (i < iov.size() && remaining >= iov[i].iov_len) {
+            remaining -= iov[i].iov_len;
+            ++i;
+        }
+        if (remaining > 0) {
+            iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + remaining;
+            iov[i].iov_len -= remaining;
+        }
+    }
+}
+
+void sendFileRange(int fd, int fileFd, off_t offset, size_t length) {
+
+#if defined(__linux__)
+    while (length > 0) {
+        ssize_t n = ::sendfile(fd, fileFd, &offset, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL || errno == ENOSYS) break;  // Not supported for this file. Fall back to copying
+            throwFailed("sendfile", errno);
+        }
+        if (n == 0) {
+            throw eckit::ReadError("Unexpected end of file in sendfile", Here());
+        }
+        length -= n;
+    }
+#endif
+
+    if (length > 0) {
+        eckit::Buffer buffer(std::min(length, size_t(4 * 1024 * 1024)));
+        while (length > 0) {
+            ssize_t n = ::pread(fileFd, buffer, std::min(length, buffer.size()), offset);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throwFailed("pread", errno);
+            }
+            if (n == 0) {
+                throw eckit::ReadError("Unexpected end of file sending file data", Here());
+            }
+            writeFully(fd, buffer, n);
+            offset += n;
+            length -= n;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
@@ -0,0 +1,50 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   SocketWrite.h
+/// @date   Oct 2026
+
+#ifndef fdb5_remote_SocketWrite_H
+#define fdb5_remote_SocketWrite_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace fdb5 {
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+inline struct iovec ioBuffer(const void* data, size_t length) {
+    struct iovec v;
+    v.iov_base = const_cast<void*>(data);
+    v.iov_len = length;
+    return v;
+}
+
+/// Write all of the buffers described by iov to the connected socket fd, using as few system calls as
+/// possible and without first gathering the data into one buffer. The iov entries are consumed.
+
+void writeVectored(int fd, std::vector<struct iovec>& iov);
+
+/// Send length bytes from offset in the open file fileFd to the connected socket fd. Where supported
+/// (sendfile) the data does not pass through user space.
+
+void sendFileRange(int fd, int fileFd, off_t offset, size_t length);
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
+
+#endif  // fdb5_remote_SocketWrite_H
@@ -0,0 +1,175 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <time.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/compression/Compressor.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/api/FDBStats.h"
+#include "fdb5/remote/SocketWrite.h"
+#include "fdb5/remote/WireCompression.h"
+
+namespace fdb5 {
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+/// CPU time used by the calling thread
+
+double threadTime() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::vector<std::string> WireCompression::available() {
+
+    // Only fast codecs are suitable for use on the wire
+
+    std::vector<std::string> result;
+    for (const char* name : {"lz4", "snappy"}) {
+        if (eckit::CompressorFactory::instance().has(name)) {
+            result.push_back(name);
+        }
+    }
+    return result;
+}
+
+WireCompression::WireCompression() :
+    minimumSize_(eckit::Resource<size_t>("fdbRemoteCompressionMinimumSize;$FDB_REMOTE_COMPRESSION_MINIMUM_SIZE", 4096)),
+    numCompressed_(0),
+    bytesIn_(0),
+    bytesOut_(0),
+    compressTime_(0),
+    numDecompressed_(0),
+    decompressTime_(0) {}
+
+WireCompression::~WireCompression() {}
+
+void WireCompression::codec(const std::string& name) {
+
+    if (name.empty() || name == "none") {
+        codec_.clear();
+        compressor_.reset();
+        return;
+    }
+
+    codec_ = name;
+    compressor_.reset(eckit::CompressorFactory::instance().build(name));
+    ASSERT(compressor_);
+
+    eckit::Log::debug<LibFdb5>() << "Remote data connection compressed with " << codec_ << std::endl;
+}
+
+void WireCompression::encode(std::vector<struct iovec>& segments, CompressedPayloadHeader& header,
+                             eckit::ResizableBuffer& buffer) {
+
+    ASSERT(enabled());
+
+    size_t length = 0;
+    for (const struct iovec& s : segments) {
+        length += s.iov_len;
+    }
+
+    header.length = length;
+    header.compressed = 0;
+    header.reserved = 0;
+
+    if (length >= minimumSize_) {
+
+        double start = threadTime();
+
+        // The compressor needs contiguous input
+
+        const void* input = segments[0].iov_base;
+        std::unique_ptr<eckit::Buffer> gathered;
+        if (segments.size() > 1) {
+            gathered.reset(new eckit::Buffer(length));
+            char* p = *gathered;
+            for (const struct iovec& s : segments) {
+                ::memcpy(p, s.iov_base, s.iov_len);
+                p += s.iov_len;
+            }
+            input = gathered->data();
+        }
+
+        size_t compressedLength = compressor_->compress(input, length, buffer);
+
+        {
+            std::lock_guard<std::mutex> lock(statsMutex_);
+            ++numCompressed_;
+            bytesIn_ += length;
+            bytesOut_ += std::min(length, compressedLength);
+            compressTime_ += threadTime() - start;
+        }
+
+        if (compressedLength < length) {
+            header.compressed = 1;
+            segments.clear();
+            segments.push_back(ioBuffer(buffer.data(), compressedLength));
+        }
+    }
+
+    segments.insert(segments.begin(), ioBuffer(&header, sizeof(header)));
+}
+
+eckit::Buffer WireCompression::decode(const void* data, size_t length) {
+
+    ASSERT(enabled());
+    ASSERT(length >= sizeof(CompressedPayloadHeader));
+
+    CompressedPayloadHeader header;
+    ::memcpy(&header, data, sizeof(header));
+
+    const char* payload = static_cast<const char*>(data) + sizeof(header);
+    size_t payloadLength = length - sizeof(header);
+
+    if (!header.compressed) {
+        ASSERT(payloadLength == header.length);
+        return eckit::Buffer(payload, payloadLength);
+    }
+
+    double start = threadTime();
+
+    eckit::ResizableBuffer uncompressed(header.length);
+    compressor_->uncompress(payload, payloadLength, uncompressed, header.length);
+
+    eckit::Buffer result(static_cast<const char*>(uncompressed.data()), header.length);
+
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    ++numDecompressed_;
+    decompressTime_ += threadTime() - start;
+
+    return result;
+}
+
+void WireCompression::stats(FDBStats& stats) const {
+    std::lock_guard<std::mutex> lock(statsMutex_);
+    stats.addCompression(numCompressed_, bytesIn_, bytesOut_, compressTime_);
+    stats.addDecompression(numDecompressed_, decompressTime_);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
@@ -0,0 +1,105 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   WireCompression.h
+/// @date   Oct 2026
+
+#ifndef fdb5_remote_WireCompression_H
+#define fdb5_remote_WireCompression_H
+
+#include <sys/uio.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/io/ResizableBuffer.h"
+#include "eckit/memory/NonCopyable.h"
+
+namespace eckit {
+class Compressor;
+}
+
+namespace fdb5 {
+
+class FDBStats;
+
+namespace remote {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// On connections that have negotiated compression, the payload of every Blob message starts with this header
+
+struct CompressedPayloadHeader {
+    uint64_t length;      ///< Length of the (uncompressed) payload
+    uint32_t compressed;  ///< Non-zero if the data that follows is compressed with the negotiated codec
+    uint32_t reserved;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Optional compression of the Blob payloads on the data connection, using the codec agreed between the
+/// client and server when the connection is set up. Payloads that are small, or that do not compress, are
+/// sent uncompressed.
+
+class WireCompression : private eckit::NonCopyable {
+
+public: // methods
+
+    /// @returns the codecs that can be used on the wire by this build, in order of preference
+    static std::vector<std::string> available();
+
+    WireCompression();
+    ~WireCompression();
+
+    /// Select the codec. An empty name, or "none", disables compression.
+    void codec(const std::string& name);
+
+    bool enabled() const { return !!compressor_; }
+    const std::string& codec() const { return codec_; }
+
+    /// Encode the payload of a Blob message, given as one or more segments. The segments are replaced with
+    /// those to be sent: the payload header, followed by the compressed data (held in buffer), or by the
+    /// original segments. The header and buffer must remain valid until the segments are written.
+    void encode(std::vector<struct iovec>& segments, CompressedPayloadHeader& header, eckit::ResizableBuffer& buffer);
+
+    /// Decode the payload of a received Blob message
+    eckit::Buffer decode(const void* data, size_t length);
+
+    /// Add the compression statistics of this connection
+    void stats(FDBStats& stats) const;
+
+private: // members
+
+    std::string codec_;
+    std::unique_ptr<eckit::Compressor> compressor_;
+
+    size_t minimumSize_;
+
+    mutable std::mutex statsMutex_;
+
+    size_t numCompressed_;
+    size_t bytesIn_;          ///< Uncompressed bytes presented for compression
+    size_t bytesOut_;         ///< Bytes sent after compression
+    double compressTime_;     ///< Thread CPU time spent compressing
+
+    size_t numDecompressed_;
+    double decompressTime_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace remote
+}  // namespace fdb5
+
+#endif  // fdb5_remote_WireCompression_H
@@ -0,0 +1,261 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   fdb-server-load.cc
+/// @date   Oct 2026
+///
+/// Load test for an FDB server. Runs a number of concurrent clients in this process, each with its own
+/// connection to the server (unless --share-connections is given), that archive (and optionally read back)
+/// synthetic fields.
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/EmptyHandle.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+#include "eckit/log/Timer.h"
+#include "eckit/option/CmdArgs.h"
+#include "eckit/option/SimpleOption.h"
+#include "eckit/utils/Translator.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/tools/FDBTool.h"
+
+using namespace eckit;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+namespace {
+
+struct ClientResult {
+    ClientResult() : fields_(0), bytesWritten_(0), bytesRead_(0), archiveTime_(0), readTime_(0) {}
+
+    size_t fields_;
+    size_t bytesWritten_;
+    size_t bytesRead_;
+    double archiveTime_;
+    double readTime_;
+};
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class FDBServerLoad : public fdb5::FDBTool {
+
+    virtual void usage(const std::string& tool) const override;
+
+    virtual void init(const eckit::option::CmdArgs& args) override;
+
+    virtual int numberOfPositionalArguments() const override { return 0; }
+
+    virtual void execute(const eckit::option::CmdArgs& args) override;
+
+    ClientResult runClient(size_t client) const;
+
+public:
+
+    FDBServerLoad(int argc, char** argv) :
+        fdb5::FDBTool(argc, argv),
+        port_(7654),
+        clients_(10),
+        fields_(100),
+        size_(1024 * 1024),
+        vary_("step"),
+        clientKey_("number"),
+        read_(false),
+        shareConnections_(false) {
+
+        options_.push_back(new eckit::option::SimpleOption<std::string>("host", "Host of the FDB server"));
+        options_.push_back(new eckit::option::SimpleOption<long>("port", "Port of the FDB server (default 7654)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("clients", "Number of concurrent clients (default 10)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("fields", "Number of fields archived by each client (default 100)"));
+        options_.push_back(new eckit::option::SimpleOption<long>("size", "Size of each field in bytes (default 1 MiB)"));
+        options_.push_back(new eckit::option::SimpleOption<std::string>("key", "Key of the fields to archive, e.g. class=rd,expver=xxxx,..."));
+        options_.push_back(new eckit::option::SimpleOption<std::string>("vary", "Keyword set to the field number (default step)"));
+        options_.push_back(new eckit::option::SimpleOption<std::string>("client-key", "Keyword set to the client number (default number)"));
+        options_.push_back(new eckit::option::SimpleOption<bool>("read", "Read the fields back once archived"));
+        options_.push_back(new eckit::option::SimpleOption<bool>("share-connections", "Share one connection to the server between the clients"));
+    }
+
+private: // members
+
+    std::string host_;
+    long port_;
+    size_t clients_;
+    size_t fields_;
+    size_t size_;
+    std::string key_;
+    std::string vary_;
+    std::string clientKey_;
+    bool read_;
+    bool shareConnections_;
+};
+
+void FDBServerLoad::usage(const std::string& tool) const {
+    Log::info() << std::endl
+                << "Usage: " << tool << " --host=<host> [--port=<port>] --key=<key> [--clients=<n>] [--fields=<n>] "
+                << "[--size=<bytes>] [--vary=<keyword>] [--client-key=<keyword>] [--read] [--share-connections]" << std::endl;
+    fdb5::FDBTool::usage(tool);
+}
+
+void FDBServerLoad::init(const eckit::option::CmdArgs& args) {
+
+    FDBTool::init(args);
+
+    if (!args.has("host") || !args.has("key")) {
+        usage(args.tool());
+        throw fdb5::FDBToolException("Both --host and --key must be specified", Here());
+    }
+
+    host_ = args.getString("host");
+    port_ = args.getLong("port", port_);
+    clients_ = args.getLong("clients", clients_);
+    fields_ = args.getLong("fields", fields_);
+    size_ = args.getLong("size", size_);
+    key_ = args.getString("key");
+    vary_ = args.getString("vary", vary_);
+    clientKey_ = args.getString("client-key", clientKey_);
+    read_ = args.getBool("read", false);
+    shareConnections_ = args.getBool("share-connections", false);
+
+    ASSERT(clients_ > 0);
+    ASSERT(size_ > 0);
+}
+
+ClientResult FDBServerLoad::runClient(size_t client) const {
+
+    eckit::LocalConfiguration remote;
+    remote.set("type", "remote");
+    remote.set("host", host_);
+    remote.set("port", port_);
+    remote.set("shareConnections", shareConnections_);
+
+    fdb5::FDB fdb{fdb5::Config(remote)};
+
+    // Each client writes a different pattern
+
+    Buffer data(size_);
+    char* p = data;
+    for (size_t i = 0; i < size_; ++i) {
+        p[i] = char((client + i) % 251);
+    }
+
+    fdb5::Key key(key_);
+    key.set(clientKey_, Translator<size_t, std::string>()(client + 1));
+
+    ClientResult result;
+
+    Timer timer;
+    for (size_t field = 0; field < fields_; ++field) {
+        key.set(vary_, Translator<size_t, std::string>()(field));
+        fdb.archive(key, data, size_);
+        result.bytesWritten_ += size_;
+        ++result.fields_;
+    }
+    fdb.flush();
+    result.archiveTime_ = timer.elapsed();
+
+    if (read_) {
+
+        metkit::mars::MarsRequest request("retrieve");
+        for (const auto& kv : key) {
+            request.setValue(kv.first, kv.second);
+        }
+
+        std::vector<std::string> values;
+        for (size_t field = 0; field < fields_; ++field) {
+            values.push_back(Translator<size_t, std::string>()(field));
+        }
+        request.values(vary_, values);
+
+        timer.start();
+        std::unique_ptr<DataHandle> dh(fdb.retrieve(request));
+        EmptyHandle sink;
+        result.bytesRead_ = dh->saveInto(sink);
+        result.readTime_ = timer.elapsed();
+
+        if (result.bytesRead_ != result.bytesWritten_) {
+            std::ostringstream ss;
+            ss << "Client " << client << " read " << result.bytesRead_ << " bytes, expected " << result.bytesWritten_;
+            throw SeriousBug(ss.str(), Here());
+        }
+    }
+
+    return result;
+}
+
+void FDBServerLoad::execute(const eckit::option::CmdArgs&) {
+
+    Log::info() << "Starting " << clients_ << " clients against " << host_ << ":" << port_ << std::endl;
+
+    Timer timer;
+
+    std::vector<std::future<ClientResult>> clients;
+    for (size_t client = 0; client < clients_; ++client) {
+        clients.emplace_back(std::async(std::launch::async, [this, client] { return runClient(client); }));
+    }
+
+    ClientResult total;
+    double slowestArchive = 0;
+    double slowestRead = 0;
+    size_t failed = 0;
+
+    for (size_t client = 0; client < clients.size(); ++client) {
+        try {
+            ClientResult result = clients[client].get();
+            total.fields_ += result.fields_;
+            total.bytesWritten_ += result.bytesWritten_;
+            total.bytesRead_ += result.bytesRead_;
+            slowestArchive = std::max(slowestArchive, result.archiveTime_);
+            slowestRead = std::max(slowestRead, result.readTime_);
+        }
+        catch (std::exception& e) {
+            Log::error() << "Client " << client << " failed: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+
+    timer.stop();
+
+    Log::info() << "Clients: " << clients_ << " (" << failed << " failed)" << std::endl;
+    Log::info() << "Fields written: " << total.fields_ << std::endl;
+    Log::info() << "Bytes written: " << Bytes(total.bytesWritten_) << std::endl;
+    Log::info() << "Slowest client archive time: " << slowestArchive << " s" << std::endl;
+    if (read_) {
+        Log::info() << "Bytes read: " << Bytes(total.bytesRead_) << std::endl;
+        Log::info() << "Slowest client read time: " << slowestRead << " s" << std::endl;
+    }
+    Log::info() << "Total duration: " << timer.elapsed() << " s" << std::endl;
+    Log::info() << "Aggregate rate: " << Bytes(total.bytesWritten_ + total.bytesRead_, timer) << std::endl;
+
+    if (failed) {
+        throw SeriousBug("Not all clients completed successfully", Here());
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    FDBServerLoad app(argc, argv);
+    return app.start();
+}
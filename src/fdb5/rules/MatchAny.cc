@@ -24,6 +24,10 @@ MatchAny::MatchAny(const std::set<std::string> &values) :
 MatchAny::~MatchAny() {
 }
 
+bool MatchAny::matchesValue() const {
+    return true;
+}
+
 bool MatchAny::match(const std::string &keyword, const Key &key) const {
 
     Key::const_iterator i = key.find(keyword);
@@ -35,6 +35,8 @@ public: // methods
 
     virtual bool match(const std::string &keyword, const Key &key) const override;
 
+    virtual bool matchesValue() const override;
+
     virtual void dump(std::ostream &s, const std::string &keyword, const TypesRegistry &registry) const override;
 
 private: // methods
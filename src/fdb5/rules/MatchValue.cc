@@ -24,6 +24,10 @@ MatchValue::MatchValue(const std::string &value) :
 MatchValue::~MatchValue() {
 }
 
+bool MatchValue::matchesValue() const {
+    return true;
+}
+
 bool MatchValue::match(const std::string &keyword, const Key &key) const {
     Key::const_iterator i = key.find(keyword);
 
@@ -45,6 +45,9 @@ public: // methods
 
     virtual bool optional() const;
 
+    /// Whether matching depends on the value of the keyword (rather than only on its presence)
+    virtual bool matchesValue() const;
+
     virtual const std::string &value(const Key &, const std::string &keyword) const;
     virtual const std::vector<std::string>& values(const metkit::mars::MarsRequest& rq, const std::string& keyword) const;
     virtual const std::string &defaultValue() const;
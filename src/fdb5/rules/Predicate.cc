@@ -47,6 +47,10 @@ bool Predicate::optional() const {
     return matcher_->optional();
 }
 
+bool Predicate::matchesValue() const {
+    return matcher_->matchesValue();
+}
+
 const std::string &Predicate::value(const Key &key) const {
     return matcher_->value(key, keyword_);
 }
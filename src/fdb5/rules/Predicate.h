@@ -50,6 +50,7 @@ public: // methods
     const std::string &defaultValue() const;
 
     bool optional() const;
+    bool matchesValue() const;
 
     std::string keyword() const;
 
@@ -227,6 +227,27 @@ void Rule::expand(const Key &field, WriteVisitor &visitor, size_t depth, std::ve
     expand(field, predicates_.begin(), depth, keys, full, visitor);
 }
 
+void Rule::expandKeys(const Key &field, Key &key, Key &full) const {
+    for (const Predicate* pred : predicates_) {
+        const std::string &keyword = pred->keyword();
+        const std::string &value = pred->value(field);
+        key.push(keyword, value);
+        full.push(keyword, value);
+    }
+    key.rule(this);
+}
+
+void Rule::valueKeywords(eckit::StringSet& result) const {
+    for (const Predicate* pred : predicates_) {
+        if (pred->matchesValue()) {
+            result.insert(pred->keyword());
+        }
+    }
+    for (const Rule* rule : rules_) {
+        rule->valueKeywords(result);
+    }
+}
+
 void Rule::expandFirstLevel( const Key &dbKey, std::vector<Predicate *>::const_iterator cur, Key &result, bool& found) const {
 
     if (cur == predicates_.end()) {
@@ -71,6 +71,12 @@ public: // methods
                 std::vector<fdb5::Key> &keys,
                 Key &full) const;
 
+    /// Push the values of this rule's keywords in field onto key (and full), as expand() does, for a
+    /// field this rule is already known to match. The predicates are not re-evaluated.
+    void expandKeys(const Key &field, Key &key, Key &full) const;
+
+    void valueKeywords(eckit::StringSet& result) const;
+
     const Rule* ruleFor(const std::vector<fdb5::Key> &keys, size_t depth) const;
     void fill(Key& key, const eckit::StringList& values) const;
 
@@ -79,6 +85,7 @@ public: // methods
     void updateParent(const Rule *parent);
 
     const Rule &topRule() const;
+    const Rule* parent() const { return parent_; }
 
     const Schema &schema() const;
     const TypesRegistry &registry() const;
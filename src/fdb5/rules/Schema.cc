@@ -92,6 +92,12 @@ void Schema::expandSecond(const metkit::mars::MarsRequest& request, ReadVisitor&
     }
 }
 
+void Schema::valueKeywords(eckit::StringSet& result) const {
+    for (const Rule* rule : rules_) {
+        rule->valueKeywords(result);
+    }
+}
+
 void Schema::expandSecond(const Key& field, WriteVisitor& visitor, const Key& dbKey) const {
 
     const Rule* dbRule = nullptr;
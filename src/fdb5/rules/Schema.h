@@ -23,6 +23,7 @@
 #include "eckit/filesystem/PathName.h"
 #include "eckit/io/DataHandle.h"
 #include "eckit/memory/NonCopyable.h"
+#include "eckit/types/Types.h"
 
 #include "fdb5/types/TypesRegistry.h"
 
@@ -64,6 +65,10 @@ public: // methods
 
     const Rule* ruleFor(const Key &dbKey, const Key& idxKey) const;
 
+    /// The keywords whose values, rather than only their presence, determine which rules match. Fields
+    /// with the same keywords, and the same values for these keywords, expand through the same rules.
+    void valueKeywords(eckit::StringSet& result) const;
+
     void load(const eckit::PathName &path, bool replace = false);
     void load(std::istream& s, bool replace = false);
 
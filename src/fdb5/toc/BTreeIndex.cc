@@ -8,8 +8,18 @@
  * does it submit to any jurisdiction.
  */
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <sstream>
+#include <vector>
+
 #include "eckit/log/BigNum.h"
+#include "eckit/log/Log.h"
 #include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/utils/Tokenizer.h"
 
 #include "fdb5/toc/BTreeIndex.h"
 #include "fdb5/toc/TocIndex.h"
@@ -46,17 +56,24 @@ private: // methods
     virtual void funlock();
     virtual void visit(BTreeIndexVisitor& visitor) const;
     virtual void preload();
+    virtual void readAhead();
+    virtual size_t keySize() const;
 
 private: // members
 
     mutable BTreeStore btree_;
 
+    eckit::PathName path_;
+    off_t offset_;
+
 };
 
 
 template<int KEYSIZE, int RECSIZE, typename PAYLOAD>
 TBTreeIndex<KEYSIZE, RECSIZE, PAYLOAD>::TBTreeIndex(const eckit::PathName &path, bool readOnly, off_t offset):
-    btree_( path, readOnly, offset) {
+    btree_( path, readOnly, offset),
+    path_(path),
+    offset_(offset) {
 }
 
 template<int KEYSIZE, int RECSIZE, typename PAYLOAD>
@@ -131,6 +148,25 @@ void TBTreeIndex<KEYSIZE, RECSIZE, PAYLOAD>::preload() {
     btree_.preload();
 }
 
+template<int KEYSIZE, int RECSIZE, typename PAYLOAD>
+void TBTreeIndex<KEYSIZE, RECSIZE, PAYLOAD>::readAhead() {
+    // eckit::BTree does its own page I/O, so we cannot read it through a mapping. But we can have the
+    // pages read ahead into the OS page cache, where they are shared between processes, rather than
+    // duplicating them on the heap of each process.
+    int fd;
+    SYSCALL2((fd = ::open(path_.localPath(), O_RDONLY)), path_);
+    int ret = ::posix_fadvise(fd, offset_, 0, POSIX_FADV_WILLNEED);
+    SYSCALL2(::close(fd), path_);
+    if (ret != 0) {
+        eckit::Log::warning() << "posix_fadvise failed for " << path_ << ": " << ::strerror(ret) << std::endl;
+    }
+}
+
+template<int KEYSIZE, int RECSIZE, typename PAYLOAD>
+size_t TBTreeIndex<KEYSIZE, RECSIZE, PAYLOAD>::keySize() const {
+    return KEYSIZE;
+}
+
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -160,6 +196,45 @@ const std::string& BTreeIndex::defaulType() {
     return fdbIndexType;
 }
 
+bool BTreeIndex::pageCachePreload(const std::string& type) {
+    static std::string fdbIndexReadMode = eckit::Resource<std::string>("fdbIndexReadMode;$FDB_INDEX_READ_MODE", "heap");
+    return pageCachePreload(type, fdbIndexReadMode);
+}
+
+bool BTreeIndex::pageCachePreload(const std::string& type, const std::string& readModes) {
+
+    std::string mode = "heap";
+    bool found = false;
+
+    std::vector<std::string> entries;
+    eckit::Tokenizer(",")(readModes, entries);
+
+    for (const std::string& entry : entries) {
+
+        std::vector<std::string> parts;
+        eckit::Tokenizer(":")(entry, parts);
+
+        if (parts.empty() || parts.size() > 2 || (parts.back() != "heap" && parts.back() != "pagecache")) {
+            std::ostringstream ss;
+            ss << "Invalid fdbIndexReadMode '" << readModes << "' (expected heap or pagecache, optionally per index type"
+               << " e.g. heap,BTreeIndex4MB:pagecache)";
+            throw eckit::UserError(ss.str(), Here());
+        }
+
+        // A mode for this specific index type takes precedence over one for all types
+
+        const std::string& m = parts.back();
+        if (parts.size() == 1) {
+            if (!found) mode = m;
+        } else if (parts[0] == type) {
+            mode = m;
+            found = true;
+        }
+    }
+
+    return mode == "pagecache";
+}
+
 static BTreeIndexBuilder<BTreeIndex_32_65536_FieldRefReduced>   defaultIndex("BTreeIndex");
 static BTreeIndexBuilder<BTreeIndex_32_65536_FieldRefFull>      PointDBIndex("PointDBIndex");
 static BTreeIndexBuilder<BTreeIndex_32_4194304_FieldRefReduced> BTreeIndex4MB("BTreeIndex4MB");
@@ -50,9 +50,23 @@ public:
     virtual void funlock() = 0;
     virtual void preload() = 0;
 
+    /// Read the index ahead into the OS page cache, rather than onto the heap. By default the same as preload().
+    virtual void readAhead() { preload(); }
+
+    /// Keys longer than this are truncated on insertion and lookup
+    virtual size_t keySize() const = 0;
 
     static const std::string& defaulType();
 
+    /// If true, indexes of the given type are preloaded with readAhead() rather than preload(). This is configured
+    /// per index type by fdbIndexReadMode (see below).
+    static bool pageCachePreload(const std::string& type);
+
+    /// @param readModes Either a single mode (heap or pagecache) for all index types, or a comma separated list of
+    ///                  type:mode pairs, optionally including a single mode for all other types.
+    ///                  e.g. "heap,BTreeIndex4MB:pagecache"
+    static bool pageCachePreload(const std::string& type, const std::string& readModes);
+
 };
 
 //----------------------------------------------------------------------------------------------------------------------
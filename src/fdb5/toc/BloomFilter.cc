@@ -0,0 +1,84 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "fdb5/toc/BloomFilter.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+BloomFilter::BloomFilter() :
+    hashes_(0) {}
+
+BloomFilter::BloomFilter(size_t entries, size_t bitsPerEntry) :
+    bits_((std::max<size_t>(entries * bitsPerEntry, 64) + 7) / 8, 0),
+    hashes_(std::min<size_t>(std::max<size_t>(std::lround(bitsPerEntry * 0.69314718056), 1), 16)) {}
+
+BloomFilter::BloomFilter(const void* bits, size_t bytes, size_t hashes) :
+    bits_(static_cast<const unsigned char*>(bits), static_cast<const unsigned char*>(bits) + bytes),
+    hashes_(hashes) {}
+
+uint64_t BloomFilter::hash(const std::string& key) {
+
+    // FNV-1a, followed by a (splitmix64) finaliser to spread the bits
+
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+void BloomFilter::insert(uint64_t h) {
+
+    if (bits_.empty()) return;
+
+    // Double hashing: derive all of the probes from two halves of one 64-bit hash
+
+    uint64_t h1 = h & 0xffffffff;
+    uint64_t h2 = (h >> 32) | 1;
+    uint64_t nbits = bits_.size() * 8;
+
+    for (size_t i = 0; i < hashes_; ++i) {
+        uint64_t bit = (h1 + i * h2) % nbits;
+        bits_[bit / 8] |= (1 << (bit % 8));
+    }
+}
+
+bool BloomFilter::mayContain(uint64_t h) const {
+
+    if (bits_.empty()) return true;
+
+    uint64_t h1 = h & 0xffffffff;
+    uint64_t h2 = (h >> 32) | 1;
+    uint64_t nbits = bits_.size() * 8;
+
+    for (size_t i = 0; i < hashes_; ++i) {
+        uint64_t bit = (h1 + i * h2) % nbits;
+        if (!(bits_[bit / 8] & (1 << (bit % 8)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
@@ -0,0 +1,68 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   BloomFilter.h
+/// @date   Oct 2026
+
+#ifndef fdb5_BloomFilter_H
+#define fdb5_BloomFilter_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A Bloom filter over index key fingerprints. The hashing is fixed (and independent of the platform
+/// and standard library), as the filter bits are persisted alongside the indexes.
+///
+/// An empty filter (with no bits) may contain anything.
+
+class BloomFilter {
+
+public: // methods
+
+    BloomFilter();
+
+    /// Size the filter for the expected number of entries
+    BloomFilter(size_t entries, size_t bitsPerEntry);
+
+    /// Reconstruct a filter from its persisted bits
+    BloomFilter(const void* bits, size_t bytes, size_t hashes);
+
+    void insert(const std::string& key) { insert(hash(key)); }
+    void insert(uint64_t hash);
+
+    bool mayContain(const std::string& key) const { return mayContain(hash(key)); }
+    bool mayContain(uint64_t hash) const;
+
+    bool empty() const { return bits_.empty(); }
+
+    size_t hashes() const { return hashes_; }
+    size_t bytes() const { return bits_.size(); }
+    const void* data() const { return bits_.data(); }
+
+    /// Keys may be hashed ahead of time, e.g. when the number of entries is not yet known
+    static uint64_t hash(const std::string& key);
+
+private: // members
+
+    std::vector<unsigned char> bits_;
+    size_t hashes_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_BloomFilter_H
@@ -0,0 +1,385 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/FDataSync.h"
+#include "eckit/log/Log.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/toc/CompactIndex.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static const char compactIndexMagic[8] = {'F', 'D', 'B', 'C', 'I', 'D', 'X', '\0'};
+static const uint32_t compactIndexVersion = 1;
+
+static size_t restartInterval() {
+    static size_t fdbCompactIndexRestartInterval =
+        eckit::Resource<size_t>("fdbCompactIndexRestartInterval;$FDB_COMPACT_INDEX_RESTART_INTERVAL", 16);
+    ASSERT(fdbCompactIndexRestartInterval > 0);
+    return fdbCompactIndexRestartInterval;
+}
+
+static size_t bloomBitsPerEntry() {
+    static size_t fdbCompactIndexBloomBits =
+        eckit::Resource<size_t>("fdbCompactIndexBloomBits;$FDB_COMPACT_INDEX_BLOOM_BITS", 10);
+    return fdbCompactIndexBloomBits;
+}
+
+static void putVarint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+static uint64_t getVarint(const char*& p, const char* end) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        ASSERT(p < end);
+        unsigned char c = static_cast<unsigned char>(*p++);
+        v |= uint64_t(c & 0x7f) << shift;
+        if (!(c & 0x80)) {
+            return v;
+        }
+    }
+    throw eckit::SeriousBug("Corrupt varint in compact index", Here());
+}
+
+static void putUInt64(std::string& out, uint64_t v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Decodes the entries in a range of the table, reconstructing the prefix-compressed keys
+
+class CompactIndexCursor {
+
+public: // methods
+
+    CompactIndexCursor(const char* begin, const char* end) : p_(begin), end_(end) {}
+
+    bool next() {
+        if (p_ >= end_) {
+            return false;
+        }
+        uint64_t shared   = getVarint(p_, end_);
+        uint64_t unshared = getVarint(p_, end_);
+        ASSERT(shared <= key_.size());
+        ASSERT(p_ + unshared <= end_);
+        key_.resize(shared);
+        key_.append(p_, unshared);
+        p_ += unshared;
+
+        uint64_t uriId  = getVarint(p_, end_);
+        uint64_t offset = getVarint(p_, end_);
+        uint64_t length = getVarint(p_, end_);
+        location_ = FieldRefLocation(uriId, eckit::Offset(offset), eckit::Length(length));
+        return true;
+    }
+
+    const std::string& key() const { return key_; }
+    const FieldRefLocation& location() const { return location_; }
+
+private: // members
+
+    const char* p_;
+    const char* end_;
+
+    std::string key_;
+    FieldRefLocation location_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CompactIndex::CompactIndex(const eckit::PathName& path, bool readOnly, off_t offset) :
+    path_(path),
+    readOnly_(readOnly),
+    offset_(offset),
+    dirty_(false),
+    fd_(-1) {
+
+    ::memset(&header_, 0, sizeof(header_));
+
+    if (readOnly_) {
+        map();
+    } else {
+        SYSCALL2((fd_ = ::open(path_.localPath(), O_RDWR | O_CREAT, (mode_t)0777)), path_);
+    }
+}
+
+CompactIndex::~CompactIndex() {
+    if (fd_ >= 0) {
+        if (dirty_) {
+            eckit::Log::warning() << "CompactIndex " << path_ << " closed with unflushed entries" << std::endl;
+        }
+        ::close(fd_);
+    }
+}
+
+void CompactIndex::map() {
+
+    int fd;
+    SYSCALL2((fd = ::open(path_.localPath(), O_RDONLY)), path_);
+
+    try {
+        ssize_t len;
+        SYSCALL2((len = ::pread(fd, &header_, sizeof(header_), offset_)), path_);
+
+        if (size_t(len) != sizeof(header_) || ::memcmp(header_.magic_, compactIndexMagic, sizeof(compactIndexMagic)) != 0) {
+            std::ostringstream ss;
+            ss << "No compact index found in " << path_ << " at offset " << offset_;
+            throw eckit::SeriousBug(ss.str(), Here());
+        }
+
+        if (header_.version_ != compactIndexVersion) {
+            std::ostringstream ss;
+            ss << "Unsupported compact index version " << header_.version_ << " in " << path_;
+            throw eckit::SeriousBug(ss.str(), Here());
+        }
+
+        mapped_.reset(new MappedFile(path_, fd, offset_, header_.size_));
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+
+    SYSCALL2(::close(fd), path_);
+
+    if (header_.bloomBytes_) {
+        bloom_ = BloomFilter(base() + header_.bloomOffset_, header_.bloomBytes_, header_.bloomHashes_);
+    }
+}
+
+uint64_t CompactIndex::blockOffset(uint64_t block) const {
+    ASSERT(block < header_.blocks_);
+    uint64_t offset;
+    ::memcpy(&offset, base() + header_.indexOffset_ + block * sizeof(uint64_t), sizeof(offset));
+    return offset;
+}
+
+bool CompactIndex::get(const std::string& key, FieldRef& data) const {
+
+    if (!readOnly_) {
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            return false;
+        }
+        data = FieldRef(it->second);
+        return true;
+    }
+
+    if (header_.count_ == 0 || !bloom_.mayContain(key)) {
+        return false;
+    }
+
+    // Find the last block whose first key is <= key. The first entry of each block has no shared prefix,
+    // so its key can be compared in place.
+
+    uint64_t lo = 0;
+    uint64_t hi = header_.blocks_;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        const char* p   = base() + blockOffset(mid);
+        const char* end = base() + header_.indexOffset_;
+        uint64_t shared = getVarint(p, end);
+        uint64_t len    = getVarint(p, end);
+        ASSERT(shared == 0);
+        if (std::string_view(p, len) <= key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if (lo == 0) {
+        return false;
+    }
+
+    uint64_t block = lo - 1;
+    const char* end = base() + ((block + 1 < header_.blocks_) ? blockOffset(block + 1) : header_.indexOffset_);
+
+    CompactIndexCursor cursor(base() + blockOffset(block), end);
+    while (cursor.next()) {
+        int c = cursor.key().compare(key);
+        if (c == 0) {
+            data = FieldRef(cursor.location());
+            return true;
+        }
+        if (c > 0) {
+            break;
+        }
+    }
+    return false;
+}
+
+bool CompactIndex::set(const std::string& key, const FieldRef& data) {
+    ASSERT(!readOnly_);
+    dirty_ = true;
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        it->second = data.location();
+        return true;
+    }
+    entries_.emplace(key, data.location());
+    return false;
+}
+
+void CompactIndex::flush() {
+
+    if (!dirty_) {
+        return;
+    }
+
+    ASSERT(!readOnly_);
+    ASSERT(fd_ >= 0);
+
+    Header header;
+    ::memset(&header, 0, sizeof(header));
+    ::memcpy(header.magic_, compactIndexMagic, sizeof(compactIndexMagic));
+    header.version_         = compactIndexVersion;
+    header.restartInterval_ = restartInterval();
+    header.count_           = entries_.size();
+
+    std::string out(sizeof(Header), '\0');
+    std::vector<uint64_t> blocks;
+    blocks.reserve(entries_.size() / header.restartInterval_ + 1);
+
+    // Entries, prefix compressed against the previous entry within each block
+
+    const std::string* previous = nullptr;
+    size_t n = 0;
+
+    for (const auto& e : entries_) {
+
+        size_t shared = 0;
+        if (n++ % header.restartInterval_ == 0) {
+            blocks.push_back(out.size());
+        } else {
+            ASSERT(previous);
+            size_t limit = std::min(previous->size(), e.first.size());
+            while (shared < limit && (*previous)[shared] == e.first[shared]) {
+                ++shared;
+            }
+        }
+
+        putVarint(out, shared);
+        putVarint(out, e.first.size() - shared);
+        out.append(e.first, shared, std::string::npos);
+        putVarint(out, e.second.uriId());
+        putVarint(out, uint64_t((long long)e.second.offset()));
+        putVarint(out, uint64_t((long long)e.second.length()));
+
+        previous = &e.first;
+    }
+
+    // The block index
+
+    header.blocks_      = blocks.size();
+    header.indexOffset_ = out.size();
+    for (uint64_t b : blocks) {
+        putUInt64(out, b);
+    }
+
+    // And the (optional) Bloom filter
+
+    size_t bits = bloomBitsPerEntry();
+    if (bits > 0 && !entries_.empty()) {
+        BloomFilter bloom(entries_.size(), bits);
+        for (const auto& e : entries_) {
+            bloom.insert(e.first);
+        }
+        header.bloomOffset_ = out.size();
+        header.bloomBytes_  = bloom.bytes();
+        header.bloomHashes_ = bloom.hashes();
+        out.append(static_cast<const char*>(bloom.data()), bloom.bytes());
+    }
+
+    header.size_ = out.size();
+    ::memcpy(&out[0], &header, sizeof(header));
+
+    // The table is always (re)written in its entirety at the index offset
+
+    size_t written = 0;
+    while (written < out.size()) {
+        ssize_t len;
+        SYSCALL2((len = ::pwrite(fd_, out.data() + written, out.size() - written, offset_ + written)), path_);
+        written += len;
+    }
+
+    eckit::Log::debug<LibFdb5>() << "Written compact index " << path_ << " offset=" << offset_
+                                 << " entries=" << header.count_ << " size=" << header.size_ << std::endl;
+
+    dirty_ = false;
+}
+
+void CompactIndex::sync() {
+    if (fd_ >= 0) {
+        SYSCALL2(eckit::fdatasync(fd_), path_);
+    }
+}
+
+void CompactIndex::visit(BTreeIndexVisitor& visitor) const {
+
+    if (!readOnly_) {
+        for (const auto& e : entries_) {
+            visitor.visit(e.first, FieldRef(e.second));
+        }
+        return;
+    }
+
+    if (header_.count_ == 0) {
+        return;
+    }
+
+    CompactIndexCursor cursor(base() + sizeof(Header), base() + header_.indexOffset_);
+    while (cursor.next()) {
+        visitor.visit(cursor.key(), FieldRef(cursor.location()));
+    }
+}
+
+// The table is written once, by the only process that ever writes to its index file, and is immutable
+// thereafter. There is nothing to lock.
+
+void CompactIndex::flock() {}
+
+void CompactIndex::funlock() {}
+
+void CompactIndex::preload() {
+    if (mapped_) {
+        mapped_->willNeed();
+    }
+}
+
+size_t CompactIndex::keySize() const {
+    // Keys are stored in full, and never truncated
+    return std::numeric_limits<size_t>::max();
+}
+
+static BTreeIndexBuilder<CompactIndex> builder("CompactIndex");
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
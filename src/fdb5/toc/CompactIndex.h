@@ -0,0 +1,111 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   CompactIndex.h
+/// @date   Oct 2026
+
+#ifndef fdb5_CompactIndex_H
+#define fdb5_CompactIndex_H
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "eckit/filesystem/PathName.h"
+
+#include "fdb5/io/MappedFile.h"
+#include "fdb5/toc/BTreeIndex.h"
+#include "fdb5/toc/BloomFilter.h"
+#include "fdb5/toc/FieldRef.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// An immutable, sorted table of (key fingerprint, field location) entries. It is an alternative to the
+/// eckit::BTree based indexes for indexes that are written once and then only read, such as those written
+/// when compacting subtocs or reconsolidating a database (see fdbCompactIndexType).
+///
+/// Layout, starting at the index offset in the index file:
+///
+///   Header
+///   Entries, in key order. Each is [shared prefix length, suffix length, suffix, uri id, offset, length],
+///            as varints. Every restartInterval entries a new block starts, with no shared prefix.
+///   Block index, the (uint64) offsets of the blocks relative to the start of the table
+///   Bloom filter bits (optional)
+///
+/// Readers map the table, and a lookup touches only the Bloom filter, the block index and one block.
+/// Entries are buffered in memory when writing, and the table is written out on flush().
+
+class CompactIndex : public BTreeIndex {
+
+public: // types
+
+    struct Header {
+        char magic_[8];
+        uint32_t version_;
+        uint32_t restartInterval_;
+        uint64_t count_;
+        uint64_t blocks_;
+        uint64_t indexOffset_;
+        uint64_t bloomOffset_;
+        uint64_t bloomBytes_;
+        uint32_t bloomHashes_;
+        uint32_t spare_;
+        uint64_t size_;
+    };
+
+public: // methods
+
+    CompactIndex(const eckit::PathName& path, bool readOnly, off_t offset);
+    ~CompactIndex() override;
+
+private: // methods
+
+    bool get(const std::string& key, FieldRef& data) const override;
+    bool set(const std::string& key, const FieldRef& data) override;
+    void flush() override;
+    void sync() override;
+    void visit(BTreeIndexVisitor& visitor) const override;
+    void flock() override;
+    void funlock() override;
+    void preload() override;
+    size_t keySize() const override;
+
+    void map();
+
+    const char* base() const { return static_cast<const char*>(mapped_->data()); }
+    uint64_t blockOffset(uint64_t block) const;
+
+private: // members
+
+    eckit::PathName path_;
+    bool readOnly_;
+    off_t offset_;
+
+    // Writing
+
+    std::map<std::string, FieldRefLocation> entries_;
+    bool dirty_;
+    int fd_;
+
+    // Reading
+
+    std::unique_ptr<MappedFile> mapped_;
+    Header header_;
+    BloomFilter bloom_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_CompactIndex_H
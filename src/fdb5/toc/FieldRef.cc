@@ -43,6 +43,12 @@ FieldRefLocation::FieldRefLocation(UriStore &store, const Field& field) {
     offset_ = tocfloc->offset();
 }
 
+FieldRefLocation::FieldRefLocation(UriID uriId, const eckit::Offset& offset, const eckit::Length& length) :
+    uriId_(uriId),
+    offset_(offset),
+    length_(length) {
+}
+
 void FieldRefLocation::print(std::ostream &s) const {
     s << "FieldRefLocation(pathid=" << uriId_ << ",offset=" << offset_ << ",length=" << length_ << ")";
 }
@@ -71,6 +77,10 @@ FieldRef::FieldRef(const FieldRefReduced& other):
     location_(other.location()) {
 }
 
+FieldRef::FieldRef(const FieldRefLocation& location):
+    location_(location) {
+}
+
 void FieldRef::print(std::ostream &s) const {
     s << location_;
 }
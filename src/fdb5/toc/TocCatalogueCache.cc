@@ -0,0 +1,370 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/TransferWatcher.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Log.h"
+#include "eckit/os/Stat.h"
+
+#include "fdb5/LibFdb5.h"
+#include "fdb5/toc/BTreeIndex.h"
+#include "fdb5/toc/FieldRef.h"
+#include "fdb5/toc/TocCatalogueCache.h"
+
+namespace fdb5 {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The complete, sorted, contents of one index btree.
+
+class TocIndexTable : private eckit::NonCopyable {
+
+public: // methods
+
+    TocIndexTable(const BTreeIndex& btree) :
+        keySize_(btree.keySize()) {
+
+        struct Collector : public BTreeIndexVisitor {
+            std::vector<std::pair<std::string, FieldRef>>& entries_;
+            Collector(std::vector<std::pair<std::string, FieldRef>>& entries) : entries_(entries) {}
+            void visit(const std::string& key, const FieldRef& ref) override {
+                entries_.emplace_back(key, ref);
+            }
+        };
+
+        Collector c(entries_);
+        btree.visit(c);
+
+        // The btree is visited in key order, but be robust to that changing
+
+        std::sort(entries_.begin(), entries_.end(),
+                  [](const std::pair<std::string, FieldRef>& a, const std::pair<std::string, FieldRef>& b) {
+                      return a.first < b.first;
+                  });
+
+        bytes_ = sizeof(*this) + entries_.capacity() * sizeof(entries_[0]);
+        for (const auto& e : entries_) {
+            bytes_ += e.first.capacity();
+        }
+    }
+
+    bool get(const std::string& key, FieldRef& data) const {
+
+        // Match the truncation of over-long keys in the btree
+
+        const std::string k = (key.size() > keySize_) ? key.substr(0, keySize_) : key;
+
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), k,
+                                   [](const std::pair<std::string, FieldRef>& e, const std::string& k) {
+                                       return e.first < k;
+                                   });
+
+        if (it == entries_.end() || it->first != k) return false;
+        data = it->second;
+        return true;
+    }
+
+    void visit(BTreeIndexVisitor& visitor) const {
+        for (const auto& e : entries_) {
+            visitor.visit(e.first, e.second);
+        }
+    }
+
+    size_t bytes() const { return bytes_; }
+    size_t keySize() const { return keySize_; }
+
+private: // members
+
+    std::vector<std::pair<std::string, FieldRef>> entries_;
+
+    size_t keySize_;
+    size_t bytes_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// A read-only BTreeIndex over a (shared) TocIndexTable
+
+class CachedBTreeIndex : public BTreeIndex {
+
+public: // methods
+
+    CachedBTreeIndex(std::shared_ptr<const TocIndexTable> table) : table_(table) {}
+
+private: // methods
+
+    bool get(const std::string& key, FieldRef& data) const override { return table_->get(key, data); }
+    bool set(const std::string&, const FieldRef&) override { NOTIMP; }
+    void flush() override {}
+    void sync() override {}
+    void visit(BTreeIndexVisitor& visitor) const override { table_->visit(visitor); }
+    void flock() override {}
+    void funlock() override {}
+    void preload() override {}
+    size_t keySize() const override { return table_->keySize(); }
+
+private: // members
+
+    std::shared_ptr<const TocIndexTable> table_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static void readFully(const eckit::PathName& path, int fd, char* buf, size_t len, off_t offset,
+                      eckit::TransferWatcher& watcher) {
+
+    static size_t bufferSize = 4 * 1024 * 1024;
+
+    while (len > 0) {
+        ssize_t n;
+        SYSCALL2(n = ::pread(fd, buf, std::min(len, bufferSize), offset), path);
+        if (n == 0) {
+            std::ostringstream ss;
+            ss << "Unexpected end of file reading TOC " << path << " at offset " << offset;
+            throw eckit::ReadError(ss.str(), Here());
+        }
+        watcher.watch(buf, n);
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TocCatalogueCacheStats::TocCatalogueCacheStats() :
+    hits_(0),
+    misses_(0),
+    refreshes_(0),
+    evictions_(0),
+    entries_(0),
+    bytes_(0),
+    capacity_(0) {}
+
+void TocCatalogueCacheStats::print(std::ostream& out) const {
+    out << "TocCatalogueCacheStats("
+        << "hits=" << hits_
+        << ",misses=" << misses_
+        << ",refreshes=" << refreshes_
+        << ",evictions=" << evictions_
+        << ",entries=" << entries_
+        << ",size=" << eckit::Bytes(bytes_)
+        << ",capacity=" << eckit::Bytes(capacity_)
+        << ")";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static size_t catalogueCacheSize() {
+
+    long size = eckit::Resource<long>("fdbCatalogueCacheSize;$FDB_CATALOGUE_CACHE_SIZE", 0);
+
+    if (size < 0) {
+        std::ostringstream ss;
+        ss << "Invalid catalogue cache size: " << size << " (fdbCatalogueCacheSize must be zero, or a size in bytes)";
+        throw eckit::UserError(ss.str(), Here());
+    }
+
+    return size;
+}
+
+TocCatalogueCache& TocCatalogueCache::instance() {
+    static TocCatalogueCache cache(catalogueCacheSize());
+    return cache;
+}
+
+TocCatalogueCache::TocCatalogueCache(size_t capacity) :
+    capacity_(capacity),
+    bytes_(0),
+    hits_(0),
+    misses_(0),
+    refreshes_(0),
+    evictions_(0) {}
+
+TocCatalogueCache::TocData TocCatalogueCache::toc(const eckit::PathName& path, int fd, eckit::TransferWatcher& watcher) {
+
+    eckit::Stat::Struct info;
+    SYSCALL2(eckit::Stat::fstat(fd, &info), path);
+
+    const std::string key = path.asString();
+
+    TocData previous;
+    off_t previousSize = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        Entry* entry = lookup(key);
+        if (entry && entry->dev_ == info.st_dev && entry->ino_ == info.st_ino) {
+
+            if (entry->size_ == info.st_size && entry->mtime_ == info.st_mtime) {
+                ++hits_;
+                return entry->toc_;
+            }
+
+            // TOCs are only ever appended to. If it has grown, we only need to read the new records.
+
+            if (entry->size_ < info.st_size) {
+                previous = entry->toc_;
+                previousSize = entry->size_;
+            }
+        }
+
+        if (previous) {
+            ++refreshes_;
+        } else {
+            ++misses_;
+        }
+    }
+
+    // Read outside of the lock. Concurrent readers of the same TOC may duplicate work, but will not block
+    // readers of unrelated TOCs.
+
+    std::shared_ptr<eckit::Buffer> data(new eckit::Buffer(info.st_size));
+    if (previous) {
+        ::memcpy(data->data(), previous->data(), previousSize);
+    }
+    readFully(path, fd, static_cast<char*>(data->data()) + previousSize, info.st_size - previousSize, previousSize, watcher);
+
+    eckit::Log::debug<LibFdb5>() << "TocCatalogueCache: " << (previous ? "extended " : "loaded ") << path
+                                 << " (" << eckit::Bytes(info.st_size - previousSize) << " read)" << std::endl;
+
+    Entry entry;
+    entry.toc_   = data;
+    entry.dev_   = info.st_dev;
+    entry.ino_   = info.st_ino;
+    entry.size_  = info.st_size;
+    entry.mtime_ = info.st_mtime;
+    entry.bytes_ = sizeof(Entry) + key.size() + data->size();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert(key, std::move(entry));
+    return data;
+}
+
+BTreeIndex* TocCatalogueCache::index(const std::string& type, const eckit::PathName& path, off_t offset) {
+
+    eckit::Stat::Struct info;
+    SYSCALL2(eckit::Stat::stat(path.localPath(), &info), path);
+
+    std::ostringstream ss;
+    ss << path << "@" << offset;
+    const std::string key = ss.str();
+
+    // Index files are appended to, but the btree at a given offset is immutable once it has been referenced
+    // from a TOC. The inode number protects against files that have been wiped and recreated.
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry* entry = lookup(key);
+        if (entry && entry->dev_ == info.st_dev && entry->ino_ == info.st_ino) {
+            ++hits_;
+            return new CachedBTreeIndex(entry->index_);
+        }
+        ++misses_;
+    }
+
+    std::shared_ptr<const TocIndexTable> table;
+    {
+        std::unique_ptr<BTreeIndex> btree(BTreeIndexFactory::build(type, path, true, offset));
+        table.reset(new TocIndexTable(*btree));
+    }
+
+    Entry entry;
+    entry.index_ = table;
+    entry.dev_   = info.st_dev;
+    entry.ino_   = info.st_ino;
+    entry.size_  = 0;
+    entry.mtime_ = 0;
+    entry.bytes_ = sizeof(Entry) + key.size() + table->bytes();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    insert(key, std::move(entry));
+    return new CachedBTreeIndex(table);
+}
+
+TocCatalogueCacheStats TocCatalogueCache::statistics() const {
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    TocCatalogueCacheStats stats;
+    stats.hits_      = hits_;
+    stats.misses_    = misses_;
+    stats.refreshes_ = refreshes_;
+    stats.evictions_ = evictions_;
+    stats.entries_   = entries_.size();
+    stats.bytes_     = bytes_;
+    stats.capacity_  = capacity_;
+    return stats;
+}
+
+void TocCatalogueCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    bytes_ = 0;
+}
+
+TocCatalogueCache::Entry* TocCatalogueCache::lookup(const std::string& key) {
+
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return nullptr;
+
+    lru_.splice(lru_.begin(), lru_, it->second.lru_);
+    return &it->second;
+}
+
+void TocCatalogueCache::insert(const std::string& key, Entry&& entry) {
+
+    // If another thread has raced us, keep whichever copy is most complete
+
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        if (it->second.size_ > entry.size_) return;
+        erase(it);
+    }
+
+    // Items larger than the entire budget are not cached at all
+
+    if (entry.bytes_ > capacity_) return;
+
+    while (bytes_ + entry.bytes_ > capacity_) {
+        ASSERT(!lru_.empty());
+        erase(entries_.find(lru_.back()));
+        ++evictions_;
+    }
+
+    lru_.push_front(key);
+    entry.lru_ = lru_.begin();
+    bytes_ += entry.bytes_;
+    entries_.emplace(key, std::move(entry));
+}
+
+void TocCatalogueCache::erase(std::map<std::string, Entry>::iterator it) {
+    ASSERT(it != entries_.end());
+    ASSERT(bytes_ >= it->second.bytes_);
+    bytes_ -= it->second.bytes_;
+    lru_.erase(it->second.lru_);
+    entries_.erase(it);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
@@ -0,0 +1,143 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   TocCatalogueCache.h
+/// @date   Oct 2026
+
+#ifndef fdb5_TocCatalogueCache_H
+#define fdb5_TocCatalogueCache_H
+
+#include <sys/types.h>
+
+#include <iosfwd>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/memory/NonCopyable.h"
+
+namespace eckit {
+class TransferWatcher;
+}
+
+namespace fdb5 {
+
+class BTreeIndex;
+class TocIndexTable;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+struct TocCatalogueCacheStats {
+
+    TocCatalogueCacheStats();
+
+    size_t hits_;
+    size_t misses_;
+    size_t refreshes_;  ///< TOCs that had grown, and were extended by reading only the new records
+    size_t evictions_;
+
+    size_t entries_;
+    size_t bytes_;
+    size_t capacity_;
+
+    void print(std::ostream& out) const;
+
+    friend std::ostream& operator<<(std::ostream& s, const TocCatalogueCacheStats& x) {
+        x.print(s);
+        return s;
+    }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Process-wide cache of TOC contents and of the (immutable) index btrees referenced from them, shared
+/// between all TocHandler and TocIndex instances in the process, irrespective of the FDB object that
+/// created them.
+///
+/// TOCs are keyed by path and revalidated against the file size and modification time each time they are
+/// opened. As TOCs are append-only, a TOC that has grown is extended by reading only the new records.
+/// Index btrees are keyed by path and offset, and are immutable once referenced from a TOC.
+///
+/// The cache is disabled unless given a memory budget (fdbCatalogueCacheSize, in bytes). Entries are
+/// evicted in least-recently-used order; evicted data remains valid for as long as it is in use.
+
+class TocCatalogueCache : private eckit::NonCopyable {
+
+public: // types
+
+    using TocData = std::shared_ptr<const eckit::Buffer>;
+
+public: // methods
+
+    static TocCatalogueCache& instance();
+
+    /// @param capacity The memory budget, in bytes. A budget of zero disables the cache.
+    explicit TocCatalogueCache(size_t capacity);
+
+    bool enabled() const { return capacity_ > 0; }
+
+    /// @returns the contents of the TOC open on the file descriptor fd, reading from the file as required
+    TocData toc(const eckit::PathName& path, int fd, eckit::TransferWatcher& watcher);
+
+    /// @returns a read-only btree over the cached contents of the index at (path, offset)
+    BTreeIndex* index(const std::string& type, const eckit::PathName& path, off_t offset);
+
+    TocCatalogueCacheStats statistics() const;
+
+    void clear();
+
+private: // types
+
+    struct Entry {
+        TocData toc_;
+        std::shared_ptr<const TocIndexTable> index_;
+
+        dev_t dev_;
+        ino_t ino_;
+        off_t size_;
+        time_t mtime_;
+
+        size_t bytes_;
+        std::list<std::string>::iterator lru_;
+    };
+
+private: // methods
+
+    /// @note The following must be called with mutex_ held
+
+    Entry* lookup(const std::string& key);
+    void insert(const std::string& key, Entry&& entry);
+    void erase(std::map<std::string, Entry>::iterator it);
+
+private: // members
+
+    mutable std::mutex mutex_;
+
+    std::map<std::string, Entry> entries_;
+    std::list<std::string> lru_; ///< Most recently used at the front
+
+    size_t capacity_;
+    size_t bytes_;
+
+    size_t hits_;
+    size_t misses_;
+    size_t refreshes_;
+    size_t evictions_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace fdb5
+
+#endif  // fdb5_TocCatalogueCache_H
@@ -40,7 +40,6 @@ void TocCatalogueReader::loadIndexesAndRemap() {
     std::vector<Index> indexes = loadIndexes(false, nullptr, nullptr, &remapKeys);
 
     ASSERT(remapKeys.size() == indexes.size());
-    indexes_.reserve(remapKeys.size());
     for (size_t i = 0; i < remapKeys.size(); ++i) {
         indexes_.emplace_back(indexes[i], remapKeys[i]);
     }
@@ -53,18 +52,71 @@ bool TocCatalogueReader::selectIndex(const Key &key) {
     }
 
     currentIndexKey_ = key;
+    matchIndexes();
+
+    eckit::Log::debug<LibFdb5>() << "TocCatalogueReader::selectIndex " << key << ", found "
+                                << matching_.size() << " matche(s)" << std::endl;
+
+    return (matching_.size() != 0);
+}
+
+void TocCatalogueReader::matchIndexes() {
+
     matching_.clear();
 
     for (auto idx = indexes_.begin(); idx != indexes_.end(); ++idx) {
-        if (idx->first.key() == key) {
+        if (idx->first.key() == currentIndexKey_) {
             matching_.push_back(&(*idx));
         }
     }
+}
 
-    eckit::Log::debug<LibFdb5>() << "TocCatalogueReader::selectIndex " << key << ", found "
-                                << matching_.size() << " matche(s)" << std::endl;
+bool TocCatalogueReader::refresh() {
 
-    return (matching_.size() != 0);
+    TocIndexUpdate update;
+    if (!refreshIndexes(update)) {
+        return false;
+    }
+
+    eckit::Log::debug<LibFdb5>() << "TocCatalogueReader::refresh " << directory() << ", "
+                                 << update.added_.size() << " new index(es)" << std::endl;
+
+    bool removed = false;
+
+    if (update.clearedAll_) {
+        removed = !indexes_.empty();
+        indexes_.clear();
+    } else if (!update.cleared_.empty()) {
+        size_t count = indexes_.size();
+        indexes_.erase(std::remove_if(indexes_.begin(), indexes_.end(), [&update](const std::pair<Index, Key>& idx) {
+            const TocIndex* tocidx = dynamic_cast<const TocIndex*>(idx.first.content());
+            ASSERT(tocidx);
+            std::pair<eckit::PathName, eckit::Offset> id(tocidx->path().baseName(), tocidx->offset());
+            return update.cleared_.find(id) != update.cleared_.end();
+        }), indexes_.end());
+        removed = (indexes_.size() != count);
+    }
+
+    // The newest indexes take precedence. n.b. update.added_ is ordered newest first
+
+    for (auto idx = update.added_.rbegin(); idx != update.added_.rend(); ++idx) {
+        indexes_.push_front(*idx);
+    }
+
+    if (removed) {
+        // Erasing from indexes_ invalidates the pointers in matching_
+        matchIndexes();
+    } else {
+        std::vector<std::pair<Index, Key>*> matches;
+        for (size_t i = 0; i < update.added_.size(); ++i) {
+            if (indexes_[i].first.key() == currentIndexKey_) {
+                matches.push_back(&indexes_[i]);
+            }
+        }
+        matching_.insert(matching_.begin(), matches.begin(), matches.end());
+    }
+
+    return true;
 }
 
 void TocCatalogueReader::deselectIndex() {
@@ -16,6 +16,8 @@
 #ifndef fdb5_TocCatalogueReader_H
 #define fdb5_TocCatalogueReader_H
 
+#include <deque>
+
 #include "fdb5/toc/TocCatalogue.h"
 
 namespace fdb5 {
@@ -36,9 +38,14 @@ public: // methods
     std::vector<Index> indexes(bool sorted) const override;
     DbStats stats() const override { return TocHandler::stats(); }
 
+    /// Pick up indexes that have been added (or cleared) since the catalogue was opened or last refreshed,
+    /// reading only the TOC records appended since then.
+    bool refresh() override;
+
 private: // methods
 
     void loadIndexesAndRemap();
+    void matchIndexes();
     bool selectIndex(const Key &key) override;
     void deselectIndex() override;
 
@@ -61,7 +68,8 @@ private: // members
 
     // All indexes
     // If there is a key remapping for a mounted SubToc, this is stored alongside
-    std::vector<std::pair<Index, Key>> indexes_;
+    // n.b. a deque, so that refreshed indexes can be prepended without invalidating matching_
+    std::deque<std::pair<Index, Key>> indexes_;
 
 };
 
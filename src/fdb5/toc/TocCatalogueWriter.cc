@@ -10,9 +10,16 @@
 
 #include "fdb5/fdb5_config.h"
 
+#include <algorithm>
+#include <ctime>
+#include <functional>
+#include <set>
+#include <unordered_map>
+
 #include "eckit/config/Resource.h"
 #include "eckit/log/Log.h"
 #include "eckit/log/Bytes.h"
+#include "eckit/io/DataHandle.h"
 #include "eckit/io/EmptyHandle.h"
 
 #include "fdb5/database/EntryVisitMechanism.h"
@@ -21,6 +28,7 @@
 #include "fdb5/toc/TocCatalogueWriter.h"
 #include "fdb5/toc/TocFieldLocation.h"
 #include "fdb5/toc/TocIndex.h"
+#include "fdb5/toc/TocIndexLocation.h"
 #include "fdb5/io/LustreSettings.h"
 
 using namespace eckit;
@@ -29,9 +37,40 @@ namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/// The type of the indexes that are written once, and then only read: those written when compacting subtocs,
+/// or when reconsolidating a database. n.b. older software cannot read the CompactIndex type.
+
+static const std::string& compactIndexType() {
+    static std::string fdbCompactIndexType = eckit::Resource<std::string>("fdbCompactIndexType;$FDB_COMPACT_INDEX_TYPE",
+                                                                          TocIndex::defaulType());
+    return fdbCompactIndexType;
+}
+
+/// Data files are compacted when less than this fraction of their contents is still reachable
+
+static double compactThreshold() {
+    static double fdbCompactThreshold = eckit::Resource<double>("fdbCompactThreshold;$FDB_COMPACT_THRESHOLD", 0.5);
+    return fdbCompactThreshold;
+}
+
+/// Data files modified within this many seconds may still be being written to, and are not compacted
+
+static long compactMinimumAge() {
+    static long fdbCompactMinimumAge = eckit::Resource<long>("fdbCompactMinimumAge;$FDB_COMPACT_MINIMUM_AGE", 3600);
+    return fdbCompactMinimumAge;
+}
+
+static std::pair<eckit::PathName, off_t> indexLocation(const Index& index) {
+    const TocIndexLocation& location = dynamic_cast<const TocIndexLocation&>(index.location());
+    return std::make_pair(location.uri().path(), location.offset());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 
 TocCatalogueWriter::TocCatalogueWriter(const Key &key, const fdb5::Config& config) :
     TocCatalogue(key, config),
+    indexType_(TocIndex::defaulType()),
     umask_(config.umask()) {
     writeInitRecord(key);
     TocCatalogue::loadSchema();
@@ -40,6 +79,7 @@ TocCatalogueWriter::TocCatalogueWriter(const Key &key, const fdb5::Config& confi
 
 TocCatalogueWriter::TocCatalogueWriter(const eckit::URI &uri, const fdb5::Config& config) :
     TocCatalogue(uri.path(), ControlIdentifiers{}, config),
+    indexType_(TocIndex::defaulType()),
     umask_(config.umask()) {
     writeInitRecord(TocCatalogue::key());
     TocCatalogue::loadSchema();
@@ -62,7 +102,7 @@ bool TocCatalogueWriter::selectIndex(const Key& key) {
             fdb5LustreapiFileCreate(indexPath.localPath(), stripeIndexLustreSettings());
         }
 
-        indexes_[key] = Index(new TocIndex(key, indexPath, 0, TocIndex::WRITE));
+        indexes_[key] = Index(new TocIndex(key, indexPath, 0, TocIndex::WRITE, indexType_));
     }
 
     current_ = indexes_[key];
@@ -84,7 +124,7 @@ bool TocCatalogueWriter::selectIndex(const Key& key) {
                 fdb5LustreapiFileCreate(indexPath.localPath(), stripeIndexLustreSettings());
             }
 
-            fullIndexes_[key] = Index(new TocIndex(key, indexPath, 0, TocIndex::WRITE));
+            fullIndexes_[key] = Index(new TocIndex(key, indexPath, 0, TocIndex::WRITE, compactIndexType()));
         }
 
         currentFull_ = fullIndexes_[key];
@@ -116,6 +156,15 @@ void TocCatalogueWriter::clean() {
     deselectIndex();
 }
 
+void TocCatalogueWriter::discard() {
+
+    eckit::Log::warning() << "Discarding the fields indexed since the last flush of " << directory_ << std::endl;
+
+    deselectIndex();
+    closeIndexes();
+    dirty_ = false;
+}
+
 void TocCatalogueWriter::close() {
 
     closeIndexes();
@@ -165,6 +214,10 @@ void TocCatalogueWriter::reconsolidateIndexesAndTocs() {
         TocCatalogueWriter& writer_;
     };
 
+    // The consolidated indexes are only ever read
+
+    indexType_ = compactIndexType();
+
     // Visit all tocs and indexes
 
     std::set<std::string> subtocs;
@@ -217,6 +270,250 @@ void TocCatalogueWriter::reconsolidateIndexesAndTocs() {
     appendBlock(buf, combinedSize);
 }
 
+void TocCatalogueWriter::compact(Store& store, std::ostream& out, bool porcelain, bool doit) {
+
+    std::ostream& logVerbose(porcelain ? Log::debug<LibFdb5>() : out);
+
+    class CompactEntryVisitor : public EntryVisitor {
+    public:
+        CompactEntryVisitor(std::function<void(const Field&, const std::string&)> fn) : fn_(fn) {}
+    private:
+        void visitDatum(const Field& field, const std::string& keyFingerprint) override { fn_(field, keyFingerprint); }
+        void visitDatum(const Field&, const Key&) override { NOTIMP; }
+        std::function<void(const Field&, const std::string&)> fn_;
+    };
+
+    struct DataUsage {
+        DataUsage() : fields_(0), reachable_(0), pinned_(false) {}
+        size_t fields_;
+        eckit::Length reachable_;
+        bool pinned_;   ///< Referenced by an index that is not owned by this database
+    };
+
+    // Walk the indexes, newest first, to find how much of each data file is still reachable, and which index
+    // holds the reachable instance of each entry.
+
+    std::vector<Index> indexes = loadIndexes();
+
+    std::unordered_map<std::string, size_t> reachableIn;
+    std::unordered_map<std::string, DataUsage> usage;
+
+    for (size_t i = 0; i < indexes.size(); ++i) {
+
+        const Index& idx(indexes[i]);
+        const std::string prefix = idx.key().valuesToString() + "+";
+
+        CompactEntryVisitor visitor([&](const Field& field, const std::string& keyFingerprint) {
+            if (reachableIn.emplace(prefix + keyFingerprint, i).second) {
+                DataUsage& u(usage[field.location().uri().path()]);
+                u.fields_++;
+                u.reachable_ += field.location().length();
+            }
+        });
+        idx.entries(visitor);
+
+        if (!idx.location().uri().path().dirName().sameAs(directory_)) {
+            for (const eckit::URI& uri : idx.dataPaths()) {
+                usage[uri.path()].pinned_ = true;
+            }
+        }
+    }
+
+    // Select the owned data files worth compacting. Those with nothing reachable are left to purge.
+
+    if (!porcelain) {
+        out << std::endl << "Reachable data per owned data file:" << std::endl;
+    }
+
+    std::set<std::string> sparse;
+    time_t now = ::time(nullptr);
+
+    for (const auto& it : usage) { // <std::string, DataUsage>
+
+        eckit::PathName path(it.first);
+        if (it.second.pinned_ || !path.dirName().sameAs(directory_) || !path.exists()) {
+            continue;
+        }
+
+        eckit::Length size = path.size();
+        bool recent = (now - path.lastModified()) < compactMinimumAge();
+        bool compact = !recent && double(it.second.reachable_) < compactThreshold() * double(size);
+
+        if (!porcelain) {
+            out << "    " << path << ": " << eckit::Bytes(it.second.reachable_) << " of " << eckit::Bytes(size)
+                << (compact ? " (compact)" : (recent ? " (recently modified)" : "")) << std::endl;
+        }
+
+        if (compact) {
+            sparse.insert(it.first);
+        }
+    }
+
+    if (sparse.empty()) {
+        logVerbose << std::endl << "Nothing to compact" << std::endl;
+        return;
+    }
+
+    // Any owned index referring to a compacted data file is replaced
+
+    std::vector<size_t> replaced;
+    for (size_t i = 0; i < indexes.size(); ++i) {
+        const Index& idx(indexes[i]);
+        if (idx.location().uri().path().dirName().sameAs(directory_)) {
+            for (const eckit::URI& uri : idx.dataPaths()) {
+                if (sparse.find(uri.path()) != sparse.end()) {
+                    replaced.push_back(i);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!porcelain) {
+        out << std::endl << "Indexes to be replaced:" << std::endl;
+        for (size_t i : replaced) {
+            out << "    " << indexes[i].location().uri() << std::endl;
+        }
+        out << std::endl;
+    }
+
+    if (!doit) {
+        return;
+    }
+
+    // Rewrite the reachable entries of the replaced indexes. Data in the compacted files is copied through
+    // the store into new data files. Other data is referred to where it is.
+
+    struct Replacement {
+        Key indexKey_;
+        Key key_;
+        eckit::URI uri_;
+        eckit::Offset offset_;
+        eckit::Length length_;
+    };
+
+    std::vector<Replacement> replacements;
+    eckit::Buffer buffer(1024 * 1024);
+    eckit::Length copied = 0;
+
+    for (size_t i : replaced) {
+
+        const Index& idx(indexes[i]);
+        const std::string prefix = idx.key().valuesToString() + "+";
+        const Rule* rule = schema().ruleFor(dbKey_, idx.key());
+
+        CompactEntryVisitor visitor([&](const Field& field, const std::string& keyFingerprint) {
+
+            if (reachableIn[prefix + keyFingerprint] != i) {
+                return;
+            }
+
+            Replacement r{idx.key(), Key(keyFingerprint, rule), field.location().uri(),
+                          field.location().offset(), field.location().length()};
+
+            if (sparse.find(field.location().uri().path()) != sparse.end()) {
+
+                if (buffer.size() < r.length_) {
+                    buffer.resize(r.length_);
+                }
+
+                std::unique_ptr<eckit::DataHandle> dh(field.dataHandle());
+                dh->openForRead();
+                eckit::AutoClose closer(*dh);
+                long len = dh->read(buffer, r.length_);
+                ASSERT(len == long(r.length_));
+
+                std::unique_ptr<FieldLocation> location = store.archive(idx.key(), buffer, r.length_);
+                r.uri_ = location->uri();
+                r.offset_ = location->offset();
+                r.length_ = location->length();
+                copied += r.length_;
+            }
+
+            replacements.emplace_back(std::move(r));
+        });
+        idx.entries(visitor);
+    }
+
+    // The data must be safely stored before any index refers to it
+
+    store.flush();
+
+    // The database remains open for archiving. Anything archived since the indexes were read takes precedence
+    // over the replacement entries, which must not hide it. n.b. This narrows, but cannot entirely close, the
+    // window in which a concurrent archive may be hidden.
+
+    std::set<std::pair<eckit::PathName, off_t>> visited;
+    for (const Index& idx : indexes) {
+        visited.insert(indexLocation(idx));
+    }
+
+    std::vector<Index> newer;
+    for (const Index& idx : loadIndexes()) {
+        if (visited.find(indexLocation(idx)) == visited.end()) {
+            newer.push_back(idx);
+        }
+    }
+
+    size_t reindexed = 0;
+    for (const Replacement& r : replacements) {
+
+        bool hidden = false;
+        for (const Index& idx : newer) {
+            Field field;
+            if (idx.key() == r.indexKey_ && idx.get(r.key_, Key(), field)) {
+                hidden = true;
+                break;
+            }
+        }
+
+        if (!hidden) {
+            if (currentIndexKey_ != r.indexKey_) {
+                selectIndex(r.indexKey_);
+            }
+            index(r.key_, r.uri_, r.offset_, r.length_);
+            reindexed++;
+        }
+    }
+
+    flush();
+    deselectIndex();
+
+    logVerbose << "Rewritten " << reindexed << " fields, copying " << eckit::Bytes(copied) << std::endl;
+
+    // Mask the replaced indexes, a block of records at a time
+
+    const size_t maskBlock = 64;
+
+    for (size_t first = 0; first < replaced.size(); first += maskBlock) {
+
+        size_t count = std::min(maskBlock, replaced.size() - first);
+        Buffer buf(sizeof(TocRecord) * count);
+        size_t combinedSize = 0;
+
+        for (size_t n = first; n < first + count; ++n) {
+            const Index& idx(indexes[replaced[n]]);
+            TocRecord* r = new (&buf[combinedSize]) TocRecord(serialisationVersion().used(), TocRecord::TOC_CLEAR);
+            combinedSize += roundRecord(*r, buildClearRecord(*r, idx));
+            logVerbose << "Masking index: " << idx.location().uri() << std::endl;
+        }
+
+        appendBlock(buf, combinedSize);
+    }
+
+    // Nothing reachable now refers to the compacted data files, but readers that loaded the indexes before
+    // they were masked may still be reading from them. They are removed, along with the replaced index files,
+    // by purge.
+
+    for (const std::string& path : sparse) {
+        if (porcelain) {
+            out << path << std::endl;
+        } else {
+            out << "Compacted data file, to be removed by purge: " << path << std::endl;
+        }
+    }
+}
+
 const Index& TocCatalogueWriter::currentIndex() {
 
     if (current_.null()) {
@@ -334,16 +631,27 @@ eckit::PathName TocCatalogueWriter::generateIndexPath(const Key &key) const {
 // a flush (i.e. every step). The indexes stored in fullIndexes then contain _all_
 // the data that is indexes thorughout the lifetime of the DBWriter, which can be
 // compacted later for read performance.
+//
+// The records of all of the indexes flushed are appended to the TOC together, so each flush
+// costs one append (and sync) of the TOC however many indexes are being written.
 void TocCatalogueWriter::flushIndexes() {
+
+    std::vector<Index> flushed;
+
     for (IndexStore::iterator j = indexes_.begin(); j != indexes_.end(); ++j ) {
         Index& idx = j->second;
 
         if (idx.dirty()) {
             idx.flush();
-            writeIndexRecord(idx);
-            idx.reopen(); // Create a new btree
+            flushed.push_back(idx);
         }
     }
+
+    writeIndexRecords(flushed);
+
+    for (Index& idx : flushed) {
+        idx.reopen(); // Create a new btree
+    }
 }
 
 
@@ -47,6 +47,15 @@ public: // methods
 
     void reconsolidate() override { reconsolidateIndexesAndTocs(); }
 
+    /// The indexes written since the last flush, and the full indexes of a sub-TOC, are left unreferenced
+    void discard() override;
+
+    /// Rewrite the reachable fields of the owned data files that are mostly unreachable into new data files,
+    /// write replacement indexes for the indexes that refer to them, and mask those indexes. Only the TOC is
+    /// rewritten: the old data files are left for purge. Data files that have been modified recently may
+    /// still be being written to, and are left alone.
+    void compact(Store& store, std::ostream& out, bool porcelain, bool doit) override;
+
     /// Mount an existing TocCatalogue, which has a different metadata key (within
     /// constraints) to allow on-line rebadging of data
     /// variableKeys: The keys that are allowed to differ between the two DBs
@@ -104,6 +113,9 @@ private: // members
     Index current_;
     Index currentFull_;
 
+    /// The type of new indexes in indexes_. Reconsolidation writes indexes that will only ever be read.
+    std::string indexType_;
+
     eckit::AutoUmask umask_;
 };
 
@@ -12,10 +12,17 @@
 #include "fdb5/LibFdb5.h"
 #include "fdb5/fdb5_config.h"
 
+#include "eckit/config/Resource.h"
+#include "eckit/exception/Exceptions.h"
+
 #if fdb5_HAVE_GRIB
 #include "fdb5/io/SingleGribMungePartFileHandle.h"
 #endif
 
+#if defined(fdb5_HAVE_URING)
+#include "fdb5/io/UringPartFileHandle.h"
+#endif
+
 namespace fdb5 {
 
 ::eckit::ClassSpec TocFieldLocation::classSpec_ = {&FieldLocation::classSpec(), "TocFieldLocation",};
@@ -47,8 +54,20 @@ std::shared_ptr<FieldLocation> TocFieldLocation::make_shared() const {
     return std::make_shared<TocFieldLocation>(std::move(*this));
 }
 
+static bool uringRead() {
+    static bool fdbUringRead = eckit::Resource<bool>("fdbUringRead;$FDB_URING_READ", false);
+    return fdbUringRead;
+}
+
 eckit::DataHandle *TocFieldLocation::dataHandle() const {
     if (remapKey_.empty()) {
+        if (uringRead()) {
+#if defined(fdb5_HAVE_URING)
+            return new UringPartFileHandle(uri_.path(), offset(), length());
+#else
+            throw eckit::UserError("fdbUringRead is set, but FDB was built without io_uring support", Here());
+#endif
+        }
         return uri_.path().partHandle(offset(), length());
     } else {
 #if fdb5_HAVE_GRIB
@@ -59,6 +78,27 @@ eckit::DataHandle *TocFieldLocation::dataHandle() const {
     }
 }
 
+std::string TocFieldLocation::batchKey() const {
+    // Any local fields can be read together, whichever data files they are in
+    return (uringRead() && remapKey_.empty()) ? std::string("uring") : std::string();
+}
+
+eckit::DataHandle* TocFieldLocation::readMany(const std::vector<std::shared_ptr<const FieldLocation>>& locations) const {
+#if defined(fdb5_HAVE_URING)
+    std::vector<UringPartFileHandle::Part> parts;
+    parts.reserve(locations.size());
+
+    for (const auto& location : locations) {
+        ASSERT(location->batchKey() == batchKey());
+        parts.push_back(UringPartFileHandle::Part{location->uri().path(), location->offset(), location->length()});
+    }
+
+    return new UringPartFileHandle(parts);
+#else
+    return FieldLocation::readMany(locations);
+#endif
+}
+
 void TocFieldLocation::print(std::ostream &out) const {
     out << "TocFieldLocation[uri=" << uri_ << ",offset=" << offset() << ",length=" << length() << ",remapKey=" << remapKey_ << "]";
 }
@@ -39,6 +39,10 @@ public:
 
     eckit::DataHandle* dataHandle() const override;
 
+    /// With fdbUringRead, fields are read in batches, with the reads of many fields in flight at once
+    std::string batchKey() const override;
+    eckit::DataHandle* readMany(const std::vector<std::shared_ptr<const FieldLocation>>& locations) const override;
+
     virtual std::shared_ptr<FieldLocation> make_shared() const override;
 
     virtual void visit(FieldLocationVisitor& visitor) const override;
@@ -12,12 +12,16 @@
 #include <sys/types.h>
 #include <pwd.h>
 
+#include <cstring>
+
 #include "eckit/config/Resource.h"
+#include "eckit/io/Buffer.h"
 #include "eckit/io/FileHandle.h"
 #include "eckit/io/FileDescHandle.h"
 #include "eckit/log/BigNum.h"
 #include "eckit/log/Log.h"
 #include "eckit/maths/Functions.h"
+#include "eckit/os/Stat.h"
 #include "eckit/serialisation/MemoryStream.h"
 #include "eckit/thread/AutoLock.h"
 #include "eckit/thread/StaticMutex.h"
@@ -68,6 +72,21 @@ class TocHandlerCloser {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+static bool mappedTocs() {
+
+    static std::string fdbTocReadMode = eckit::Resource<std::string>("fdbTocReadMode;$FDB_TOC_READ_MODE", "heap");
+
+    if (fdbTocReadMode != "heap" && fdbTocReadMode != "mmap") {
+        std::ostringstream ss;
+        ss << "Unknown fdbTocReadMode '" << fdbTocReadMode << "' (expected heap or mmap)";
+        throw eckit::UserError(ss.str(), Here());
+    }
+
+    return fdbTocReadMode == "mmap";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 class CachedFDProxy {
 public: // methods
 
@@ -130,7 +149,10 @@ TocHandler::TocHandler(const eckit::PathName& directory, const Config& config) :
     cachedToc_(nullptr),
     count_(0),
     enumeratedMaskedEntries_(false),
-    writeMode_(false)
+    writeMode_(false),
+    tailOffset_(0),
+    tailInode_(0),
+    trackTail_(false)
 {
 
     // An override to enable using sub tocs without configurations being passed in, for ease
@@ -153,7 +175,10 @@ TocHandler::TocHandler(const eckit::PathName& path, const Key& parentKey) :
     cachedToc_(nullptr),
     count_(0),
     enumeratedMaskedEntries_(false),
-    writeMode_(false)
+    writeMode_(false),
+    tailOffset_(0),
+    tailInode_(0),
+    trackTail_(false)
 {
 
     /// Are we remapping a mounted DB?
@@ -226,9 +251,7 @@ void TocHandler::openForAppend() {
 
     checkUID(); // n.b. may openForRead
 
-    if (cachedToc_) {
-        cachedToc_.reset();
-    }
+    resetTocCache();
 
     writeMode_ = true;
 
@@ -278,7 +301,31 @@ void TocHandler::openForRead() const {
     enumeratedMaskedEntries_ = false;
     maskedEntries_.clear();
 
-    if(fdbCacheTocsOnRead) {
+    TocCatalogueCache& cache(TocCatalogueCache::instance());
+
+    if (mappedTocs()) {
+
+        // Read directly from the OS page cache, shared with all other readers of this TOC
+
+        mappedToc_.reset(new MappedFile(tocPath_, fd_, 0, tocSize));
+        SYSCALL2(::close(fd_), tocPath_);
+        fd_ = -1;
+
+        cachedToc_.reset( new eckit::MemoryHandle(mappedToc_->data(), mappedToc_->size()) );
+        cachedToc_->openForRead();
+
+    } else if (cache.enabled()) {
+
+        // Share the TOC contents with any other handlers in this process
+
+        sharedToc_ = cache.toc(tocPath_, fd_, tocReadStats_);
+        SYSCALL2(::close(fd_), tocPath_);
+        fd_ = -1;
+
+        cachedToc_.reset( new eckit::MemoryHandle(sharedToc_->data(), sharedToc_->size()) );
+        cachedToc_->openForRead();
+
+    } else if(fdbCacheTocsOnRead) {
 
         FileDescHandle toc(fd_, true); // closes the file descriptor
         AutoClose closer1(toc);
@@ -294,6 +341,12 @@ void TocHandler::openForRead() const {
     }
 }
 
+void TocHandler::resetTocCache() const {
+    cachedToc_.reset();
+    sharedToc_.reset();
+    mappedToc_.reset();
+}
+
 void TocHandler::dumpTocCache() const {
     if (cachedToc_) {
         eckit::Offset offset = cachedToc_->position();
@@ -340,9 +393,9 @@ void TocHandler::appendBlock(const void *data, size_t size) {
     ASSERT(fd_ != -1);
     ASSERT(not cachedToc_);
 
-    // Ensure that this block is appropriately rounded.
+    // Ensure that this block is appropriately rounded. Compact records are not rounded.
 
-    ASSERT(size % recordRoundSize() == 0);
+    ASSERT(TocRecord::compact(serialisationVersion_.used()) || size % recordRoundSize() == 0);
 
     size_t len;
     SYSCALL2( len = ::write(fd_, data, size), tocPath_ );
@@ -362,11 +415,24 @@ size_t TocHandler::recordRoundSize() {
 
 size_t TocHandler::roundRecord(TocRecord &r, size_t payloadSize) {
 
+    if (TocRecord::compact(r.header_.serialisationVersion_)) {
+        return r.pack(payloadSize);
+    }
+
     r.header_.size_ = eckit::round(sizeof(TocRecord::Header) + payloadSize, recordRoundSize());
 
     return r.header_.size_;
 }
 
+TocRecord& TocHandler::readRecord() const {
+    // Allocate (large) TocRecord on heap not stack (MARS-779), and only once, as indexes may be
+    // reloaded or refreshed many times
+    if (!readRecord_) {
+        readRecord_.reset(new TocRecord(serialisationVersion_.used()));
+    }
+    return *readRecord_;
+}
+
 // readNext wraps readNextInternal.
 // readNext reads the next TOC entry from this toc, or from an appropriate subtoc if necessary.
 bool TocHandler::readNext( TocRecord &r, bool walkSubTocs, bool hideSubTocEntries, bool hideClearEntries, bool readMasked) const {
@@ -390,6 +456,9 @@ bool TocHandler::readNext( TocRecord &r, bool walkSubTocs, bool hideSubTocEntrie
         if (subTocRead_) {
             len = subTocRead_->readNext(r, walkSubTocs, hideSubTocEntries, hideClearEntries, readMasked);
             if (len == 0) {
+                if (trackTail_) {
+                    retainTailSubToc();
+                }
                 subTocRead_.reset();
             } else {
                 ASSERT(r.header_.tag_ != TocRecord::TOC_SUB_TOC);
@@ -495,20 +564,28 @@ bool TocHandler::readNextInternal(TocRecord& r) const {
 
     CachedFDProxy proxy(tocPath_, fd_, cachedToc_);
 
+    // The first bytes of the record identify its form, and so the size of its header
+
+    char* p = reinterpret_cast<char*>(&r);
+
     try {
-        long len = proxy.read(&r, sizeof(TocRecord::Header));
+        long len = proxy.read(p, TocRecord::prefixSize);
         if (len == 0) {
             return false;
         }
-        ASSERT(len == sizeof(TocRecord::Header));
-    } catch(...) {
-        dumpTocCache();
-        throw;
-    }
+        ASSERT(len == TocRecord::prefixSize);
 
-    try {
-        long len = proxy.read(&r.payload_, r.header_.size_ - sizeof(TocRecord::Header));
-        ASSERT(size_t(len) == r.header_.size_ - sizeof(TocRecord::Header));
+        size_t hdrSize = r.storedHeaderSize();
+        len = proxy.read(p + TocRecord::prefixSize, hdrSize - TocRecord::prefixSize);
+        ASSERT(size_t(len) == hdrSize - TocRecord::prefixSize);
+
+        size_t size = r.storedSize();
+        ASSERT(size >= hdrSize && size <= sizeof(TocRecord));
+
+        len = proxy.read(p + hdrSize, size - hdrSize);
+        ASSERT(size_t(len) == size - hdrSize);
+
+        r.unpack();
     } catch(...) {
         dumpTocCache();
         throw;
@@ -768,8 +845,8 @@ void TocHandler::writeInitRecord(const Key &key) {
         eckit::MemoryStream s(&r2->payload_[0], r2->maxPayloadSize);
         s << key;
         s << isSubToc_;
+        dbUID_ = r2->header_.uid_;  // n.b. before the record is packed for writing
         append(*r2, s.position());
-        dbUID_ = r2->header_.uid_;
 
     } else {
         ASSERT(r->header_.tag_ == TocRecord::TOC_INIT);
@@ -855,31 +932,66 @@ void TocHandler::writeIndexRecord(const Index& index) {
     // If we are using a sub toc, delegate there
 
     if (useSubToc_) {
+        subTocForWrite().writeIndexRecord(index);
+        return;
+    }
 
-        // Create the sub toc, and insert the redirection record into the the master toc.
-
-        if (!subTocWrite_) {
+    // Otherwise, we actually do the writing!
 
-            eckit::PathName subtoc = eckit::PathName::unique("toc");
+    openForAppend();
+    TocHandlerCloser closer(*this);
 
-            subTocWrite_.reset(new TocHandler(currentDirectory() / subtoc, Key{}));
+    WriteToStream writeVisitor(index, *this);
+    index.visit(writeVisitor);
+}
 
-            subTocWrite_->writeInitRecord(databaseKey());
+void TocHandler::writeIndexRecords(const std::vector<Index>& indexes) {
 
-            writeSubTocRecord(*subTocWrite_);
-        }
+    if (indexes.empty()) {
+        return;
+    }
 
-        subTocWrite_->writeIndexRecord(index);
+    if (useSubToc_) {
+        subTocForWrite().writeIndexRecords(indexes);
         return;
     }
 
-    // Otherwise, we actually do the writing!
+    // Build all of the records into one block, so that they are published together by a single write
 
-    openForAppend();
-    TocHandlerCloser closer(*this);
+    std::vector<char> block;
 
-    WriteToStream writeVisitor(index, *this);
-    index.visit(writeVisitor);
+    for (const Index& index : indexes) {
+
+        std::unique_ptr<TocRecord> r(new TocRecord(serialisationVersion_.used(), TocRecord::TOC_INDEX)); // allocate (large) TocRecord on heap not stack (MARS-779)
+        size_t sz = roundRecord(*r, buildIndexRecord(*r, index));
+
+        const char* p = reinterpret_cast<const char*>(r.get());
+        block.insert(block.end(), p, p + sz);
+
+        eckit::Log::debug<LibFdb5>() << "Write TOC_INDEX " << index.location() << " " << index.type() << std::endl;
+    }
+
+    appendBlock(block.data(), block.size());
+}
+
+TocHandler& TocHandler::subTocForWrite() {
+
+    ASSERT(useSubToc_);
+
+    // Create the sub toc, and insert the redirection record into the the master toc.
+
+    if (!subTocWrite_) {
+
+        eckit::PathName subtoc = eckit::PathName::unique("toc");
+
+        subTocWrite_.reset(new TocHandler(currentDirectory() / subtoc, Key{}));
+
+        subTocWrite_->writeInitRecord(databaseKey());
+
+        writeSubTocRecord(*subTocWrite_);
+    }
+
+    return *subTocWrite_;
 }
 
 void TocHandler::writeSubTocMaskRecord(const TocHandler &subToc) {
@@ -1003,8 +1115,22 @@ std::vector<Index> TocHandler::loadIndexes(bool sorted,
     openForRead();
     TocHandlerCloser close(*this);
 
-    // Allocate (large) TocRecord on heap not stack (MARS-779)
-    std::unique_ptr<TocRecord> r(new TocRecord(serialisationVersion_.used()));
+    // Record where we got to, so that refreshIndexes() can follow on from here
+
+    struct TailTracker {
+        const TocHandler& handler_;
+        TailTracker(const TocHandler& handler) : handler_(handler) {
+            handler_.tailSubTocs_.clear();
+            handler_.trackTail_ = true;
+        }
+        ~TailTracker() { handler_.trackTail_ = false; }
+    } tracker(*this);
+
+    eckit::Stat::Struct info;
+    SYSCALL2(eckit::Stat::stat(tocPath_.localPath(), &info), tocPath_);
+    tailInode_ = info.st_ino;
+
+    TocRecord* r = &readRecord();
     count_ = 0;
 
     bool debug = LibFdb5::instance().debug();
@@ -1041,6 +1167,9 @@ std::vector<Index> TocHandler::loadIndexes(bool sorted,
             if (subTocs != 0 && subTocRead_) {
                 subTocs->insert(subTocRead_->tocPath());
             }
+            if (subTocRead_) {
+                tailSubTocs_[subTocRead_->tocPath().baseName()].indexes_.emplace((currentDirectory() / path).baseName(), offset);
+            }
             if (indexInSubtoc) {
                 indexInSubtoc->push_back(!!subTocRead_);
             }
@@ -1067,6 +1196,8 @@ std::vector<Index> TocHandler::loadIndexes(bool sorted,
 
     }
 
+    tailOffset_ = CachedFDProxy(tocPath_, fd_, cachedToc_).position();
+
     // For some purposes, it is useful to have the indexes sorted by their location, as this is is faster for
     // iterating through the data.
 
@@ -1093,6 +1224,272 @@ std::vector<Index> TocHandler::loadIndexes(bool sorted,
 
 }
 
+void TocHandler::retainTailSubToc() const {
+
+    ASSERT(subTocRead_);
+
+    TocHandler& subToc(*subTocRead_);
+    subToc.tailOffset_ = CachedFDProxy(subToc.tocPath_, subToc.fd_, subToc.cachedToc_).position();
+    subToc.close();
+    subToc.resetTocCache();
+
+    tailSubTocs_[subToc.tocPath_.baseName()].handler_ = std::move(subTocRead_);
+}
+
+void TocHandler::readTail(const std::function<void(TocRecord&)>& visitor) const {
+
+    int fd;
+    SYSCALL2((fd = ::open(tocPath_.localPath(), O_RDONLY)), tocPath_);
+    FileDescHandle toc(fd, true); // closes the file descriptor
+    AutoClose closer(toc);
+
+    eckit::Stat::Struct info;
+    SYSCALL2(eckit::Stat::fstat(fd, &info), tocPath_);
+    if (info.st_size <= off_t(tailOffset_)) {
+        return;
+    }
+
+    eckit::Buffer buffer(info.st_size - tailOffset_);
+    char* data = buffer;
+    size_t len = 0;
+    while (len < buffer.size()) {
+        ssize_t n;
+        SYSCALL2((n = ::pread(fd, data + len, buffer.size() - len, off_t(tailOffset_) + len)), tocPath_);
+        if (n == 0) break;
+        len += n;
+    }
+
+    TocRecord* r = &readRecord();
+
+    size_t pos = 0;
+    while (len - pos >= TocRecord::prefixSize) {
+
+        ::memcpy(r, data + pos, TocRecord::prefixSize);
+
+        // A record that is still being appended will be picked up next time
+
+        size_t hdrSize = r->storedHeaderSize();
+        if (len - pos < hdrSize) {
+            break;
+        }
+
+        ::memcpy(r, data + pos, hdrSize);
+
+        size_t size = r->storedSize();
+        ASSERT(size >= hdrSize && size <= sizeof(TocRecord));
+
+        if (len - pos < size) {
+            break;
+        }
+
+        ::memcpy(r, data + pos, size);
+        r->unpack();
+        serialisationVersion_.check(r->header_.serialisationVersion_, true);
+
+        pos += size;
+        tailOffset_ += size;
+
+        visitor(*r);
+    }
+}
+
+bool TocHandler::refreshIndexes(TocIndexUpdate& update) const {
+
+    update = TocIndexUpdate();
+
+    // If the TOC has been replaced (or truncated), then we cannot follow on from where we got to.
+
+    eckit::Stat::Struct info;
+    if (eckit::Stat::stat(tocPath_.localPath(), &info) != 0 ||
+        info.st_ino != tailInode_ ||
+        info.st_size < off_t(tailOffset_)) {
+
+        eckit::Log::debug<LibFdb5>() << "Reloading all indexes from TOC " << tocPath_ << std::endl;
+
+        resetTocCache();
+
+        std::vector<Key> remapKeys;
+        std::vector<Index> indexes = loadIndexes(false, nullptr, nullptr, &remapKeys);
+
+        ASSERT(remapKeys.size() == indexes.size());
+        update.clearedAll_ = true;
+        for (size_t i = 0; i < indexes.size(); ++i) {
+            update.added_.emplace_back(indexes[i], remapKeys[i]);
+        }
+        return true;
+    }
+
+    // Indexes found in this refresh, in the order they are found
+
+    std::vector<std::pair<Index, Key>> added;
+    std::vector<std::pair<PathName, Offset>> addedIds;
+
+    auto addIndex = [&](TocRecord& r, const TocHandler& handler, TailSubToc* subToc) {
+
+        eckit::MemoryStream s(&r.payload_[0], r.maxPayloadSize);
+        std::string path;
+        off_t offset;
+        std::string type;
+        s >> path;
+        s >> offset;
+        s >> type;
+
+        PathName absPath = handler.directory_ / path;
+        std::pair<PathName, Offset> id(absPath.baseName(), offset);
+        if (maskedEntries_.find(id) != maskedEntries_.end()) {
+            Log::debug<LibFdb5>() << "Index ignored by mask: " << path << ":" << offset << std::endl;
+            return;
+        }
+
+        added.emplace_back(Index(new TocIndex(s, r.header_.serialisationVersion_, handler.directory_, absPath,
+                                              offset, preloadBTree_)),
+                           handler.remapKey_);
+        addedIds.push_back(id);
+        if (subToc) {
+            subToc->indexes_.insert(id);
+        }
+    };
+
+    auto clear = [&](TocRecord& r) {
+
+        eckit::MemoryStream s(&r.payload_[0], r.maxPayloadSize);
+        std::string path;
+        off_t offset;
+        s >> path;
+        s >> offset;
+
+        // For the "*" path, mask EVERYTHING that we have already seen
+
+        if (path == "*") {
+            for (const auto& subToc : tailSubTocs_) {
+                maskedEntries_.emplace(subToc.first, 0);
+            }
+            tailSubTocs_.clear();
+            added.clear();
+            addedIds.clear();
+            update.cleared_.clear();
+            update.clearedAll_ = true;
+            return;
+        }
+
+        std::pair<PathName, Offset> id(PathName(path).baseName(), offset);
+        maskedEntries_.insert(id);
+
+        // Masking a subtoc masks all of the indexes that have been loaded from it
+
+        std::set<std::pair<PathName, Offset>> ids;
+        auto subToc = tailSubTocs_.find(id.first);
+        if (offset == 0 && subToc != tailSubTocs_.end()) {
+            ids = std::move(subToc->second.indexes_);
+            tailSubTocs_.erase(subToc);
+        } else {
+            ids.insert(id);
+        }
+
+        for (size_t i = 0; i < added.size();) {
+            if (ids.find(addedIds[i]) != ids.end()) {
+                added.erase(added.begin() + i);
+                addedIds.erase(addedIds.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+
+        update.cleared_.insert(ids.begin(), ids.end());
+    };
+
+    std::set<PathName> followed;
+
+    auto follow = [&](const PathName& name, TailSubToc& subToc) {
+        followed.insert(name);
+        if (!subToc.handler_) return;
+        subToc.handler_->readTail([&](TocRecord& r) {
+            switch (r.header_.tag_) {
+                case TocRecord::TOC_INIT:
+                    break;
+                case TocRecord::TOC_INDEX:
+                    addIndex(r, *subToc.handler_, &subToc);
+                    break;
+                default:
+                    Log::warning() << "Unexpected entry in sub toc " << subToc.handler_->tocPath_
+                                   << ": " << r << std::endl;
+                    break;
+            }
+        });
+    };
+
+    readTail([&](TocRecord& r) {
+        switch (r.header_.tag_) {
+
+            case TocRecord::TOC_INIT:
+                break;
+
+            case TocRecord::TOC_INDEX:
+                addIndex(r, *this, nullptr);
+                break;
+
+            case TocRecord::TOC_CLEAR:
+                clear(r);
+                break;
+
+            case TocRecord::TOC_SUB_TOC: {
+                eckit::MemoryStream s(&r.payload_[0], r.maxPayloadSize);
+                eckit::PathName path;
+                s >> path;
+                ASSERT(path.path().size() > 0);
+                eckit::PathName absPath;
+                if (path.path()[0] == '/') {
+                    absPath = findRealPath(path);
+                    if (!absPath.exists()) {
+                        absPath = directory_ / path.baseName();
+                    }
+                } else {
+                    absPath = directory_ / path;
+                }
+
+                PathName name = absPath.baseName();
+                if (maskedEntries_.find(std::make_pair(name, Offset(0))) != maskedEntries_.end() ||
+                    tailSubTocs_.find(name) != tailSubTocs_.end()) {
+                    break;
+                }
+                if (!absPath.exists()) {
+                    Log::debug<LibFdb5>() << "SubToc does not exist: " << path << std::endl;
+                    break;
+                }
+
+                eckit::Log::debug<LibFdb5>() << "Following SUB_TOC: " << absPath << " " << parentKey_ << std::endl;
+
+                TailSubToc& subToc(tailSubTocs_[name]);
+                subToc.handler_.reset(new TocHandler(absPath, parentKey_));
+                subToc.handler_->close();
+                subToc.handler_->resetTocCache();
+                follow(name, subToc);
+                break;
+            }
+
+            default:
+                // This is only a warning, as it is legal for later versions of software to add stuff
+                // that is just meaningless in a backwards-compatible sense.
+                Log::warning() << "Unknown TOC entry " << r << " @ " << Here() << std::endl;
+                break;
+        }
+    });
+
+    // And pick up anything appended to the subtocs that we were already following
+
+    for (auto& subToc : tailSubTocs_) {
+        if (followed.find(subToc.first) == followed.end()) {
+            follow(subToc.first, subToc.second);
+        }
+    }
+
+    // As for loadIndexes, the last index takes precedence
+
+    update.added_.assign(added.rbegin(), added.rend());
+
+    return update.clearedAll_ || !update.cleared_.empty() || !update.added_.empty();
+}
+
 const eckit::PathName &TocHandler::tocPath() const {
     return tocPath_;
 }
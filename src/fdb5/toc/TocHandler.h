@@ -14,8 +14,11 @@
 #ifndef fdb5_TocHandler_H
 #define fdb5_TocHandler_H
 
+#include <functional>
 #include <map>
 #include <memory>
+#include <set>
+#include <vector>
 
 #include "eckit/filesystem/PathName.h"
 #include "eckit/filesystem/URI.h"
@@ -26,6 +29,9 @@
 #include "fdb5/config/Config.h"
 #include "fdb5/database/DbStats.h"
 #include "fdb5/database/DB.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/io/MappedFile.h"
+#include "fdb5/toc/TocCatalogueCache.h"
 #include "fdb5/toc/TocCommon.h"
 #include "fdb5/toc/TocRecord.h"
 #include "fdb5/toc/TocSerialisationVersion.h"
@@ -93,6 +99,19 @@ private:
 
 //-----------------------------------------------------------------------------
 
+/// The changes to the visible indexes since they were last loaded or refreshed (see TocHandler::refreshIndexes)
+
+struct TocIndexUpdate {
+
+    TocIndexUpdate() : clearedAll_(false) {}
+
+    std::vector<std::pair<Index, Key>> added_;                      ///< new indexes and their remap keys, newest first
+    std::set<std::pair<eckit::PathName, eckit::Offset>> cleared_;  ///< (file name, offset) of indexes now masked
+    bool clearedAll_;                                               ///< all previously visible indexes are masked
+};
+
+//-----------------------------------------------------------------------------
+
 class TocHandler : public TocCommon, private eckit::NonCopyable {
 
 public: // typedefs
@@ -119,6 +138,8 @@ public: // methods
     void writeClearAllRecord();
     void writeSubTocRecord(const TocHandler& subToc);
     void writeIndexRecord(const Index &);
+    /// Write the records of several indexes with a single append (and sync) of the TOC
+    void writeIndexRecords(const std::vector<Index>& indexes);
     void writeSubTocMaskRecord(const TocHandler& subToc);
 
     void reconsolidateIndexesAndTocs();
@@ -133,6 +154,12 @@ public: // methods
                                    std::vector<bool>* indexInSubtoc = nullptr,
                                    std::vector<Key>* remapKeys = nullptr) const;
 
+    /// Follow the TOC incrementally. Only the records appended since the indexes were last loaded (or refreshed)
+    /// are read, including those appended to any live subtocs. If the TOC has been replaced (e.g. by
+    /// reconsolidation) the indexes are reloaded in full, and all previously loaded indexes are cleared.
+    /// @returns true if the visible indexes have changed
+    bool refreshIndexes(TocIndexUpdate& update) const;
+
     Key databaseKey();
     size_t numberOfRecords() const;
 
@@ -217,6 +244,9 @@ private: // methods
 
     void append(TocRecord &r, size_t payloadSize);
 
+    /// The sub toc that index records are written to, created (and referenced from this toc) on first use
+    TocHandler& subTocForWrite();
+
     // hideSubTocEntries=true returns entries as though only one toc existed (i.e. to hide
     // the mechanism of subtocs).
     // readMasked=true will walk subtocs and read indexes even if they are masked. This is
@@ -226,11 +256,28 @@ private: // methods
 
     bool readNextInternal(TocRecord &r) const;
 
+    /// The record that indexes are read into, allocated once for the lifetime of the handler
+    TocRecord& readRecord() const;
+
+    /// Visit the complete records appended to the TOC file beyond tailOffset_, and advance past them
+    void readTail(const std::function<void(TocRecord&)>& visitor) const;
+
+    /// Retain the exhausted subTocRead_, so that it can be followed by refreshIndexes
+    void retainTailSubToc() const;
+
     std::string userName(long) const;
 
     static size_t recordRoundSize();
 
     void dumpTocCache() const;
+    void resetTocCache() const;
+
+private: // types
+
+    struct TailSubToc {
+        std::unique_ptr<TocHandler> handler_;
+        std::set<std::pair<eckit::PathName, eckit::Offset>> indexes_;  ///< indexes loaded from this subtoc
+    };
 
 private: // members
 
@@ -251,16 +298,25 @@ private: // members
 
     mutable TocCopyWatcher tocReadStats_;
     mutable std::unique_ptr<eckit::MemoryHandle> cachedToc_; ///< this is only for read path
+    mutable TocCatalogueCache::TocData sharedToc_; ///< backs cachedToc_ if the process-wide cache is in use
+    mutable std::unique_ptr<MappedFile> mappedToc_; ///< backs cachedToc_ if reading TOCs through mmap
 
     /// The sub toc is initialised in the read or write pathways for maintaining state.
     mutable std::unique_ptr<TocHandler> subTocRead_;
     mutable std::unique_ptr<TocHandler> subTocWrite_;
+    mutable std::unique_ptr<TocRecord> readRecord_;
     mutable size_t count_;
 
     mutable std::set<std::pair<eckit::PathName, eckit::Offset>> maskedEntries_;
 
     mutable bool enumeratedMaskedEntries_;
     mutable bool writeMode_;
+
+    // State for following the TOC incrementally (see refreshIndexes)
+    mutable eckit::Offset tailOffset_;
+    mutable ino_t tailInode_;
+    mutable bool trackTail_;
+    mutable std::map<eckit::PathName, TailSubToc> tailSubTocs_; ///< live subtocs, by file name
 };
 
 
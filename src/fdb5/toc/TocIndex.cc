@@ -8,12 +8,17 @@
  * does it submit to any jurisdiction.
  */
 
+#include <algorithm>
+
+#include "eckit/config/Resource.h"
 #include "eckit/log/BigNum.h"
+#include "eckit/serialisation/Stream.h"
 
 #include "fdb5/LibFdb5.h"
 #include "fdb5/toc/TocStats.h"
 #include "fdb5/toc/TocIndex.h"
 #include "fdb5/toc/BTreeIndex.h"
+#include "fdb5/toc/TocCatalogueCache.h"
 #include "fdb5/toc/FieldRef.h"
 #include "fdb5/toc/TocFieldLocation.h"
 
@@ -66,6 +71,10 @@ TocIndex::TocIndex(eckit::Stream &s, const int version, const eckit::PathName &d
     mode_(TocIndex::READ),
     location_(path, offset),
     preloadBTree_(preloadBTree) {
+
+    if (version >= 4) {
+        decodeFilter(s);
+    }
 }
 
 TocIndex::~TocIndex() {
@@ -75,6 +84,71 @@ TocIndex::~TocIndex() {
 void TocIndex::encode(eckit::Stream& s, const int version) const {
     files_.encode(s);
     IndexBase::encode(s, version);
+    if (version >= 4) {
+        encodeFilter(s);
+    }
+}
+
+void TocIndex::encodeFilter(eckit::Stream& s) const {
+
+    static size_t bitsPerEntry = eckit::Resource<size_t>("fdbIndexBloomBits;$FDB_INDEX_BLOOM_BITS", 10);
+
+    // In write mode, build the filter over the keys added to this btree. Otherwise pass on the
+    // filter that was read from the TOC (which may be empty).
+
+    BloomFilter filter(filter_);
+    if (mode_ == TocIndex::WRITE) {
+        filter = BloomFilter();
+        if (bitsPerEntry > 0 && !keyHashes_.empty()) {
+            std::vector<uint64_t> hashes(keyHashes_);
+            std::sort(hashes.begin(), hashes.end());
+            hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+            filter = BloomFilter(hashes.size(), bitsPerEntry);
+            for (uint64_t h : hashes) {
+                filter.insert(h);
+            }
+        }
+    }
+
+    s.startObject();
+    s << "hashes" << filter.hashes();
+    s << "bits" << std::string(static_cast<const char*>(filter.data()), filter.bytes());
+    s.endObject();
+}
+
+void TocIndex::decodeFilter(eckit::Stream& s) {
+
+    size_t hashes = 0;
+    std::string bits;
+
+    ASSERT(s.next());
+    std::string k;
+    while (!s.endObjectFound()) {
+        s >> k;
+        if (k == "hashes") {
+            s >> hashes;
+        } else if (k == "bits") {
+            s >> bits;
+        } else {
+            throw eckit::SeriousBug("TocIndex filter de-serialization error: " + k + " field is not recognized");
+        }
+    }
+
+    if (!bits.empty()) {
+        ASSERT(hashes > 0);
+        filter_ = BloomFilter(bits.data(), bits.size(), hashes);
+    }
+}
+
+bool TocIndex::mayContain(const Key& key) const {
+
+    if (!IndexBase::mayContain(key)) return false;
+
+    // The axes only describe the values of each keyword independently. For indexes sharing the
+    // same axes (e.g. one per step), the filter rejects the combinations that are not present.
+
+    return filter_.mayContain(key.valuesToString());
 }
 
 
@@ -96,8 +170,20 @@ bool TocIndex::get(const Key &key, const Key &remapKey, Field &field) const {
 void TocIndex::open() {
     if (!btree_) {
         eckit::Log::debug<LibFdb5>() << "Opening " << *this << std::endl;
-        btree_.reset(BTreeIndexFactory::build(type_, location_.path_, mode_ == TocIndex::READ, location_.offset_));
-        if (mode_ == TocIndex::READ && preloadBTree_) btree_->preload();
+        TocCatalogueCache& cache(TocCatalogueCache::instance());
+        if (mode_ == TocIndex::READ && cache.enabled()) {
+            // The shared cache holds the entire (preloaded) btree contents
+            btree_.reset(cache.index(type_, location_.path_, location_.offset_));
+        } else {
+            btree_.reset(BTreeIndexFactory::build(type_, location_.path_, mode_ == TocIndex::READ, location_.offset_));
+            if (mode_ == TocIndex::READ && preloadBTree_) {
+                if (BTreeIndex::pageCachePreload(type_)) {
+                    btree_->readAhead();
+                } else {
+                    btree_->preload();
+                }
+            }
+        }
     }
 }
 
@@ -107,6 +193,7 @@ void TocIndex::reopen() {
     // Create a new btree at the end of this one
 
     location_.offset_ = location_.path_.size();
+    keyHashes_.clear();
 
     // The axes object must be reset at this point, as the TocIndex object is no longer referring
     // to the same region in memory. (i.e. the index is still associated with the same metadata
@@ -130,8 +217,11 @@ void TocIndex::add(const Key &key, const Field &field) {
 
     FieldRef ref(files_, field);
 
+    const std::string fingerprint(key.valuesToString());
+
     //  bool replace =
-    btree_->set(key.valuesToString(), ref); // returns true if replace, false if new insert
+    btree_->set(fingerprint, ref); // returns true if replace, false if new insert
+    keyHashes_.push_back(BloomFilter::hash(fingerprint));
 
     dirty_ = true;
 
@@ -26,6 +26,7 @@
 
 #include "fdb5/database/Index.h"
 #include "fdb5/database/UriStore.h"
+#include "fdb5/toc/BloomFilter.h"
 #include "fdb5/toc/TocIndexLocation.h"
 
 namespace fdb5 {
@@ -101,6 +102,7 @@ private: // methods
     void add( const Key &key, const Field &field ) override;
     void flush() override;
     void encode(eckit::Stream& s, const int version) const override;
+    bool mayContain(const Key& key) const override;
     void entries(EntryVisitor& visitor) const override;
 
     void print( std::ostream &out ) const override;
@@ -108,6 +110,9 @@ private: // methods
 
     IndexStats statistics() const override;
 
+    void encodeFilter(eckit::Stream& s) const;
+    void decodeFilter(eckit::Stream& s);
+
 private: // members
 
     std::unique_ptr<BTreeIndex>  btree_;
@@ -122,6 +127,13 @@ private: // members
 
     // In read-only mode, optimise (e.g. for pgen) by greedily reading entire btree
     bool preloadBTree_;
+
+    /// Filter of the keys in the btree, as persisted in the TOC (empty if not available)
+    BloomFilter filter_;
+
+    /// In write mode, the hashes of the keys added since the index was (re)opened. The filter is
+    /// only sized and built when the index is encoded, as the number of entries is then known.
+    std::vector<uint64_t> keyHashes_;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -14,10 +14,14 @@
 #include "fdb5/fdb5_version.h"
 #include "fdb5/LibFdb5.h"
 
+#include <cstddef>
+#include <cstring>
 #include <iomanip>
 
 #include "TocRecord.h"
 
+#include "eckit/exception/Exceptions.h"
+#include "eckit/maths/Functions.h"
 #include "eckit/memory/Zero.h"
 #include "eckit/log/TimeStamp.h"
 #include "eckit/log/Log.h"
@@ -27,6 +31,37 @@ namespace fdb5 {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+namespace {
+
+/// CRC-32 (IEEE 802.3)
+
+uint32_t crc32(const void* data, size_t length) {
+
+    static const struct Table {
+        Table() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) {
+                    c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+                }
+                values[i] = c;
+            }
+        }
+        uint32_t values[256];
+    } table;
+
+    uint32_t crc = 0xffffffff;
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < length; ++i) {
+        crc = table.values[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return crc ^ 0xffffffff;
+}
+
+}  // namespace
+
+//----------------------------------------------------------------------------------------------------------------------
+
 TocRecord::Header::Header(unsigned int serialisationVersion, unsigned char tag):
     tag_(tag) {
 
@@ -51,7 +86,109 @@ TocRecord::Header::Header(unsigned int serialisationVersion, unsigned char tag):
 //----------------------------------------------------------------------------------------------------------------------
 
 TocRecord::TocRecord(unsigned int serialisationVersion, unsigned char tag):
-    header_(serialisationVersion, tag) {}
+    header_(serialisationVersion, tag) {
+
+    static_assert(offsetof(TocRecord, payload_) == sizeof(Header), "TocRecord payload must follow the header");
+    static_assert(offsetof(Header, serialisationVersion_) + sizeof(unsigned int) == prefixSize,
+                  "TocRecord prefix must contain the serialisation version");
+    static_assert(offsetof(CompactHeader, serialisationVersion_) + sizeof(unsigned int) == prefixSize,
+                  "Compact TocRecord prefix must contain the serialisation version");
+}
+
+size_t TocRecord::storedHeaderSize() const {
+    return compact(header_.serialisationVersion_) ? sizeof(CompactHeader) : sizeof(Header);
+}
+
+size_t TocRecord::storedSize() const {
+
+    if (!compact(header_.serialisationVersion_)) {
+        return header_.size_;
+    }
+
+    CompactHeader hdr;
+    ::memcpy(&hdr, this, sizeof(hdr));
+    return hdr.size_;
+}
+
+size_t TocRecord::pack(size_t payloadSize) {
+
+    ASSERT(compact(header_.serialisationVersion_));
+    ASSERT(payloadSize <= maxPayloadSize);
+
+    std::string host(header_.hostname_.asString());
+    host = host.substr(0, host.find('\0'));
+    ASSERT(host.size() < 256);
+
+    CompactHeader hdr;
+    eckit::zero(hdr);
+    hdr.tag_                  = header_.tag_;
+    hdr.hostnameLength_       = host.size();
+    hdr.serialisationVersion_ = header_.serialisationVersion_;
+    hdr.fdbVersion_           = header_.fdbVersion_;
+    hdr.usec_                 = header_.timestamp_.tv_usec;
+    hdr.sec_                  = header_.timestamp_.tv_sec;
+    hdr.pid_                  = header_.pid_;
+    hdr.uid_                  = header_.uid_;
+
+    // Keep records 8-byte aligned, so that they may be built one after another in a block (see appendBlock)
+
+    size_t size = eckit::round(sizeof(CompactHeader) + host.size() + payloadSize, 8);
+    size_t padding = size - sizeof(CompactHeader) - host.size() - payloadSize;
+    ASSERT(size <= sizeof(TocRecord));
+    hdr.size_ = size;
+
+    // n.b. the packed record overlaps the header of the unpacked one, which has been copied above
+
+    char* p = reinterpret_cast<char*>(this);
+    char* body = p + sizeof(CompactHeader);
+
+    ::memmove(body + host.size(), payload_, payloadSize);
+    ::memcpy(body, host.data(), host.size());
+    ::memset(body + host.size() + payloadSize, 0, padding);
+    hdr.checksum_ = crc32(body, host.size() + payloadSize + padding);
+    ::memcpy(p, &hdr, sizeof(hdr));
+
+    return size;
+}
+
+void TocRecord::unpack() {
+
+    if (!compact(header_.serialisationVersion_)) {
+        return;
+    }
+
+    const char* p = reinterpret_cast<const char*>(this);
+    const char* body = p + sizeof(CompactHeader);
+
+    CompactHeader hdr;
+    ::memcpy(&hdr, p, sizeof(hdr));
+
+    if (hdr.size_ < sizeof(CompactHeader) + hdr.hostnameLength_ || hdr.size_ > sizeof(TocRecord)) {
+        throw eckit::SeriousBug("Corrupt TOC record: bad size", Here());
+    }
+
+    // n.b. the payload includes the padding, which is zeroed and covered by the checksum
+
+    size_t payloadSize = hdr.size_ - sizeof(CompactHeader) - hdr.hostnameLength_;
+
+    if (crc32(body, hdr.hostnameLength_ + payloadSize) != hdr.checksum_) {
+        throw eckit::SeriousBug("Corrupt TOC record: checksum mismatch", Here());
+    }
+
+    std::string host(body, hdr.hostnameLength_);
+    ::memmove(payload_, body + hdr.hostnameLength_, payloadSize);
+
+    eckit::zero(header_);
+    header_.tag_                  = hdr.tag_;
+    header_.serialisationVersion_ = hdr.serialisationVersion_;
+    header_.fdbVersion_           = hdr.fdbVersion_;
+    header_.timestamp_.tv_sec     = hdr.sec_;
+    header_.timestamp_.tv_usec    = hdr.usec_;
+    header_.pid_                  = hdr.pid_;
+    header_.uid_                  = hdr.uid_;
+    header_.hostname_             = host;
+    header_.size_                 = hdr.size_;
+}
 
 void TocRecord::dump(std::ostream& out, bool simple) const {
 
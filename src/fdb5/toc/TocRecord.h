@@ -18,6 +18,8 @@
 #include <time.h>
 #include <sys/time.h>
 
+#include <cstdint>
+
 #include "eckit/types/FixedString.h"
 #include "eckit/filesystem/PathName.h"
 
@@ -67,6 +69,44 @@ struct TocRecord {
 
     static const size_t headerSize = sizeof(Header);
 
+    /// From serialisation version 5, records are stored in a compact form: a small fixed header, the
+    /// hostname and the payload, tightly packed and rounded only to 8 bytes. The payload and hostname
+    /// are checksummed.
+    ///
+    /// The tag and serialisation version occupy the same (first prefixSize) bytes in both forms, so
+    /// records of either form can be read from the same TOC.
+
+    struct CompactHeader {
+        unsigned char          tag_;                    ///<  (1)  tag identifying the TocRecord type
+        unsigned char          hostnameLength_;         ///<  (1)  length of the hostname that follows the header
+        unsigned char          spare_[2];               ///<  (2)  padding
+        unsigned int           serialisationVersion_;   ///<  (4)  serialisation version of the TocRecord
+        uint32_t               size_;                   ///<  (4)  record size, including header and padding
+        uint32_t               checksum_;               ///<  (4)  CRC-32 of the hostname and payload
+        uint32_t               fdbVersion_;             ///<  (4)  version of FDB writing this entry
+        uint32_t               usec_;                   ///<  (4)  date & time of entry (microseconds)
+        int64_t                sec_;                    ///<  (8)  date & time of entry (in Unix seconds)
+        uint32_t               pid_;                    ///<  (4)  process PID
+        uint32_t               uid_;                    ///<  (4)  user ID
+    };
+
+    static const size_t prefixSize = 8;
+
+    static bool compact(unsigned int serialisationVersion) { return serialisationVersion >= 5; }
+
+    /// Given the first prefixSize bytes of a record read into this one, the size of its header
+    size_t storedHeaderSize() const;
+
+    /// Given the header of a record read into this one, the size of the whole record as stored
+    size_t storedSize() const;
+
+    /// Convert a record with the given payload size, in place, into the compact form to be written.
+    /// The header of the record is no longer usable. @returns the size to write.
+    size_t pack(size_t payloadSize);
+
+    /// Convert a record that has been read, in place, from the form in which it was stored
+    void unpack();
+
     void dump(std::ostream& out, bool simple = false) const;
 
     void print(std::ostream &out) const;
@@ -20,6 +20,8 @@ namespace fdb5 {
 
 /// Version 2: TOC format originally used in first public release
 /// Version 3: TOC serialisation format includes Stream objects
+/// Version 4: As version 3, with a Bloom filter of the entries of each index
+/// Version 5: As version 4, with compact, checksummed TOC records
 class TocSerialisationVersion {
 
 public:
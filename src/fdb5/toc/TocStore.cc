@@ -11,6 +11,10 @@
 #include <dirent.h>
 #include <fcntl.h>
 
+#include <sstream>
+
+#include "fdb5/fdb5_config.h"
+
 #include "eckit/log/Timer.h"
 
 #include "eckit/config/Resource.h"
@@ -25,8 +29,14 @@
 #include "fdb5/toc/TocPurgeVisitor.h"
 #include "fdb5/toc/TocStats.h"
 #include "fdb5/toc/TocStore.h"
+#include "fdb5/io/DirectFileHandle.h"
 #include "fdb5/io/FDBFileHandle.h"
 #include "fdb5/io/LustreFileHandle.h"
+#include "fdb5/io/WriteBufferPool.h"
+
+#if defined(fdb5_HAVE_URING)
+#include "fdb5/io/UringFileHandle.h"
+#endif
 
 using namespace eckit;
 
@@ -131,6 +141,7 @@ eckit::DataHandle *TocStore::createFileHandle(const eckit::PathName &path) {
 
     eckit::Log::debug<LibFdb5>() << "Creating FDBFileHandle to " << path
                                  << " with buffer of " << eckit::Bytes(sizeBuffer)
+                                 << " from a shared budget of " << eckit::Bytes(WriteBufferPool::instance().budget())
                                  << std::endl;
 
     return new FDBFileHandle(path, sizeBuffer);
@@ -154,16 +165,78 @@ eckit::DataHandle *TocStore::createAsyncHandle(const eckit::PathName &path) {
     return new eckit::AIOHandle(path, nbBuffers, sizeBuffer);
 }
 
+eckit::DataHandle *TocStore::createDirectHandle(const eckit::PathName &path) {
+
+    static size_t sizeBuffer = eckit::Resource<unsigned long>("fdbDirectIOBufferSize;$FDB_DIRECT_IO_BUFFER_SIZE", 16 * 1024 * 1024);
+
+    if(stripeLustre()) {
+
+        eckit::Log::debug<LibFdb5>() << "Creating LustreFileHandle<DirectFileHandle> to " << path
+                                     << " with buffer of " << eckit::Bytes(sizeBuffer)
+                                     << std::endl;
+
+        return new LustreFileHandle<DirectFileHandle>(path, sizeBuffer, stripeDataLustreSettings());
+    }
+
+    eckit::Log::debug<LibFdb5>() << "Creating DirectFileHandle to " << path
+                                 << " with buffer of " << eckit::Bytes(sizeBuffer)
+                                 << std::endl;
+
+    return new DirectFileHandle(path, sizeBuffer);
+}
+
+eckit::DataHandle *TocStore::createUringHandle(const eckit::PathName &path) {
+
+#if defined(fdb5_HAVE_URING)
+    static size_t nbBuffers  = eckit::Resource<unsigned long>("fdbUringWriteBuffers;$FDB_URING_WRITE_BUFFERS", 4);
+    static size_t sizeBuffer = eckit::Resource<unsigned long>("fdbUringWriteBufferSize;$FDB_URING_WRITE_BUFFER_SIZE", 16 * 1024 * 1024);
+
+    if(stripeLustre()) {
+
+        eckit::Log::debug<LibFdb5>() << "Creating LustreFileHandle<UringFileHandle> to " << path
+                                     << " with " << nbBuffers
+                                     << " buffer each with " << eckit::Bytes(sizeBuffer)
+                                     << std::endl;
+
+        return new LustreFileHandle<UringFileHandle>(path, nbBuffers, sizeBuffer, stripeDataLustreSettings());
+    }
+
+    return new UringFileHandle(path, nbBuffers, sizeBuffer);
+#else
+    throw eckit::UserError("fdbUringWrite is set, but FDB was built without io_uring support", Here());
+#endif
+}
+
 eckit::DataHandle *TocStore::createDataHandle(const eckit::PathName &path) {
 
     static bool fdbWriteToNull = eckit::Resource<bool>("fdbWriteToNull;$FDB_WRITE_TO_NULL", false);
     if(fdbWriteToNull)
         return new eckit::EmptyHandle();
 
+    // Each of these selects how data files are written. Only one of them can be used.
+
     static bool fdbAsyncWrite = eckit::Resource<bool>("fdbAsyncWrite;$FDB_ASYNC_WRITE", false);
+    static bool fdbUringWrite = eckit::Resource<bool>("fdbUringWrite;$FDB_URING_WRITE", false);
+    static bool fdbDirectIO = eckit::Resource<bool>("fdbDirectIO;$FDB_DIRECT_IO", false);
+
+    if(int(fdbAsyncWrite) + int(fdbUringWrite) + int(fdbDirectIO) > 1) {
+        std::ostringstream msg;
+        msg << "Only one of fdbAsyncWrite, fdbUringWrite and fdbDirectIO can be set, but these are set:"
+            << (fdbAsyncWrite ? " fdbAsyncWrite" : "")
+            << (fdbUringWrite ? " fdbUringWrite" : "")
+            << (fdbDirectIO ? " fdbDirectIO" : "");
+        throw eckit::UserError(msg.str(), Here());
+    }
+
     if(fdbAsyncWrite)
         return createAsyncHandle(path);
 
+    if(fdbUringWrite)
+        return createUringHandle(path);
+
+    if(fdbDirectIO)
+        return createDirectHandle(path);
+
     return createFileHandle(path);
 }
 
@@ -65,6 +65,8 @@ protected: // methods
     void closeDataHandles();
     eckit::DataHandle *createFileHandle(const eckit::PathName &path);
     eckit::DataHandle *createAsyncHandle(const eckit::PathName &path);
+    eckit::DataHandle *createUringHandle(const eckit::PathName &path);
+    eckit::DataHandle *createDirectHandle(const eckit::PathName &path);
     eckit::DataHandle *createDataHandle(const eckit::PathName &path);
     eckit::DataHandle& getDataHandle( const eckit::PathName &path );
     eckit::PathName generateDataPath(const Key &key) const;
@@ -0,0 +1,126 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   fdb-compact.cc
+/// @date   Oct 2026
+
+#include "fdb5/tools/FDBVisitTool.h"
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+
+#include "eckit/option/CmdArgs.h"
+#include "eckit/option/SimpleOption.h"
+
+
+using namespace eckit;
+using namespace eckit::option;
+
+namespace fdb5 {
+namespace tools {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Rewrites the reachable fields of data files that are mostly unreachable (e.g. following re-archiving) into new
+/// data files, and replaces the indexes that refer to them. The old data files are left for fdb-purge. The
+/// database remains available for reading and archiving throughout.
+
+class FDBCompact : public FDBVisitTool {
+
+public: // methods
+
+    FDBCompact(int argc, char **argv) :
+        FDBVisitTool(argc, argv, "class,expver,stream,date,time"),
+        doit_(false),
+        porcelain_(false),
+        ignoreNoData_(false) {
+
+        options_.push_back(new SimpleOption<bool>("doit", "Rewrite the data and indexes"));
+        options_.push_back(new SimpleOption<bool>("ignore-no-data", "No data available to compact is not an error"));
+        options_.push_back(new SimpleOption<bool>("porcelain", "List only the compacted files"));
+    }
+
+private: // methods
+
+    virtual void init(const CmdArgs &args);
+    virtual void execute(const CmdArgs& args);
+    virtual void finish(const CmdArgs &args);
+
+    bool doit_;
+    bool porcelain_;
+    bool ignoreNoData_;
+};
+
+
+void FDBCompact::init(const CmdArgs& args) {
+    FDBVisitTool::init(args);
+    doit_ = args.getBool("doit", false);
+    porcelain_ = args.getBool("porcelain", false);
+    ignoreNoData_ = args.getBool("ignore-no-data", false);
+}
+
+void FDBCompact::execute(const CmdArgs& args) {
+
+    FDB fdb(config(args));
+
+    for (const FDBToolRequest& request : requests()) {
+
+        if (!porcelain_) {
+            Log::info() << "Compacting for request" << std::endl;
+            request.print(Log::info());
+            Log::info() << std::endl;
+        }
+
+        auto compactIterator = fdb.compact(request, doit_, porcelain_);
+
+        size_t count = 0;
+        CompactElement elem;
+        while (compactIterator.next(elem)) {
+            Log::info() << elem << std::endl;
+            count++;
+        }
+
+        if (count == 0 && fail() && !ignoreNoData_) {
+            std::stringstream ss;
+            ss << "No FDB entries found for: " << request << std::endl;
+            throw FDBToolException(ss.str());
+        }
+    }
+}
+
+
+void FDBCompact::finish(const CmdArgs&) {
+
+    if (porcelain_) {
+        return;
+    }
+
+    if (!doit_) {
+        Log::info() << std::endl
+                    << "Rerun command with --doit flag to compact the data files"
+                    << std::endl
+                    << std::endl;
+    } else {
+        Log::info() << std::endl
+                    << "Run fdb-purge to remove the data and index files that are no longer referenced"
+                    << std::endl
+                    << std::endl;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+} // namespace tools
+} // namespace fdb5
+
+
+int main(int argc, char **argv) {
+    fdb5::tools::FDBCompact app(argc, argv);
+    return app.start();
+}
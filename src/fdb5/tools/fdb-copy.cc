@@ -8,10 +8,20 @@
  * does it submit to any jurisdiction.
  */
 
+#include <atomic>
 #include <fstream>
+#include <iterator>
 #include <memory>
+#include <thread>
+#include <vector>
 
+#include "eckit/container/Queue.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/Buffer.h"
+#include "eckit/io/DataHandle.h"
 #include "eckit/io/FileHandle.h"
+#include "eckit/log/Bytes.h"
+#include "eckit/log/Timer.h"
 #include "eckit/option/CmdArgs.h"
 #include "eckit/filesystem/PathName.h"
 
@@ -20,6 +30,7 @@
 #include "metkit/mars/MarsExpension.h"
 
 #include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
 #include "fdb5/message/MessageArchiver.h"
 #include "fdb5/io/HandleGatherer.h"
 #include "fdb5/tools/FDBTool.h"
@@ -37,11 +48,14 @@ class FDBCopy : public fdb5::FDBTool {
         options_.push_back(new SimpleOption<bool>("sort", "Sort fields according to location on input storage"));
         options_.push_back(new SimpleOption<eckit::PathName>("to", "Configuration of FDB to write to"));
         options_.push_back(new SimpleOption<eckit::PathName>("from", "Configuration of FDB to read from"));
+        options_.push_back(new SimpleOption<bool>("no-decode", "Copy the fields under the keys listed by the source FDB, without decoding them. "
+                                                               "The source and destination must share a schema"));
+        options_.push_back(new SimpleOption<long>("readers", "Number of fields read in parallel with --no-decode (default 4)"));
     }
 };
 
 void FDBCopy::usage(const std::string &tool) const {
-    eckit::Log::info() << std::endl << "Usage: " << tool << " --from <config> --to <config> <request1>" << std::endl;
+    eckit::Log::info() << std::endl << "Usage: " << tool << " --from <config> --to <config> [--no-decode [--readers=<n>]] <request1>" << std::endl;
     fdb5::FDBTool::usage(tool);
 }
 
@@ -77,6 +91,135 @@ static std::vector<metkit::mars::MarsRequest> readRequest(const CmdArgs& args) {
     return requests;
 }
 
+static void checkSameSchema(const fdb5::Config& from, const fdb5::Config& to) {
+
+    const eckit::PathName& fromSchema = from.schemaPath();
+    const eckit::PathName& toSchema = to.schemaPath();
+
+    if (fromSchema.sameAs(toSchema)) {
+        return;
+    }
+
+    std::ifstream fromIn(fromSchema.localPath());
+    std::ifstream toIn(toSchema.localPath());
+    std::string fromContents((std::istreambuf_iterator<char>(fromIn)), std::istreambuf_iterator<char>());
+    std::string toContents((std::istreambuf_iterator<char>(toIn)), std::istreambuf_iterator<char>());
+
+    if (fromIn.bad() || toIn.bad() || fromContents != toContents) {
+        std::ostringstream msg;
+        msg << "Copying with --no-decode requires the same schema for source and destination (found "
+            << fromSchema << " and " << toSchema << ")";
+        throw eckit::UserError(msg.str(), Here());
+    }
+}
+
+namespace {
+
+struct RawField {
+    RawField() : data_(0) {}
+    RawField(fdb5::Key&& key, eckit::Buffer&& data) : key_(std::move(key)), data_(std::move(data)) {}
+
+    fdb5::Key key_;
+    eckit::Buffer data_;
+};
+
+}  // namespace
+
+/// Copy the fields as they are stored. The keys are taken from the source listing, so the messages are
+/// never decoded. The listing, the reads and the archival each run in their own thread(s), connected by
+/// bounded queues.
+
+static void copyRaw(const fdb5::Config& readConfig, const fdb5::Config& writeConfig,
+                    const std::vector<metkit::mars::MarsRequest>& requests, size_t readers, bool verbose) {
+
+    ASSERT(readers > 0);
+
+    fdb5::FDB fdbRead(readConfig);
+    fdb5::FDB fdbWrite(writeConfig);
+
+    eckit::Queue<fdb5::ListElement> listed(readers * 16);
+    eckit::Queue<RawField> fields(readers * 4);
+
+    std::vector<std::thread> threads;
+
+    threads.emplace_back([&] {
+        try {
+            for (const auto& request : requests) {
+                eckit::Log::info() << request << std::endl;
+                const bool deduplicate = true;
+                fdb5::ListIterator it = fdbRead.list(fdb5::FDBToolRequest(request), deduplicate);
+                fdb5::ListElement elem;
+                while (it.next(elem)) {
+                    listed.emplace(std::move(elem));
+                }
+            }
+            listed.close();
+        } catch (...) {
+            listed.interrupt(std::current_exception());
+        }
+    });
+
+    std::atomic<size_t> activeReaders(readers);
+
+    for (size_t i = 0; i < readers; ++i) {
+        threads.emplace_back([&] {
+            try {
+                fdb5::ListElement elem;
+                while (listed.pop(elem) != -1) {
+                    size_t length = elem.location().length();
+                    eckit::Buffer data(length);
+
+                    std::unique_ptr<eckit::DataHandle> dh(elem.location().dataHandle());
+                    dh->openForRead();
+                    eckit::AutoClose closer(*dh);
+                    long len = dh->read(data, length);
+                    ASSERT(len == long(length));
+
+                    fields.emplace(elem.combinedKey(), std::move(data));
+                }
+                if (--activeReaders == 0) {
+                    fields.close();
+                }
+            } catch (...) {
+                fields.interrupt(std::current_exception());
+            }
+        });
+    }
+
+    size_t count = 0;
+    eckit::Length total = 0;
+    eckit::Timer timer;
+
+    try {
+        RawField field;
+        while (fields.pop(field) != -1) {
+            if (verbose) {
+                eckit::Log::info() << "Copying " << field.key_ << std::endl;
+            }
+            fdbWrite.archive(field.key_, field.data_, field.data_.size());
+            total += field.data_.size();
+            ++count;
+        }
+        fdbWrite.flush();
+    } catch (...) {
+        std::exception_ptr e = std::current_exception();
+        listed.interrupt(e);
+        fields.interrupt(e);
+        for (std::thread& t : threads) {
+            t.join();
+        }
+        throw;
+    }
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    timer.stop();
+    eckit::Log::info() << "Copied " << count << " fields, " << eckit::Bytes(total) << " in " << timer.elapsed()
+                       << "s (" << eckit::Bytes(total, timer) << ")" << std::endl;
+}
+
 void FDBCopy::execute(const CmdArgs& args) {
 
     bool verbose            = args.getBool("verbose", false);
@@ -98,6 +241,16 @@ void FDBCopy::execute(const CmdArgs& args) {
 
     std::vector<metkit::mars::MarsRequest> requests = readRequest(args);
 
+    if (args.getBool("no-decode", false)) {
+        long readers = args.getLong("readers", 4);
+        if (readers < 1) {
+            throw eckit::UserError("--readers must be at least 1");
+        }
+        checkSameSchema(readConfig, writeConfig);
+        copyRaw(readConfig, writeConfig, requests, readers, verbose);
+        return;
+    }
+
     // std::cout << "REQUESTS: " << std::endl;
     // for (auto r : requests)
     //     std::cout << r << std::endl;
@@ -10,6 +10,7 @@
 
 #include <unordered_set>
 #include <memory>
+#include <vector>
 
 #include "eccodes.h"
 
@@ -18,10 +19,13 @@
 #include "eckit/io/StdFile.h"
 #include "eckit/io/MemoryHandle.h"
 #include "eckit/io/EmptyHandle.h"
+#include "eckit/message/Message.h"
+#include "eckit/message/Reader.h"
 #include "eckit/option/CmdArgs.h"
 #include "eckit/option/SimpleOption.h"
 #include "eckit/option/VectorOption.h"
 
+#include "fdb5/api/FDB.h"
 #include "fdb5/message/MessageArchiver.h"
 #include "fdb5/io/HandleGatherer.h"
 #include "fdb5/tools/FDBTool.h"
@@ -62,6 +66,7 @@ public:
         options_.push_back(new eckit::option::SimpleOption<long>("nlevels", "Number of levels"));
         options_.push_back(new eckit::option::SimpleOption<long>("nparams", "Number of parameters"));
         options_.push_back(new eckit::option::SimpleOption<bool>("verbose", "Print verbose output"));
+        options_.push_back(new eckit::option::SimpleOption<bool>("batch", "Archive each step as a single batch"));
     }
     ~FDBWrite() override {}
 
@@ -70,7 +75,7 @@ private:
 };
 
 void FDBWrite::usage(const std::string &tool) const {
-    eckit::Log::info() << std::endl << "Usage: " << tool << " [--statistics] [--read] --nsteps=<nsteps> --nensembles=<nensembles> --nlevels=<nlevels> --nparams=<nparams> --expver=<expver> <grib_path>" << std::endl;
+    eckit::Log::info() << std::endl << "Usage: " << tool << " [--statistics] [--read] [--batch] --nsteps=<nsteps> --nensembles=<nensembles> --nlevels=<nlevels> --nparams=<nparams> --expver=<expver> <grib_path>" << std::endl;
     fdb5::FDBTool::usage(tool);
 }
 
@@ -116,6 +121,16 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
 
     fdb5::MessageArchiver archiver(fdb5::Key(), false, verbose_, args);
 
+    // In batch mode, the fields of each step are copied, and archived together at the end of the step
+
+    bool batch = args.getBool("batch", false);
+    std::unique_ptr<fdb5::FDB> fdb;
+    if (batch) {
+        fdb.reset(new fdb5::FDB(args));
+    }
+    std::vector<fdb5::ArchiveElement> elements;
+    std::vector<std::vector<char>> messages;
+
     std::string expver = args.getString("expver");
     size = expver.length();
     CODES_CHECK(codes_set_string(handle, "expver", expver.c_str(), &size), 0);
@@ -157,8 +172,16 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
                     gribTimer.stop();
                     elapsed_grib += gribTimer.elapsed();
 
-                    MemoryHandle dh(buffer, size);
-                    archiver.archive(dh);
+                    if (batch) {
+                        messages.emplace_back(buffer, buffer + size);
+                        MemoryHandle dh(messages.back().data(), size);
+                        eckit::message::Reader reader(dh);
+                        eckit::message::Message msg = reader.next();
+                        elements.emplace_back(fdb5::MessageDecoder::messageToKey(msg), messages.back().data(), size);
+                    } else {
+                        MemoryHandle dh(buffer, size);
+                        archiver.archive(dh);
+                    }
                     writeCount++;
                     bytesWritten += size;
 
@@ -168,7 +191,14 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
 
             gribTimer.stop();
             elapsed_grib += gribTimer.elapsed();
-            archiver.flush();
+            if (batch) {
+                fdb->archive(elements);
+                fdb->flush();
+                elements.clear();
+                messages.clear();
+            } else {
+                archiver.flush();
+            }
             gribTimer.start();
         }
     }
@@ -187,6 +217,7 @@ void FDBWrite::executeWrite(const eckit::option::CmdArgs &args) {
     Log::info() << "Writing duration: " << timer.elapsed() - elapsed_grib << std::endl;
     Log::info() << "Total rate: " << double(bytesWritten) / timer.elapsed() << " bytes / s" << std::endl;
     Log::info() << "Total rate: " << double(bytesWritten) / (timer.elapsed() * 1024 * 1024) << " MB / s" << std::endl;
+    Log::info() << "Writing rate: " << double(writeCount) / (timer.elapsed() - elapsed_grib) << " fields / s" << std::endl;
 }
 
 
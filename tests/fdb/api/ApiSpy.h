@@ -21,6 +21,7 @@
 #include <vector>
 #include <tuple>
 
+#include "eckit/exception/Exceptions.h"
 #include "eckit/message/Message.h"
 
 #include "fdb5/api/FDBFactory.h"
@@ -40,7 +41,7 @@ private: // types
     struct Counts {
         Counts() :
             archive(0), inspect(0), list(0), dump(0), status(0), wipe(0),
-            purge(0), stats(0), flush(0), control(0), move(0) {}
+            purge(0), compact(0), stats(0), flush(0), control(0), move(0) {}
         size_t archive;
         size_t inspect;
         size_t list;
@@ -48,6 +49,7 @@ private: // types
         size_t status;
         size_t wipe;
         size_t purge;
+        size_t compact;
         size_t stats;
         size_t flush;
         size_t control;
@@ -72,7 +74,9 @@ public: // methods
 
     using FDBBase::stats;
 
-    ApiSpy(const fdb5::Config& config, const std::string& name) : FDBBase(config, name) {
+    ApiSpy(const fdb5::Config& config, const std::string& name) :
+        FDBBase(config, name),
+        failArchiveAfter_(config.getLong("failArchiveAfter", -1)) {
         knownSpies().push_back(this);
     }
     ~ApiSpy() override {
@@ -81,6 +85,9 @@ public: // methods
 
     void archive(const fdb5::Key& key, const void* data, size_t length) override {
         counts_.archive += 1;
+        if (failArchiveAfter_ >= 0 && archives_.size() >= size_t(failArchiveAfter_)) {
+            throw eckit::WriteError("ApiSpy: archive failure", Here());
+        }
         archives_.push_back(std::make_tuple(key, data, length));
     }
 
@@ -115,6 +122,11 @@ public: // methods
         return fdb5::PurgeIterator(0);
     }
 
+    fdb5::CompactIterator compact(const fdb5::FDBToolRequest& request, bool doit, bool verbose) override {
+        counts_.compact += 1;
+        return fdb5::CompactIterator(0);
+    }
+
     fdb5::StatsIterator stats(const fdb5::FDBToolRequest& request) override {
         counts_.stats += 1;
         return fdb5::StatsIterator(0);
@@ -156,6 +168,8 @@ private: // members
 
     Counts counts_;
 
+    long failArchiveAfter_;   ///< Archives fail once this many have succeeded, unless negative
+
     Archives archives_;
     Retrieves retrieves_;
 };
@@ -102,12 +102,15 @@ CASE( "archives_distributed_according_to_dist" ) {
 
             fdb.archive(k, data.data(), len);
 
-            EXPECT((spy1.counts().archive + spy2.counts().archive + spy3.counts().archive) == (1 + a + (narch * f)));
             EXPECT(spy1.counts().flush + spy2.counts().flush + spy3.counts().flush == flush_count);
         }
 
+        // n.b. the lanes archive asynchronously, and everything queued has been archived once flushed
+
         fdb.flush();
 
+        EXPECT((spy1.counts().archive + spy2.counts().archive + spy3.counts().archive) == (narch * (f + 1)));
+
         EXPECT(spy1.counts().flush + spy2.counts().flush + spy3.counts().flush <= flush_count+3);
 
         flush_count = (spy1.counts().flush + spy2.counts().flush + spy3.counts().flush);
@@ -130,6 +133,70 @@ CASE( "archives_distributed_according_to_dist" ) {
 }
 
 
+CASE( "archives_move_on_from_lanes_that_fail_before_written_to" ) {
+
+    fdb5::Config cfg = defaultConfig();
+    std::vector<LocalConfiguration> lanes = cfg.getSubConfigs("lanes");
+    lanes[0].set("failArchiveAfter", 0);
+    cfg.set("lanes", lanes);
+
+    fdb5::FDB fdb(cfg);
+    EXPECT(ApiSpy::knownSpies().size() == 3);
+    ApiSpy& spy1(*ApiSpy::knownSpies()[0]);
+    ApiSpy& spy2(*ApiSpy::knownSpies()[1]);
+    ApiSpy& spy3(*ApiSpy::knownSpies()[2]);
+
+    const int narch = 20;
+    int data = 0;
+
+    for (int a = 0; a < narch; a++) {
+        fdb5::Key k;
+        k.set("class", "od");
+        k.set("expver", "xxxx");
+        k.set("a", eckit::Translator<int, std::string>()(a));
+        fdb.archive(k, &data, sizeof(data));
+    }
+
+    EXPECT_NO_THROW(fdb.flush());
+
+    // Every field has been archived on one of the remaining lanes
+
+    EXPECT(spy1.archives().empty());
+    EXPECT(spy2.archives().size() + spy3.archives().size() == narch);
+}
+
+
+CASE( "archive_failures_on_dirty_lanes_are_reported_on_flush" ) {
+
+    fdb5::Config cfg = defaultConfig();
+    std::vector<LocalConfiguration> lanes = cfg.getSubConfigs("lanes");
+    for (LocalConfiguration& lane : lanes) {
+        lane.set("failArchiveAfter", 1);
+    }
+    cfg.set("lanes", lanes);
+
+    fdb5::FDB fdb(cfg);
+    EXPECT(ApiSpy::knownSpies().size() == 3);
+
+    // The same field twice goes to the same lane, which fails once it has been written to. The failure
+    // happens in the lane's thread, after archive() has returned, so is reported by the flush.
+
+    fdb5::Key k;
+    k.set("class", "od");
+    k.set("expver", "xxxx");
+    int data = 0;
+
+    fdb.archive(k, &data, sizeof(data));
+    fdb.archive(k, &data, sizeof(data));
+
+    EXPECT_THROWS_AS(fdb.flush(), eckit::Exception);
+
+    // The error is only reported once
+
+    EXPECT_NO_THROW(fdb.flush());
+}
+
+
 CASE( "retrieves_distributed_according_to_dist" ) {
 
     // Build FDB from default config
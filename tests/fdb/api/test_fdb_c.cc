@@ -8,6 +8,7 @@
  * does it submit to any jurisdiction.
  */
 
+#include <memory>
 #include <string.h>
 
 #include "eckit/config/Resource.h"
@@ -336,6 +337,76 @@ CASE( "fdb_c - multiple archive & list" ) {
 }
 #endif
 
+CASE( "fdb_c - batch archive & list" ) {
+
+    fdb_handle_t* fdb;
+    fdb_new_handle(&fdb);
+
+    const char* levels[] = {"300", "400"};
+    const char* files[] = {"x138-300.grib", "x138-400.grib"};
+
+    fdb_key_t* keys[2];
+    const char* data[2];
+    size_t lengths[2];
+    std::vector<std::unique_ptr<eckit::Buffer>> buffers;
+
+    for (size_t i = 0; i < 2; ++i) {
+        fdb_new_key(&keys[i]);
+        fdb_key_add(keys[i], "domain", "g");
+        fdb_key_add(keys[i], "stream", "oper");
+        fdb_key_add(keys[i], "levtype", "pl");
+        fdb_key_add(keys[i], "levelist", levels[i]);
+        fdb_key_add(keys[i], "date", "20191110");
+        fdb_key_add(keys[i], "time", "0000");
+        fdb_key_add(keys[i], "step", "0");
+        fdb_key_add(keys[i], "param", "138");
+        fdb_key_add(keys[i], "class", "rd");
+        fdb_key_add(keys[i], "type", "an");
+        fdb_key_add(keys[i], "expver", "xxxz");
+
+        eckit::PathName grib(files[i]);
+        lengths[i] = grib.size();
+        buffers.emplace_back(new eckit::Buffer(lengths[i]));
+        std::unique_ptr<DataHandle> dh(grib.fileHandle());
+        dh->openForRead();
+        dh->read(*buffers.back(), lengths[i]);
+        dh->close();
+        data[i] = *buffers.back();
+    }
+
+    EXPECT(FDB_SUCCESS == fdb_archive_batch(fdb, keys, data, lengths, 2));
+    EXPECT(FDB_SUCCESS == fdb_flush(fdb));
+
+    fdb_request_t* request;
+    fdb_new_request(&request);
+    fdb_request_add1(request, "domain", "g");
+    fdb_request_add1(request, "stream", "oper");
+    fdb_request_add1(request, "levtype", "pl");
+    fdb_request_add(request, "levelist", levels, 2);
+    fdb_request_add1(request, "date", "20191110");
+    fdb_request_add1(request, "time", "0000");
+    fdb_request_add1(request, "step", "0");
+    fdb_request_add1(request, "param", "138");
+    fdb_request_add1(request, "class", "rd");
+    fdb_request_add1(request, "type", "an");
+    fdb_request_add1(request, "expver", "xxxz");
+
+    fdb_listiterator_t* it;
+    fdb_list(fdb, request, &it, true);
+    size_t count = 0;
+    while (fdb_listiterator_next(it) == FDB_SUCCESS) {
+        ++count;
+    }
+    EXPECT(count == 2);
+    fdb_delete_listiterator(it);
+
+    fdb_delete_request(request);
+    for (size_t i = 0; i < 2; ++i) {
+        fdb_delete_key(keys[i]);
+    }
+    fdb_delete_handle(fdb);
+}
+
 CASE( "fdb_c - retrieve bad request" ) {
 
     fdb_handle_t* fdb;
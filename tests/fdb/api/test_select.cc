@@ -149,6 +149,46 @@ CASE( "archives_distributed_according_to_select" ) {
 }
 
 
+CASE( "flushes_asynchronously_according_to_select" ) {
+
+    fdb5::FDB fdb(defaultConfig());
+    EXPECT(ApiSpy::knownSpies().size() == 3);
+    ApiSpy& spy_od(*ApiSpy::knownSpies()[0]);
+    ApiSpy& spy_rd1(*ApiSpy::knownSpies()[1]);
+    ApiSpy& spy_rd2(*ApiSpy::knownSpies()[2]);
+
+    // Nothing to flush until dirty
+
+    fdb.flushAsync().get();
+
+    EXPECT(spy_od.counts().flush == 0);
+    EXPECT(spy_rd1.counts().flush == 0);
+    EXPECT(spy_rd2.counts().flush == 0);
+
+    fdb5::Key k;
+    k.set("class", "od");
+    k.set("expver", "xxxx");
+
+    fdb.archive(k, (const void*)0x1234, 1234);
+
+    std::shared_future<void> flushed = fdb.flushAsync();
+    flushed.get();
+
+    EXPECT(spy_od.counts().flush == 1);
+    EXPECT(spy_rd1.counts().flush == 0);
+    EXPECT(spy_rd2.counts().flush == 0);
+
+    // The FDB is clean, but a subsequent flush still waits for the background flushes
+
+    EXPECT(!fdb.dirty());
+    fdb.flush();
+
+    EXPECT(spy_od.counts().flush == 2);
+    EXPECT(spy_rd1.counts().flush == 0);
+    EXPECT(spy_rd2.counts().flush == 0);
+}
+
+
 CASE( "retrieves_distributed_according_to_select" ) {
 
     // Build FDB from default config
@@ -0,0 +1,265 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_archive_workers.cc
+/// @date   Oct 2026
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/runtime/Main.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Archiver.h"
+#include "fdb5/database/Key.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static fdb5::Config workerConfig() {
+    fdb5::Config config = fdb5::Config().expandConfig();
+    config.set("archiveWorkers", true);
+    return config;
+}
+
+static Key fieldKey(const std::string& expver, const std::string& type) {
+    Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("date", "20200401");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("type", type);
+    key.set("levtype", "sfc");
+    key.set("step", "0");
+    key.set("param", "130");
+    return key;
+}
+
+static void archive(Archiver& archiver, const std::string& expver, const std::string& type,
+                    const std::string& data = "Raining cats and dogs") {
+    archiver.archive(fieldKey(expver, type), data.c_str(), data.size());
+}
+
+/// The data retrieved for a field
+static std::string retrieve(const std::string& expver, const std::string& type) {
+
+    metkit::mars::MarsRequest request("retrieve");
+    for (const auto& kv : fieldKey(expver, type)) {
+        request.setValue(kv.first, kv.second);
+    }
+
+    fdb5::FDB fdb;
+    std::unique_ptr<DataHandle> dh(fdb.retrieve(request));
+    MemoryHandle out;
+    dh->saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+/// Remove a database from under the feet of the Archiver, so that new indexes and data files cannot be created
+static void removeDatabase(const std::string& expver) {
+
+    metkit::mars::MarsRequest request("retrieve");
+    request.setValue("class", "rd");
+    request.setValue("expver", expver);
+
+    PathName directory;
+    {
+        fdb5::FDB fdb;
+        ListIterator it = fdb.list(FDBToolRequest(request));
+        ListElement el;
+        EXPECT(it.next(el));
+        directory = el.location().uri().path().dirName();
+    }
+
+    std::vector<PathName> files;
+    std::vector<PathName> dirs;
+    directory.children(files, dirs);
+    EXPECT(dirs.empty());
+    for (PathName& file : files) {
+        file.unlink();
+    }
+    directory.rmdir();
+}
+
+static void wipe(const std::string& expver) {
+    fdb5::FDB fdb;
+    WipeIterator it = fdb.wipe(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true, false, true);
+    WipeElement el;
+    while (it.next(el)) {}
+}
+
+/// The types of the fields listed in a database
+static std::set<std::string> types(const std::string& expver) {
+    std::set<std::string> result;
+    fdb5::FDB fdb;
+    ListIterator it = fdb.list(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true);
+    ListElement el;
+    while (it.next(el)) {
+        result.insert(el.combinedKey().get("type"));
+    }
+    return result;
+}
+
+static bool ready(const std::shared_future<void>& future) {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("An error in an archive worker is reported by flush()") {
+
+    Archiver archiver(workerConfig());
+
+    archive(archiver, "xaw1", "fc");
+    archiver.flush();
+
+    removeDatabase("xaw1");
+
+    // A new index, whose files cannot be created. n.b. the field is queued for the worker, so the error
+    // is only seen by the caller on flush.
+
+    archive(archiver, "xaw1", "an");
+    EXPECT_THROWS_AS(archiver.flush(), eckit::Exception);
+}
+
+CASE("Destroying an Archiver with an unreported worker error does not throw") {
+
+    {
+        Archiver archiver(workerConfig());
+
+        archive(archiver, "xaw2", "fc");
+        archiver.flush();
+
+        removeDatabase("xaw2");
+
+        archive(archiver, "xaw2", "an");
+    }
+
+    // We would not get here if the error escaped from ~Archiver
+    EXPECT(true);
+}
+
+CASE("Only one background flush is in progress at a time") {
+
+    wipe("xaw3");
+
+    Archiver archiver(workerConfig());
+
+    archive(archiver, "xaw3", "fc");
+    std::shared_future<void> first = archiver.flushAsync();
+
+    archive(archiver, "xaw3", "an");
+    std::shared_future<void> second = archiver.flushAsync();
+    EXPECT(ready(first));
+
+    second.get();
+    EXPECT(types("xaw3") == std::set<std::string>({"fc", "an"}));
+}
+
+CASE("An error in a background flush is reported by its future, and by the following flush") {
+
+    Archiver archiver(workerConfig());
+
+    archive(archiver, "xaw4", "fc");
+    archiver.flush();
+
+    removeDatabase("xaw4");
+
+    archive(archiver, "xaw4", "an");
+    std::shared_future<void> flushed = archiver.flushAsync();
+    EXPECT_THROWS_AS(flushed.get(), eckit::Exception);
+
+    // The following archives go to the database created afresh
+
+    archive(archiver, "xaw4", "cf");
+    EXPECT_THROWS_AS(archiver.flush(), eckit::Exception);
+    EXPECT_NO_THROW(archiver.flush());
+
+    EXPECT(types("xaw4") == std::set<std::string>({"cf"}));
+}
+
+CASE("A database closed to open another does not publish its indexes before a background flush") {
+
+    wipe("xaw6");
+    wipe("xaw7");
+
+    fdb5::Config config = workerConfig();
+    config.set("maxOpenDatabases", 1);
+
+    {
+        Archiver archiver(config);
+
+        archive(archiver, "xaw6", "fc", "first");
+        std::shared_future<void> flushed = archiver.flushAsync();
+
+        // The database is reopened, and then closed to open another, while the first may still be flushing
+
+        archive(archiver, "xaw6", "fc", "second");
+        archive(archiver, "xaw7", "fc");
+
+        archiver.flush();
+        flushed.get();
+    }
+
+    // The field archived last masks the first
+
+    EXPECT(retrieve("xaw6", "fc") == "second");
+    EXPECT(retrieve("xaw7", "fc") == "Raining cats and dogs");
+}
+
+CASE("Background flushes are timed until they complete") {
+
+    wipe("xaw5");
+
+    fdb5::FDB fdb;
+    std::string data = "Raining cats and dogs";
+    fdb.archive(fieldKey("xaw5", "fc"), data.c_str(), data.size());
+
+    std::shared_future<void> flushed = fdb.flushAsync();
+    flushed.get();
+    EXPECT(fdb.stats().numFlush() == 1);
+
+    // ... and are counted once, along with the flush that follows
+
+    fdb.flush();
+    EXPECT(fdb.stats().numFlush() == 2);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
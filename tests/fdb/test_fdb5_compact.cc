@@ -0,0 +1,252 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_compact.cc
+/// @date   Oct 2026
+
+#include <cstdlib>
+
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/runtime/Main.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/TocHandler.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const std::string expver = "xcp1";
+const size_t nsteps = 10;
+const size_t nrewritten = 8;
+
+static void wipe() {
+    fdb5::FDB fdb;
+    WipeIterator it = fdb.wipe(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true, false, true);
+    WipeElement el;
+    while (it.next(el)) {}
+}
+
+static Key fieldKey(size_t step) {
+    Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("date", "20200601");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("type", "fc");
+    key.set("levtype", "sfc");
+    key.set("step", std::to_string(step));
+    key.set("param", "130");
+    return key;
+}
+
+static std::string data(size_t step, size_t version) {
+    return "Raining cats and dogs, step " + std::to_string(step) + " version " + std::to_string(version);
+}
+
+/// The data last archived for each step
+static std::string expected(size_t step) {
+    return data(step, step < nrewritten ? 2 : 1);
+}
+
+/// Archive the given steps, from one FDB, so that they are written to one data file
+static void archive(size_t count, size_t version) {
+    fdb5::FDB fdb;
+    for (size_t step = 0; step < count; ++step) {
+        std::string d = data(step, version);
+        fdb.archive(fieldKey(step), d.c_str(), d.size());
+    }
+    fdb.flush();
+}
+
+static std::unique_ptr<DataHandle> retrieve(fdb5::FDB& fdb, size_t step) {
+    metkit::mars::MarsRequest request("retrieve");
+    for (const auto& kv : fieldKey(step)) {
+        request.setValue(kv.first, kv.second);
+    }
+    return std::unique_ptr<DataHandle>(fdb.retrieve(request));
+}
+
+static std::string contents(DataHandle& dh) {
+    MemoryHandle out;
+    dh.saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+/// The data files referenced by the visible fields, by step
+static std::vector<PathName> dataFiles() {
+    std::vector<PathName> files(nsteps);
+    fdb5::FDB fdb;
+    ListIterator it = fdb.list(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true);
+    ListElement el;
+    size_t count = 0;
+    while (it.next(el)) {
+        size_t step = std::stoul(el.combinedKey().get("step"));
+        EXPECT(step < nsteps);
+        files[step] = el.location().uri().path();
+        count++;
+    }
+    EXPECT(count == nsteps);
+    return files;
+}
+
+static std::vector<std::string> compact() {
+    fdb5::FDB fdb;
+    CompactIterator it = fdb.compact(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true);
+    std::vector<std::string> output;
+    CompactElement el;
+    while (it.next(el)) {
+        Log::info() << el << std::endl;
+        output.push_back(el);
+    }
+    return output;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Compaction rewrites only the TOC, and reads continue throughout") {
+
+    wipe();
+
+    // Ten fields in one data file, most of which are then archived again into a second one
+
+    archive(nsteps, 1);
+    archive(nrewritten, 2);
+
+    std::vector<PathName> before = dataFiles();
+    PathName sparse = before[nsteps - 1];
+    EXPECT(before[0] != sparse);
+    PathName directory = sparse.dirName();
+
+    // A reader that has already located its data, in the sparse data file among others
+
+    std::vector<std::unique_ptr<DataHandle>> early;
+    {
+        fdb5::FDB fdb;
+        for (size_t step = 0; step < nsteps; ++step) {
+            early.push_back(retrieve(fdb, step));
+        }
+    }
+
+    // Readers that keep on locating and reading data while the database is compacted
+
+    std::atomic<bool> done(false);
+    std::atomic<size_t> reads(0);
+    std::atomic<size_t> errors(0);
+
+    std::thread reader([&] {
+        while (!done) {
+            try {
+                fdb5::FDB fdb;
+                for (size_t step = 0; step < nsteps; ++step) {
+                    std::unique_ptr<DataHandle> dh = retrieve(fdb, step);
+                    if (contents(*dh) != expected(step)) {
+                        errors++;
+                    }
+                    reads++;
+                }
+            } catch (std::exception& e) {
+                Log::error() << "Read during compaction: " << e.what() << std::endl;
+                errors++;
+            }
+        }
+    });
+
+    std::vector<std::string> output = compact();
+
+    done = true;
+    reader.join();
+
+    Log::info() << "Reads during compaction: " << reads << std::endl;
+    EXPECT(errors == 0);
+
+    // The sparse data file has been replaced in the TOC, but is left in place for purge
+
+    EXPECT(sparse.exists());
+
+    std::vector<PathName> after = dataFiles();
+    for (size_t step = 0; step < nsteps; ++step) {
+        EXPECT(after[step] != sparse);
+        if (step < nrewritten) {
+            EXPECT(after[step] == before[step]);
+        }
+    }
+
+    TocHandler handler(directory, fdb5::Config().expandConfig());
+    for (const Index& index : handler.loadIndexes()) {
+        for (const eckit::URI& uri : index.dataPaths()) {
+            EXPECT(uri.path() != sparse);
+        }
+    }
+
+    std::ostringstream dump;
+    handler.dump(dump, true, true);
+    EXPECT(dump.str().find("TOC_CLEAR") != std::string::npos);
+
+    // The reader that located its data before compaction can still read it
+
+    for (size_t step = 0; step < nsteps; ++step) {
+        EXPECT(contents(*early[step]) == expected(step));
+    }
+
+    // ... as can readers after compaction
+
+    fdb5::FDB fdb;
+    for (size_t step = 0; step < nsteps; ++step) {
+        EXPECT(contents(*retrieve(fdb, step)) == expected(step));
+    }
+
+    // There is then nothing left to compact
+
+    output = compact();
+    bool nothing = false;
+    for (const std::string& line : output) {
+        nothing = nothing || line.find("Nothing to compact") != std::string::npos;
+    }
+    EXPECT(nothing);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+
+    // Data files written by the test are eligible for compaction straight away
+    ::setenv("FDB_COMPACT_MINIMUM_AGE", "0", 1);
+
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
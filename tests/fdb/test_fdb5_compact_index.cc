@@ -0,0 +1,192 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_compact_index.cc
+/// @date   Oct 2026
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/toc/BTreeIndex.h"
+#include "fdb5/toc/BloomFilter.h"
+#include "fdb5/toc/FieldRef.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// Keys with shared prefixes, as produced by the schema. n.b. short enough not to be truncated by the btree
+static std::string key(size_t i) {
+    return "{step=" + std::to_string(i / 10) + ",param=" + std::to_string(i % 10) + "}";
+}
+
+static FieldRef ref(size_t i) {
+    return FieldRef(FieldRefLocation(i % 3, Offset((long long)(1000 * i)), Length((long long)(i + 1))));
+}
+
+static PathName freshPath(const std::string& name) {
+    PathName path(name);
+    if (path.exists()) {
+        path.unlink();
+    }
+    return path;
+}
+
+static void write(const std::string& type, const PathName& path, off_t offset, size_t count) {
+    std::unique_ptr<BTreeIndex> index(BTreeIndexFactory::build(type, path, false, offset));
+    for (size_t i = 0; i < count; ++i) {
+        index->set(key(i), ref(i));
+    }
+    index->flush();
+    index->sync();
+}
+
+static void check(BTreeIndex& index, size_t count) {
+
+    for (size_t i = 0; i < count; ++i) {
+        FieldRef r;
+        EXPECT(index.get(key(i), r));
+        EXPECT(r.uriId() == ref(i).uriId());
+        EXPECT(r.offset() == ref(i).offset());
+        EXPECT(r.length() == ref(i).length());
+    }
+
+    struct Collector : public BTreeIndexVisitor {
+        std::vector<std::string> keys_;
+        void visit(const std::string& key, const FieldRef&) override { keys_.push_back(key); }
+    };
+
+    Collector c;
+    index.visit(c);
+    EXPECT(c.keys_.size() == count);
+    for (size_t i = 1; i < c.keys_.size(); ++i) {
+        EXPECT(c.keys_[i - 1] < c.keys_[i]);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Bloom filters contain everything inserted, and few false positives") {
+
+    const size_t n = 10000;
+
+    BloomFilter bloom(n, 10);
+    for (size_t i = 0; i < n; ++i) {
+        bloom.insert(key(i));
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT(bloom.mayContain(key(i)));
+    }
+
+    // With 10 bits per entry, the expected false positive rate is ~1%
+
+    size_t falsePositives = 0;
+    for (size_t i = n; i < 2 * n; ++i) {
+        if (bloom.mayContain(key(i))) {
+            ++falsePositives;
+        }
+    }
+    Log::info() << "Bloom filter false positives: " << falsePositives << " of " << n << std::endl;
+    EXPECT(falsePositives < n / 50);
+
+    // A filter reconstructed from its (persisted) bits gives the same answers
+
+    BloomFilter copy(bloom.data(), bloom.bytes(), bloom.hashes());
+    for (size_t i = 0; i < 2 * n; ++i) {
+        EXPECT(copy.mayContain(key(i)) == bloom.mayContain(key(i)));
+    }
+
+    // An empty filter may contain anything
+
+    BloomFilter empty;
+    EXPECT(empty.empty());
+    EXPECT(empty.mayContain(key(0)));
+}
+
+CASE("Compact indexes give back what was written") {
+
+    PathName path = freshPath("compact_index_roundtrip.index");
+
+    // Several restart blocks, with a partial last block
+
+    const size_t n = 1001;
+    write("CompactIndex", path, 0, n);
+
+    std::unique_ptr<BTreeIndex> index(BTreeIndexFactory::build("CompactIndex", path, true, 0));
+    check(*index, n);
+
+    // Lookups that miss: before the first key, after the last, between keys, and prefixes of keys
+
+    FieldRef r;
+    EXPECT(!index->get("", r));
+    EXPECT(!index->get("{", r));
+    EXPECT(!index->get("~", r));
+    EXPECT(!index->get(key(n), r));
+    EXPECT(!index->get(key(5) + "x", r));
+    EXPECT(!index->get(key(5).substr(0, key(5).size() - 1), r));
+}
+
+CASE("Unflushed compact indexes cannot be read") {
+
+    PathName path = freshPath("compact_index_empty.index");
+
+    {
+        std::unique_ptr<BTreeIndex> index(BTreeIndexFactory::build("CompactIndex", path, false, 0));
+        index->set(key(0), ref(0));
+    }
+
+    // Entries that were never flushed are not visible
+
+    EXPECT_THROWS(BTreeIndexFactory::build("CompactIndex", path, true, 0));
+}
+
+CASE("Legacy and compact indexes may be read from the same index file") {
+
+    PathName path = freshPath("compact_index_mixed.index");
+
+    // A legacy btree index, followed by a compact index (as appended by reconsolidation)
+
+    write("BTreeIndex", path, 0, 100);
+
+    off_t offset = path.size();
+    write("CompactIndex", path, offset, 500);
+
+    std::unique_ptr<BTreeIndex> legacy(BTreeIndexFactory::build("BTreeIndex", path, true, 0));
+    std::unique_ptr<BTreeIndex> compact(BTreeIndexFactory::build("CompactIndex", path, true, offset));
+
+    check(*legacy, 100);
+    check(*compact, 500);
+
+    FieldRef r;
+    EXPECT(!legacy->get(key(100), r));
+    EXPECT(compact->get(key(100), r));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
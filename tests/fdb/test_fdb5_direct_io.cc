@@ -0,0 +1,121 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_direct_io.cc
+/// @date   Oct 2026
+
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/log/Log.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/io/DirectFileHandle.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static std::string contents(const PathName& path) {
+    MemoryHandle out;
+    FileHandle in(path);
+    in.saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+static std::string pattern(size_t length, char first) {
+    std::string s(length, ' ');
+    for (size_t i = 0; i < length; ++i) {
+        s[i] = char(first + (i % 23));
+    }
+    return s;
+}
+
+/// Not all filesystems support direct I/O. Where it is not supported, there is nothing to test.
+
+static bool open(DirectFileHandle& dh) {
+    try {
+        dh.openForAppend(0);
+        return true;
+    } catch (eckit::BadParameter& e) {
+        Log::warning() << "Direct I/O not tested: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Data is written at its true offsets, and the padding is removed on close") {
+
+    PathName path("direct_io_1.data");
+    if (path.exists()) {
+        path.unlink();
+    }
+
+    const size_t alignment = DirectFileHandle::alignment();
+
+    std::string a = pattern(alignment + 100, 'a');
+    std::string b = pattern(3 * alignment, 'A');
+    std::string c = pattern(10, '0');
+
+    DirectFileHandle dh(path, 2 * alignment);
+    if (!open(dh)) {
+        return;
+    }
+
+    dh.write(a.data(), a.size());
+    EXPECT(dh.position() == Offset(a.size()));
+
+    // The partial block is padded on flush
+
+    dh.flush();
+    EXPECT(path.size() == Length(2 * alignment));
+    EXPECT(contents(path).substr(0, a.size()) == a);
+
+    // ... and completed by the following writes
+
+    dh.write(b.data(), b.size());
+    EXPECT(dh.position() == Offset(a.size() + b.size()));
+    dh.flush();
+    EXPECT(contents(path).substr(0, a.size() + b.size()) == a + b);
+
+    dh.close();
+    EXPECT(contents(path) == a + b);
+
+    // Appending continues from the end of the data
+
+    DirectFileHandle dh2(path, 2 * alignment);
+    EXPECT(open(dh2));
+    EXPECT(dh2.position() == Offset(a.size() + b.size()));
+    dh2.write(c.data(), c.size());
+    dh2.close();
+
+    EXPECT(contents(path) == a + b + c);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
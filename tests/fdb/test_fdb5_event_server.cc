@@ -0,0 +1,192 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_event_server.cc
+/// @date   Oct 2026
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/net/TCPClient.h"
+#include "eckit/net/TCPServer.h"
+#include "eckit/runtime/Main.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/remote/EventServer.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const long timeout = 2;
+
+/// An event driven server, with fewer workers than clients, running for the lifetime of the object
+class TestServer {
+public:
+    TestServer() : server_(0), port_(server_.localPort()) {
+        fdb5::Config config = fdb5::Config().expandConfig();
+        config.set("serverWorkers", 2L);
+        config.set("serverTimeout", timeout);
+        events_.reset(new remote::EventServer(server_, config));
+        thread_ = std::thread([this] { events_->run(); });
+    }
+    ~TestServer() {
+        events_->stop();
+        thread_.join();
+    }
+    int port() const { return port_; }
+
+private:
+    net::TCPServer server_;
+    int port_;
+    std::unique_ptr<remote::EventServer> events_;
+    std::thread thread_;
+};
+
+static fdb5::Config clientConfig(int port) {
+    eckit::LocalConfiguration conf;
+    conf.set("type", "remote");
+    conf.set("host", "localhost");
+    conf.set("port", port);
+    conf.set("shareConnections", false);
+    return fdb5::Config(conf);
+}
+
+static void wipe(const std::string& expver) {
+    fdb5::FDB fdb;
+    WipeIterator it = fdb.wipe(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true, false, true);
+    WipeElement el;
+    while (it.next(el)) {}
+}
+
+/// Archives a field through the server, and reads it back. @returns the data read.
+static std::string archiveAndRetrieve(int port, const std::string& expver, const std::string& data) {
+
+    fdb5::FDB fdb(clientConfig(port));
+
+    Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("date", "20200501");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("type", "fc");
+    key.set("levtype", "sfc");
+    key.set("step", "0");
+    key.set("param", "130");
+
+    fdb.archive(key, data.c_str(), data.size());
+    fdb.flush();
+
+    metkit::mars::MarsRequest request("retrieve");
+    for (const auto& kv : key) {
+        request.setValue(kv.first, kv.second);
+    }
+
+    std::unique_ptr<DataHandle> dh(fdb.retrieve(request));
+    MemoryHandle out;
+    dh->saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+/// A connection that never sends anything
+static std::unique_ptr<net::TCPClient> stalledConnection(int port) {
+    std::unique_ptr<net::TCPClient> client(new net::TCPClient);
+    client->connect("localhost", port);
+    return client;
+}
+
+static bool closedByServer(net::TCPClient& client) {
+    char c;
+    return ::recv(client.socket(), &c, 1, MSG_DONTWAIT) == 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Many clients are served concurrently, while other connections stall") {
+
+    const size_t nclients = 6;
+
+    for (size_t i = 0; i < nclients; ++i) {
+        wipe("xev" + std::to_string(i));
+    }
+
+    TestServer server;
+
+    // More stalled connections than there are workers. None of them holds up the clients.
+
+    std::vector<std::unique_ptr<net::TCPClient>> stalled;
+    for (size_t i = 0; i < 3; ++i) {
+        stalled.push_back(stalledConnection(server.port()));
+    }
+
+    std::vector<std::string> expected(nclients);
+    std::vector<std::string> results(nclients);
+    std::vector<std::thread> clients;
+
+    for (size_t i = 0; i < nclients; ++i) {
+        expected[i] = "Raining cats and dogs " + std::to_string(i);
+        clients.emplace_back([&server, &expected, &results, i] {
+            try {
+                results[i] = archiveAndRetrieve(server.port(), "xev" + std::to_string(i), expected[i]);
+            } catch (std::exception& e) {
+                results[i] = std::string("Error: ") + e.what();
+            }
+        });
+    }
+
+    for (std::thread& client : clients) {
+        client.join();
+    }
+
+    for (size_t i = 0; i < nclients; ++i) {
+        Log::info() << "Client " << i << ": " << results[i] << std::endl;
+        EXPECT(results[i] == expected[i]);
+    }
+
+    // Connections that never start a session are closed once the timeout has passed
+
+    std::this_thread::sleep_for(std::chrono::seconds(timeout + 2));
+
+    for (auto& client : stalled) {
+        EXPECT(closedByServer(*client));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,103 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_index_read_mode.cc
+/// @date   Oct 2026
+
+#include <memory>
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/toc/BTreeIndex.h"
+#include "fdb5/toc/FieldRef.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("The index read mode applies to all index types, or is given per index type") {
+
+    EXPECT(!BTreeIndex::pageCachePreload("BTreeIndex", "heap"));
+    EXPECT(BTreeIndex::pageCachePreload("BTreeIndex", "pagecache"));
+    EXPECT(BTreeIndex::pageCachePreload("BTreeIndex4MB", "pagecache"));
+
+    const std::string modes = "heap,BTreeIndex4MB:pagecache";
+    EXPECT(!BTreeIndex::pageCachePreload("BTreeIndex", modes));
+    EXPECT(BTreeIndex::pageCachePreload("BTreeIndex4MB", modes));
+
+    // Types that are not listed use the heap, unless a mode for all types is given
+
+    EXPECT(!BTreeIndex::pageCachePreload("BTreeIndex", "BTreeIndex4MB:pagecache"));
+
+    // The mode for a specific type takes precedence, wherever it is given
+
+    EXPECT(!BTreeIndex::pageCachePreload("BTreeIndex", "BTreeIndex:heap,pagecache"));
+    EXPECT(!BTreeIndex::pageCachePreload("BTreeIndex", "pagecache,BTreeIndex:heap"));
+    EXPECT(BTreeIndex::pageCachePreload("PointDBIndex", "pagecache,BTreeIndex:heap"));
+}
+
+CASE("Invalid index read modes are rejected") {
+    EXPECT_THROWS_AS(BTreeIndex::pageCachePreload("BTreeIndex", "mmap"), eckit::UserError);
+    EXPECT_THROWS_AS(BTreeIndex::pageCachePreload("BTreeIndex", "heap,BTreeIndex:mmap"), eckit::UserError);
+    EXPECT_THROWS_AS(BTreeIndex::pageCachePreload("BTreeIndex", "BTreeIndex:heap:pagecache"), eckit::UserError);
+}
+
+CASE("Indexes read ahead into the page cache give the same results as those preloaded onto the heap") {
+
+    PathName path("index_read_mode.index");
+    if (path.exists()) {
+        path.unlink();
+    }
+
+    {
+        std::unique_ptr<BTreeIndex> index(BTreeIndexFactory::build("BTreeIndex", path, false, 0));
+        for (int i = 0; i < 1000; ++i) {
+            index->set("key" + std::to_string(i), FieldRef());
+        }
+        index->flush();
+        index->sync();
+    }
+
+    for (bool pageCache : {false, true}) {
+
+        std::unique_ptr<BTreeIndex> index(BTreeIndexFactory::build("BTreeIndex", path, true, 0));
+
+        if (pageCache) {
+            index->readAhead();
+        } else {
+            index->preload();
+        }
+
+        FieldRef ref;
+        EXPECT(index->get("key0", ref));
+        EXPECT(index->get("key999", ref));
+        EXPECT(!index->get("key1000", ref));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,194 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_inspect.cc
+/// @date   Oct 2026
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/runtime/Main.h"
+
+#include "metkit/mars/MarsRequest.h"
+#include "metkit/mars/TypeAny.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/database/Key.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static const std::vector<std::string> dates{"20200201", "20200202", "20200203", "20200204", "20200205", "20200206"};
+static const std::vector<std::string> types{"fc", "an"};
+static const std::vector<std::string> steps{"0", "6", "12"};
+static const std::vector<std::string> params{"130", "167"};
+
+static Key baseKey(const std::string& expver) {
+    Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("levtype", "sfc");
+    return key;
+}
+
+static void archive(const std::string& expver) {
+
+    fdb5::FDB fdb;
+    Key key = baseKey(expver);
+
+    for (const std::string& date : dates) {
+        key.set("date", date);
+        for (const std::string& type : types) {
+            key.set("type", type);
+            for (const std::string& step : steps) {
+                key.set("step", step);
+                for (const std::string& param : params) {
+                    key.set("param", param);
+                    std::string data = "Raining cats and dogs on " + date + " " + type + " " + step + " " + param;
+                    fdb.archive(key, data.c_str(), data.size());
+                }
+            }
+        }
+    }
+
+    fdb.flush();
+}
+
+static metkit::mars::MarsRequest request(const std::string& expver) {
+
+    metkit::mars::MarsRequest r("retrieve");
+    r.setValue("class", "rd");
+    r.setValue("expver", expver);
+    r.setValue("stream", "oper");
+    r.setValue("time", "0000");
+    r.setValue("domain", "g");
+    r.setValue("levtype", "sfc");
+    r.setValuesTyped(new metkit::mars::TypeAny("date"), dates);
+    r.setValuesTyped(new metkit::mars::TypeAny("type"), types);
+    r.setValuesTyped(new metkit::mars::TypeAny("step"), steps);
+    r.setValuesTyped(new metkit::mars::TypeAny("param"), params);
+    return r;
+}
+
+static fdb5::Config inspectConfig(long threads) {
+    eckit::LocalConfiguration userConf;
+    userConf.set("inspectThreads", threads);
+    return fdb5::Config(fdb5::Config().expandConfig(), userConf);
+}
+
+static std::vector<std::string> elements(ListIterator&& it) {
+    std::vector<std::string> result;
+    ListElement el;
+    while (it.next(el)) {
+        std::ostringstream ss;
+        ss << el.combinedKey() << " " << el.location().uri() << " " << el.location().offset() << " "
+           << el.location().length();
+        result.push_back(ss.str());
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Pipelined inspection gives the same elements, in the same order, as serial inspection") {
+
+    archive("xin1");
+
+    std::vector<std::string> serial;
+    {
+        fdb5::FDB fdb(inspectConfig(1));
+        serial = elements(fdb.inspect(request("xin1")));
+    }
+
+    EXPECT(serial.size() == dates.size() * types.size() * steps.size() * params.size());
+
+    for (long threads : {2, 3, 8}) {
+        fdb5::FDB fdb(inspectConfig(threads));
+        EXPECT(elements(fdb.inspect(request("xin1"))) == serial);
+    }
+}
+
+CASE("Inspection iterators may outlive the FDB") {
+
+    std::unique_ptr<ListIterator> serial;
+    std::unique_ptr<ListIterator> pipelined;
+    {
+        fdb5::FDB fdb1(inspectConfig(1));
+        serial.reset(new ListIterator(fdb1.inspect(request("xin1"))));
+
+        fdb5::FDB fdb4(inspectConfig(4));
+        pipelined.reset(new ListIterator(fdb4.inspect(request("xin1"))));
+    }
+
+    EXPECT(elements(std::move(*pipelined)) == elements(std::move(*serial)));
+
+    // ... or be abandoned part way through
+
+    fdb5::FDB fdb(inspectConfig(4));
+    ListIterator it = fdb.inspect(request("xin1"));
+    ListElement el;
+    EXPECT(it.next(el));
+}
+
+CASE("Errors in pipelined inspection are reported to the consumer") {
+
+    archive("xin2");
+
+    // Corrupt the TOC of one of the databases (not the first)
+
+    {
+        fdb5::FDB fdb;
+        metkit::mars::MarsRequest r(request("xin2"));
+        r.setValue("date", dates[3]);
+        ListIterator it = fdb.list(FDBToolRequest(r));
+        ListElement el;
+        EXPECT(it.next(el));
+
+        eckit::PathName toc = el.location().uri().path().dirName() / "toc";
+        std::string garbage(4096, 'x');
+        eckit::FileHandle fh(toc);
+        fh.openForWrite(0);
+        fh.write(garbage.c_str(), garbage.size());
+        fh.close();
+    }
+
+    for (long threads : {1, 4}) {
+        fdb5::FDB fdb(inspectConfig(threads));
+        EXPECT_THROWS_AS(elements(fdb.inspect(request("xin2"))), eckit::Exception);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,212 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_location_batcher.cc
+/// @date   Oct 2026
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/api/helpers/ListIterator.h"
+#include "fdb5/database/FieldLocation.h"
+#include "fdb5/io/FieldHandle.h"
+#include "fdb5/io/HandleGatherer.h"
+#include "fdb5/io/LocationBatcher.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The reads made, as server:count. Locations read on their own have a count of 1.
+static std::vector<std::string> reads;
+static bool batching = false;
+
+/// A location whose data is its name. Locations with a server are batched by server, as remote locations
+/// are, and the others are read one at a time, as local locations are.
+
+class TestLocation : public FieldLocation {
+
+public: // methods
+
+    TestLocation(const std::string& data, const std::string& server) :
+        FieldLocation(eckit::URI("test://" + server), Offset(0), Length((long long)data.size()), Key()),
+        data_(data),
+        server_(server) {}
+
+    eckit::DataHandle* dataHandle() const override {
+        if (!batching) {
+            reads.push_back(server_ + ":1");
+        }
+        return new eckit::MemoryHandle(data_.c_str(), data_.size());
+    }
+
+    std::string batchKey() const override { return server_; }
+
+    eckit::DataHandle* readMany(const std::vector<std::shared_ptr<const FieldLocation>>& locations) const override {
+        for (const auto& location : locations) {
+            EXPECT(location->batchKey() == server_);
+        }
+        reads.push_back(server_ + ":" + std::to_string(locations.size()));
+        batching = true;
+        eckit::DataHandle* result = FieldLocation::readMany(locations);
+        batching = false;
+        return result;
+    }
+
+    std::shared_ptr<FieldLocation> make_shared() const override {
+        return std::make_shared<TestLocation>(data_, server_);
+    }
+
+    void visit(FieldLocationVisitor&) const override { NOTIMP; }
+
+protected: // For Streamable
+
+    const eckit::ReanimatorBase& reanimator() const override { NOTIMP; }
+
+private: // members
+
+    std::string data_;
+    std::string server_;
+};
+
+/// Reads the locations through a batcher, and returns the concatenated data
+static std::string read(const std::vector<std::shared_ptr<const FieldLocation>>& locations, size_t batchSize) {
+
+    reads.clear();
+
+    HandleGatherer gatherer(false);
+    LocationBatcher batcher(gatherer, batchSize);
+    for (const auto& location : locations) {
+        batcher.add(location);
+    }
+    batcher.flush();
+
+    std::unique_ptr<eckit::DataHandle> dh(gatherer.dataHandle());
+    eckit::MemoryHandle out;
+    dh->saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+static std::shared_ptr<const FieldLocation> location(const std::string& data, const std::string& server = "") {
+    return std::make_shared<TestLocation>(data, server);
+}
+
+/// Lists the locations, as they would be returned by a query
+class TestListIterator : public APIIteratorBase<ListElement> {
+public:
+    TestListIterator(const std::vector<std::shared_ptr<const FieldLocation>>& locations) :
+        locations_(locations), next_(0) {}
+
+    bool next(ListElement& el) override {
+        if (next_ == locations_.size()) {
+            return false;
+        }
+        el = ListElement({Key(), Key(), Key()}, locations_[next_++], 0);
+        return true;
+    }
+
+private:
+    std::vector<std::shared_ptr<const FieldLocation>> locations_;
+    size_t next_;
+};
+
+/// Reads the locations as a stream, through a FieldHandle, and returns the concatenated data
+static std::string stream(const std::vector<std::shared_ptr<const FieldLocation>>& locations, size_t batchSize) {
+
+    reads.clear();
+
+    FieldHandle dh(ListIterator(APIIterator<ListElement>(new TestListIterator(locations))), batchSize);
+    eckit::MemoryHandle out;
+    dh.saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Locations on the same server are read together, in order") {
+
+    std::vector<std::shared_ptr<const FieldLocation>> locations;
+    for (const char* data : {"a", "b", "c", "d", "e"}) {
+        locations.push_back(location(data, "host1"));
+    }
+
+    EXPECT(read(locations, 100) == "abcde");
+    EXPECT(reads == std::vector<std::string>({"host1:5"}));
+}
+
+CASE("Batches are limited in size") {
+
+    std::vector<std::shared_ptr<const FieldLocation>> locations;
+    for (const char* data : {"a", "b", "c", "d", "e"}) {
+        locations.push_back(location(data, "host1"));
+    }
+
+    EXPECT(read(locations, 2) == "abcde");
+    EXPECT(reads == std::vector<std::string>({"host1:2", "host1:2", "host1:1"}));
+
+    // A batch size of one disables batching
+
+    EXPECT(read(locations, 1) == "abcde");
+    EXPECT(reads == std::vector<std::string>(5, "host1:1"));
+}
+
+CASE("Mixed local and remote locations are returned in the order requested") {
+
+    std::vector<std::shared_ptr<const FieldLocation>> locations{
+        location("a", "host1"), location("b", "host1"),  // batch
+        location("c"),                                   // local
+        location("d", "host1"), location("e", "host1"),  // batch
+        location("f", "host2"), location("g", "host2"),  // batch, other server
+        location("h", "host1"),                          // alone
+        location("i"), location("j"),                    // local
+    };
+
+    EXPECT(read(locations, 100) == "abcdefghij");
+    EXPECT(reads == std::vector<std::string>({"host1:2", ":1", "host1:2", "host2:2", "host1:1", ":1", ":1"}));
+}
+
+CASE("Streamed reads batch the locations of each batch of fields") {
+
+    std::vector<std::shared_ptr<const FieldLocation>> locations{
+        location("a", "host1"), location("b", "host1"), location("c", "host1"),
+        location("d"),
+        location("e", "host1"), location("f", "host2"), location("g", "host2"),
+    };
+
+    // No batch of locations spans two batches of fields
+
+    EXPECT(stream(locations, 100) == "abcdefg");
+    EXPECT(reads == std::vector<std::string>({"host1:3", ":1", "host1:1", "host2:2"}));
+
+    EXPECT(stream(locations, 2) == "abcdefg");
+    EXPECT(reads == std::vector<std::string>({"host1:2", "host1:1", ":1", "host1:1", "host2:1", "host2:1"}));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
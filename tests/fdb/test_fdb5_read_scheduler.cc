@@ -0,0 +1,423 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_read_scheduler.cc
+/// @date   Oct 2026
+
+#include <unistd.h>
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/remote/ReadScheduler.h"
+#include "fdb5/toc/TocFieldLocation.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+using namespace fdb5::remote;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// As set in main()
+const size_t readAhead = 4096;
+const size_t coalesce = 1024;
+
+/// The contents of the data files, by path
+static std::map<std::string, std::string> files;
+
+static std::string pattern(size_t length, char first) {
+    std::string s(length, ' ');
+    for (size_t i = 0; i < length; ++i) {
+        s[i] = char(first + (i % 23));
+    }
+    return s;
+}
+
+static PathName file(const std::string& name, size_t length, char first) {
+    PathName path(name);
+    if (path.exists()) {
+        path.unlink();
+    }
+    std::string data = pattern(length, first);
+    FileHandle out(path);
+    out.openForWrite(0);
+    out.write(data.c_str(), data.size());
+    out.close();
+    files[path.asString()] = data;
+    return path;
+}
+
+struct Field {
+    PathName path_;
+    size_t offset_;
+    size_t length_;
+
+    std::string data() const {
+        auto it = files.find(path_.asString());
+        ASSERT(it != files.end());
+        return it->second.substr(offset_, length_);
+    }
+};
+
+struct Sent {
+    Message message_;
+    uint32_t id_;
+    std::string data_;
+    const char* address_;  ///< Where the data was read into, if it was not sent straight from the file
+};
+
+/// Records the messages sent on a channel, either from the data read or straight from the file
+class Recorder {
+public:
+
+    ReadScheduler::Sender sender() {
+        return [this](Message message, uint32_t id, const void* data, uint32_t length) {
+            const char* p = static_cast<const char*>(data);
+            record(Sent{message, id, length ? std::string(p, length) : std::string(), p});
+        };
+    }
+
+    ReadScheduler::FileSender fileSender() {
+        return [this](Message message, uint32_t id, int fd, off_t offset, uint32_t length) {
+            std::string data(length, '\0');
+            ASSERT(::pread(fd, &data[0], length, offset) == ssize_t(length));
+            record(Sent{message, id, data, nullptr});
+        };
+    }
+
+    std::vector<Sent> sent() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return sent_;
+    }
+
+private:
+
+    void record(Sent&& sent) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sent_.emplace_back(std::move(sent));
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<Sent> sent_;
+};
+
+using Request = std::pair<uint32_t, std::vector<Field>>;
+
+static fdb5::Config schedulerConfig() {
+    fdb5::Config config;
+    config.set("serverReadThreads", 4);
+    config.set("serverSendThreads", 2);
+    return config;
+}
+
+static ReadScheduler::ChannelPtr channel(ReadScheduler& scheduler, Recorder& recorder, bool sendfile) {
+    return scheduler.channel(recorder.sender(), sendfile ? recorder.fileSender() : ReadScheduler::FileSender());
+}
+
+static void enqueue(ReadScheduler& scheduler, const ReadScheduler::ChannelPtr& channel, const Request& request) {
+    std::vector<std::unique_ptr<FieldLocation>> locations;
+    for (const Field& field : request.second) {
+        locations.emplace_back(new TocFieldLocation(field.path_, field.offset_, field.length_, Key()));
+    }
+    scheduler.enqueue(channel, request.first, std::move(locations));
+}
+
+/// Checks that each request was sent in turn, as the data of each of its fields followed by a Complete message.
+/// The requests that fail are sent as the data of (at most) the fields before the failure, then an Error message.
+static void checkSent(const std::vector<Sent>& sent, const std::vector<Request>& requests,
+                      const std::set<uint32_t>& failing = {}) {
+
+    size_t i = 0;
+    for (const Request& request : requests) {
+
+        size_t fields = 0;
+        while (i < sent.size() && sent[i].message_ == Message::Blob && fields < request.second.size()) {
+            EXPECT(sent[i].id_ == request.first);
+            EXPECT(sent[i].data_ == request.second[fields].data());
+            ++fields;
+            ++i;
+        }
+
+        EXPECT(i < sent.size());
+        EXPECT(sent[i].id_ == request.first);
+
+        if (failing.find(request.first) == failing.end()) {
+            EXPECT(fields == request.second.size());
+            EXPECT(sent[i].message_ == Message::Complete);
+        } else {
+            EXPECT(sent[i].message_ == Message::Error);
+        }
+        ++i;
+    }
+
+    EXPECT(i == sent.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Requests are sent in the order they are queued, field by field, on each channel") {
+
+    PathName path1 = file("read_scheduler_1.data", 4000, 'a');
+    PathName path2 = file("read_scheduler_2.data", 2000, 'A');
+
+    for (bool sendfile : {false, true}) {
+
+        // Interleaved, out of order, and overlapping fields, of one file and of several
+
+        std::vector<Request> requests1{
+            {1, {{path1, 300, 100}, {path1, 0, 100}, {path1, 200, 50}}},
+            {2, {{path2, 0, 100}, {path2, 100, 100}}},
+            {3, {{path1, 100, 100}, {path1, 50, 200}, {path1, 150, 10}}},
+            {4, {{path2, 500, 10}, {path1, 10, 10}, {path2, 0, 2000}}},
+        };
+
+        std::vector<Request> requests2{
+            {1, {{path1, 0, 4000}}},
+            {7, {{path2, 1500, 100}, {path1, 3000, 100}}},
+            {5, {{path1, 250, 50}, {path2, 250, 50}}},
+        };
+
+        ReadScheduler scheduler(schedulerConfig());
+
+        Recorder recorder1;
+        Recorder recorder2;
+        ReadScheduler::ChannelPtr channel1 = channel(scheduler, recorder1, sendfile);
+        ReadScheduler::ChannelPtr channel2 = channel(scheduler, recorder2, sendfile);
+
+        for (size_t i = 0; i < std::max(requests1.size(), requests2.size()); ++i) {
+            if (i < requests1.size()) enqueue(scheduler, channel1, requests1[i]);
+            if (i < requests2.size()) enqueue(scheduler, channel2, requests2[i]);
+        }
+
+        scheduler.wait(channel1);
+        scheduler.wait(channel2);
+
+        checkSent(recorder1.sent(), requests1);
+        checkSent(recorder2.sent(), requests2);
+    }
+
+    path1.unlink();
+    path2.unlink();
+}
+
+CASE("Adjacent and overlapping fields are read together, up to the coalescing limit") {
+
+    PathName path = file("read_scheduler_3.data", 4000, 'a');
+
+    // Adjacent fields, out of order, one field overlapping two others, and one on its own
+
+    std::vector<Field> fields;
+    for (size_t offset = 0; offset < 2000; offset += 100) {
+        fields.push_back(Field{path, (offset * 7) % 2000, 100});
+    }
+    fields.push_back(Field{path, 450, 100});
+    fields.push_back(Field{path, 3000, 100});
+
+    std::vector<Request> requests{{1, fields}};
+
+    ReadScheduler scheduler(schedulerConfig());
+    Recorder recorder;
+    ReadScheduler::ChannelPtr ch = channel(scheduler, recorder, false);
+
+    enqueue(scheduler, ch, requests[0]);
+    scheduler.wait(ch);
+
+    std::vector<Sent> sent = recorder.sent();
+    checkSent(sent, requests);
+
+    // The fields of one read are in the same buffer, at the same positions relative to each other as in the
+    // file. Buffers are reused once sent, but not at the same position relative to the file.
+
+    std::map<size_t, const char*> bases;
+    for (size_t i = 0; i < fields.size(); ++i) {
+        bases[fields[i].offset_] = sent[i].address_ - fields[i].offset_;
+    }
+
+    std::set<const char*> reads;
+    for (const auto& base : bases) {
+        reads.insert(base.second);
+    }
+    EXPECT(reads.size() == 3);
+
+    // The fields are read from 0 for as far as the coalescing limit allows, then from the next field on.
+
+    for (const auto& base : bases) {
+        size_t first = (base.first + 100 <= coalesce) ? 0 : (base.first < 3000 ? 1000 : 3000);
+        EXPECT(base.second == bases[first]);
+    }
+
+    path.unlink();
+}
+
+CASE("Fields larger than the read-ahead are sent") {
+
+    PathName path = file("read_scheduler_4.data", 5 * readAhead, 'a');
+
+    for (bool sendfile : {false, true}) {
+
+        std::vector<Request> requests{
+            {1, {{path, 0, 100}, {path, 100, 3 * readAhead}, {path, 50, 100}}},
+            {2, {{path, 0, 5 * readAhead}}},
+            {3, {{path, 10, 10}}},
+        };
+
+        ReadScheduler scheduler(schedulerConfig());
+        Recorder recorder;
+        ReadScheduler::ChannelPtr ch = channel(scheduler, recorder, sendfile);
+
+        for (const Request& request : requests) {
+            enqueue(scheduler, ch, request);
+        }
+        scheduler.wait(ch);
+
+        checkSent(recorder.sent(), requests);
+    }
+
+    path.unlink();
+}
+
+CASE("A field that cannot be read fails its own request, and not those behind it") {
+
+    PathName path = file("read_scheduler_5.data", 2000, 'a');
+    PathName missing("read_scheduler_missing.data");
+    if (missing.exists()) {
+        missing.unlink();
+    }
+
+    for (bool sendfile : {false, true}) {
+
+        std::vector<Request> requests{
+            {1, {{path, 0, 100}, {path, 100, 100}}},
+            {2, {{path, 200, 100}, {missing, 0, 100}, {path, 300, 100}}},
+            {3, {{path, 400, 100}, {path, 0, 50}}},
+            {4, {{missing, 100, 10}}},
+            {5, {{path, 1000, 1000}}},
+        };
+
+        ReadScheduler scheduler(schedulerConfig());
+        Recorder recorder;
+        ReadScheduler::ChannelPtr ch = channel(scheduler, recorder, sendfile);
+
+        for (const Request& request : requests) {
+            enqueue(scheduler, ch, request);
+        }
+        scheduler.wait(ch);
+
+        checkSent(recorder.sent(), requests, {2, 4});
+    }
+
+    path.unlink();
+}
+
+CASE("Requests for far more than the read-ahead are all sent, whether or not they fail") {
+
+    PathName path = file("read_scheduler_6.data", 2000, 'a');
+    PathName missing("read_scheduler_missing.data");
+
+    // The data held is released as it is sent, or as requests fail, so that the scheduler never stalls
+
+    std::vector<Request> requests;
+    std::set<uint32_t> failing;
+    for (uint32_t id = 0; id < 50; ++id) {
+        std::vector<Field> fields;
+        for (size_t i = 0; i < 10; ++i) {
+            fields.push_back(Field{path, (id * 100 + i * 150) % 1900, 100});
+        }
+        if (id % 5 == 2) {
+            fields.insert(fields.begin() + 3, Field{missing, 0, 100});
+            failing.insert(id);
+        }
+        requests.emplace_back(id, fields);
+    }
+
+    ReadScheduler scheduler(schedulerConfig());
+    Recorder recorder;
+    ReadScheduler::ChannelPtr ch = channel(scheduler, recorder, false);
+
+    for (const Request& request : requests) {
+        enqueue(scheduler, ch, request);
+    }
+    scheduler.wait(ch);
+
+    checkSent(recorder.sent(), requests, failing);
+
+    // And later requests are still served
+
+    Recorder after;
+    ReadScheduler::ChannelPtr ch2 = channel(scheduler, after, false);
+    std::vector<Request> more{{100, {{path, 0, 2000}}}};
+
+    enqueue(scheduler, ch2, more[0]);
+    scheduler.wait(ch2);
+
+    checkSent(after.sent(), more);
+
+    path.unlink();
+}
+
+CASE("Requests still queued are completed on close") {
+
+    PathName path = file("read_scheduler_7.data", 2000, 'a');
+
+    std::vector<Request> requests;
+    for (uint32_t id = 0; id < 20; ++id) {
+        requests.emplace_back(id, std::vector<Field>{{path, id * 50, 500}, {path, 0, 100}});
+    }
+
+    Recorder recorder;
+    {
+        ReadScheduler scheduler(schedulerConfig());
+        ReadScheduler::ChannelPtr ch = channel(scheduler, recorder, false);
+
+        for (const Request& request : requests) {
+            enqueue(scheduler, ch, request);
+        }
+        scheduler.close();
+    }
+
+    checkSent(recorder.sent(), requests);
+
+    path.unlink();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+
+    // A small read-ahead and coalescing limit, so that requests of small fields exceed them
+    ::setenv("FDB_SERVER_READ_AHEAD", std::to_string(fdb::test::readAhead).c_str(), 1);
+    ::setenv("FDB_SERVER_READ_COALESCE", std::to_string(fdb::test::coalesce).c_str(), 1);
+
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
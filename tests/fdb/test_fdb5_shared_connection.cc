@@ -0,0 +1,326 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_shared_connection.cc
+/// @date   Oct 2026
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/log/Log.h"
+#include "eckit/net/TCPServer.h"
+#include "eckit/runtime/Main.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/remote/EventServer.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const size_t nsteps = 12;
+
+/// An event driven server, running for the lifetime of the process. The shared connections are kept open by
+/// the client for as long, so the server must outlive them.
+class TestServer {
+public:
+    static TestServer& instance() {
+        static TestServer server;
+        return server;
+    }
+    int port() const { return port_; }
+
+private:
+    TestServer() : server_(0), port_(server_.localPort()) {
+        fdb5::Config config = fdb5::Config().expandConfig();
+        config.set("serverWorkers", 2L);
+        events_.reset(new remote::EventServer(server_, config));
+        thread_ = std::thread([this] { events_->run(); });
+    }
+    ~TestServer() {
+        events_->stop();
+        thread_.join();
+    }
+
+    net::TCPServer server_;
+    int port_;
+    std::unique_ptr<remote::EventServer> events_;
+    std::thread thread_;
+};
+
+static fdb5::Config clientConfig() {
+    eckit::LocalConfiguration conf;
+    conf.set("type", "remote");
+    conf.set("host", "localhost");
+    conf.set("port", TestServer::instance().port());
+    conf.set("shareConnections", true);
+    return fdb5::Config(conf);
+}
+
+static void wipe(const std::string& expver) {
+    fdb5::FDB fdb;
+    WipeIterator it = fdb.wipe(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true, false, true);
+    WipeElement el;
+    while (it.next(el)) {}
+}
+
+static Key key(const std::string& expver, size_t step) {
+    Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("date", "20200501");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("type", "fc");
+    key.set("levtype", "sfc");
+    key.set("step", std::to_string(step));
+    key.set("param", "130");
+    return key;
+}
+
+static std::string data(const std::string& expver, size_t step) {
+    return "Raining cats and dogs " + expver + " " + std::string(step * 100, char('a' + step));
+}
+
+static void archive(fdb5::FDB& fdb, const std::string& expver, size_t step) {
+    std::string d = data(expver, step);
+    fdb.archive(key(expver, step), d.c_str(), d.size());
+}
+
+static metkit::mars::MarsRequest retrieveRequest(const std::string& expver, const std::vector<size_t>& steps) {
+    metkit::mars::MarsRequest request("retrieve");
+    for (const auto& kv : key(expver, 0)) {
+        request.setValue(kv.first, kv.second);
+    }
+    std::vector<std::string> values;
+    for (size_t step : steps) {
+        values.push_back(std::to_string(step));
+    }
+    request.values("step", values);
+    return request;
+}
+
+static std::string readAll(DataHandle& dh) {
+    MemoryHandle out;
+    dh.saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+/// The data of the request, read directly rather than through the server
+static std::string expected(const metkit::mars::MarsRequest& request) {
+    fdb5::FDB fdb;
+    std::unique_ptr<DataHandle> dh(fdb.retrieve(request));
+    return readAll(*dh);
+}
+
+static std::string describe(const fdb5::FDB& fdb) {
+    std::ostringstream ss;
+    ss << fdb;
+    return ss.str();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Clients sharing a connection receive the data of their own retrieves, however interleaved") {
+
+    wipe("xsc1");
+    {
+        fdb5::FDB fdb(clientConfig());
+        for (size_t step = 0; step < nsteps; ++step) {
+            archive(fdb, "xsc1", step);
+        }
+        fdb.flush();
+    }
+
+    std::vector<size_t> even;
+    std::vector<size_t> odd;
+    for (size_t step = 0; step < nsteps; ++step) {
+        (step % 2 ? odd : even).push_back(step);
+    }
+
+    metkit::mars::MarsRequest request1 = retrieveRequest("xsc1", even);
+    metkit::mars::MarsRequest request2 = retrieveRequest("xsc1", odd);
+    std::string expected1 = expected(request1);
+    std::string expected2 = expected(request2);
+    EXPECT(!expected1.empty());
+    EXPECT(!expected2.empty());
+
+    fdb5::FDB fdb1(clientConfig());
+    fdb5::FDB fdb2(clientConfig());
+
+    // Both requests are outstanding at once, and their data is read a little of each at a time
+
+    std::unique_ptr<DataHandle> dh1(fdb1.retrieve(request1));
+    std::unique_ptr<DataHandle> dh2(fdb2.retrieve(request2));
+
+    EXPECT(describe(fdb1).find("data=") != std::string::npos);
+    EXPECT(describe(fdb1) == describe(fdb2));
+
+    dh1->openForRead();
+    dh2->openForRead();
+
+    std::string result1;
+    std::string result2;
+    std::vector<char> buffer(37);
+    bool done1 = false;
+    bool done2 = false;
+    while (!done1 || !done2) {
+        if (!done1) {
+            long n = dh1->read(buffer.data(), buffer.size());
+            result1.append(buffer.data(), std::max(n, 0L));
+            done1 = (n <= 0);
+        }
+        if (!done2) {
+            long n = dh2->read(buffer.data(), buffer.size());
+            result2.append(buffer.data(), std::max(n, 0L));
+            done2 = (n <= 0);
+        }
+    }
+
+    dh1->close();
+    dh2->close();
+
+    EXPECT(result1 == expected1);
+    EXPECT(result2 == expected2);
+
+    // And again, from many threads at once
+
+    std::vector<std::string> results(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&results, &request1, &request2, i] {
+            try {
+                fdb5::FDB fdb(clientConfig());
+                std::unique_ptr<DataHandle> dh(fdb.retrieve(i % 2 ? request2 : request1));
+                results[i] = readAll(*dh);
+            } catch (std::exception& e) {
+                results[i] = std::string("Error: ") + e.what();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        EXPECT(results[i] == (i % 2 ? expected2 : expected1));
+    }
+}
+
+CASE("A client archives through a shared connection while another reads through it") {
+
+    wipe("xsc2");
+    wipe("xsc3");
+    {
+        fdb5::FDB fdb(clientConfig());
+        for (size_t step = 0; step < nsteps; ++step) {
+            archive(fdb, "xsc2", step);
+        }
+        fdb.flush();
+    }
+
+    std::vector<size_t> steps;
+    for (size_t step = 0; step < nsteps; ++step) {
+        steps.push_back(step);
+    }
+
+    metkit::mars::MarsRequest request = retrieveRequest("xsc2", steps);
+    std::string expectedRead = expected(request);
+
+    fdb5::FDB writer(clientConfig());
+    fdb5::FDB reader(clientConfig());
+
+    std::atomic<bool> archiving(true);
+    std::string error;
+
+    std::thread archiver([&writer, &archiving, &error] {
+        try {
+            for (size_t round = 0; round < 5; ++round) {
+                for (size_t step = 0; step < nsteps; ++step) {
+                    archive(writer, "xsc3", step);
+                }
+                writer.flush();
+            }
+        } catch (std::exception& e) {
+            error = e.what();
+        }
+        archiving = false;
+    });
+
+    // n.b. nothing may throw until the archiving thread has been joined
+
+    size_t reads = 0;
+    size_t mismatched = 0;
+    while (archiving || reads == 0) {
+        try {
+            std::unique_ptr<DataHandle> dh(reader.retrieve(request));
+            if (readAll(*dh) != expectedRead) {
+                ++mismatched;
+            }
+        } catch (std::exception& e) {
+            Log::error() << "Error reading while archiving: " << e.what() << std::endl;
+            ++mismatched;
+        }
+        ++reads;
+    }
+
+    archiver.join();
+    EXPECT(error.empty());
+    EXPECT(mismatched == 0);
+
+    Log::info() << "Read " << reads << " times while archiving" << std::endl;
+
+    EXPECT(describe(writer) == describe(reader));
+
+    // What was archived can be read back by either client
+
+    metkit::mars::MarsRequest archived = retrieveRequest("xsc3", steps);
+    std::string expectedArchived = expected(archived);
+
+    size_t length = 0;
+    for (size_t step : steps) {
+        length += data("xsc3", step).size();
+    }
+    EXPECT(expectedArchived.size() == length);
+
+    std::unique_ptr<DataHandle> dh(reader.retrieve(archived));
+    EXPECT(readAll(*dh) == expectedArchived);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,178 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_toc_cache.cc
+/// @date   Oct 2026
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/TransferWatcher.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/toc/TocCatalogueCache.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class NullWatcher : public eckit::TransferWatcher {
+    void watch(const void*, long) override {}
+};
+
+static void writeFile(const PathName& path, const std::string& data, bool append = false) {
+    FileHandle fh(path);
+    if (append) {
+        fh.openForAppend(0);
+    } else {
+        fh.openForWrite(0);
+    }
+    fh.write(data.c_str(), data.size());
+    fh.close();
+}
+
+/// Reads a TOC through the cache, as TocHandler does
+static std::string readToc(TocCatalogueCache& cache, const PathName& path) {
+
+    NullWatcher watcher;
+
+    int fd;
+    SYSCALL2(fd = ::open(path.localPath(), O_RDONLY), path);
+    TocCatalogueCache::TocData data = cache.toc(path, fd, watcher);
+    ::close(fd);
+
+    return std::string(static_cast<const char*>(data->data()), data->size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("A cache without a budget is disabled") {
+    TocCatalogueCache cache(0);
+    EXPECT(!cache.enabled());
+}
+
+CASE("TOCs are evicted in least recently used order") {
+
+    // Room for two TOCs of 10000 bytes, but not for three
+
+    TocCatalogueCache cache(25000);
+    EXPECT(cache.enabled());
+
+    PathName a("toc_cache_a");
+    PathName b("toc_cache_b");
+    PathName c("toc_cache_c");
+
+    writeFile(a, std::string(10000, 'a'));
+    writeFile(b, std::string(10000, 'b'));
+    writeFile(c, std::string(10000, 'c'));
+
+    EXPECT(readToc(cache, a) == std::string(10000, 'a'));
+    EXPECT(readToc(cache, b) == std::string(10000, 'b'));
+    EXPECT(cache.statistics().misses_ == 2);
+    EXPECT(cache.statistics().entries_ == 2);
+
+    // Touch a, so that b becomes the least recently used
+
+    readToc(cache, a);
+    EXPECT(cache.statistics().hits_ == 1);
+
+    EXPECT(readToc(cache, c) == std::string(10000, 'c'));
+
+    TocCatalogueCacheStats stats = cache.statistics();
+    EXPECT(stats.misses_ == 3);
+    EXPECT(stats.evictions_ == 1);
+    EXPECT(stats.entries_ == 2);
+    EXPECT(stats.bytes_ <= stats.capacity_);
+
+    // a and c are still cached, b has gone
+
+    readToc(cache, a);
+    readToc(cache, c);
+    EXPECT(cache.statistics().hits_ == 3);
+    EXPECT(cache.statistics().misses_ == 3);
+
+    EXPECT(readToc(cache, b) == std::string(10000, 'b'));
+    EXPECT(cache.statistics().misses_ == 4);
+    EXPECT(cache.statistics().evictions_ == 2);
+
+    // Items larger than the whole budget are not cached
+
+    PathName big("toc_cache_big");
+    writeFile(big, std::string(30000, 'x'));
+
+    EXPECT(readToc(cache, big) == std::string(30000, 'x'));
+    EXPECT(readToc(cache, big) == std::string(30000, 'x'));
+    EXPECT(cache.statistics().misses_ == 6);
+    EXPECT(cache.statistics().evictions_ == 2);
+
+    cache.clear();
+    EXPECT(cache.statistics().entries_ == 0);
+    EXPECT(cache.statistics().bytes_ == 0);
+}
+
+CASE("Cached TOCs are revalidated when the TOC changes") {
+
+    TocCatalogueCache cache(1024 * 1024);
+
+    PathName path("toc_cache_toc");
+    writeFile(path, "first");
+
+    EXPECT(readToc(cache, path) == "first");
+    EXPECT(readToc(cache, path) == "first");
+    EXPECT(cache.statistics().misses_ == 1);
+    EXPECT(cache.statistics().hits_ == 1);
+
+    // A TOC that has been appended to is extended with the new records
+
+    writeFile(path, "second", true);
+
+    EXPECT(readToc(cache, path) == "firstsecond");
+    EXPECT(cache.statistics().refreshes_ == 1);
+    EXPECT(cache.statistics().misses_ == 1);
+
+    EXPECT(readToc(cache, path) == "firstsecond");
+    EXPECT(cache.statistics().hits_ == 2);
+
+    // A TOC that has been replaced (e.g. by re-consolidation) is a different file, and is re-read in full
+
+    PathName replacement("toc_cache_toc.new");
+    writeFile(replacement, "replaced");
+    PathName::rename(replacement, path);
+
+    EXPECT(readToc(cache, path) == "replaced");
+    EXPECT(cache.statistics().misses_ == 2);
+    EXPECT(cache.statistics().refreshes_ == 1);
+    EXPECT(cache.statistics().entries_ == 1);
+
+    EXPECT(readToc(cache, path) == "replaced");
+    EXPECT(cache.statistics().hits_ == 3);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,260 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_toc_index_records.cc
+/// @date   Oct 2026
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/DataHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/runtime/Main.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/EntryVisitMechanism.h"
+#include "fdb5/database/Field.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/TocHandler.h"
+#include "fdb5/toc/TocIndex.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// The fields archived by each flush, by type. Each type is archived into an index of its own.
+const std::vector<std::vector<std::string>> flushes{{"fc", "an", "cf"}, {"an", "fc"}, {"cf"}};
+
+static fdb5::Config tocConfig(bool subTocs) {
+    eckit::LocalConfiguration userConf;
+    userConf.set("useSubToc", subTocs);
+    return fdb5::Config(fdb5::Config().expandConfig(), userConf);
+}
+
+static void wipe(const std::string& expver) {
+    fdb5::FDB fdb;
+    WipeIterator it = fdb.wipe(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true, false, true);
+    WipeElement el;
+    while (it.next(el)) {}
+}
+
+static std::string data(const std::string& type, size_t step) {
+    return "Raining cats and dogs " + type + " " + std::to_string(step);
+}
+
+static void archive(fdb5::FDB& fdb, const std::string& expver, const std::string& type, size_t step) {
+
+    Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("date", "20200701");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("type", type);
+    key.set("levtype", "sfc");
+    key.set("step", std::to_string(step));
+    key.set("param", "130");
+
+    std::string d = data(type, step);
+    fdb.archive(key, d.c_str(), d.size());
+}
+
+/// Archive the fields of each flush, with the step of the flush, and flush them together
+static void archiveAll(fdb5::FDB& fdb, const std::string& expver) {
+    for (size_t step = 0; step < flushes.size(); ++step) {
+        for (const std::string& type : flushes[step]) {
+            archive(fdb, expver, type, step);
+        }
+        fdb.flush();
+    }
+}
+
+static PathName databaseDirectory(const std::string& expver) {
+
+    metkit::mars::MarsRequest request("retrieve");
+    request.setValue("class", "rd");
+    request.setValue("expver", expver);
+
+    fdb5::FDB fdb;
+    ListIterator it = fdb.list(FDBToolRequest(request));
+    ListElement el;
+    EXPECT(it.next(el));
+    return el.location().uri().path().dirName();
+}
+
+static const TocIndex& tocIndex(const Index& index) {
+    const TocIndex* tocidx = dynamic_cast<const TocIndex*>(index.content());
+    ASSERT(tocidx);
+    return *tocidx;
+}
+
+/// The data of the fields in an index
+static std::set<std::string> contents(const Index& index) {
+
+    class DataVisitor : public EntryVisitor {
+    public:
+        std::set<std::string> data_;
+    private:
+        void visitDatum(const Field&, const Key&) override { NOTIMP; }
+        void visitDatum(const Field& field, const std::string&) override {
+            std::unique_ptr<DataHandle> dh(field.dataHandle());
+            MemoryHandle out;
+            dh->saveInto(out);
+            data_.insert(std::string(static_cast<const char*>(out.data()), out.size()));
+        }
+    };
+
+    DataVisitor visitor;
+    index.entries(visitor);
+    return visitor.data_;
+}
+
+/// Checks that the indexes, in the order of their records in the TOC, are those written by each flush
+static void checkFlushes(const std::vector<Index>& indexes) {
+
+    size_t n = 0;
+    for (const auto& types : flushes) {
+        n += types.size();
+    }
+    EXPECT(indexes.size() == n);
+
+    // The records of a flush are appended together, and in no particular order within it. Each index is
+    // reopened after it is flushed, so those of a later flush follow on in the same index file.
+
+    std::map<std::string, const TocIndex*> previous;
+
+    auto index = indexes.begin();
+    for (size_t step = 0; step < flushes.size(); ++step) {
+
+        std::set<std::string> expected(flushes[step].begin(), flushes[step].end());
+        std::set<std::string> found;
+
+        for (size_t i = 0; i < flushes[step].size(); ++i, ++index) {
+
+            std::string type = index->key().get("type");
+            found.insert(type);
+            EXPECT(contents(*index) == std::set<std::string>({data(type, step)}));
+
+            const TocIndex& tocidx = tocIndex(*index);
+            auto prev = previous.find(type);
+            if (prev != previous.end()) {
+                EXPECT(tocidx.path() == prev->second->path());
+                EXPECT(tocidx.offset() > prev->second->offset());
+            }
+            previous[type] = &tocidx;
+        }
+
+        EXPECT(found == expected);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("The indexes of each flush are recorded in the TOC together, and in order") {
+
+    wipe("xir1");
+    {
+        fdb5::FDB fdb(tocConfig(false));
+        archiveAll(fdb, "xir1");
+    }
+
+    TocHandler handler(databaseDirectory("xir1"), tocConfig(false));
+
+    std::vector<bool> inSubToc;
+    std::vector<Index> indexes = handler.loadIndexes(false, nullptr, &inSubToc);
+
+    // n.b. loaded with the most recent first
+
+    std::reverse(indexes.begin(), indexes.end());
+    checkFlushes(indexes);
+
+    EXPECT(std::find(inSubToc.begin(), inSubToc.end(), true) == inSubToc.end());
+    EXPECT(handler.subTocPaths().empty());
+}
+
+CASE("With sub-TOCs, the indexes of each flush are recorded in the sub-TOC, and compacted on close") {
+
+    wipe("xir2");
+
+    PathName directory;
+    {
+        fdb5::FDB fdb(tocConfig(true));
+        archiveAll(fdb, "xir2");
+
+        // While the writer is open, its flushes are found through the sub-TOC
+
+        directory = databaseDirectory("xir2");
+        TocHandler handler(directory, tocConfig(false));
+
+        std::set<std::string> subTocs;
+        std::vector<bool> inSubToc;
+        std::vector<Index> indexes = handler.loadIndexes(false, &subTocs, &inSubToc);
+
+        std::reverse(indexes.begin(), indexes.end());
+        checkFlushes(indexes);
+
+        EXPECT(subTocs.size() == 1);
+        EXPECT(std::find(inSubToc.begin(), inSubToc.end(), false) == inSubToc.end());
+    }
+
+    // Once it is closed, the sub-TOC is masked, and replaced by one full index of each type
+
+    TocHandler handler(directory, tocConfig(false));
+
+    std::vector<bool> inSubToc;
+    std::vector<Index> indexes = handler.loadIndexes(false, nullptr, &inSubToc);
+
+    std::set<std::string> types;
+    for (const Index& index : indexes) {
+        std::string type = index.key().get("type");
+        EXPECT(types.insert(type).second);
+
+        std::set<std::string> expected;
+        for (size_t step = 0; step < flushes.size(); ++step) {
+            if (std::find(flushes[step].begin(), flushes[step].end(), type) != flushes[step].end()) {
+                expected.insert(data(type, step));
+            }
+        }
+        EXPECT(contents(index) == expected);
+    }
+
+    EXPECT(types == std::set<std::string>({"fc", "an", "cf"}));
+    EXPECT(std::find(inSubToc.begin(), inSubToc.end(), true) == inSubToc.end());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,193 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_toc_record.cc
+/// @date   Oct 2026
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/runtime/Main.h"
+#include "eckit/serialisation/MemoryStream.h"
+
+#include "fdb5/toc/TocRecord.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+const unsigned int compactVersion = 5;
+
+static std::string hostname(const TocRecord::Header& header) {
+    std::string host(header.hostname_.asString());
+    return host.substr(0, host.find('\0'));
+}
+
+/// A record with a payload, as built for writing. @returns the payload size.
+static size_t build(TocRecord& r, const std::string& path, off_t offset) {
+    eckit::MemoryStream s(&r.payload_[0], r.maxPayloadSize);
+    s << path;
+    s << offset;
+    return s.position();
+}
+
+/// Copy a stored record, a prefix at a time, as it is read from a TOC
+static std::unique_ptr<TocRecord> readBack(const TocRecord& stored) {
+
+    std::unique_ptr<TocRecord> r(new TocRecord(compactVersion));
+    char* p = reinterpret_cast<char*>(r.get());
+    const char* q = reinterpret_cast<const char*>(&stored);
+
+    ::memcpy(p, q, TocRecord::prefixSize);
+    size_t hdrSize = r->storedHeaderSize();
+    ::memcpy(p, q, hdrSize);
+    size_t size = r->storedSize();
+    ::memcpy(p, q, size);
+
+    return r;
+}
+
+static void corrupt(TocRecord& r, size_t offset) {
+    reinterpret_cast<unsigned char*>(&r)[offset] ^= 0x01;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Compact records give back what was written") {
+
+    std::unique_ptr<TocRecord> out(new TocRecord(compactVersion, TocRecord::TOC_INDEX));
+    size_t payloadSize = build(*out, "index.file", 12345);
+    TocRecord::Header original = out->header_;
+
+    size_t size = out->pack(payloadSize);
+
+    // Tightly packed, in place of the full size header
+
+    EXPECT(size % 8 == 0);
+    EXPECT(size < sizeof(TocRecord::Header) + payloadSize);
+    EXPECT(out->storedHeaderSize() == sizeof(TocRecord::CompactHeader));
+    EXPECT(out->storedSize() == size);
+
+    std::unique_ptr<TocRecord> in = readBack(*out);
+    in->unpack();
+
+    EXPECT(in->header_.tag_ == TocRecord::TOC_INDEX);
+    EXPECT(in->header_.serialisationVersion_ == compactVersion);
+    EXPECT(in->header_.fdbVersion_ == original.fdbVersion_);
+    EXPECT(in->header_.timestamp_.tv_sec == original.timestamp_.tv_sec);
+    EXPECT(in->header_.timestamp_.tv_usec == original.timestamp_.tv_usec);
+    EXPECT(in->header_.pid_ == original.pid_);
+    EXPECT(in->header_.uid_ == original.uid_);
+    EXPECT(hostname(in->header_) == hostname(original));
+    EXPECT(in->header_.size_ == size);
+
+    eckit::MemoryStream s(&in->payload_[0], in->maxPayloadSize);
+    std::string path;
+    off_t offset;
+    s >> path;
+    s >> offset;
+    EXPECT(path == "index.file");
+    EXPECT(offset == 12345);
+}
+
+CASE("Compact records may have empty or maximal payloads") {
+
+    std::unique_ptr<TocRecord> empty(new TocRecord(compactVersion, TocRecord::TOC_CLEAR));
+    size_t size = empty->pack(0);
+    EXPECT(size == empty->storedSize());
+
+    std::unique_ptr<TocRecord> in = readBack(*empty);
+    in->unpack();
+    EXPECT(in->header_.tag_ == TocRecord::TOC_CLEAR);
+
+    std::unique_ptr<TocRecord> full(new TocRecord(compactVersion, TocRecord::TOC_INDEX));
+    for (size_t i = 0; i < TocRecord::maxPayloadSize; ++i) {
+        full->payload_[i] = static_cast<unsigned char>(i % 251);
+    }
+
+    size = full->pack(TocRecord::maxPayloadSize);
+    EXPECT(size <= sizeof(TocRecord));
+
+    in = readBack(*full);
+    in->unpack();
+    for (size_t i = 0; i < TocRecord::maxPayloadSize; ++i) {
+        if (in->payload_[i] != static_cast<unsigned char>(i % 251)) {
+            EXPECT(false);
+            break;
+        }
+    }
+}
+
+CASE("Corrupt compact records are detected when read") {
+
+    std::unique_ptr<TocRecord> out(new TocRecord(compactVersion, TocRecord::TOC_INDEX));
+    size_t payloadSize = build(*out, "index.file", 12345);
+    size_t size = out->pack(payloadSize);
+
+    EXPECT_NO_THROW(readBack(*out)->unpack());
+
+    // A flipped bit anywhere in the checksummed part of the record, or in the checksum itself
+
+    for (size_t offset : {sizeof(TocRecord::CompactHeader), size / 2, size - 1,
+                          offsetof(TocRecord::CompactHeader, checksum_)}) {
+        std::unique_ptr<TocRecord> in = readBack(*out);
+        corrupt(*in, offset);
+        EXPECT_THROWS_AS(in->unpack(), eckit::SeriousBug);
+    }
+
+    // A size too small to hold the header and hostname
+
+    std::unique_ptr<TocRecord> in = readBack(*out);
+    uint32_t bad = sizeof(TocRecord::CompactHeader) - 8;
+    ::memcpy(reinterpret_cast<char*>(in.get()) + offsetof(TocRecord::CompactHeader, size_), &bad, sizeof(bad));
+    EXPECT_THROWS_AS(in->unpack(), eckit::SeriousBug);
+}
+
+CASE("Records before version 5 are stored as they are") {
+
+    for (unsigned int version : {2, 3, 4}) {
+
+        EXPECT(!TocRecord::compact(version));
+
+        std::unique_ptr<TocRecord> r(new TocRecord(version, TocRecord::TOC_INDEX));
+        size_t payloadSize = build(*r, "index.file", 12345);
+        r->header_.size_ = sizeof(TocRecord::Header) + payloadSize;
+
+        EXPECT(r->storedHeaderSize() == sizeof(TocRecord::Header));
+        EXPECT(r->storedSize() == sizeof(TocRecord::Header) + payloadSize);
+
+        r->unpack();
+
+        eckit::MemoryStream s(&r->payload_[0], r->maxPayloadSize);
+        std::string path;
+        s >> path;
+        EXPECT(path == "index.file");
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,283 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_toc_refresh.cc
+/// @date   Oct 2026
+
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "eckit/config/LocalConfiguration.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/Offset.h"
+#include "eckit/runtime/Main.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+#include "fdb5/toc/TocHandler.h"
+#include "fdb5/toc/TocIndex.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+using IndexId = std::pair<PathName, Offset>;
+
+static fdb5::Config tocConfig(bool subTocs) {
+    eckit::LocalConfiguration userConf;
+    userConf.set("useSubToc", subTocs);
+    return fdb5::Config(fdb5::Config().expandConfig(), userConf);
+}
+
+/// Start from an empty database, irrespective of previous runs
+static void wipe(const std::string& expver) {
+    fdb5::FDB fdb;
+    WipeIterator it = fdb.wipe(FDBToolRequest::requestsFromString("class=rd,expver=" + expver)[0], true, false, true);
+    WipeElement el;
+    while (it.next(el)) {}
+}
+
+static void archive(fdb5::FDB& fdb, const std::string& expver, const std::string& type, const std::string& step) {
+
+    Key key;
+    key.set("class", "rd");
+    key.set("expver", expver);
+    key.set("stream", "oper");
+    key.set("date", "20200301");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("type", type);
+    key.set("levtype", "sfc");
+    key.set("step", step);
+    key.set("param", "130");
+
+    std::string data = "Raining cats and dogs " + type + " " + step;
+    fdb.archive(key, data.c_str(), data.size());
+    fdb.flush();
+}
+
+static PathName databaseDirectory(const std::string& expver) {
+
+    metkit::mars::MarsRequest request("retrieve");
+    request.setValue("class", "rd");
+    request.setValue("expver", expver);
+
+    fdb5::FDB fdb;
+    ListIterator it = fdb.list(FDBToolRequest(request));
+    ListElement el;
+    EXPECT(it.next(el));
+    return el.location().uri().path().dirName();
+}
+
+static IndexId indexId(const Index& index) {
+    const TocIndex* tocidx = dynamic_cast<const TocIndex*>(index.content());
+    ASSERT(tocidx);
+    return IndexId(tocidx->path().baseName(), tocidx->offset());
+}
+
+/// The indexes visible to a reader that has just opened the TOC
+static std::set<IndexId> loadedIndexes(const PathName& directory) {
+    TocHandler handler(directory, tocConfig(false));
+    std::set<IndexId> ids;
+    for (const Index& index : handler.loadIndexes()) {
+        ids.insert(indexId(index));
+    }
+    return ids;
+}
+
+/// Apply a refresh to the indexes previously visible to a reader
+static void apply(std::set<IndexId>& ids, const TocIndexUpdate& update) {
+    if (update.clearedAll_) {
+        ids.clear();
+    }
+    for (const IndexId& id : update.cleared_) {
+        EXPECT(ids.erase(id) == 1);
+    }
+    for (const auto& added : update.added_) {
+        EXPECT(ids.insert(indexId(added.first)).second);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Refreshing a TOC picks up indexes appended, masked and cleared since it was loaded") {
+
+    wipe("xrf1");
+    {
+        fdb5::FDB fdb;
+        archive(fdb, "xrf1", "fc", "0");
+    }
+
+    PathName directory = databaseDirectory("xrf1");
+
+    TocHandler reader(directory, tocConfig(false));
+    std::set<IndexId> visible;
+    for (const Index& index : reader.loadIndexes()) {
+        visible.insert(indexId(index));
+    }
+    EXPECT(visible.size() == 1);
+
+    TocIndexUpdate update;
+    EXPECT(!reader.refreshIndexes(update));
+    EXPECT(update.added_.empty());
+
+    // Indexes written by another writer (each flush writes a further index record)
+
+    {
+        fdb5::FDB fdb;
+        archive(fdb, "xrf1", "an", "0");
+        archive(fdb, "xrf1", "an", "6");
+    }
+
+    EXPECT(reader.refreshIndexes(update));
+    EXPECT(!update.clearedAll_);
+    EXPECT(update.cleared_.empty());
+    EXPECT(update.added_.size() == 2);
+
+    // ... newest first
+
+    EXPECT(update.added_[0].first.key().value("type") == "an");
+    EXPECT(update.added_[1].first.key().value("type") == "an");
+    EXPECT(indexId(update.added_[1].first).second < indexId(update.added_[0].first).second);
+
+    apply(visible, update);
+    EXPECT(visible == loadedIndexes(directory));
+    EXPECT(visible.size() == 3);
+
+    // Mask one of the indexes that was found by the refresh
+
+    Index masked = update.added_[0].first;
+    {
+        TocHandler writer(directory, tocConfig(false));
+        writer.writeClearRecord(masked);
+    }
+
+    EXPECT(reader.refreshIndexes(update));
+    EXPECT(update.added_.empty());
+    EXPECT(update.cleared_.size() == 1);
+    EXPECT(update.cleared_.count(indexId(masked)) == 1);
+
+    apply(visible, update);
+    EXPECT(visible == loadedIndexes(directory));
+    EXPECT(visible.size() == 2);
+
+    // Clear everything, then add an index after the clear record
+
+    {
+        TocHandler writer(directory, tocConfig(false));
+        writer.writeClearAllRecord();
+    }
+    {
+        fdb5::FDB fdb;
+        archive(fdb, "xrf1", "fc", "12");
+    }
+
+    EXPECT(reader.refreshIndexes(update));
+    EXPECT(update.clearedAll_);
+    EXPECT(update.added_.size() == 1);
+
+    apply(visible, update);
+    EXPECT(visible == loadedIndexes(directory));
+    EXPECT(visible.size() == 1);
+
+    EXPECT(!reader.refreshIndexes(update));
+}
+
+CASE("Refreshing a TOC follows indexes appended to subtocs") {
+
+    wipe("xrf2");
+
+    PathName directory;
+    std::unique_ptr<TocHandler> reader;
+    std::set<IndexId> visible;
+    TocIndexUpdate update;
+
+    {
+        fdb5::FDB fdb(tocConfig(true));
+        archive(fdb, "xrf2", "fc", "0");
+
+        directory = databaseDirectory("xrf2");
+
+        reader.reset(new TocHandler(directory, tocConfig(false)));
+        for (const Index& index : reader->loadIndexes()) {
+            visible.insert(indexId(index));
+        }
+        EXPECT(visible.size() == 1);
+
+        // Appended to the subtoc that the reader has already read to the end of
+
+        archive(fdb, "xrf2", "fc", "6");
+
+        EXPECT(reader->refreshIndexes(update));
+        EXPECT(update.added_.size() == 1);
+        EXPECT(update.cleared_.empty());
+
+        apply(visible, update);
+        EXPECT(visible == loadedIndexes(directory));
+
+        // A new subtoc, from a second writer
+
+        {
+            fdb5::FDB fdb2(tocConfig(true));
+            archive(fdb2, "xrf2", "an", "0");
+
+            EXPECT(reader->refreshIndexes(update));
+            EXPECT(update.added_.size() == 1);
+            EXPECT(update.added_[0].first.key().value("type") == "an");
+
+            apply(visible, update);
+            EXPECT(visible == loadedIndexes(directory));
+            EXPECT(visible.size() == 3);
+        }
+
+        // Closing the second writer writes its indexes into the main TOC, and masks its subtoc
+
+        EXPECT(reader->refreshIndexes(update));
+        EXPECT(!update.clearedAll_);
+        EXPECT(update.cleared_.size() == 1);
+        EXPECT(update.added_.size() == 1);
+
+        apply(visible, update);
+        EXPECT(visible == loadedIndexes(directory));
+        EXPECT(visible.size() == 3);
+    }
+
+    // As does closing the first writer, masking both of the indexes read from its subtoc
+
+    EXPECT(reader->refreshIndexes(update));
+    EXPECT(update.cleared_.size() == 2);
+    EXPECT(update.added_.size() >= 1);
+
+    apply(visible, update);
+    EXPECT(visible == loadedIndexes(directory));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,276 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_uring.cc
+/// @date   Oct 2026
+
+#include <cstdlib>
+
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/log/Log.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/io/UringFileHandle.h"
+#include "fdb5/io/UringPartFileHandle.h"
+#include "fdb5/io/UringQueue.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/// As set in main()
+const size_t chunkSize = 1000;
+
+/// Everything is tested synchronously, as where io_uring is unavailable, and through io_uring where it is not
+static std::vector<bool> modes() {
+    std::vector<bool> result{false};
+    if (UringQueue::available()) {
+        result.push_back(true);
+    } else {
+        Log::warning() << "io_uring is unavailable, only the synchronous fallback is tested" << std::endl;
+    }
+    return result;
+}
+
+static std::string pattern(size_t length, char first) {
+    std::string s(length, ' ');
+    for (size_t i = 0; i < length; ++i) {
+        s[i] = char(first + (i % 23));
+    }
+    return s;
+}
+
+static PathName file(const std::string& name, const std::string& data) {
+    PathName path(name);
+    if (path.exists()) {
+        path.unlink();
+    }
+    FileHandle out(path);
+    out.openForWrite(0);
+    out.write(data.c_str(), data.size());
+    out.close();
+    return path;
+}
+
+static std::string contents(const PathName& path) {
+    MemoryHandle out;
+    FileHandle in(path);
+    in.saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+/// Reads the rest of an open handle, with reads of the given size
+static std::string readAll(DataHandle& dh, size_t bufferSize) {
+    std::string result;
+    std::vector<char> buffer(bufferSize);
+    long n;
+    while ((n = dh.read(buffer.data(), buffer.size())) > 0) {
+        result.append(buffer.data(), n);
+    }
+    EXPECT(n == 0);
+    return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Queues fall back to synchronous I/O") {
+
+    UringQueue queue(4, false);
+    EXPECT(!queue.uring());
+
+    if (UringQueue::available()) {
+        EXPECT(UringQueue(4).uring());
+        EXPECT(UringQueue::local().uring());
+    }
+}
+
+CASE("Writes of any size are gathered into buffers, and appended in order") {
+
+    for (bool uring : modes()) {
+
+        PathName path = file("uring_1.data", "existing");
+
+        std::string expected = "existing";
+        {
+            UringFileHandle dh(path, 3, 64, uring);
+            dh.openForAppend(0);
+            EXPECT(dh.position() == Offset(expected.size()));
+
+            // Less than, exactly, and many times a buffer, and buffers left part filled
+
+            for (size_t length : {1, 63, 64, 200, 5, 1000, 64, 7}) {
+                std::string data = pattern(length, 'a' + (expected.size() % 13));
+                EXPECT(dh.write(data.c_str(), data.size()) == long(data.size()));
+                expected += data;
+                EXPECT(dh.position() == Offset(expected.size()));
+            }
+
+            dh.flush();
+            EXPECT(contents(path) == expected);
+
+            std::string more = pattern(100, 'A');
+            dh.write(more.c_str(), more.size());
+            expected += more;
+
+            dh.close();
+        }
+
+        EXPECT(contents(path) == expected);
+        path.unlink();
+    }
+}
+
+CASE("Parts are read across chunk boundaries") {
+
+    std::string data = pattern(10 * chunkSize, 'a');
+    PathName path = file("uring_2.data", data);
+
+    const size_t offset = 123;
+    const size_t length = 5 * chunkSize + 17;
+    std::string expected = data.substr(offset, length);
+
+    for (bool uring : modes()) {
+
+        // In one read, many reads that each span chunks, and reads smaller than a chunk
+
+        for (size_t bufferSize : {length, 2 * chunkSize + 1, chunkSize, size_t(333)}) {
+            UringPartFileHandle dh(path, offset, length, uring);
+            EXPECT(dh.openForRead() == Length(length));
+            EXPECT(readAll(dh, bufferSize) == expected);
+            EXPECT(dh.position() == Offset(length));
+            dh.close();
+        }
+    }
+
+    path.unlink();
+}
+
+CASE("Reads are short at the end of a part, and the part may be read again") {
+
+    std::string data = pattern(4 * chunkSize, 'A');
+    PathName path = file("uring_3.data", data);
+
+    for (bool uring : modes()) {
+
+        UringPartFileHandle dh(path, 10, 2 * chunkSize, uring);
+        dh.openForRead();
+
+        std::vector<char> buffer(3 * chunkSize);
+        EXPECT(dh.read(buffer.data(), buffer.size()) == long(2 * chunkSize));
+        EXPECT(std::string(buffer.data(), 2 * chunkSize) == data.substr(10, 2 * chunkSize));
+        EXPECT(dh.read(buffer.data(), buffer.size()) == 0);
+
+        EXPECT(dh.seek(2 * chunkSize - 10) == Offset(2 * chunkSize - 10));
+        EXPECT(dh.read(buffer.data(), buffer.size()) == 10);
+        EXPECT(std::string(buffer.data(), 10) == data.substr(2 * chunkSize, 10));
+
+        dh.seek(0);
+        EXPECT(readAll(dh, chunkSize / 3) == data.substr(10, 2 * chunkSize));
+    }
+
+    path.unlink();
+}
+
+CASE("Parts that extend beyond the end of the file cannot be read") {
+
+    std::string data = pattern(3 * chunkSize, 'a');
+    PathName path = file("uring_4.data", data);
+
+    for (bool uring : modes()) {
+
+        // The read of the last chunk is short, and then reaches the end of the file
+
+        UringPartFileHandle dh(path, chunkSize / 2, 3 * chunkSize, uring);
+        dh.openForRead();
+
+        std::vector<char> buffer(3 * chunkSize);
+        EXPECT_THROWS_AS(dh.read(buffer.data(), buffer.size()), eckit::ReadError);
+
+        // Nothing at all there
+
+        UringPartFileHandle beyond(path, 4 * chunkSize, 10, uring);
+        beyond.openForRead();
+        EXPECT_THROWS_AS(beyond.read(buffer.data(), buffer.size()), eckit::ReadError);
+    }
+
+    UringPartFileHandle missing(PathName("uring_missing.data"), 0, 10);
+    EXPECT_THROWS_AS(missing.openForRead(), eckit::CantOpenFile);
+
+    path.unlink();
+}
+
+CASE("Many parts, of many files, are read as one stream") {
+
+    std::string data1 = pattern(5 * chunkSize, 'a');
+    std::string data2 = pattern(3 * chunkSize, 'A');
+    PathName path1 = file("uring_5.data", data1);
+    PathName path2 = file("uring_6.data", data2);
+
+    std::vector<UringPartFileHandle::Part> parts{
+        {path1, 4000, 200},                       // within a chunk
+        {path2, 0, 3 * chunkSize},                // spanning chunks
+        {path1, 10, 0},                           // empty
+        {path1, 100, 2 * chunkSize + 1},          // the same file again, out of order
+        {path2, 2 * chunkSize + 500, 500},        // to the end of the file
+        {path1, 4 * chunkSize, chunkSize},
+    };
+
+    std::string expected;
+    for (const auto& part : parts) {
+        const std::string& data = (part.path_ == path1) ? data1 : data2;
+        expected += data.substr((long long)part.offset_, (long long)part.length_);
+    }
+
+    for (bool uring : modes()) {
+        for (size_t bufferSize : {expected.size(), 2 * chunkSize + 3, size_t(150)}) {
+            UringPartFileHandle dh(parts, uring);
+            EXPECT(dh.size() == Length(expected.size()));
+            dh.openForRead();
+            EXPECT(readAll(dh, bufferSize) == expected);
+        }
+
+        // Reads may start part way through the stream
+
+        UringPartFileHandle dh(parts, uring);
+        dh.openForRead();
+        dh.seek(150);
+        EXPECT(readAll(dh, 1000) == expected.substr(150));
+    }
+
+    path1.unlink();
+    path2.unlink();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+
+    // Small chunks, so that small reads span many of them
+    ::setenv("FDB_URING_READ_CHUNK_SIZE", std::to_string(fdb::test::chunkSize).c_str(), 1);
+
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
@@ -0,0 +1,285 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_visit.cc
+/// @date   Oct 2026
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eckit/exception/Exceptions.h"
+#include "eckit/runtime/Main.h"
+
+#include "metkit/mars/MarsRequest.h"
+
+#include "fdb5/api/FDB.h"
+#include "fdb5/api/helpers/FDBToolRequest.h"
+#include "fdb5/api/helpers/ListIterator.h"
+#include "fdb5/api/helpers/StatsIterator.h"
+#include "fdb5/config/Config.h"
+#include "fdb5/database/Catalogue.h"
+#include "fdb5/database/EntryVisitMechanism.h"
+#include "fdb5/database/Index.h"
+#include "fdb5/database/Key.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static const char* dates[] = {"20200101", "20200102", "20200103", "20200104", "20200105"};
+
+static void archiveDatabases() {
+
+    fdb5::FDB fdb;
+
+    Key key;
+    key.set("class", "rd");
+    key.set("expver", "xvis");
+    key.set("stream", "oper");
+    key.set("time", "0000");
+    key.set("domain", "g");
+    key.set("levtype", "sfc");
+
+    std::string data("Raining cats and dogs");
+
+    for (const char* date : dates) {
+        key.set("date", date);
+        for (const char* type : {"fc", "an"}) {
+            key.set("type", type);
+            for (const char* step : {"0", "6", "12"}) {
+                key.set("step", step);
+                for (const char* param : {"130", "167"}) {
+                    key.set("param", param);
+                    fdb.archive(key, data.c_str(), data.size());
+                }
+            }
+        }
+    }
+
+    fdb.flush();
+}
+
+static FDBToolRequest visitRequest() {
+    metkit::mars::MarsRequest request("retrieve");
+    request.setValue("class", "rd");
+    request.setValue("expver", "xvis");
+    return FDBToolRequest(request);
+}
+
+static fdb5::Config visitConfig(long threads, bool ordered = true) {
+    fdb5::Config config = fdb5::Config().expandConfig();
+    config.set("visitThreads", threads);
+    config.set("visitOrdered", ordered);
+    return config;
+}
+
+/// The elements listed, with their locations, in the order they are returned
+static std::vector<std::string> list(const fdb5::Config& config) {
+    fdb5::FDB fdb(config);
+    ListIterator it = fdb.list(visitRequest());
+    std::vector<std::string> result;
+    ListElement el;
+    while (it.next(el)) {
+        std::ostringstream ss;
+        el.print(ss, true, true);
+        result.push_back(ss.str());
+    }
+    return result;
+}
+
+/// The statistics reported for each database, in the order they are returned
+static std::vector<std::string> stats(const fdb5::Config& config) {
+    fdb5::FDB fdb(config);
+    StatsIterator it = fdb.stats(visitRequest());
+    std::vector<std::string> result;
+    StatsElement el;
+    while (it.next(el)) {
+        std::ostringstream ss;
+        el.indexStatistics.report(ss);
+        el.dbStatistics.report(ss);
+        result.push_back(ss.str());
+    }
+    return result;
+}
+
+static std::vector<std::string> sorted(std::vector<std::string> v) {
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+/// Records every entry visited, with the keys at each level of the schema
+
+class RecordingVisitor : public EntryVisitor {
+
+public: // methods
+
+    RecordingVisitor(std::vector<std::string>& entries) : entries_(entries) {}
+
+    bool visitDatabase(const Catalogue& catalogue, const Store& store) override {
+        EntryVisitor::visitDatabase(catalogue, store);
+        std::ostringstream ss;
+        ss << "db " << catalogue.key();
+        entries_.push_back(ss.str());
+        return true;
+    }
+
+private: // methods
+
+    void visitDatum(const Field&, const Key& key) override {
+        ASSERT(currentCatalogue_);
+        ASSERT(currentIndex_);
+        std::ostringstream ss;
+        ss << currentCatalogue_->key() << currentIndex_->key() << key;
+        entries_.push_back(ss.str());
+    }
+
+private: // members
+
+    std::vector<std::string>& entries_;
+};
+
+/// Builds a recording visitor per database, keeping the entries of each database apart
+
+class RecordingBuilder : public EntryVisitorBuilder {
+
+public: // methods
+
+    /// n.b. the entries of each database are allocated up front, so they do not move while being written
+    RecordingBuilder(size_t count) : entries_(count), built_(0), completed_(0) {}
+
+    std::unique_ptr<EntryVisitor> build(size_t index) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ASSERT(index < entries_.size());
+        ++built_;
+        return std::unique_ptr<EntryVisitor>(new RecordingVisitor(entries_[index]));
+    }
+
+    void complete(size_t, std::exception_ptr error) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        EXPECT(!error);
+        ++completed_;
+    }
+
+    /// The entries of all of the databases, in visitation order
+    std::vector<std::string> entries() const {
+        std::vector<std::string> result;
+        for (const auto& db : entries_) {
+            result.insert(result.end(), db.begin(), db.end());
+        }
+        return result;
+    }
+
+public: // members
+
+    std::mutex mutex_;
+    std::vector<std::vector<std::string>> entries_;
+    size_t built_;
+    size_t completed_;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Databases visited concurrently give the same entries as a serial visit") {
+
+    archiveDatabases();
+
+    std::vector<std::string> serial;
+    {
+        fdb5::Config config(visitConfig(1));
+        EntryVisitMechanism mechanism(config);
+        RecordingVisitor visitor(serial);
+        mechanism.visit(visitRequest(), visitor);
+    }
+
+    // 5 databases, each with 2 indexes of 6 fields
+
+    EXPECT(serial.size() == 5 * (1 + 2 * 6));
+
+    for (long threads : {1, 2, 4, 8}) {
+
+        fdb5::Config config(visitConfig(threads));
+        EntryVisitMechanism mechanism(config);
+        EXPECT(mechanism.threads() == size_t(threads));
+
+        RecordingBuilder builder(5);
+        mechanism.visit(visitRequest(), builder);
+
+        EXPECT(builder.built_ == 5);
+        EXPECT(builder.completed_ == 5);
+        EXPECT(builder.entries() == serial);
+    }
+}
+
+CASE("Listing and statistics from concurrent visits match those of a serial visit") {
+
+    archiveDatabases();
+
+    std::vector<std::string> serialList = list(visitConfig(1));
+    std::vector<std::string> serialStats = stats(visitConfig(1));
+
+    EXPECT(serialList.size() >= 5 * 2 * 3 * 2);
+    EXPECT(serialStats.size() == 5);
+
+    for (long threads : {2, 4, 8}) {
+
+        // In order, the output is identical
+
+        EXPECT(list(visitConfig(threads, true)) == serialList);
+        EXPECT(stats(visitConfig(threads, true)) == serialStats);
+
+        // Otherwise, the same elements are returned in any order
+
+        EXPECT(sorted(list(visitConfig(threads, false))) == sorted(serialList));
+        EXPECT(sorted(stats(visitConfig(threads, false))) == sorted(serialStats));
+    }
+}
+
+CASE("An error in one database is reported by the concurrent visit") {
+
+    class FailingBuilder : public RecordingBuilder {
+    public:
+        FailingBuilder() : RecordingBuilder(5) {}
+        std::unique_ptr<EntryVisitor> build(size_t index) override {
+            if (index == 2) {
+                throw eckit::SeriousBug("Failed to build visitor", Here());
+            }
+            return RecordingBuilder::build(index);
+        }
+        void complete(size_t, std::exception_ptr) override {}
+    };
+
+    fdb5::Config config(visitConfig(4));
+    EntryVisitMechanism mechanism(config);
+
+    FailingBuilder builder;
+
+    EXPECT_THROWS_AS(mechanism.visit(visitRequest(), builder), eckit::SeriousBug);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
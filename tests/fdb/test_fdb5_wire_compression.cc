@@ -0,0 +1,157 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_wire_compression.cc
+/// @date   Oct 2026
+
+#include <sys/uio.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "eckit/io/Buffer.h"
+#include "eckit/io/ResizableBuffer.h"
+#include "eckit/log/Log.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/remote/SocketWrite.h"
+#include "fdb5/remote/WireCompression.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+using namespace fdb5::remote;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static std::string compressible(size_t length) {
+    std::string data;
+    while (data.size() < length) {
+        data += "Raining cats and dogs " + std::to_string(data.size() % 7) + " ";
+    }
+    data.resize(length);
+    return data;
+}
+
+static std::string incompressible(size_t length) {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> distribution(0, 255);
+    std::string data(length, '\0');
+    for (char& c : data) {
+        c = static_cast<char>(distribution(generator));
+    }
+    return data;
+}
+
+/// Encodes the data, given as (nearly) equal segments, and checks it decodes to the original.
+/// @returns whether the payload was compressed.
+static bool roundTrip(WireCompression& compression, const std::string& data, size_t nsegments) {
+
+    std::vector<struct iovec> segments;
+    size_t step = data.size() / nsegments;
+    for (size_t i = 0; i < nsegments; ++i) {
+        size_t end = (i + 1 == nsegments) ? data.size() : (i + 1) * step;
+        segments.push_back(ioBuffer(data.data() + i * step, end - i * step));
+    }
+
+    CompressedPayloadHeader header;
+    eckit::ResizableBuffer buffer(1);
+    compression.encode(segments, header, buffer);
+
+    // The header comes first, followed by the payload
+
+    EXPECT(!segments.empty());
+    EXPECT(segments[0].iov_base == &header);
+    EXPECT(segments[0].iov_len == sizeof(header));
+    EXPECT(header.length == data.size());
+
+    if (header.compressed) {
+        EXPECT(segments.size() == 2);
+        EXPECT(segments[1].iov_len < data.size());
+    } else {
+        EXPECT(segments.size() == nsegments + 1);
+    }
+
+    // As received on the other side of the connection
+
+    std::string wire;
+    for (const struct iovec& s : segments) {
+        wire.append(static_cast<const char*>(s.iov_base), s.iov_len);
+    }
+
+    eckit::Buffer decoded = compression.decode(wire.data(), wire.size());
+    EXPECT(decoded.size() == data.size());
+    EXPECT(std::string(static_cast<const char*>(decoded.data()), decoded.size()) == data);
+
+    return header.compressed;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Compression may be disabled") {
+
+    WireCompression compression;
+    EXPECT(!compression.enabled());
+
+    for (const std::string& name : {"", "none"}) {
+        compression.codec(name);
+        EXPECT(!compression.enabled());
+        EXPECT(compression.codec().empty());
+    }
+}
+
+CASE("Payloads round trip through each available codec") {
+
+    std::vector<std::string> codecs = WireCompression::available();
+    if (codecs.empty()) {
+        Log::info() << "No codecs suitable for the wire in this build" << std::endl;
+    }
+
+    for (const std::string& codec : codecs) {
+
+        Log::info() << "Testing codec " << codec << std::endl;
+
+        WireCompression compression;
+        compression.codec(codec);
+        EXPECT(compression.enabled());
+        EXPECT(compression.codec() == codec);
+
+        // Small payloads are sent as they are, however compressible
+
+        EXPECT(!roundTrip(compression, compressible(100), 1));
+        EXPECT(!roundTrip(compression, compressible(100), 3));
+
+        // Larger payloads are compressed, whether in one segment or gathered from several
+
+        EXPECT(roundTrip(compression, compressible(1024 * 1024), 1));
+        EXPECT(roundTrip(compression, compressible(1024 * 1024), 5));
+
+        // ... unless they do not compress
+
+        EXPECT(!roundTrip(compression, incompressible(1024 * 1024), 1));
+        EXPECT(!roundTrip(compression, incompressible(1024 * 1024), 5));
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}
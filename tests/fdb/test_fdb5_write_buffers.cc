@@ -0,0 +1,255 @@
+/*
+ * (C) Copyright 1996- ECMWF.
+ *
+ * This software is licensed under the terms of the Apache Licence Version 2.0
+ * which can be obtained at http://www.apache.org/licenses/LICENSE-2.0.
+ * In applying this licence, ECMWF does not waive the privileges and immunities
+ * granted to it by virtue of its status as an intergovernmental organisation nor
+ * does it submit to any jurisdiction.
+ */
+
+/// @file   test_fdb5_write_buffers.cc
+/// @date   Oct 2026
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eckit/filesystem/PathName.h"
+#include "eckit/io/FileHandle.h"
+#include "eckit/io/MemoryHandle.h"
+#include "eckit/runtime/Main.h"
+
+#include "fdb5/api/FDBStats.h"
+#include "fdb5/io/FDBFileHandle.h"
+#include "fdb5/io/WriteBufferPool.h"
+
+#include "eckit/testing/Test.h"
+
+using namespace eckit;
+using namespace eckit::testing;
+using namespace fdb5;
+
+namespace fdb {
+namespace test {
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static std::string contents(const PathName& path) {
+    MemoryHandle out;
+    FileHandle in(path);
+    in.saveInto(out);
+    return std::string(static_cast<const char*>(out.data()), out.size());
+}
+
+static PathName freshPath(const std::string& name) {
+    PathName path(name);
+    if (path.exists()) {
+        path.unlink();
+    }
+    return path;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+CASE("Buffers are reclaimed from the least recently used handle") {
+
+    // Room for one buffer of 16 bytes
+
+    WriteBufferPool pool(16);
+
+    PathName path1 = freshPath("write_buffers_1.data");
+    PathName path2 = freshPath("write_buffers_2.data");
+
+    FDBFileHandle h1(path1, 16, pool);
+    FDBFileHandle h2(path2, 16, pool);
+
+    h1.openForAppend(0);
+    h2.openForAppend(0);
+
+    h1.write("aaaa", 4);
+    EXPECT(pool.used() == 16);
+    EXPECT(path1.size() == Length(0));
+
+    // The buffer of h1 is written out, and given to h2
+
+    h2.write("bbbb", 4);
+    EXPECT(pool.used() == 16);
+    EXPECT(contents(path1) == "aaaa");
+    EXPECT(path2.size() == Length(0));
+
+    h1.write("cccc", 4);
+    EXPECT(contents(path2) == "bbbb");
+
+    EXPECT(h1.position() == Offset(8));
+    EXPECT(h2.position() == Offset(4));
+
+    h1.close();
+    h2.close();
+
+    EXPECT(pool.used() == 0);
+    EXPECT(contents(path1) == "aaaacccc");
+    EXPECT(contents(path2) == "bbbb");
+}
+
+CASE("The least recently written to handle gives up its buffer") {
+
+    // Room for two buffers of 16 bytes
+
+    WriteBufferPool pool(32);
+
+    PathName path1 = freshPath("write_buffers_5.data");
+    PathName path2 = freshPath("write_buffers_6.data");
+    PathName path3 = freshPath("write_buffers_7.data");
+
+    FDBFileHandle h1(path1, 16, pool);
+    FDBFileHandle h2(path2, 16, pool);
+    FDBFileHandle h3(path3, 16, pool);
+
+    h1.openForAppend(0);
+    h2.openForAppend(0);
+    h3.openForAppend(0);
+
+    h1.write("aaaa", 4);
+    h2.write("bbbb", 4);
+    h1.write("cccc", 4);
+
+    // h2 was used less recently than h1
+
+    h3.write("dddd", 4);
+    EXPECT(path1.size() == Length(0));
+    EXPECT(contents(path2) == "bbbb");
+    EXPECT(path3.size() == Length(0));
+
+    h1.close();
+    h2.close();
+    h3.close();
+
+    EXPECT(contents(path1) == "aaaacccc");
+    EXPECT(contents(path3) == "dddd");
+
+    WriteBufferPoolStats stats = pool.statistics();
+    EXPECT(stats.used_ == 0);
+    EXPECT(stats.peak_ == 32);
+    EXPECT(stats.reserved_ == 3);
+    EXPECT(stats.reclaimed_ == 1);
+    EXPECT(stats.refused_ == 0);
+}
+
+CASE("Buffers are reclaimed between handles written to from many threads") {
+
+    const size_t nthreads = 8;
+    const size_t nwrites = 2000;
+
+    // Room for fewer buffers than there are handles
+
+    WriteBufferPool pool(3 * 64);
+
+    std::vector<PathName> paths;
+    std::vector<std::unique_ptr<FDBFileHandle>> handles;
+    for (size_t i = 0; i < nthreads; ++i) {
+        paths.push_back(freshPath("write_buffers_thread_" + std::to_string(i) + ".data"));
+        handles.emplace_back(new FDBFileHandle(paths.back(), 64, pool));
+        handles.back()->openForAppend(0);
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nthreads; ++i) {
+        threads.emplace_back([&handles, i, nwrites] {
+            std::string record = "<" + std::to_string(i) + ">";
+            for (size_t n = 0; n < nwrites; ++n) {
+                handles[i]->write(record.c_str(), record.size());
+            }
+        });
+    }
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    for (size_t i = 0; i < nthreads; ++i) {
+        handles[i]->close();
+        std::string expected;
+        for (size_t n = 0; n < nwrites; ++n) {
+            expected += "<" + std::to_string(i) + ">";
+        }
+        EXPECT(contents(paths[i]) == expected);
+    }
+
+    WriteBufferPoolStats stats = pool.statistics();
+    Log::info() << "Write buffers reserved: " << stats.reserved_ << ", reclaimed: " << stats.reclaimed_
+                << ", refused: " << stats.refused_ << std::endl;
+    EXPECT(stats.used_ == 0);
+    EXPECT(stats.peak_ <= pool.budget());
+}
+
+CASE("Write buffer usage is reported with the FDB statistics") {
+
+    WriteBufferPool pool(1024);
+
+    PathName path = freshPath("write_buffers_8.data");
+    FDBFileHandle h(path, 16, pool);
+    h.openForAppend(0);
+    h.write("abcd", 4);
+
+    FDBStats stats;
+    stats.writeBuffers(pool.statistics());
+
+    std::ostringstream out;
+    stats.report(out, "");
+    EXPECT(out.str().find("write buffers reserved") != std::string::npos);
+
+    h.close();
+}
+
+CASE("Handles write unbuffered when the budget is exhausted") {
+
+    WriteBufferPool pool(8);
+
+    PathName path = freshPath("write_buffers_3.data");
+
+    FDBFileHandle h(path, 16, pool);
+    h.openForAppend(0);
+
+    h.write("abcd", 4);
+    EXPECT(pool.used() == 0);
+    EXPECT(contents(path) == "abcd");
+
+    h.close();
+}
+
+CASE("Buffered data is written out on flush, and large writes bypass the buffer") {
+
+    WriteBufferPool pool(1024);
+
+    PathName path = freshPath("write_buffers_4.data");
+
+    FDBFileHandle h(path, 8, pool);
+    h.openForAppend(0);
+
+    h.write("abc", 3);
+    EXPECT(path.size() == Length(0));
+
+    h.write("0123456789", 10);
+    EXPECT(contents(path) == "abc0123456789");
+
+    h.write("xyz", 3);
+    h.flush();
+    EXPECT(contents(path) == "abc0123456789xyz");
+    EXPECT(pool.used() == 8);
+
+    h.close();
+    EXPECT(pool.used() == 0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+}  // namespace test
+}  // namespace fdb
+
+int main(int argc, char** argv) {
+    eckit::Main::initialise(argc, argv, "FDB_HOME");
+    return run_tests(argc, argv, false);
+}